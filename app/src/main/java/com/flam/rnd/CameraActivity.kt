@@ -1,7 +1,14 @@
 package com.flam.rnd
 
+import android.content.ComponentCallbacks2
 import android.content.pm.PackageManager
+import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.Rect
+import android.graphics.RectF
+import android.graphics.drawable.BitmapDrawable
 import android.os.Bundle
+import android.os.SystemClock
 import android.util.Log
 import android.widget.Button
 import android.widget.TextView
@@ -12,8 +19,11 @@ import androidx.camera.core.*
 import androidx.camera.lifecycle.ProcessCameraProvider
 import androidx.camera.view.PreviewView
 import androidx.core.content.ContextCompat
+import java.io.File
 import java.util.concurrent.ExecutorService
 import java.util.concurrent.Executors
+import java.util.concurrent.atomic.AtomicBoolean
+import com.flam.rnd.utils.NativeLoader
 import com.flam.rnd.utils.OpenCVUtils
 import kotlin.system.measureTimeMillis
 
@@ -22,6 +32,21 @@ class CameraActivity : AppCompatActivity() {
     companion object {
         private const val TAG = "CameraActivity"
         private val REQUIRED_PERMISSIONS = arrayOf(android.Manifest.permission.CAMERA)
+
+        // Idle pooled buffers kept through a background trim, so resuming needs no large allocation
+        private const val TRIM_POOL_FLOOR_BYTES = 4L shl 20
+
+        // Opt-in native profiling for field units:
+        //   adb shell am start -n com.flam.rnd/.MainActivity --ei profile_hz 1000
+        // (MainActivity forwards it) and open the camera. Folded stacks are written to
+        // files/native_profile.folded when the camera activity closes
+        const val EXTRA_PROFILE_HZ = "profile_hz"
+
+        // Remote preview for headless units: --ei preview_port 8080 [--ez preview_lan true],
+        // then adb forward tcp:8080 tcp:8080 (or browse the device's LAN address)
+        const val EXTRA_PREVIEW_PORT = "preview_port"
+        const val EXTRA_PREVIEW_LAN = "preview_lan"
+        private const val PROFILE_FILE = "native_profile.folded"
     }
 
     // Native method declarations
@@ -46,15 +71,68 @@ class CameraActivity : AppCompatActivity() {
     private var frameCount = 0
     private var fpsStartTime = 0L
 
+    // Native session and the bitmap it presents into; both live on the analyzer thread.
+    // ivProcessed shows frontBitmap, which only the UI thread writes: the dirty rects of
+    // each presented frame are copied across there, so HWUI never uploads a half-written
+    // bitmap. presentPending is set from present until that copy is done.
+    private var sessionAddr = 0L
+    private var previewBitmap: Bitmap? = null
+    private var frontBitmap: Bitmap? = null
+    private val presentPending = AtomicBoolean(false)
+    @Volatile private var edgeMode = OpenCVUtils.EdgeMode.FULL
+    private var appliedEdgeMode: OpenCVUtils.EdgeMode? = null
+    private val dirtyRects = IntArray(4 * 64)
+
+    // Near-duplicate index and thumbnail atlas of earlier captures, owned by the analyzer thread
+    private var phashIndex = 0L
+    private var thumbnailAtlas = 0L
+    @Volatile private var captureRequested = false
+    private var profiling = false
+
+    // Time to the first camera frame, measured from onCreate (elapsedRealtime)
+    private var createdAtMs = 0L
+    private var firstFrameLogged = false
+
+    // Latest trim not yet followed by a resumed frame, and when the activity resumed
+    // (elapsedRealtime), so the cost of regrowing after a trim shows up in the log
+    @Volatile private var pendingTrim: OpenCVUtils.TrimLevel? = null
+    @Volatile private var resumedAtMs = 0L
+
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
+        createdAtMs = SystemClock.elapsedRealtime()
         setContentView(R.layout.activity_camera)
 
         initializeViews()
         setupClickListeners()
+
+        // The processing library is not loaded by MainActivity; pull it in before
+        // anything below touches OpenCVUtils
+        try {
+            val loadMs = NativeLoader.loadProcessing()
+            updateStatus("Native library loaded in ${loadMs}ms")
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "Failed to load native library", e)
+            Toast.makeText(this, "Native library unavailable: ${e.message}", Toast.LENGTH_LONG).show()
+            finish()
+            return
+        }
+        OpenCVUtils.startMetricsExporter()
+        OpenCVUtils.startTelemetry()
+        val previewPort = intent.getIntExtra(EXTRA_PREVIEW_PORT, 0)
+        if (previewPort > 0) {
+            val port = OpenCVUtils.startPreviewServer(previewPort, intent.getBooleanExtra(EXTRA_PREVIEW_LAN, false))
+            if (port > 0) updateStatus("Preview stream on port $port")
+        }
+        val profileHz = intent.getIntExtra(EXTRA_PROFILE_HZ, 0)
+        profiling = profileHz > 0 && OpenCVUtils.startProfiler(profileHz)
         
         // Initialize camera executor
         cameraExecutor = Executors.newSingleThreadExecutor()
+        cameraExecutor.execute {
+            phashIndex = OpenCVUtils.openPhashIndex(File(filesDir, "captures.phash").path)
+            thumbnailAtlas = OpenCVUtils.openAtlas(File(filesDir, "captures.atlas").path)
+        }
 
         // Check permissions and start camera
         if (allPermissionsGranted()) {
@@ -85,6 +163,11 @@ class CameraActivity : AppCompatActivity() {
             toggleImageProcessing()
         }
 
+        btnProcessing.setOnLongClickListener {
+            cycleEdgeMode()
+            true
+        }
+
         btnBack.setOnClickListener {
             finish()
         }
@@ -142,6 +225,45 @@ class CameraActivity : AppCompatActivity() {
     }
 
     private fun captureImage() {
+        // The next analyzed frame is checked against earlier captures first
+        captureRequested = true
+    }
+
+    /**
+     * Hash the frame being captured and check it against earlier captures; runs on
+     * the analyzer thread before the frame is processed.
+     * @return Id to record the capture under, or null if it nearly duplicates one
+     */
+    private fun checkCaptureDuplicate(matAddr: Long): Long? {
+        // Without a hash the capture can be neither matched nor indexed; take it anyway
+        val hash = OpenCVUtils.computePhash(matAddr)
+        if (hash != null) {
+            val duplicateOf = OpenCVUtils.findNearDuplicate(phashIndex, hash)
+            if (duplicateOf >= 0L) {
+                updateStatus("Near-duplicate of capture $duplicateOf, skipped")
+                return null
+            }
+        }
+        val captureId = System.currentTimeMillis()
+        if (hash != null) OpenCVUtils.insertPhash(phashIndex, hash, captureId)
+        return captureId
+    }
+
+    /**
+     * Thumbnail a captured frame while live processing is off. The preview session
+     * keeps temporal state, so the frame goes through a throwaway session instead.
+     */
+    private fun appendCaptureThumbnail(matAddr: Long, w: Int, h: Int, captureId: Long) {
+        val session = OpenCVUtils.createSession(w, h)
+        if (session == 0L) return
+        OpenCVUtils.setEdgeMode(session, edgeMode)
+        if (OpenCVUtils.processFrame(session, matAddr, copyEdges = true)) {
+            OpenCVUtils.appendThumbnail(thumbnailAtlas, session, matAddr, captureId)
+        }
+        OpenCVUtils.releaseSession(session)
+    }
+
+    private fun takePicture() {
         // Get a stable reference of the modifiable image capture use case
         val imageCapture = imageCapture ?: return
 
@@ -194,6 +316,12 @@ class CameraActivity : AppCompatActivity() {
         }
     }
 
+    private fun cycleEdgeMode() {
+        val modes = OpenCVUtils.EdgeMode.values()
+        edgeMode = modes[(edgeMode.ordinal + 1) % modes.size]
+        updateStatus("Edge mode: ${edgeMode.name}")
+    }
+
     private fun processImageWithNative() {
         try {
             // This is a placeholder - in a real implementation you would:
@@ -226,17 +354,129 @@ class CameraActivity : AppCompatActivity() {
         ContextCompat.checkSelfPermission(baseContext, it) == PackageManager.PERMISSION_GRANTED
     }
 
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        val trimLevel = when {
+            level >= ComponentCallbacks2.TRIM_MEMORY_MODERATE -> OpenCVUtils.TrimLevel.ALL
+            level >= ComponentCallbacks2.TRIM_MEMORY_UI_HIDDEN -> OpenCVUtils.TrimLevel.HISTORY
+            else -> OpenCVUtils.TrimLevel.SCRATCH
+        }
+        if (!::cameraExecutor.isInitialized || cameraExecutor.isShutdown) return
+        // The session belongs to the analyzer thread, so trim it there
+        cameraExecutor.execute {
+            val stats = OpenCVUtils.trimSession(sessionAddr, trimLevel, TRIM_POOL_FLOOR_BYTES) ?: return@execute
+            pendingTrim = trimLevel
+            Log.i(TAG, "Trimmed native memory (${trimLevel.name}): RSS " +
+                    "${stats.rssBeforeBytes shr 20} MB -> ${stats.rssAfterBytes shr 20} MB, " +
+                    "${stats.freedBytes shr 10} KB released")
+        }
+    }
+
+    override fun onResume() {
+        super.onResume()
+        if (pendingTrim != null) resumedAtMs = SystemClock.elapsedRealtime()
+    }
+
     override fun onDestroy() {
         super.onDestroy()
+        if (!::cameraExecutor.isInitialized) return // native library failed to load
+        OpenCVUtils.stopMetricsExporter()
+        OpenCVUtils.stopTelemetry()
+        OpenCVUtils.stopPreviewServer()
+        if (profiling) {
+            OpenCVUtils.stopProfiler()
+            OpenCVUtils.profileFolded()?.let { File(filesDir, PROFILE_FILE).writeText(it) }
+            profiling = false
+        }
+        cameraExecutor.execute {
+            OpenCVUtils.releaseSession(sessionAddr)
+            sessionAddr = 0L
+            OpenCVUtils.closePhashIndex(phashIndex)
+            phashIndex = 0L
+            OpenCVUtils.closeAtlas(thumbnailAtlas)
+            thumbnailAtlas = 0L
+        }
         cameraExecutor.shutdown()
     }
 
+    /**
+     * (Re)create the native session and preview bitmap when the frame size changes
+     */
+    private fun ensureSession(w: Int, h: Int) {
+        val bmp = previewBitmap
+        if (sessionAddr == 0L || bmp == null || bmp.width != w || bmp.height != h) {
+            OpenCVUtils.releaseSession(sessionAddr)
+            sessionAddr = OpenCVUtils.createSession(w, h)
+            previewBitmap = Bitmap.createBitmap(w, h, Bitmap.Config.ARGB_8888)
+            frontBitmap = Bitmap.createBitmap(w, h, Bitmap.Config.ARGB_8888)
+            appliedEdgeMode = null
+        }
+        if (appliedEdgeMode != edgeMode) {
+            OpenCVUtils.setEdgeMode(sessionAddr, edgeMode)
+            appliedEdgeMode = edgeMode
+        }
+    }
+
+    /**
+     * Present the session's latest edge map into the persistent preview bitmap, then hand the
+     * changed rectangles to the UI thread, which copies them into the displayed
+     * bitmap and redraws only those. A frame that arrives while the previous copy
+     * is still pending is dropped rather than written underneath it.
+     */
+    private fun presentFrame(): Boolean {
+        val back = previewBitmap ?: return false
+        val front = frontBitmap ?: return false
+        if (!presentPending.compareAndSet(false, true)) return true
+        val changed = OpenCVUtils.presentEdges(sessionAddr, back, dirtyRects)
+        if (changed <= 0) {
+            presentPending.set(false)
+            return changed == 0
+        }
+        val rects = dirtyRects.copyOf(4 * changed)
+        runOnUiThread {
+            copyDirtyRects(back, front, rects)
+            presentPending.set(false)
+        }
+        return true
+    }
+
+    /**
+     * Copy (x, y, w, h) rectangles from the analyzer's bitmap into the displayed one
+     * and invalidate the view area they map to; UI thread only.
+     */
+    private fun copyDirtyRects(back: Bitmap, front: Bitmap, rects: IntArray) {
+        val canvas = Canvas(front)
+        val rect = Rect()
+        val area = RectF()
+        val shown = (ivProcessed.drawable as? BitmapDrawable)?.bitmap === front
+        for (i in rects.indices step 4) {
+            rect.set(rects[i], rects[i + 1], rects[i] + rects[i + 2], rects[i + 1] + rects[i + 3])
+            canvas.drawBitmap(back, rect, rect, null)
+            if (shown) {
+                area.set(rect)
+                ivProcessed.imageMatrix.mapRect(area)
+                area.offset(ivProcessed.paddingLeft.toFloat(), ivProcessed.paddingTop.toFloat())
+                area.roundOut(rect)
+                @Suppress("DEPRECATION")
+                ivProcessed.invalidate(rect)
+            }
+        }
+        if (!shown) ivProcessed.setImageBitmap(front)
+    }
+
     // Image analyzer class for real-time processing
     private inner class ImageAnalyzer : ImageAnalysis.Analyzer {
         
         override fun analyze(image: ImageProxy) {
-            // Only process if real-time processing is enabled
-            if (isProcessingEnabled) {
+            if (!firstFrameLogged) {
+                firstFrameLogged = true
+                Log.i(TAG, "First camera frame ${SystemClock.elapsedRealtime() - createdAtMs}ms after onCreate " +
+                        "(processing library load ${NativeLoader.processingLoadMs}ms)")
+            }
+            val capture = captureRequested
+            captureRequested = false
+            // Only process if real-time processing is enabled or a capture is pending
+            if (isProcessingEnabled || capture) {
                 try {
                     val w = image.width
                     val h = image.height
@@ -246,22 +486,46 @@ class CameraActivity : AppCompatActivity() {
                     }
                     Log.d(TAG, "Analyzing frame: ${w}x${h}, convert ${convertMs}ms")
 
+                    // A capture is hashed on the camera frame, then thumbnailed from the
+                    // processed one, so each frame is converted and processed only once
+                    var captureId: Long? = null
+                    var takeCapture = capture
+                    if (capture && matAddr != 0L) {
+                        try {
+                            captureId = checkCaptureDuplicate(matAddr)
+                            takeCapture = captureId != null
+                        } catch (e: Exception) {
+                            Log.e(TAG, "Capture check error", e)
+                        }
+                    }
+
                     var processed = false
                     if (matAddr != 0L) {
-                        val processMs = measureTimeMillis {
-                            processed = OpenCVUtils.processImageWithOpenCV(matAddr)
-                        }
-                        Log.d(TAG, "Native processed in ${processMs}ms")
-                        if (processed) {
-                            val bmp = OpenCVUtils.matToBitmap(matAddr, w, h)
-                            if (bmp != null) {
-                                runOnUiThread {
-                                    ivProcessed.setImageBitmap(bmp)
-                                }
+                        if (isProcessingEnabled) {
+                            ensureSession(w, h)
+                            val processMs = measureTimeMillis {
+                                // Only a capture thumbnail needs the edges back in the Mat
+                                processed = OpenCVUtils.processFrame(sessionAddr, matAddr, copyEdges = captureId != null)
+                            }
+                            Log.d(TAG, "Native processed in ${processMs}ms")
+                            val trimmed = pendingTrim
+                            if (trimmed != null && resumedAtMs != 0L) {
+                                pendingTrim = null
+                                Log.i(TAG, "First frame after ${trimmed.name} trim: " +
+                                        "${SystemClock.elapsedRealtime() - resumedAtMs}ms after resume, " +
+                                        "processed in ${processMs}ms, RSS ${OpenCVUtils.residentBytes() shr 20} MB")
+                                resumedAtMs = 0L
+                            }
+                            if (processed) {
+                                presentFrame()
+                                captureId?.let { OpenCVUtils.appendThumbnail(thumbnailAtlas, sessionAddr, matAddr, it) }
                             }
+                        } else if (captureId != null) {
+                            appendCaptureThumbnail(matAddr, w, h, captureId)
                         }
                         OpenCVUtils.releaseMat(matAddr)
                     }
+                    if (takeCapture) runOnUiThread { takePicture() }
 
                     if (processed) {
                         frameCount += 1
@@ -270,7 +534,10 @@ class CameraActivity : AppCompatActivity() {
                         val elapsed = now - fpsStartTime
                         if (elapsed >= 1000L) {
                             val fps = (frameCount * 1000f) / elapsed
-                            Log.d(TAG, "AVG FPS: ${"%.1f".format(fps)} over ${elapsed}ms")
+                            val device = OpenCVUtils.telemetry(1).lastOrNull()
+                            val deviceState = if (device == null) "" else
+                                " (${"%.1f".format(device.maxTempC)}C, clocks at ${"%.0f".format(device.minFreqRatio * 100)}%)"
+                            Log.d(TAG, "AVG FPS: ${"%.1f".format(fps)} over ${elapsed}ms$deviceState")
                             runOnUiThread {
                                 tvFps.text = "FPS: ${"%.1f".format(fps)}"
                             }
@@ -4,21 +4,30 @@ import android.Manifest
 import android.content.Intent
 import android.content.pm.PackageManager
 import android.os.Bundle
+import android.os.Process
+import android.os.SystemClock
+import android.util.Log
+import android.view.ViewTreeObserver
 import android.widget.Button
 import android.widget.TextView
 import android.widget.Toast
 import androidx.activity.result.contract.ActivityResultContracts
 import androidx.appcompat.app.AppCompatActivity
 import androidx.core.content.ContextCompat
+import com.flam.rnd.utils.NativeLoader
+import com.flam.rnd.utils.OpenCVUtils
+import com.flam.rnd.utils.PipelineBenchmark
 
 class MainActivity : AppCompatActivity() {
 
     companion object {
-        // Load the native library
+        // Only the small info library is loaded at start; the processing
+        // library is loaded on demand through NativeLoader
         init {
-            System.loadLibrary("flam_rnd_native")
+            System.loadLibrary(NativeLoader.INFO_LIBRARY)
         }
 
+        private const val TAG = "MainActivity"
         private const val CAMERA_PERMISSION_REQUEST_CODE = 1001
     }
 
@@ -33,6 +42,7 @@ class MainActivity : AppCompatActivity() {
     private lateinit var tvOpenCVInfo: TextView
     private lateinit var btnCamera: Button
     private lateinit var btnTestNative: Button
+    private var fullyDrawnReported = false
 
     // Camera permission launcher
     private val requestPermissionLauncher = registerForActivityResult(
@@ -56,6 +66,29 @@ class MainActivity : AppCompatActivity() {
         initializeViews()
         setupClickListeners()
         loadNativeInfo()
+        reportFullyDrawnAfterFirstFrame()
+    }
+
+    /**
+     * Report the launch complete once the first frame, native info included, is drawn.
+     * The system logs it as "Fully drawn" (am start -W and Macrobenchmark read it too);
+     * the time since process start is logged here as well, to compare cold starts
+     */
+    private fun reportFullyDrawnAfterFirstFrame() {
+        val root = window.decorView
+        root.viewTreeObserver.addOnDrawListener(object : ViewTreeObserver.OnDrawListener {
+            override fun onDraw() {
+                if (fullyDrawnReported) return
+                fullyDrawnReported = true
+                // Draw listeners cannot be removed from inside onDraw
+                root.post {
+                    root.viewTreeObserver.removeOnDrawListener(this)
+                    reportFullyDrawn()
+                    Log.i(TAG, "Fully drawn ${SystemClock.uptimeMillis() - Process.getStartUptimeMillis()}ms " +
+                            "after process start")
+                }
+            }
+        })
     }
 
     private fun initializeViews() {
@@ -117,13 +150,17 @@ class MainActivity : AppCompatActivity() {
             // Test OpenCV version
             val openCvVersion = getOpenCVVersion()
             
-            // Test image processing (with dummy data)
+            // Test image processing (with dummy data); this pulls in the processing library
+            val loadMs = NativeLoader.loadProcessing()
             val processingResult = processImage(0L) // Passing 0 as placeholder
+            val simdCheck = OpenCVUtils.simdSelfCheck()?.lines()?.last() ?: "unavailable"
             
             val testResults = """
                 Native Test Results:
                 ├─ String from JNI: $result
                 ├─ OpenCV Version: ${if (openCvVersion > 0) formatOpenCVVersion(openCvVersion) else "Not configured"}
+                ├─ Processing Library Load: ${loadMs}ms
+                ├─ SIMD Self-Check: $simdCheck
                 └─ Image Processing Test: ${if (processingResult) "SUCCESS" else "FAILED"}
             """.trimIndent()
             
@@ -131,12 +168,55 @@ class MainActivity : AppCompatActivity() {
             
             // Update UI with test results
             tvNativeInfo.text = testResults
+
+            runPipelineBenchmark(testResults)
             
+        } catch (e: UnsatisfiedLinkError) {
+            Toast.makeText(this, "Native test failed: ${e.message}", Toast.LENGTH_LONG).show()
         } catch (e: Exception) {
             Toast.makeText(this, "Native test failed: ${e.message}", Toast.LENGTH_LONG).show()
         }
     }
 
+    /**
+     * Time every pipeline mode in the background and append the result to the test output.
+     * On a PGO-instrumented build this is also the training run that writes the profile.
+     */
+    private fun runPipelineBenchmark(testResults: String) {
+        btnTestNative.isEnabled = false
+        Thread {
+            val result = try {
+                PipelineBenchmark.run(applicationContext)
+            } catch (e: UnsatisfiedLinkError) {
+                null
+            }
+            runOnUiThread {
+                btnTestNative.isEnabled = true
+                if (result == null) {
+                    tvNativeInfo.text = "$testResults\n\nPipeline benchmark unavailable"
+                    return@runOnUiThread
+                }
+                val build = when (result.pgoMode) {
+                    1 -> "PGO instrumented"
+                    2 -> "PGO optimized"
+                    else -> "baseline"
+                }
+                val speedup = result.speedup?.let { " (${"%.2f".format(it)}x vs baseline)" } ?: ""
+                val modes = OpenCVUtils.BENCHMARK_MODES.indices.joinToString("\n") { i ->
+                    val t = i * OpenCVUtils.BENCHMARK_TRAFFIC_VALUES
+                    val traffic = result.trafficBytes
+                    "├─ ${OpenCVUtils.BENCHMARK_MODES[i]}: ${"%.1f".format(result.msPerFrame[i])} ms, " +
+                            "F ${"%.3f".format(result.edgeFScore[i])}, " +
+                            "edges ${"%.0f".format(traffic[t] / 1024)}/${"%.0f".format(traffic[t + 1] / 1024)} KiB computed, " +
+                            "present ${"%.0f".format(traffic[t + 2] / 1024)}/${"%.0f".format(traffic[t + 3] / 1024)} KiB measured"
+                }
+                tvNativeInfo.text = "$testResults\n\nPipeline Benchmark, $build, " +
+                        "${if (result.usedCorpus) "corpus" else "synthetic"}$speedup " +
+                        "(image traffic planar/RGBA per frame):\n$modes"
+            }
+        }.start()
+    }
+
     private fun checkCameraPermissionAndOpen() {
         when {
             ContextCompat.checkSelfPermission(
@@ -164,6 +244,8 @@ class MainActivity : AppCompatActivity() {
 
     private fun openCameraActivity() {
         val intent = Intent(this, CameraActivity::class.java)
+        // CameraActivity is not exported; profiling and preview extras reach it through here
+        this.intent.extras?.let { intent.putExtras(it) }
         startActivity(intent)
     }
 
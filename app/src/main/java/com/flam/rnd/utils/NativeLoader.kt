@@ -0,0 +1,43 @@
+package com.flam.rnd.utils
+
+import android.os.SystemClock
+import android.util.Log
+
+/**
+ * Loads the native libraries.
+ *
+ * The app ships two: a tiny info library that MainActivity loads at start-up, and the
+ * processing library (OpenCV, camera, kernels) that is only loaded the first time a
+ * screen actually needs it. Keeping the latter off the start-up path saves mapping and
+ * relocating several MB before the first frame is drawn.
+ */
+object NativeLoader {
+
+    private const val TAG = "NativeLoader"
+
+    const val INFO_LIBRARY = "flam_rnd_info"
+    const val PROCESSING_LIBRARY = "flam_rnd_native"
+
+    /** Time the processing library took to load in ms, or -1 while it is not loaded */
+    @Volatile var processingLoadMs = -1L
+        private set
+
+    val isProcessingLoaded: Boolean
+        get() = processingLoadMs >= 0
+
+    /**
+     * Load the processing library if it is not loaded yet.
+     * Safe to call from any thread and any number of times.
+     * @return load time in ms (of the first, actual load)
+     */
+    @Synchronized
+    fun loadProcessing(): Long {
+        if (processingLoadMs < 0) {
+            val start = SystemClock.elapsedRealtime()
+            System.loadLibrary(PROCESSING_LIBRARY)
+            processingLoadMs = SystemClock.elapsedRealtime() - start
+            Log.i(TAG, "lib$PROCESSING_LIBRARY.so loaded in ${processingLoadMs}ms")
+        }
+        return processingLoadMs
+    }
+}
@@ -2,6 +2,7 @@ package com.flam.rnd.utils
 
 import android.content.Context
 import android.graphics.Bitmap
+import android.media.Image
 import android.util.Log
 import androidx.camera.core.ImageProxy
 import kotlin.system.measureTimeMillis
@@ -14,6 +15,45 @@ import java.nio.ByteBuffer
 object OpenCVUtils {
     
     private const val TAG = "OpenCVUtils"
+
+    /** Floats per contour written by nativeFindContours (see native_lib.cpp) */
+    const val CONTOUR_RECORD_SIZE = 16
+
+    // Hamming distance (of 64 bits) under which two captures count as near-duplicates
+    const val PHASH_DUPLICATE_DISTANCE = 6
+
+    // Capture thumbnails: 128x128 gray
+    const val THUMBNAIL_SIZE = 128
+
+    // Abstract socket for the metrics exporter: socat - ABSTRACT-CONNECT:flam_rnd.metrics
+    const val METRICS_SOCKET = "@flam_rnd.metrics"
+
+    /** Pipeline configurations timed by runPipelineBenchmark, in result order (see native_lib.cpp) */
+    val BENCHMARK_MODES = listOf(
+        "full", "half-res guided", "temporal", "temporal + flow", "temporal + block motion", "full + panorama"
+    )
+
+    /** Values per mode in runPipelineBenchmark's trafficOut (kBenchmarkTrafficValues) */
+    const val BENCHMARK_TRAFFIC_VALUES = 4
+
+    // Session input formats for createSession (PixelFormat in pixel_format.h). YUV
+    // frames arrive as one CV_8UC1 Mat of height * 3 / 2 rows.
+    const val PIXEL_FORMAT_GRAY = 0
+    const val PIXEL_FORMAT_RGB = 1
+    const val PIXEL_FORMAT_RGBA = 2
+    const val PIXEL_FORMAT_BGR = 3
+    const val PIXEL_FORMAT_BGRA = 4
+    const val PIXEL_FORMAT_I420 = 6
+    const val PIXEL_FORMAT_NV12 = 7
+    const val PIXEL_FORMAT_NV21 = 8
+
+    // RAW frame packing (RawPacking in bayer.h): plane 0 of an ImageFormat.RAW10 / RAW_SENSOR Image
+    const val RAW_PACKING_RAW10 = 0
+    const val RAW_PACKING_RAW16 = 1
+
+    // Demosaic methods for rawToBitmap (DemosaicMethod in bayer.h)
+    const val DEMOSAIC_BILINEAR = 0
+    const val DEMOSAIC_EDGE_DIRECTED = 1
     
     // Native method declarations for OpenCV integration
     external fun nativeProcessImage(matAddr: Long): Boolean
@@ -30,6 +70,85 @@ object OpenCVUtils {
         uvStride: Int
     ): Long
     external fun nativeMatToRgbaBytes(matAddr: Long, outRgba: ByteArray, width: Int, height: Int): Boolean
+    external fun nativeMatToYuv420(
+        matAddr: Long,
+        yBuffer: ByteBuffer, yStride: Int,
+        uBuffer: ByteBuffer, uStride: Int,
+        vBuffer: ByteBuffer, vStride: Int,
+        chromaPixelStride: Int
+    ): Boolean
+    external fun nativeCreateSession(width: Int, height: Int, format: Int): Long
+    external fun nativeReleaseSession(sessionAddr: Long)
+    external fun nativeMatToBitmapDirty(sessionAddr: Long, matAddr: Long, bitmap: Bitmap, rectsOut: IntArray): Int
+    external fun nativeEdgesToBitmapDirty(sessionAddr: Long, bitmap: Bitmap, rectsOut: IntArray): Int
+    external fun nativeSetEdgeMode(sessionAddr: Long, mode: Int)
+    external fun nativeTrimSession(sessionAddr: Long, level: Int, poolFloorBytes: Long, statsOut: LongArray?): Boolean
+    external fun nativeResidentBytes(): Long
+    external fun nativeProcessFrame(sessionAddr: Long, matAddr: Long, copyEdges: Boolean): Boolean
+    external fun nativeSetRawParams(
+        sessionAddr: Long, pattern: Int, blackLevel: IntArray, whiteLevel: Int, gains: FloatArray, srgb: Boolean
+    ): Boolean
+    external fun nativeRawToBitmap(
+        sessionAddr: Long, buffer: ByteBuffer, rowStride: Int, width: Int, height: Int,
+        packing: Int, method: Int, bitmap: Bitmap, rectsOut: IntArray
+    ): Int
+    external fun nativeProcessRawFrame(
+        sessionAddr: Long, buffer: ByteBuffer, rowStride: Int, width: Int, height: Int, packing: Int, matAddr: Long
+    ): Boolean
+    external fun nativeThinMask(sessionAddr: Long, matAddr: Long, maxIterations: Int): Int
+    external fun nativeFindContours(sessionAddr: Long, matAddr: Long, out: FloatArray?): Int
+    external fun nativeSetFlowEnabled(sessionAddr: Long, enabled: Boolean)
+    external fun nativeGetFlow(sessionAddr: Long, out: ShortArray, sizeOut: IntArray?): Int
+    external fun nativeSetBlockMotionEnabled(sessionAddr: Long, enabled: Boolean)
+    external fun nativeGetBlockMotion(sessionAddr: Long, out: IntArray, sizeOut: IntArray?): Int
+    external fun nativeSetPanoramaEnabled(sessionAddr: Long, enabled: Boolean)
+    external fun nativeRenderPanorama(sessionAddr: Long, matAddr: Long, edges: Boolean): Boolean
+    external fun nativeFuseExposures(sessionAddr: Long, matAddrs: LongArray, dstAddr: Long): Boolean
+    external fun nativeComputePhash(matAddr: Long, out: LongArray): Boolean
+    external fun nativeOpenPhashIndex(path: String): Long
+    external fun nativeClosePhashIndex(indexAddr: Long)
+    external fun nativePhashFindNear(indexAddr: Long, hash: Long, maxDistance: Int): Long
+    external fun nativePhashInsert(indexAddr: Long, hash: Long, id: Long): Boolean
+    external fun nativeOpenAtlas(path: String, width: Int, height: Int, channels: Int): Long
+    external fun nativeCloseAtlas(atlasAddr: Long)
+    external fun nativeAtlasAppend(atlasAddr: Long, sessionAddr: Long, matAddr: Long, id: Long): Int
+    external fun nativeAtlasCount(atlasAddr: Long): Int
+    external fun nativeAtlasFind(atlasAddr: Long, id: Long): Int
+    external fun nativeAtlasSlice(atlasAddr: Long, index: Int): ByteBuffer?
+    external fun nativeAtlasToBitmap(atlasAddr: Long, index: Int, bitmap: Bitmap): Boolean
+    external fun nativeStartCameraSource(sessionAddr: Long, cameraId: String?, width: Int, height: Int): Long
+    external fun nativeStartSyntheticSource(sessionAddr: Long, width: Int, height: Int, fps: Double): Long
+    external fun nativeStartFileSource(
+        sessionAddr: Long, path: String, format: Int,
+        width: Int, height: Int, fps: Double, loop: Boolean
+    ): Long
+    external fun nativeStopFrameSource(sourceAddr: Long)
+    external fun nativePresentSourceFrame(sourceAddr: Long, bitmap: Bitmap, rectsOut: IntArray): Int
+    external fun nativeRunPipelineBenchmark(
+        width: Int,
+        height: Int,
+        frames: Int,
+        corpusPath: String?,
+        format: Int,
+        profileDir: String?,
+        msOut: DoubleArray,
+        fScoreOut: DoubleArray?,
+        trafficOut: DoubleArray?
+    ): Boolean
+    external fun nativePgoMode(): Int
+    external fun nativeSimdSelfCheck(): String?
+    external fun nativeImageQuality(matAddr: Long, referenceAddr: Long, out: DoubleArray): Boolean
+    external fun nativeEdgeScore(edgesAddr: Long, referenceAddr: Long, tolerance: Int, out: DoubleArray): Boolean
+    external fun nativeStartMetricsExporter(address: String): Boolean
+    external fun nativeStopMetricsExporter()
+    external fun nativeStartPreviewServer(port: Int, lan: Boolean, maxFps: Int, maxKbps: Int, quality: Int): Int
+    external fun nativeStopPreviewServer()
+    external fun nativeStartTelemetry(periodMs: Int): Boolean
+    external fun nativeStopTelemetry()
+    external fun nativeGetTelemetry(out: DoubleArray): Int
+    external fun nativeStartProfiler(hz: Int): Boolean
+    external fun nativeStopProfiler()
+    external fun nativeProfileFolded(): String?
     
     /**
      * Initialize OpenCV library
@@ -144,7 +263,725 @@ object OpenCVUtils {
             null
         }
     }
+
+    /**
+     * Convert a gray or RGBA Mat into a YUV_420_888 Image (e.g. MediaCodec.getInputImage) of the
+     * same size, BT.601 limited range. The image's chroma must be planar (I420) or NV12
+     * @return true if the image was filled
+     */
+    fun matToYuvImage(matAddr: Long, image: Image): Boolean {
+        if (matAddr == 0L || image.planes.size < 3) return false
+        val (y, u, v) = image.planes
+        return try {
+            nativeMatToYuv420(
+                matAddr,
+                y.buffer, y.rowStride,
+                u.buffer, u.rowStride,
+                v.buffer, v.rowStride,
+                u.pixelStride
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "matToYuvImage failed: ${e.message}", e)
+            false
+        }
+    }
     
+    /**
+     * Create a native processing session holding per-stream state between frames
+     * @param format Layout of the Mats passed to processFrame, one of PIXEL_FORMAT_*
+     * @return Session address or 0 if creation failed
+     */
+    fun createSession(width: Int, height: Int, format: Int = PIXEL_FORMAT_RGBA): Long {
+        return try {
+            nativeCreateSession(width, height, format)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error creating session: ${e.message}", e)
+            0L
+        }
+    }
+
+    /**
+     * Release a native processing session
+     */
+    fun releaseSession(sessionAddr: Long) {
+        if (sessionAddr != 0L) {
+            try {
+                nativeReleaseSession(sessionAddr)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error releasing session: ${e.message}", e)
+            }
+        }
+    }
+
+    /**
+     * Present a processed Mat into a persistent ARGB_8888 bitmap, rewriting only changed tiles
+     * @param rectsOut Receives changed rectangles as (x, y, w, h) quadruples
+     * @return Number of changed rectangles (0 if the frame is unchanged), or -1 on failure
+     */
+    fun updateBitmapDirty(sessionAddr: Long, matAddr: Long, bitmap: Bitmap, rectsOut: IntArray): Int {
+        if (sessionAddr == 0L || matAddr == 0L) return -1
+        return try {
+            nativeMatToBitmapDirty(sessionAddr, matAddr, bitmap, rectsOut)
+        } catch (e: Exception) {
+            Log.e(TAG, "updateBitmapDirty failed: ${e.message}", e)
+            -1
+        }
+    }
+
+    /**
+     * Like updateBitmapDirty for the edge map of the session's latest processFrame,
+     * presented from native memory without a Mat
+     * @return Number of changed rectangles (0 if the frame is unchanged), or -1 on failure
+     */
+    fun presentEdges(sessionAddr: Long, bitmap: Bitmap, rectsOut: IntArray): Int {
+        if (sessionAddr == 0L) return -1
+        return try {
+            nativeEdgesToBitmapDirty(sessionAddr, bitmap, rectsOut)
+        } catch (e: Exception) {
+            Log.e(TAG, "presentEdges failed: ${e.message}", e)
+            -1
+        }
+    }
+
+    /**
+     * Select the edge pipeline a session runs in processFrame
+     */
+    fun setEdgeMode(sessionAddr: Long, mode: EdgeMode) {
+        if (sessionAddr != 0L) {
+            nativeSetEdgeMode(sessionAddr, mode.nativeValue)
+        }
+    }
+
+    /**
+     * Release session memory under memory pressure. Parameters and LUTs are kept and the
+     * next processed frame re-warms the buffer pool, so streaming resumes at full speed
+     * within a frame or two. Call on the thread that processes the session's frames.
+     * @param poolFloorBytes Idle pooled buffers kept up to this many bytes
+     * @return Resident memory before and after, or null on failure
+     */
+    fun trimSession(sessionAddr: Long, level: TrimLevel, poolFloorBytes: Long = 0L): TrimStats? {
+        if (sessionAddr == 0L) return null
+        return try {
+            val stats = LongArray(3)
+            if (nativeTrimSession(sessionAddr, level.nativeValue, poolFloorBytes, stats)) {
+                TrimStats(stats[0], stats[1], stats[2])
+            } else {
+                null
+            }
+        } catch (e: Exception) {
+            Log.e(TAG, "Error trimming session: ${e.message}", e)
+            null
+        }
+    }
+
+    /**
+     * Resident set size of the process in bytes, 0 if unknown
+     */
+    fun residentBytes(): Long = try {
+        nativeResidentBytes()
+    } catch (e: Exception) {
+        Log.e(TAG, "Error reading RSS: ${e.message}", e)
+        0L
+    }
+
+    /**
+     * Run the session's edge pipeline on a Mat in the session's input format
+     * (RGBA unless createSession said otherwise). The edge map stays in the
+     * session for presentEdges
+     * @param copyEdges Also replace the Mat by the single-channel edge map
+     * @return true if processing was successful
+     */
+    fun processFrame(sessionAddr: Long, matAddr: Long, copyEdges: Boolean = false): Boolean {
+        if (sessionAddr == 0L || matAddr == 0L) return false
+        return try {
+            nativeProcessFrame(sessionAddr, matAddr, copyEdges)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error processing frame: ${e.message}", e)
+            false
+        }
+    }
+
+    /**
+     * Set the sensor parameters RAW frames are decoded with; they persist in the session
+     * @param pattern SENSOR_INFO_COLOR_FILTER_ARRANGEMENT (RGGB 0, GRBG 1, GBRG 2, BGGR 3)
+     * @param blackLevel SENSOR_BLACK_LEVEL_PATTERN, 4 values in raster order
+     * @param whiteLevel SENSOR_INFO_WHITE_LEVEL
+     * @param gains COLOR_CORRECTION_GAINS: R, G even, G odd, B
+     * @param srgb Apply the sRGB transfer curve; false keeps the 8-bit output linear
+     * @return true if the parameters were accepted
+     */
+    fun setRawParams(
+        sessionAddr: Long,
+        pattern: Int,
+        blackLevel: IntArray,
+        whiteLevel: Int,
+        gains: FloatArray,
+        srgb: Boolean = true
+    ): Boolean {
+        if (sessionAddr == 0L) return false
+        return try {
+            nativeSetRawParams(sessionAddr, pattern, blackLevel, whiteLevel, gains, srgb)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error setting RAW parameters: ${e.message}", e)
+            false
+        }
+    }
+
+    /**
+     * Demosaic a RAW frame (direct buffer, RAW_PACKING_*) and present it into the bitmap
+     * like updateBitmapDirty
+     * @param method DEMOSAIC_BILINEAR for preview, DEMOSAIC_EDGE_DIRECTED for stills
+     * @return Number of dirty rectangles, or -1 on error
+     */
+    fun rawToBitmap(
+        sessionAddr: Long,
+        buffer: ByteBuffer,
+        rowStride: Int,
+        width: Int,
+        height: Int,
+        packing: Int,
+        method: Int,
+        bitmap: Bitmap,
+        rectsOut: IntArray
+    ): Int {
+        if (sessionAddr == 0L) return -1
+        return try {
+            nativeRawToBitmap(sessionAddr, buffer, rowStride, width, height, packing, method, bitmap, rectsOut)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error presenting RAW frame: ${e.message}", e)
+            -1
+        }
+    }
+
+    /**
+     * Run the session's edge pipeline on a RAW frame, taking luma straight from the
+     * mosaic without demosaicing; the edge map is written to the Mat as by processFrame
+     * @return true if processing was successful
+     */
+    fun processRawFrame(
+        sessionAddr: Long,
+        buffer: ByteBuffer,
+        rowStride: Int,
+        width: Int,
+        height: Int,
+        packing: Int,
+        matAddr: Long
+    ): Boolean {
+        if (sessionAddr == 0L || matAddr == 0L) return false
+        return try {
+            nativeProcessRawFrame(sessionAddr, buffer, rowStride, width, height, packing, matAddr)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error processing RAW frame: ${e.message}", e)
+            false
+        }
+    }
+
+    /**
+     * Thin a binary mask (gray or gray-in-RGBA Mat) to one-pixel-wide skeletons in place
+     * @param maxIterations Upper bound on thinning iterations (0 = native default)
+     * @return Iterations run, or -1 on failure
+     */
+    fun thinMask(sessionAddr: Long, matAddr: Long, maxIterations: Int = 0): Int {
+        if (sessionAddr == 0L || matAddr == 0L) return -1
+        return try {
+            nativeThinMask(sessionAddr, matAddr, maxIterations)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error thinning mask: ${e.message}", e)
+            -1
+        }
+    }
+
+    /**
+     * Trace contours (with hierarchy and shape descriptors) of a binary mask Mat
+     * @param out Receives CONTOUR_RECORD_SIZE floats per contour: parent, isHole, area,
+     *            perimeter, bbox x/y/w/h, centroid x/y, min-area rect cx/cy/w/h/angle, hull size
+     * @return Total number of contours found (may exceed what fits in out), or -1 on failure
+     */
+    fun findContours(sessionAddr: Long, matAddr: Long, out: FloatArray?): Int {
+        if (sessionAddr == 0L || matAddr == 0L) return -1
+        return try {
+            nativeFindContours(sessionAddr, matAddr, out)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error finding contours: ${e.message}", e)
+            -1
+        }
+    }
+
+    /**
+     * Enable dense optical flow estimation in processFrame (1/4 resolution field)
+     */
+    fun setFlowEnabled(sessionAddr: Long, enabled: Boolean) {
+        if (sessionAddr != 0L) {
+            nativeSetFlowEnabled(sessionAddr, enabled)
+        }
+    }
+
+    /**
+     * Copy the latest flow field as (dx, dy) pairs in 1/16 full-resolution pixels
+     * @param sizeOut Receives the field's width and height
+     * @return Number of vectors copied, 0 if no field is available
+     */
+    fun getFlow(sessionAddr: Long, out: ShortArray, sizeOut: IntArray? = null): Int {
+        if (sessionAddr == 0L) return 0
+        return try {
+            nativeGetFlow(sessionAddr, out, sizeOut)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading flow: ${e.message}", e)
+            0
+        }
+    }
+
+    /**
+     * Enable 16x16 block motion vectors in processFrame
+     */
+    fun setBlockMotionEnabled(sessionAddr: Long, enabled: Boolean) {
+        if (sessionAddr != 0L) {
+            nativeSetBlockMotionEnabled(sessionAddr, enabled)
+        }
+    }
+
+    /**
+     * Copy the latest block motion field, one packed int per block in row order;
+     * decode with blockDx / blockDy / blockSad
+     * @param sizeOut Receives the field's width and height in blocks
+     * @return Number of blocks copied, 0 if no field is available
+     */
+    fun getBlockMotion(sessionAddr: Long, out: IntArray, sizeOut: IntArray? = null): Int {
+        if (sessionAddr == 0L) return 0
+        return try {
+            nativeGetBlockMotion(sessionAddr, out, sizeOut)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading block motion: ${e.message}", e)
+            0
+        }
+    }
+
+    /** Horizontal offset into the previous frame of a packed block vector */
+    fun blockDx(packed: Int): Int = (packed shl 24) shr 24
+
+    /** Vertical offset into the previous frame of a packed block vector */
+    fun blockDy(packed: Int): Int = (packed shl 16) shr 24
+
+    /** Residual SAD of a packed block vector */
+    fun blockSad(packed: Int): Int = packed ushr 16
+
+    /**
+     * Start (true) or stop (false) stitching processed frames into a panorama;
+     * starting discards the previous mosaic
+     */
+    fun setPanoramaEnabled(sessionAddr: Long, enabled: Boolean) {
+        if (sessionAddr != 0L) {
+            nativeSetPanoramaEnabled(sessionAddr, enabled)
+        }
+    }
+
+    /**
+     * Render the current panorama into a gray Mat, as edges by default
+     * @param matAddr Destination Mat address; it is reallocated to the mosaic size
+     * @return true if a mosaic was rendered
+     */
+    fun renderPanorama(sessionAddr: Long, matAddr: Long, edges: Boolean = true): Boolean {
+        if (sessionAddr == 0L || matAddr == 0L) return false
+        return try {
+            nativeRenderPanorama(sessionAddr, matAddr, edges)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error rendering panorama: ${e.message}", e)
+            false
+        }
+    }
+
+    /**
+     * Fuse an exposure bracket (2 to 5 gray or RGBA Mats of one size) into one
+     * 8-bit gray Mat
+     * @return true on success
+     */
+    fun fuseExposures(sessionAddr: Long, matAddrs: LongArray, dstAddr: Long): Boolean {
+        if (sessionAddr == 0L || dstAddr == 0L) return false
+        return try {
+            nativeFuseExposures(sessionAddr, matAddrs, dstAddr)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error fusing exposures: ${e.message}", e)
+            false
+        }
+    }
+
+    /**
+     * Compute the 64-bit perceptual hash of a gray or RGBA Mat
+     * @return The hash (any value, 0 included), or null if it could not be computed
+     */
+    fun computePhash(matAddr: Long): Long? {
+        if (matAddr == 0L) return null
+        val out = LongArray(1)
+        return try {
+            if (nativeComputePhash(matAddr, out)) out[0] else null
+        } catch (e: Exception) {
+            Log.e(TAG, "Error computing pHash: ${e.message}", e)
+            null
+        }
+    }
+
+    /**
+     * Open (or create) the persistent near-duplicate index at the given path
+     * @return Index handle or 0 on failure
+     */
+    fun openPhashIndex(path: String): Long {
+        return try {
+            nativeOpenPhashIndex(path)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error opening pHash index: ${e.message}", e)
+            0L
+        }
+    }
+
+    fun closePhashIndex(indexAddr: Long) {
+        if (indexAddr != 0L) {
+            nativeClosePhashIndex(indexAddr)
+        }
+    }
+
+    /**
+     * Look up a near-duplicate of the hash
+     * @return Id of the closest indexed capture within maxDistance, or -1
+     */
+    fun findNearDuplicate(indexAddr: Long, hash: Long, maxDistance: Int = PHASH_DUPLICATE_DISTANCE): Long {
+        if (indexAddr == 0L) return -1L
+        return nativePhashFindNear(indexAddr, hash, maxDistance)
+    }
+
+    fun insertPhash(indexAddr: Long, hash: Long, id: Long): Boolean {
+        if (indexAddr == 0L) return false
+        return nativePhashInsert(indexAddr, hash, id)
+    }
+
+    /**
+     * Open (or create) a memory-mapped thumbnail atlas
+     * @param channels 1 for gray, 4 for RGBA
+     * @return Atlas handle or 0 on failure (including a format mismatch)
+     */
+    fun openAtlas(path: String, width: Int = THUMBNAIL_SIZE, height: Int = THUMBNAIL_SIZE, channels: Int = 1): Long {
+        return try {
+            nativeOpenAtlas(path, width, height, channels)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error opening thumbnail atlas: ${e.message}", e)
+            0L
+        }
+    }
+
+    fun closeAtlas(atlasAddr: Long) {
+        if (atlasAddr != 0L) {
+            nativeCloseAtlas(atlasAddr)
+        }
+    }
+
+    /**
+     * Append a thumbnail of a gray or RGBA Mat under the given id
+     * @return Thumbnail index or -1
+     */
+    fun appendThumbnail(atlasAddr: Long, sessionAddr: Long, matAddr: Long, id: Long): Int {
+        if (atlasAddr == 0L || sessionAddr == 0L || matAddr == 0L) return -1
+        return nativeAtlasAppend(atlasAddr, sessionAddr, matAddr, id)
+    }
+
+    fun thumbnailCount(atlasAddr: Long): Int =
+        if (atlasAddr != 0L) nativeAtlasCount(atlasAddr) else 0
+
+    fun findThumbnail(atlasAddr: Long, id: Long): Int =
+        if (atlasAddr != 0L) nativeAtlasFind(atlasAddr, id) else -1
+
+    /**
+     * Read-only view of a thumbnail's pixels in the mapped atlas; do not use
+     * it after closeAtlas
+     */
+    fun thumbnailSlice(atlasAddr: Long, index: Int): ByteBuffer? =
+        if (atlasAddr != 0L) nativeAtlasSlice(atlasAddr, index)?.asReadOnlyBuffer() else null
+
+    /**
+     * Copy a thumbnail into an ARGB_8888 bitmap of the atlas size, without decoding
+     */
+    fun thumbnailToBitmap(atlasAddr: Long, index: Int, bitmap: Bitmap): Boolean {
+        if (atlasAddr == 0L) return false
+        return try {
+            nativeAtlasToBitmap(atlasAddr, index, bitmap)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading thumbnail: ${e.message}", e)
+            false
+        }
+    }
+
+    /**
+     * Stream frames from the camera straight into the session through an
+     * AImageReader, bypassing CameraX; the camera must not be bound elsewhere
+     * @param cameraId Camera to open, or null for the first back camera
+     * @return Source handle or 0 on failure
+     */
+    fun startCameraSource(sessionAddr: Long, width: Int, height: Int, cameraId: String? = null): Long {
+        if (sessionAddr == 0L) return 0L
+        return try {
+            nativeStartCameraSource(sessionAddr, cameraId, width, height)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error starting camera source: ${e.message}", e)
+            0L
+        }
+    }
+
+    /**
+     * Stream a moving synthetic test pattern into the session
+     */
+    fun startSyntheticSource(sessionAddr: Long, width: Int, height: Int, fps: Double = 30.0): Long {
+        if (sessionAddr == 0L) return 0L
+        return nativeStartSyntheticSource(sessionAddr, width, height, fps)
+    }
+
+    /**
+     * Replay raw frames from a file into the session
+     * @param fps Playback rate; 0 runs as fast as the pipeline allows
+     */
+    fun startFileSource(
+        sessionAddr: Long, path: String, format: RawFormat,
+        width: Int, height: Int, fps: Double = 0.0, loop: Boolean = false
+    ): Long {
+        if (sessionAddr == 0L) return 0L
+        return nativeStartFileSource(sessionAddr, path, format.nativeValue, width, height, fps, loop)
+    }
+
+    /**
+     * Stop a native frame source; the session can be used by processFrame again afterwards
+     */
+    fun stopFrameSource(sourceAddr: Long) {
+        if (sourceAddr != 0L) {
+            nativeStopFrameSource(sourceAddr)
+        }
+    }
+
+    /**
+     * Present the newest frame processed from a native source into the bitmap
+     * @return Number of dirty rectangles, 0 if there was no new frame, -1 on error
+     */
+    fun presentSourceFrame(sourceAddr: Long, bitmap: Bitmap, rectsOut: IntArray): Int {
+        if (sourceAddr == 0L) return -1
+        return try {
+            nativePresentSourceFrame(sourceAddr, bitmap, rectsOut)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error presenting source frame: ${e.message}", e)
+            -1
+        }
+    }
+
+    /**
+     * Replay frames through every pipeline configuration in BENCHMARK_MODES
+     * @param corpus Raw recorded frames (looped as needed); null uses the synthetic pattern
+     * @param profileDir Where an instrumented (PGO generate) build writes its profile
+     * @param fScoreOut Receives each mode's mean edge F-score against exact Canny (1-pixel tolerance)
+     * @param trafficOut Receives BENCHMARK_TRAFFIC_VALUES mean bytes per frame for each mode:
+     *                   edge output size (computed) and present traffic (measured), each
+     *                   planar then RGBA
+     * @return Mean native ms per frame for each mode (-1 where it could not run), or null on failure
+     */
+    fun runPipelineBenchmark(
+        width: Int,
+        height: Int,
+        frames: Int,
+        corpus: String? = null,
+        format: RawFormat = RawFormat.GRAY8,
+        profileDir: String? = null,
+        fScoreOut: DoubleArray? = null,
+        trafficOut: DoubleArray? = null
+    ): DoubleArray? {
+        return try {
+            val ms = DoubleArray(BENCHMARK_MODES.size)
+            if (nativeRunPipelineBenchmark(
+                    width, height, frames, corpus, format.nativeValue, profileDir, ms, fScoreOut, trafficOut
+                )) ms else null
+        } catch (e: Exception) {
+            Log.e(TAG, "Error running pipeline benchmark: ${e.message}", e)
+            null
+        }
+    }
+
+    /**
+     * PSNR (dB, infinite when identical) and SSIM of a gray or RGBA Mat against a reference, on luma
+     * @return {psnr, ssim}, or null on failure
+     */
+    fun imageQuality(matAddr: Long, referenceAddr: Long): DoubleArray? {
+        if (matAddr == 0L || referenceAddr == 0L) return null
+        return try {
+            val out = DoubleArray(2)
+            if (nativeImageQuality(matAddr, referenceAddr, out)) out else null
+        } catch (e: Exception) {
+            Log.e(TAG, "Error computing image quality: ${e.message}", e)
+            null
+        }
+    }
+
+    /**
+     * Precision, recall and F-score of an edge map against a reference edge map, counting
+     * edges within `tolerance` pixels as matching
+     * @return {precision, recall, fScore}, or null on failure
+     */
+    fun edgeScore(edgesAddr: Long, referenceAddr: Long, tolerance: Int = 1): DoubleArray? {
+        if (edgesAddr == 0L || referenceAddr == 0L) return null
+        return try {
+            val out = DoubleArray(3)
+            if (nativeEdgeScore(edgesAddr, referenceAddr, tolerance, out)) out else null
+        } catch (e: Exception) {
+            Log.e(TAG, "Error scoring edges: ${e.message}", e)
+            null
+        }
+    }
+
+    /**
+     * Serve native pipeline metrics (Prometheus text format) on a local socket
+     * @param address Socket path, or "@name" for an abstract socket
+     * @return true if the exporter is listening on `address`
+     */
+    fun startMetricsExporter(address: String = METRICS_SOCKET): Boolean {
+        return try {
+            nativeStartMetricsExporter(address)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error starting metrics exporter: ${e.message}", e)
+            false
+        }
+    }
+
+    fun stopMetricsExporter() {
+        try {
+            nativeStopMetricsExporter()
+        } catch (e: Exception) {
+            Log.e(TAG, "Error stopping metrics exporter: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Stream processed frames as MJPEG over HTTP (http://host:port/, or /snapshot.jpg).
+     * Viewers may lower their own caps with ?fps=N&kbps=N
+     * @param lan Listen on all interfaces instead of localhost only
+     * @param maxKbps Bitrate cap per viewer
+     * @return The port listened on, or 0 on failure
+     */
+    fun startPreviewServer(
+        port: Int = 8080,
+        lan: Boolean = false,
+        maxFps: Int = 10,
+        maxKbps: Int = 4000,
+        quality: Int = 70
+    ): Int {
+        return try {
+            nativeStartPreviewServer(port, lan, maxFps, maxKbps, quality)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error starting preview server: ${e.message}", e)
+            0
+        }
+    }
+
+    fun stopPreviewServer() {
+        try {
+            nativeStopPreviewServer()
+        } catch (e: Exception) {
+            Log.e(TAG, "Error stopping preview server: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Start sampling thermal zones and CPU clocks alongside pipeline throughput; exported as
+     * metrics and kept as recent history (see telemetry)
+     */
+    fun startTelemetry(periodMs: Int = 1000): Boolean {
+        return try {
+            nativeStartTelemetry(periodMs)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error starting telemetry: ${e.message}", e)
+            false
+        }
+    }
+
+    fun stopTelemetry() {
+        try {
+            nativeStopTelemetry()
+        } catch (e: Exception) {
+            Log.e(TAG, "Error stopping telemetry: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Up to `max` most recent telemetry samples, oldest first
+     */
+    fun telemetry(max: Int = 60): List<TelemetrySample> {
+        return try {
+            val values = DoubleArray(max * 5)
+            val count = nativeGetTelemetry(values)
+            List(count) { i ->
+                TelemetrySample(
+                    timestampNs = values[i * 5].toLong(),
+                    maxTempC = values[i * 5 + 1],
+                    minFreqRatio = values[i * 5 + 2],
+                    fps = values[i * 5 + 3],
+                    meanFrameMs = values[i * 5 + 4]
+                )
+            }
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading telemetry: ${e.message}", e)
+            emptyList()
+        }
+    }
+
+    /**
+     * Start sampling the native pipeline threads (analyzer, frame sources, band workers)
+     * @param hz Samples per CPU-second of each thread, at most 1000
+     * @return true if the profiler is running
+     */
+    fun startProfiler(hz: Int = 1000): Boolean {
+        return try {
+            nativeStartProfiler(hz)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error starting profiler: ${e.message}", e)
+            false
+        }
+    }
+
+    fun stopProfiler() {
+        try {
+            nativeStopProfiler()
+        } catch (e: Exception) {
+            Log.e(TAG, "Error stopping profiler: ${e.message}", e)
+        }
+    }
+
+    /**
+     * The profile collected since the last startProfiler, as folded stacks
+     * ("thread;outer;...;inner count" per line) for flamegraph.pl or speedscope
+     */
+    fun profileFolded(): String? {
+        return try {
+            nativeProfileFolded()
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading profile: ${e.message}", e)
+            null
+        }
+    }
+
+    /**
+     * How the processing library was built: 0 plain, 1 PGO-instrumented, 2 PGO-optimized
+     */
+    fun pgoMode(): Int = try {
+        nativePgoMode()
+    } catch (e: UnsatisfiedLinkError) {
+        0
+    }
+
+    /**
+     * Runs every SIMD operation and vector kernel against its scalar fallback
+     * on random inputs. Returns one line per mismatch followed by a summary
+     * line, or null if the check could not run.
+     */
+    fun simdSelfCheck(): String? {
+        return try {
+            nativeSimdSelfCheck()
+        } catch (e: Exception) {
+            Log.e(TAG, "Error running SIMD self-check: ${e.message}", e)
+            null
+        }
+    }
+
     /**
      * Process image using OpenCV native functions
      * @param matAddr OpenCV Mat address
@@ -258,6 +1095,56 @@ object OpenCVUtils {
         }
     }
     
+    /**
+     * Edge pipeline variants; values match the native EdgeMode enum
+     */
+    enum class EdgeMode(val nativeValue: Int) {
+        FULL(0),
+        HALF_RES_GUIDED(1),
+        TEMPORAL(2)
+    }
+
+    /**
+     * Layouts of raw frame files for the file-backed native source
+     */
+    enum class RawFormat(val nativeValue: Int) {
+        GRAY8(0),
+        I420(1),
+        NV12(2)
+    }
+
+    /**
+     * How much a session releases in trimSession; each level includes the previous ones.
+     * Values match the native TrimLevel enum.
+     */
+    enum class TrimLevel(val nativeValue: Int) {
+        SCRATCH(0),   // per-frame scratch and pooled buffers above the floor
+        HISTORY(1),   // also inter-frame state (temporal edges, pyramids, motion)
+        ALL(2)        // also the panorama mosaic (HISTORY while one is being captured); the pool floor is ignored
+    }
+
+    /**
+     * Resident memory around a trimSession call, and what the session itself freed
+     */
+    data class TrimStats(
+        val rssBeforeBytes: Long,
+        val rssAfterBytes: Long,
+        val freedBytes: Long
+    )
+
+    /**
+     * One telemetry period: device state and pipeline throughput over the same window.
+     * Temperature and frequency ratio are NaN where the device does not expose them;
+     * a frequency ratio well below 1 under load means the clocks are being capped
+     */
+    data class TelemetrySample(
+        val timestampNs: Long,
+        val maxTempC: Double,
+        val minFreqRatio: Double,
+        val fps: Double,
+        val meanFrameMs: Double
+    )
+
     /**
      * Enum for different image processing operations
      */
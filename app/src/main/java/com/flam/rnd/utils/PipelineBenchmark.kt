@@ -0,0 +1,99 @@
+package com.flam.rnd.utils
+
+import android.content.Context
+import android.util.Log
+import java.io.File
+import kotlin.math.exp
+import kotlin.math.ln
+
+/**
+ * Pipeline benchmark and PGO training run.
+ *
+ * Replays the recorded-frame corpus (files/replay_640x480.gray, raw 8-bit frames pushed with
+ * adb) or, without one, the synthetic pattern through every pipeline mode. Timings from a
+ * plain build are kept as the baseline, so running the same benchmark on a PGO-optimized
+ * build reports its speedup. Each mode is also scored against the exact Canny path, so faster
+ * approximations report what they cost in edge accuracy, and each mode's per-stage image
+ * traffic is reported for the planar layout and for an RGBA one. An instrumented build also
+ * writes its profile next to the corpus.
+ */
+object PipelineBenchmark {
+
+    private const val TAG = "PipelineBenchmark"
+    private const val PREFS = "pipeline_benchmark"
+
+    const val WIDTH = 640
+    const val HEIGHT = 480
+    const val FRAMES = 120
+    const val CORPUS_FILE = "replay_640x480.gray"
+
+    /**
+     * @param msPerFrame Mean native ms per frame, per OpenCVUtils.BENCHMARK_MODES entry
+     * @param edgeFScore Mean edge F-score against exact Canny, per mode (1 = identical)
+     * @param trafficBytes Mean bytes per frame, OpenCVUtils.BENCHMARK_TRAFFIC_VALUES per mode:
+     *                     edge output planar / RGBA (computed from the image sizes), then
+     *                     present planar / RGBA (measured)
+     * @param speedup Baseline / PGO time (geometric mean over modes) on an optimized build
+     *                with a stored baseline, else null
+     */
+    data class Result(
+        val pgoMode: Int,
+        val usedCorpus: Boolean,
+        val msPerFrame: DoubleArray,
+        val edgeFScore: DoubleArray,
+        val trafficBytes: DoubleArray,
+        val speedup: Double?
+    )
+
+    /**
+     * Run the benchmark; blocks for a few seconds, so call it off the main thread.
+     * Loads the processing library if needed.
+     */
+    fun run(context: Context): Result? {
+        NativeLoader.loadProcessing()
+        val corpus = File(context.filesDir, CORPUS_FILE).takeIf { it.isFile }
+        val pgoMode = OpenCVUtils.pgoMode()
+        val fScore = DoubleArray(OpenCVUtils.BENCHMARK_MODES.size)
+        val traffic = DoubleArray(OpenCVUtils.BENCHMARK_MODES.size * OpenCVUtils.BENCHMARK_TRAFFIC_VALUES)
+        val ms = OpenCVUtils.runPipelineBenchmark(
+            WIDTH, HEIGHT, FRAMES,
+            corpus = corpus?.path,
+            format = OpenCVUtils.RawFormat.GRAY8,
+            profileDir = context.filesDir.path,
+            fScoreOut = fScore,
+            trafficOut = traffic
+        ) ?: return null
+
+        val prefs = context.getSharedPreferences(PREFS, Context.MODE_PRIVATE)
+        val key = if (corpus != null) "corpus" else "synthetic"
+        var speedup: Double? = null
+        when (pgoMode) {
+            0 -> prefs.edit().apply {
+                ms.forEachIndexed { i, v -> putFloat("$key.$i", v.toFloat()) }
+            }.apply()
+            2 -> {
+                var logSum = 0.0
+                var n = 0
+                ms.forEachIndexed { i, v ->
+                    val base = prefs.getFloat("$key.$i", -1f).toDouble()
+                    if (base > 0.0 && v > 0.0) {
+                        logSum += ln(base / v)
+                        ++n
+                    }
+                }
+                if (n > 0) speedup = exp(logSum / n)
+            }
+        }
+
+        OpenCVUtils.BENCHMARK_MODES.forEachIndexed { i, name ->
+            val t = i * OpenCVUtils.BENCHMARK_TRAFFIC_VALUES
+            Log.i(TAG, "$name: ${"%.2f".format(ms[i])} ms/frame, edge F ${"%.4f".format(fScore[i])}, " +
+                    "edges ${kib(traffic[t])}/${kib(traffic[t + 1])} KiB computed, " +
+                    "present ${kib(traffic[t + 2])}/${kib(traffic[t + 3])} KiB measured (planar/RGBA)")
+        }
+        speedup?.let { Log.i(TAG, "PGO speedup vs baseline: ${"%.3f".format(it)}x") }
+        return Result(pgoMode, corpus != null, ms, fScore, traffic, speedup)
+    }
+
+    private fun kib(bytes: Double) = "%.0f".format(bytes / 1024.0)
+}
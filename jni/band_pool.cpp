@@ -0,0 +1,98 @@
+#include "band_pool.h"
+
+#include "sampling_profiler.h"
+
+#include <algorithm>
+
+// Android big.LITTLE parts rarely gain from more than four image workers.
+static constexpr int kMaxWorkers = 4;
+
+static thread_local bool tInsideBand = false;
+
+BandPool& BandPool::instance() {
+    static BandPool pool(std::max(1, std::min(kMaxWorkers, static_cast<int>(std::thread::hardware_concurrency()))));
+    return pool;
+}
+
+BandPool::BandPool(int threads) {
+    for (int i = 1; i < threads; ++i) {
+        threads_.emplace_back(&BandPool::workerLoop, this);
+    }
+}
+
+BandPool::~BandPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t : threads_) t.join();
+}
+
+void BandPool::drainBands(const BandFn* job, int rows, int bands) {
+    tInsideBand = true;
+    for (;;) {
+        const int band = nextBand_.fetch_add(1);
+        if (band >= bands) break;
+        const int y0 = static_cast<int>(static_cast<int64_t>(rows) * band / bands);
+        const int y1 = static_cast<int>(static_cast<int64_t>(rows) * (band + 1) / bands);
+        (*job)(y0, y1);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) done_.notify_all();
+    }
+    tInsideBand = false;
+}
+
+void BandPool::workerLoop() {
+    ProfiledThread profiled("band");
+    uint64_t seen = 0;
+    for (;;) {
+        const BandFn* job;
+        int rows;
+        int bands;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+            if (job_ == nullptr) continue;  // woke after that job already finished
+            job = job_;
+            rows = rows_;
+            bands = bands_;
+            ++active_;
+        }
+        drainBands(job, rows, bands);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--active_ == 0) done_.notify_all();
+    }
+}
+
+void BandPool::run(int rows, int minRows, const BandFn& fn) {
+    if (rows <= 0) return;
+    const int maxBands = std::max(1, rows / std::max(1, minRows));
+    const int bands = std::min(workerCount(), maxBands);
+    if (bands == 1 || tInsideBand) {
+        fn(0, rows);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex_);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Workers that joined the previous job late must leave before the
+        // band counter is reset for this one.
+        done_.wait(lock, [&] { return active_ == 0; });
+        job_ = &fn;
+        rows_ = rows;
+        bands_ = bands;
+        pending_ = bands;
+        nextBand_.store(0);
+        ++generation_;
+    }
+    wake_.notify_all();
+    drainBands(&fn, rows, bands);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&] { return pending_ == 0 && active_ == 0; });
+    job_ = nullptr;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ================= Band Worker Pool =================
+// Persistent worker threads that split a row range into contiguous bands.
+// run() returns only after every band has finished, so consecutive run()
+// calls act as a barrier between passes that read each other's output.
+class BandPool {
+public:
+    using BandFn = std::function<void(int y0, int y1)>;
+
+    static BandPool& instance();
+
+    int workerCount() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // Splits [0, rows) into at most workerCount() bands of at least minRows
+    // rows each and runs fn on them; the calling thread takes a band too.
+    // Calls made from inside a band run serially on the calling thread.
+    void run(int rows, int minRows, const BandFn& fn);
+
+    BandPool(const BandPool&) = delete;
+    BandPool& operator=(const BandPool&) = delete;
+
+private:
+    explicit BandPool(int threads);
+    ~BandPool();
+
+    void workerLoop();
+    void drainBands(const BandFn* job, int rows, int bands);
+
+    std::mutex runMutex_;  // one job at a time
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::vector<std::thread> threads_;
+
+    const BandFn* job_ = nullptr;
+    int rows_ = 0;
+    int bands_ = 0;
+    std::atomic<int> nextBand_{0};
+    int pending_ = 0;  // bands not yet finished
+    int active_ = 0;   // workers inside drainBands
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
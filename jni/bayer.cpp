@@ -0,0 +1,269 @@
+#include "bayer.h"
+
+#include "band_pool.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Black level and scale of one column parity of a row.
+struct Normalizer {
+    int black;
+    uint32_t scale;
+    int shift;
+
+    uint16_t operator()(int sample) const {
+        const int v = sample > black ? sample - black : 0;
+        const uint32_t n = (static_cast<uint32_t>(v) * scale + (1u << shift >> 1)) >> shift;
+        return static_cast<uint16_t>(n < 4095 ? n : 4095);
+    }
+};
+
+template <RawPacking P>
+void normalizeRow(const uint8_t* src, int width, const Normalizer& even, const Normalizer& odd, uint16_t* dst) {
+    using T = RawPackingTraits<P>;
+    if constexpr (P == RawPacking::Raw10) {
+        for (int x = 0; x < width; x += T::groupPixels, src += T::groupBytes) {
+            const int low = src[4];
+            dst[x] = even((src[0] << 2) | (low & 3));
+            dst[x + 1] = odd((src[1] << 2) | ((low >> 2) & 3));
+            dst[x + 2] = even((src[2] << 2) | ((low >> 4) & 3));
+            dst[x + 3] = odd((src[3] << 2) | (low >> 6));
+        }
+    } else {
+        for (int x = 0; x < width; x += 2, src += 2 * T::groupBytes) {
+            dst[x] = even(src[0] | (src[1] << 8));
+            dst[x + 1] = odd(src[2] | (src[3] << 8));
+        }
+    }
+}
+
+inline uint16_t clamp12(int v) { return static_cast<uint16_t>(v < 0 ? 0 : (v > 4095 ? 4095 : v)); }
+
+}  // namespace
+
+void BayerDecoder::setParams(const Params& params) {
+    params_ = params;
+    static const uint8_t kPatterns[4][2][2] = {
+        {{0, 1}, {1, 2}},  // RGGB
+        {{1, 0}, {2, 1}},  // GRBG
+        {{1, 2}, {0, 1}},  // GBRG
+        {{2, 1}, {1, 0}},  // BGGR
+    };
+    const int pattern = std::min(std::max(static_cast<int>(params.pattern), 0), 3);
+    for (int py = 0; py < 2; ++py) {
+        for (int px = 0; px < 2; ++px) {
+            const int colour = kPatterns[pattern][py][px];
+            cfa_[py][px] = static_cast<uint8_t>(colour);
+            // Gains are R, G on even rows, G on odd rows, B.
+            const float gain = colour == 0 ? params.gains[0] : colour == 2 ? params.gains[3] : params.gains[1 + py];
+            const int black = std::max(params.blackLevel[py * 2 + px], 0);
+            const int range = std::max(params.whiteLevel - black, 1);
+            // Largest shift that keeps scale below 2^15, so (sample - black) * scale
+            // fits 32 bits for 16-bit samples.
+            const double scale = std::max(static_cast<double>(gain), 0.0) * kMaxLevel / range;
+            int shift = 24;
+            while (shift > 0 && scale * (1 << shift) >= 32767.0) --shift;
+            black_[py][px] = black;
+            shift_[py][px] = shift;
+            scale_[py][px] = static_cast<uint32_t>(std::min(std::lround(scale * (1 << shift)), 32767L));
+        }
+    }
+    for (int v = 0; v <= kMaxLevel; ++v) {
+        if (params.srgb) {
+            const double l = static_cast<double>(v) / kMaxLevel;
+            const double e = l <= 0.0031308 ? 12.92 * l : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+            tone_[v] = static_cast<uint8_t>(std::lround(255.0 * e));
+        } else {
+            tone_[v] = static_cast<uint8_t>(std::min((v + 8) >> 4, 255));
+        }
+    }
+}
+
+void BayerDecoder::trim() {
+    std::vector<uint16_t>().swap(mosaic_);
+    std::vector<uint16_t>().swap(green_);
+    std::vector<std::vector<uint16_t>>().swap(bandScratch_);
+    width_ = height_ = 0;
+    stride_ = 0;
+}
+
+bool BayerDecoder::normalize(const RawFrame& raw) {
+    const int w = raw.width;
+    const int h = raw.height;
+    if (raw.data == nullptr || w < 4 || h < 4 || ((w | h) & 1) != 0) return false;
+    const bool raw10 = raw.packing == RawPacking::Raw10;
+    if (raw10 && w % RawPackingTraits<RawPacking::Raw10>::groupPixels != 0) return false;
+    const size_t rowBytes = raw10 ? static_cast<size_t>(w) / 4 * 5 : static_cast<size_t>(w) * 2;
+    if (raw.stride < rowBytes) return false;
+
+    width_ = w;
+    height_ = h;
+    stride_ = (static_cast<size_t>(kPad + w + 8) + 7) & ~static_cast<size_t>(7);
+    mosaic_.resize(stride_ * (h + 2 * kPad));
+
+    BandPool::instance().run(h, 16, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const int py = y & 1;
+            const Normalizer even{black_[py][0], scale_[py][0], shift_[py][0]};
+            const Normalizer odd{black_[py][1], scale_[py][1], shift_[py][1]};
+            const uint8_t* src = raw.data + y * raw.stride;
+            if (raw10) {
+                normalizeRow<RawPacking::Raw10>(src, w, even, odd, row(mosaic_, y));
+            } else {
+                normalizeRow<RawPacking::Raw16>(src, w, even, odd, row(mosaic_, y));
+            }
+        }
+    });
+    mirrorBorders(mosaic_);
+    return true;
+}
+
+void BayerDecoder::mirrorBorders(std::vector<uint16_t>& plane) const {
+    const int w = width_;
+    const int h = height_;
+    for (int y = 0; y < h; ++y) {
+        uint16_t* r = row(plane, y);
+        for (int i = 1; i <= kPad; ++i) {
+            r[-i] = r[i];
+            r[w - 1 + i] = r[w - 1 - i];
+        }
+    }
+    for (int i = 1; i <= kPad; ++i) {
+        std::memcpy(row(plane, -i) - kPad, row(plane, i) - kPad, stride_ * sizeof(uint16_t));
+        std::memcpy(row(plane, h - 1 + i) - kPad, row(plane, h - 1 - i) - kPad, stride_ * sizeof(uint16_t));
+    }
+}
+
+void BayerDecoder::reserveBandScratch(size_t elements) {
+    bandScratch_.resize(static_cast<size_t>(BandPool::instance().workerCount()));
+    for (std::vector<uint16_t>& scratch : bandScratch_) scratch.resize(elements);
+}
+
+void BayerDecoder::toneRow(const uint16_t* src, uint8_t* dst, int width) const {
+    if (params_.srgb) {
+        for (int x = 0; x < width; ++x) dst[x] = tone_[src[x]];
+    } else {
+        kernels::shrNarrowRowU16<4, simd::Native>(src, dst, width);
+    }
+}
+
+bool BayerDecoder::demosaic(const RawFrame& raw, DemosaicMethod method, PlanarImage& rgb) {
+    if (!normalize(raw)) return false;
+    const int w = width_;
+    const int h = height_;
+    rgb.reset(PlanarFormat::Rgb, w, h);
+
+    std::atomic<int> slot{0};
+    if (method == DemosaicMethod::EdgeDirected) {
+        green_.resize(mosaic_.size());
+        reserveBandScratch(3 * static_cast<size_t>(w));
+        BandPool::instance().run(h, 16, [&](int y0, int y1) { greenEdgeDirected(y0, y1); });
+        mirrorBorders(green_);
+        BandPool::instance().run(h, 16, [&](int y0, int y1) {
+            colourEdgeDirected(y0, y1, bandScratch_[slot.fetch_add(1)].data(), rgb);
+        });
+        return true;
+    }
+
+    const int w8 = (w + 7) & ~7;
+    reserveBandScratch(3 * static_cast<size_t>(w8));
+    BandPool::instance().run(h, 16, [&](int y0, int y1) {
+        uint16_t* const scratch = bandScratch_[slot.fetch_add(1)].data();
+        uint16_t* const out[3] = {scratch, scratch + w8, scratch + 2 * w8};
+        for (int y = y0; y < y1; ++y) {
+            const uint16_t* const rows[3] = {row(mosaic_, y - 1), row(mosaic_, y), row(mosaic_, y + 1)};
+            kernels::bayerBilinearRow<simd::Native>(rows, cfa_, y & 1, out, w);
+            for (int c = 0; c < 3; ++c) toneRow(out[c], rgb.plane(c) + y * rgb.stride(), w);
+        }
+    });
+    return true;
+}
+
+// Hamilton-Adams: at R / B sites green is interpolated along the direction
+// (horizontal or vertical) with the smaller gradient, corrected by the
+// second derivative of the site's own colour.
+void BayerDecoder::greenEdgeDirected(int y0, int y1) {
+    const int w = width_;
+    for (int y = y0; y < y1; ++y) {
+        const uint16_t* m = row(mosaic_, y);
+        const uint16_t* up = row(mosaic_, y - 1);
+        const uint16_t* up2 = row(mosaic_, y - 2);
+        const uint16_t* dn = row(mosaic_, y + 1);
+        const uint16_t* dn2 = row(mosaic_, y + 2);
+        uint16_t* g = row(green_, y);
+        const int firstGreen = cfa_[y & 1][0] == 1 ? 0 : 1;
+        for (int x = firstGreen; x < w; x += 2) g[x] = m[x];
+        for (int x = 1 - firstGreen; x < w; x += 2) {
+            const int c = m[x];
+            const int lh = 2 * c - m[x - 2] - m[x + 2];
+            const int lv = 2 * c - up2[x] - dn2[x];
+            const int dh = std::abs(m[x - 1] - m[x + 1]) + std::abs(lh);
+            const int dv = std::abs(up[x] - dn[x]) + std::abs(lv);
+            const int gh = 2 * (m[x - 1] + m[x + 1]) + lh;  // 4x the estimate
+            const int gv = 2 * (up[x] + dn[x]) + lv;
+            const int g8 = dh < dv ? 2 * gh : (dv < dh ? 2 * gv : gh + gv);
+            g[x] = clamp12((g8 + 4) / 8);
+        }
+    }
+}
+
+// R and B from bilinearly interpolated colour differences against the full
+// green plane, which follows edges better than interpolating R and B alone.
+// `scratch` holds 3 * width samples.
+void BayerDecoder::colourEdgeDirected(int y0, int y1, uint16_t* scratch, PlanarImage& rgb) const {
+    const int w = width_;
+    uint16_t* const out[3] = {scratch, scratch + w, scratch + 2 * w};
+    for (int y = y0; y < y1; ++y) {
+        const uint16_t* m[3] = {row(mosaic_, y - 1), row(mosaic_, y), row(mosaic_, y + 1)};
+        const uint16_t* g[3] = {row(green_, y - 1), row(green_, y), row(green_, y + 1)};
+        auto diff = [&](int r, int x) { return m[r][x] - g[r][x]; };
+        const uint8_t* colours = cfa_[y & 1];
+        for (int x = 0; x < w; ++x) {
+            const int colour = colours[x & 1];
+            const int green = g[1][x];
+            out[1][x] = static_cast<uint16_t>(green);
+            if (colour == 1) {
+                // Horizontal neighbours carry this row's other colour, vertical ones the opposite one.
+                const int horizontal = colours[(x + 1) & 1];
+                out[horizontal][x] = clamp12(green + (diff(1, x - 1) + diff(1, x + 1)) / 2);
+                out[2 - horizontal][x] = clamp12(green + (diff(0, x) + diff(2, x)) / 2);
+            } else {
+                out[colour][x] = m[1][x];
+                out[2 - colour][x] = clamp12(
+                    green + (diff(0, x - 1) + diff(0, x + 1) + diff(2, x - 1) + diff(2, x + 1)) / 4);
+            }
+        }
+        for (int c = 0; c < 3; ++c) toneRow(out[c], rgb.plane(c) + y * rgb.stride(), w);
+    }
+}
+
+bool BayerDecoder::luma(const RawFrame& raw, uint8_t* dst, size_t dstStride) {
+    if (dst == nullptr || !normalize(raw)) return false;
+    const int w = width_;
+    const int h = height_;
+    reserveBandScratch(2 * static_cast<size_t>(w) + 2);
+    std::atomic<int> slot{0};
+    BandPool::instance().run(h, 16, [&](int y0, int y1) {
+        // Column sums over x = -1 .. w, then the row tap; at most 16 * 4095.
+        uint16_t* const columns = bandScratch_[slot.fetch_add(1)].data();
+        uint16_t* const sums = columns + w + 2;
+        for (int y = y0; y < y1; ++y) {
+            kernels::sum121RowsU16<simd::Native>(row(mosaic_, y - 1) - 1, row(mosaic_, y) - 1,
+                                                 row(mosaic_, y + 1) - 1, columns, w + 2);
+            kernels::sum121RowU16<simd::Native>(columns + 1, sums, w);
+            uint8_t* out = dst + y * dstStride;
+            if (params_.srgb) {
+                for (int x = 0; x < w; ++x) out[x] = tone_[(sums[x] + 8) >> 4];
+            } else {
+                kernels::shrNarrowRowU16<8, simd::Native>(sums, out, w);
+            }
+        }
+    });
+    return true;
+}
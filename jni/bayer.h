@@ -0,0 +1,114 @@
+#pragma once
+
+#include "planar_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= RAW Bayer Ingest =================
+// Sensor RAW frames (Camera2 RAW10 / RAW16) to 8-bit RGB planes or luma,
+// starting before the ISP's sharpening and noise reduction so edges carry no
+// halos. Samples are unpacked, black-level subtracted, white-balanced and
+// normalized to 12 bits in one pass; demosaicing and luma work from that.
+
+// Sample packing, described at compile time by RawPackingTraits.
+enum class RawPacking : int {
+    Raw10 = 0,  // 4 pixels in 5 bytes: high 8 bits each, then a byte of the 2-bit remainders
+    Raw16 = 1,  // little-endian 16-bit words, value in the low bits
+};
+
+template <RawPacking P> struct RawPackingTraits;
+template <> struct RawPackingTraits<RawPacking::Raw10> {
+    static constexpr int bitDepth = 10;
+    static constexpr int groupPixels = 4;
+    static constexpr int groupBytes = 5;
+};
+template <> struct RawPackingTraits<RawPacking::Raw16> {
+    static constexpr int bitDepth = 16;
+    static constexpr int groupPixels = 1;
+    static constexpr int groupBytes = 2;
+};
+
+// Colour of the top-left 2x2 quad, in raster order. Values mirror Camera2's
+// SENSOR_INFO_COLOR_FILTER_ARRANGEMENT.
+enum class BayerPattern : int { Rggb = 0, Grbg = 1, Gbrg = 2, Bggr = 3 };
+
+// Values mirror OpenCVUtils.DEMOSAIC_*.
+enum class DemosaicMethod : int {
+    Bilinear = 0,      // vectorized 3x3 average; for preview
+    EdgeDirected = 1,  // Hamilton-Adams green, colour-difference R / B; for stills
+};
+
+// One frame as Camera2 delivers it: plane 0 of a RAW10 or RAW16 Image.
+// RAW10 widths are a multiple of 4; both dimensions must be even.
+struct RawFrame {
+    const uint8_t* data = nullptr;
+    size_t stride = 0;  // bytes per row
+    int width = 0;
+    int height = 0;
+    RawPacking packing = RawPacking::Raw10;
+};
+
+class BayerDecoder {
+public:
+    struct Params {
+        BayerPattern pattern = BayerPattern::Rggb;
+        // Per quad position in raster order, as SENSOR_BLACK_LEVEL_PATTERN.
+        int blackLevel[4] = {64, 64, 64, 64};
+        int whiteLevel = 1023;  // SENSOR_INFO_WHITE_LEVEL
+        // R, G on even rows, G on odd rows, B, as COLOR_CORRECTION_GAINS.
+        float gains[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        bool srgb = true;  // sRGB transfer on 8-bit output; false keeps it linear
+    };
+
+    BayerDecoder() { setParams(Params()); }
+
+    void setParams(const Params& params);
+    const Params& params() const { return params_; }
+
+    // Frees the normalized mosaic, green and row scratch.
+    void trim();
+
+    // Full-colour demosaic into three planes (PlanarFormat::Rgb).
+    bool demosaic(const RawFrame& raw, DemosaicMethod method, PlanarImage& rgb);
+
+    // Luma only, without demosaicing: the white-balanced mosaic through a 3x3
+    // binomial filter, which yields (R + 2G + B) / 4 at every site.
+    bool luma(const RawFrame& raw, uint8_t* dst, size_t dstStride);
+
+private:
+    // Mosaic borders are mirrored by kPad pixels, which keeps the colour
+    // parity; rows are padded further on the right for whole-vector reads.
+    static constexpr int kPad = 2;
+    static constexpr int kMaxLevel = 4095;
+
+    bool normalize(const RawFrame& raw);
+    void mirrorBorders(std::vector<uint16_t>& plane) const;
+    uint16_t* row(std::vector<uint16_t>& plane, int y) const { return plane.data() + (y + kPad) * stride_ + kPad; }
+    const uint16_t* row(const std::vector<uint16_t>& plane, int y) const {
+        return plane.data() + (y + kPad) * stride_ + kPad;
+    }
+    void toneRow(const uint16_t* src, uint8_t* dst, int width) const;
+    void greenEdgeDirected(int y0, int y1);
+    void colourEdgeDirected(int y0, int y1, uint16_t* scratch, PlanarImage& rgb) const;
+    // Sizes every band's row scratch to `elements`; see bandScratch_.
+    void reserveBandScratch(size_t elements);
+
+
+    Params params_;
+    uint8_t cfa_[2][2];        // colour (0 R, 1 G, 2 B) by row / column parity
+    uint32_t scale_[2][2];     // (sample - black) * scale >> shift normalizes to 12 bits
+    int shift_[2][2];
+    int black_[2][2];
+    uint8_t tone_[kMaxLevel + 1];  // 12-bit linear to 8-bit output
+
+    int width_ = 0;
+    int height_ = 0;
+    size_t stride_ = 0;
+    std::vector<uint16_t> mosaic_;  // normalized samples, padded
+    std::vector<uint16_t> green_;   // edge-directed green, same geometry
+    // Row scratch, one slot per BandPool worker. A pass never has more bands
+    // than workers, so each band claims the next slot through a counter.
+    std::vector<std::vector<uint16_t>> bandScratch_;
+};
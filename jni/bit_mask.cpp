@@ -0,0 +1,44 @@
+#include "bit_mask.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+
+void BitMask::reset(int w, int h) {
+    width = w;
+    height = h;
+    wordsPerRow = (w + 63) / 64;
+    stride = wordsPerRow + 2;
+    words.assign(static_cast<size_t>(stride) * (h + 2), 0);
+}
+
+void packMask(const uint8_t* mask, size_t stride, int width, int height, BitMask& out) {
+    out.reset(width, height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = mask + y * stride;
+        uint64_t* dst = out.row(y);
+        for (int k = 0; k < out.wordsPerRow; ++k) {
+            const int x0 = k * 64;
+            const int n = std::min(64, width - x0);
+            dst[k] = kernels::packNonZeroBits<simd::Native>(src + x0, n);
+        }
+    }
+}
+
+void unpackMask(const BitMask& mask, uint8_t* dst, size_t stride, uint8_t on) {
+    for (int y = 0; y < mask.height; ++y) {
+        const uint64_t* src = mask.row(y);
+        uint8_t* out = dst + y * stride;
+        for (int k = 0; k < mask.wordsPerRow; ++k) {
+            const int x0 = k * 64;
+            const int n = std::min(64, mask.width - x0);
+            const uint64_t word = src[k];
+            if (word == 0) {
+                std::fill(out + x0, out + x0 + n, static_cast<uint8_t>(0));
+                continue;
+            }
+            for (int i = 0; i < n; ++i) {
+                out[x0 + i] = ((word >> i) & 1u) ? on : 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Bit-Packed Masks =================
+// One bit per pixel, 64 pixels per word, LSB = leftmost pixel. Every row has a
+// zero guard word on each side and there is a zero guard row above and below,
+// so 3x3 neighbourhood kernels need no border checks.
+struct BitMask {
+    int width = 0;
+    int height = 0;
+    int wordsPerRow = 0;  // payload words, excluding the two guards
+    int stride = 0;       // words between rows, including guards
+    std::vector<uint64_t> words;
+
+    void reset(int w, int h);
+
+    // First payload word of row y; valid for y in [-1, height].
+    uint64_t* row(int y) { return words.data() + static_cast<size_t>(y + 1) * stride + 1; }
+    const uint64_t* row(int y) const { return words.data() + static_cast<size_t>(y + 1) * stride + 1; }
+
+    bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1u; }
+};
+
+// Sets a bit for every non-zero byte of an 8-bit mask.
+void packMask(const uint8_t* mask, size_t stride, int width, int height, BitMask& out);
+
+// Writes `on` / 0 bytes back out.
+void unpackMask(const BitMask& mask, uint8_t* dst, size_t stride, uint8_t on = 255);
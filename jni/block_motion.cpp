@@ -0,0 +1,144 @@
+#include "block_motion.h"
+
+#include "band_pool.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static constexpr int kB = BlockMatcher::kBlockSize;
+static_assert(kB == 16, "blocks are matched with kernels::sadBlock16");
+
+// Large and small diamond search patterns.
+static constexpr int kLargeDiamond[8][2] = {
+    {0, -2}, {1, -1}, {2, 0}, {1, 1}, {0, 2}, {-1, 1}, {-2, 0}, {-1, -1}};
+static constexpr int kSmallDiamond[4][2] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+
+void BlockMatcher::setParams(const Params& params) {
+    params_ = params;
+    params_.searchRange = std::min(std::max(params_.searchRange, 1), 127);
+    params_.maxSteps = std::max(params_.maxSteps, 1);
+    reset();
+}
+
+void BlockMatcher::reset() {
+    width_ = height_ = 0;
+    blocksX_ = blocksY_ = 0;
+    prevLuma_.clear();
+    field_.clear();
+    prevField_.clear();
+}
+
+void BlockMatcher::trim() {
+    reset();
+    std::vector<uint8_t>().swap(prevLuma_);
+    std::vector<BlockVector>().swap(field_);
+    std::vector<BlockVector>().swap(prevField_);
+}
+
+bool BlockMatcher::process(const uint8_t* luma, size_t stride, int width, int height) {
+    const bool primed = width == width_ && height == height_ && !prevLuma_.empty();
+    if (!primed) {
+        width_ = width;
+        height_ = height;
+        blocksX_ = width / kB;
+        blocksY_ = height / kB;
+        prevLuma_.resize(static_cast<size_t>(width) * height);
+        field_.clear();
+        prevField_.assign(static_cast<size_t>(blocksX_) * blocksY_, BlockVector{0, 0, 0});
+    } else if (blocksX_ > 0 && blocksY_ > 0) {
+        if (!field_.empty()) field_.swap(prevField_);  // last field seeds the search
+        field_.resize(static_cast<size_t>(blocksX_) * blocksY_);
+        BandPool::instance().run(blocksY_, 2, [&](int by0, int by1) {
+            matchRows(luma, stride, by0, by1);
+        });
+    }
+
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(prevLuma_.data() + static_cast<size_t>(y) * width, luma + y * stride, width);
+    }
+    return primed;
+}
+
+void BlockMatcher::matchRows(const uint8_t* luma, size_t stride, int by0, int by1) {
+    const int range = params_.searchRange;
+    const size_t prevStride = static_cast<size_t>(width_);
+
+    for (int by = by0; by < by1; ++by) {
+        for (int bx = 0; bx < blocksX_; ++bx) {
+            const int x0 = bx * kB;
+            const int y0 = by * kB;
+            // Valid vectors keep the displaced block inside the previous frame.
+            const int minDx = std::max(-range, -x0), maxDx = std::min(range, width_ - kB - x0);
+            const int minDy = std::max(-range, -y0), maxDy = std::min(range, height_ - kB - y0);
+            const uint8_t* block = luma + y0 * stride + x0;
+            const uint8_t* ref = prevLuma_.data() + y0 * prevStride + x0;
+
+            auto sadAt = [&](int dx, int dy) {
+                return kernels::sadBlock16<simd::Native>(block, stride, ref + dy * static_cast<ptrdiff_t>(prevStride) + dx, prevStride);
+            };
+            auto inRange = [&](int dx, int dy) {
+                return dx >= minDx && dx <= maxDx && dy >= minDy && dy <= maxDy;
+            };
+
+            int bestX = 0, bestY = 0;
+            uint32_t best = sadAt(0, 0);
+            auto tryCandidate = [&](int dx, int dy) {
+                if ((dx == bestX && dy == bestY) || !inRange(dx, dy)) return false;
+                const uint32_t s = sadAt(dx, dy);
+                if (s >= best) return false;
+                best = s;
+                bestX = dx;
+                bestY = dy;
+                return true;
+            };
+
+            if (best != 0) {
+                const BlockVector& co = prevField_[static_cast<size_t>(by) * blocksX_ + bx];
+                tryCandidate(co.dx, co.dy);
+                if (bx > 0) {
+                    const BlockVector& left = field_[static_cast<size_t>(by) * blocksX_ + bx - 1];
+                    tryCandidate(left.dx, left.dy);
+                }
+            }
+
+            for (int step = 0; step < params_.maxSteps && best != 0; ++step) {
+                const int cx = bestX, cy = bestY;
+                bool moved = false;
+                for (const auto& d : kLargeDiamond) moved |= tryCandidate(cx + d[0], cy + d[1]);
+                if (!moved) break;
+            }
+            if (best != 0) {
+                const int cx = bestX, cy = bestY;
+                for (const auto& d : kSmallDiamond) tryCandidate(cx + d[0], cy + d[1]);
+            }
+
+            field_[static_cast<size_t>(by) * blocksX_ + bx] =
+                BlockVector{static_cast<int8_t>(bestX), static_cast<int8_t>(bestY), static_cast<uint16_t>(best)};
+        }
+    }
+}
+
+bool BlockMatcher::medianVector(int& dx, int& dy) const {
+    if (field_.empty()) return false;
+    // Histograms over the int8 range; the field is at most a few thousand blocks.
+    int histX[256] = {};
+    int histY[256] = {};
+    for (const BlockVector& v : field_) {
+        ++histX[v.dx + 128];
+        ++histY[v.dy + 128];
+    }
+    auto median = [&](const int* hist) {
+        const int half = static_cast<int>(field_.size()) / 2;
+        int seen = 0;
+        for (int i = 0; i < 256; ++i) {
+            seen += hist[i];
+            if (seen > half) return i - 128;
+        }
+        return 0;
+    };
+    dx = median(histX);
+    dy = median(histY);
+    return true;
+}
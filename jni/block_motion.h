@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One 16x16 block's match in the previous frame: the block at (x, y) in the
+// current frame best matches (x + dx, y + dy) in the previous one, with `sad`
+// as its residual energy (sum of absolute differences, at most 16*16*255).
+struct BlockVector {
+    int8_t dx;
+    int8_t dy;
+    uint16_t sad;
+};
+
+// ================= Block Motion Estimation =================
+// Encoder-style block matching against the previous frame's luma: each full
+// 16x16 block starts from the best of the zero vector, its left neighbour's
+// vector and the co-located vector of the previous field, then refines with a
+// large diamond search followed by a small one. SADs use 16-byte absolute
+// difference instructions (NEON vabd / SSE2 psadbw). Block rows are split
+// across the BandPool; candidates never depend on other rows of the current
+// field, so the result does not depend on the band split.
+class BlockMatcher {
+public:
+    static constexpr int kBlockSize = 16;
+
+    struct Params {
+        int searchRange = 32;  // max |dx|, |dy|; at most 127
+        int maxSteps = 16;     // large diamond steps per block
+    };
+
+    BlockMatcher() = default;
+    explicit BlockMatcher(const Params& params) { setParams(params); }
+
+    void setParams(const Params& params);
+    const Params& params() const { return params_; }
+
+    // Drops the previous frame; the next process() call only primes.
+    void reset();
+
+    // reset() and free the frame and vector fields; params are kept.
+    void trim();
+
+    // Matches the blocks of `luma` against the previous call's frame and
+    // keeps a copy of `luma` for the next call. Returns false (and leaves an
+    // empty field) on the first frame or after a size change.
+    bool process(const uint8_t* luma, size_t stride, int width, int height);
+
+    int blocksX() const { return blocksX_; }
+    int blocksY() const { return blocksY_; }
+    const std::vector<BlockVector>& vectors() const { return field_; }
+
+    // Component-wise median of the field; a cheap global motion estimate.
+    bool medianVector(int& dx, int& dy) const;
+
+private:
+    void matchRows(const uint8_t* luma, size_t stride, int by0, int by1);
+
+    Params params_;
+    int width_ = 0;
+    int height_ = 0;
+    int blocksX_ = 0;
+    int blocksY_ = 0;
+    std::vector<uint8_t> prevLuma_;
+    std::vector<BlockVector> field_;
+    std::vector<BlockVector> prevField_;
+};
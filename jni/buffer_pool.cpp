@@ -0,0 +1,172 @@
+#include "buffer_pool.h"
+
+#include "band_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+static constexpr size_t kAlignment = 64;
+
+// rewarm() writes once per page to fault it in; a band of the BandPool takes
+// at least kRewarmMinPages of them.
+static constexpr size_t kPageBytes = 4096;
+static constexpr int kRewarmMinPages = 256;
+
+static uint8_t* alignedStart(uint8_t* p) {
+    const uintptr_t v = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<uint8_t*>((v + kAlignment - 1) & ~static_cast<uintptr_t>(kAlignment - 1));
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pool_ = other.pool_;
+        block_ = std::move(other.block_);
+        capacity_ = other.capacity_;
+        data_ = other.data_;
+        size_ = other.size_;
+        other.pool_ = nullptr;
+        other.capacity_ = 0;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+void PooledBuffer::reset() {
+    if (pool_ && block_) {
+        pool_->release(std::move(block_), capacity_);
+    }
+    pool_ = nullptr;
+    block_.reset();
+    capacity_ = 0;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+PooledBuffer BufferPool::acquire(size_t bytes) {
+    PooledBuffer buffer;
+    if (bytes == 0) return buffer;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t best = free_.size();
+        for (size_t i = 0; i < free_.size(); ++i) {
+            const size_t cap = free_[i].capacity;
+            if (cap >= bytes && cap <= bytes * 2 &&
+                (best == free_.size() || cap < free_[best].capacity)) {
+                best = i;
+            }
+        }
+        if (best != free_.size()) {
+            buffer.block_ = std::move(free_[best].memory);
+            buffer.capacity_ = free_[best].capacity;
+            freeBytes_ -= buffer.capacity_;
+            free_[best] = std::move(free_.back());
+            free_.pop_back();
+        }
+        liveBytes_ += buffer.block_ ? buffer.capacity_ : bytes;
+
+        // A fresh allocation satisfies a trimmed block's demand; rewarm()
+        // must not bring that block back on top of it.
+        if (!buffer.block_) {
+            for (size_t i = 0; i < trimmed_.size(); ++i) {
+                if (trimmed_[i] >= bytes && trimmed_[i] <= bytes * 2) {
+                    trimmed_[i] = trimmed_.back();
+                    trimmed_.pop_back();
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!buffer.block_) {
+        buffer.block_.reset(new uint8_t[bytes + kAlignment - 1]);
+        buffer.capacity_ = bytes;
+    }
+    buffer.pool_ = this;
+    buffer.data_ = alignedStart(buffer.block_.get());
+    buffer.size_ = bytes;
+    return buffer;
+}
+
+void BufferPool::release(std::unique_ptr<uint8_t[]> memory, size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    liveBytes_ -= capacity;
+    freeBytes_ += capacity;
+    free_.push_back({std::move(memory), capacity});
+}
+
+size_t BufferPool::trim(size_t floorBytes) {
+    std::vector<Block> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::sort(free_.begin(), free_.end(),
+                  [](const Block& a, const Block& b) { return a.capacity < b.capacity; });
+        while (!free_.empty() && freeBytes_ > floorBytes) {
+            freeBytes_ -= free_.back().capacity;
+            trimmed_.push_back(free_.back().capacity);
+            dropped.push_back(std::move(free_.back()));
+            free_.pop_back();
+        }
+    }
+    // Freed outside the lock; large blocks go straight back to the kernel.
+    size_t bytes = 0;
+    for (const Block& block : dropped) bytes += block.capacity;
+    return bytes;
+}
+
+size_t BufferPool::rewarm() {
+    std::vector<size_t> sizes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sizes.swap(trimmed_);
+    }
+    if (sizes.empty()) return 0;
+
+    // New blocks are only address space until written. Fault them in with one
+    // write per page (plus each block's last byte), spread over the band
+    // workers, instead of zeroing every byte on this thread. firstPage[i] is
+    // the first of block i's writes in the combined page range.
+    std::vector<Block> blocks;
+    std::vector<size_t> firstPage(1, 0);
+    blocks.reserve(sizes.size());
+    firstPage.reserve(sizes.size() + 1);
+    for (size_t capacity : sizes) {
+        const size_t span = capacity + kAlignment - 1;
+        blocks.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[span]), capacity});
+        firstPage.push_back(firstPage.back() + span / kPageBytes + 1);
+    }
+    BandPool::instance().run(static_cast<int>(firstPage.back()), kRewarmMinPages, [&](int p0, int p1) {
+        size_t b = static_cast<size_t>(std::upper_bound(firstPage.begin(), firstPage.end(),
+                                                        static_cast<size_t>(p0)) - firstPage.begin()) - 1;
+        for (size_t p = static_cast<size_t>(p0); p < static_cast<size_t>(p1); ++p) {
+            while (p >= firstPage[b + 1]) ++b;
+            const size_t span = blocks[b].capacity + kAlignment - 1;
+            blocks[b].memory[std::min((p - firstPage[b]) * kPageBytes, span - 1)] = 0;
+        }
+    });
+
+    size_t bytes = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Block& block : blocks) {
+        freeBytes_ += block.capacity;
+        bytes += block.capacity;
+        free_.push_back(std::move(block));
+    }
+    return bytes;
+}
+
+size_t BufferPool::freeBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return freeBytes_;
+}
+
+size_t BufferPool::liveBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return liveBytes_;
+}
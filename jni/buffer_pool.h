@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ================= Buffer Pool =================
+// Recycles large 64-byte-aligned blocks between frames so steady-state
+// streaming does not hit the allocator. Buffers return to their pool when the
+// PooledBuffer handle is destroyed or reset; the pool must outlive them.
+class BufferPool;
+
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    ~PooledBuffer() { reset(); }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return data_ == nullptr; }
+
+    template <typename T> T* as() { return reinterpret_cast<T*>(data_); }
+    template <typename T> const T* as() const { return reinterpret_cast<const T*>(data_); }
+
+    // Returns the block to its pool.
+    void reset();
+
+private:
+    friend class BufferPool;
+
+    BufferPool* pool_ = nullptr;
+    std::unique_ptr<uint8_t[]> block_;
+    size_t capacity_ = 0;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class BufferPool {
+public:
+    BufferPool() = default;
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // A block of at least `bytes`, reusing the smallest free block that fits
+    // without wasting more than half of it.
+    PooledBuffer acquire(size_t bytes);
+
+    // Frees idle blocks, largest first, until at most floorBytes stay pooled.
+    // Their sizes are remembered for rewarm(). Returns the bytes freed.
+    size_t trim(size_t floorBytes);
+
+    // Reallocates the trimmed blocks that acquire() has not needed again
+    // since and faults their pages in on the BandPool, so they are ready
+    // before the frames that use them. Returns the bytes allocated.
+    size_t rewarm();
+
+    size_t freeBytes() const;
+    size_t liveBytes() const;
+
+private:
+    friend class PooledBuffer;
+
+    struct Block {
+        std::unique_ptr<uint8_t[]> memory;
+        size_t capacity;
+    };
+
+    void release(std::unique_ptr<uint8_t[]> memory, size_t capacity);
+
+    mutable std::mutex mutex_;
+    std::vector<Block> free_;
+    std::vector<size_t> trimmed_;  // capacities dropped by trim(), for rewarm()
+    size_t freeBytes_ = 0;
+    size_t liveBytes_ = 0;
+};
@@ -0,0 +1,193 @@
+#include "camera_frame_source.h"
+
+#include <android/log.h>
+
+#define TAG "FlameRnDNative"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+CameraFrameSource::CameraFrameSource(std::string cameraId, int width, int height, int maxImages)
+    : cameraId_(std::move(cameraId)), width_(width), height_(height), maxImages_(maxImages) {}
+
+CameraFrameSource::~CameraFrameSource() {
+    stop();
+}
+
+bool CameraFrameSource::selectCamera() {
+    if (!cameraId_.empty()) return true;
+    ACameraIdList* ids = nullptr;
+    if (ACameraManager_getCameraIdList(manager_, &ids) != ACAMERA_OK || ids == nullptr) return false;
+    for (int i = 0; i < ids->numCameras && cameraId_.empty(); ++i) {
+        ACameraMetadata* metadata = nullptr;
+        if (ACameraManager_getCameraCharacteristics(manager_, ids->cameraIds[i], &metadata) != ACAMERA_OK) continue;
+        ACameraMetadata_const_entry facing{};
+        if (ACameraMetadata_getConstEntry(metadata, ACAMERA_LENS_FACING, &facing) == ACAMERA_OK &&
+            facing.data.u8[0] == ACAMERA_LENS_FACING_BACK) {
+            cameraId_ = ids->cameraIds[i];
+        }
+        ACameraMetadata_free(metadata);
+    }
+    if (cameraId_.empty() && ids->numCameras > 0) cameraId_ = ids->cameraIds[0];
+    ACameraManager_deleteCameraIdList(ids);
+    return !cameraId_.empty();
+}
+
+bool CameraFrameSource::start(const FrameCallback& callback) {
+    if (manager_ != nullptr || !callback) return false;
+    callback_ = callback;
+    manager_ = ACameraManager_create();
+    if (!selectCamera()) {
+        LOGE("No camera available");
+        stop();
+        return false;
+    }
+
+    if (AImageReader_new(width_, height_, AIMAGE_FORMAT_YUV_420_888, maxImages_, &reader_) != AMEDIA_OK ||
+        AImageReader_getWindow(reader_, &window_) != AMEDIA_OK) {
+        LOGE("Cannot create a %dx%d image reader", width_, height_);
+        stop();
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(deliverMutex_);
+        running_ = true;
+    }
+    imageListener_.context = this;
+    imageListener_.onImageAvailable = &CameraFrameSource::onImageAvailable;
+    AImageReader_setImageListener(reader_, &imageListener_);
+
+    deviceCallbacks_.context = this;
+    deviceCallbacks_.onDisconnected = &CameraFrameSource::onDeviceDisconnected;
+    deviceCallbacks_.onError = &CameraFrameSource::onDeviceError;
+    sessionCallbacks_.context = this;
+    sessionCallbacks_.onClosed = &CameraFrameSource::onSessionClosed;
+    sessionCallbacks_.onReady = &CameraFrameSource::onSessionReady;
+    sessionCallbacks_.onActive = &CameraFrameSource::onSessionActive;
+
+    camera_status_t status = ACameraManager_openCamera(manager_, cameraId_.c_str(), &deviceCallbacks_, &device_);
+    if (status == ACAMERA_OK) status = ACaptureSessionOutputContainer_create(&outputs_);
+    if (status == ACAMERA_OK) status = ACaptureSessionOutput_create(window_, &output_);
+    if (status == ACAMERA_OK) status = ACaptureSessionOutputContainer_add(outputs_, output_);
+    if (status == ACAMERA_OK) status = ACameraOutputTarget_create(window_, &target_);
+    if (status == ACAMERA_OK) status = ACameraDevice_createCaptureRequest(device_, TEMPLATE_PREVIEW, &request_);
+    if (status == ACAMERA_OK) status = ACaptureRequest_addTarget(request_, target_);
+    if (status == ACAMERA_OK) {
+        status = ACameraDevice_createCaptureSession(device_, outputs_, &sessionCallbacks_, &session_);
+    }
+    if (status == ACAMERA_OK) {
+        status = ACameraCaptureSession_setRepeatingRequest(session_, nullptr, 1, &request_, nullptr);
+    }
+    if (status != ACAMERA_OK) {
+        LOGE("Camera %s failed to start: %d", cameraId_.c_str(), status);
+        stop();
+        return false;
+    }
+    LOGI("Camera %s streaming %dx%d", cameraId_.c_str(), width_, height_);
+    return true;
+}
+
+void CameraFrameSource::stop() {
+    {
+        // Waits for an in-flight delivery; later callbacks see !running_.
+        std::lock_guard<std::mutex> lock(deliverMutex_);
+        running_ = false;
+    }
+    if (session_ != nullptr) {
+        ACameraCaptureSession_stopRepeating(session_);
+        ACameraCaptureSession_close(session_);
+        session_ = nullptr;
+    }
+    if (request_ != nullptr) {
+        if (target_ != nullptr) ACaptureRequest_removeTarget(request_, target_);
+        ACaptureRequest_free(request_);
+        request_ = nullptr;
+    }
+    if (target_ != nullptr) {
+        ACameraOutputTarget_free(target_);
+        target_ = nullptr;
+    }
+    if (outputs_ != nullptr) {
+        if (output_ != nullptr) ACaptureSessionOutputContainer_remove(outputs_, output_);
+        ACaptureSessionOutputContainer_free(outputs_);
+        outputs_ = nullptr;
+    }
+    if (output_ != nullptr) {
+        ACaptureSessionOutput_free(output_);
+        output_ = nullptr;
+    }
+    if (device_ != nullptr) {
+        ACameraDevice_close(device_);
+        device_ = nullptr;
+    }
+    if (reader_ != nullptr) {
+        // The window belongs to the reader.
+        AImageReader_delete(reader_);
+        reader_ = nullptr;
+        window_ = nullptr;
+    }
+    if (manager_ != nullptr) {
+        ACameraManager_delete(manager_);
+        manager_ = nullptr;
+    }
+}
+
+void CameraFrameSource::onImageAvailable(void* context, AImageReader* reader) {
+    static_cast<CameraFrameSource*>(context)->deliver(reader);
+}
+
+void CameraFrameSource::deliver(AImageReader* reader) {
+    AImage* image = nullptr;
+    if (AImageReader_acquireLatestImage(reader, &image) != AMEDIA_OK || image == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(deliverMutex_);
+    if (running_) {
+        FrameView view;
+        uint8_t* data = nullptr;
+        int length = 0;
+        int32_t stride = 0;
+        int32_t pixelStride = 1;
+        int32_t w = 0, h = 0;
+        AImage_getWidth(image, &w);
+        AImage_getHeight(image, &h);
+        AImage_getTimestamp(image, &view.timestampNs);
+
+        AImage_getPlaneData(image, 0, &data, &length);
+        AImage_getPlaneRowStride(image, 0, &stride);
+        view.y = data;
+        view.yStride = static_cast<size_t>(stride);
+        AImage_getPlaneData(image, 1, &data, &length);
+        view.u = data;
+        AImage_getPlaneData(image, 2, &data, &length);
+        view.v = data;
+        AImage_getPlaneRowStride(image, 1, &stride);
+        AImage_getPlanePixelStride(image, 1, &pixelStride);
+        view.chromaStride = static_cast<size_t>(stride);
+        view.chromaPixelStride = pixelStride;
+        view.width = w;
+        view.height = h;
+        callback_(view);
+    }
+    AImage_delete(image);
+}
+
+void CameraFrameSource::onDeviceDisconnected(void* context, ACameraDevice* device) {
+    (void)device;
+    LOGE("Camera %s disconnected", static_cast<CameraFrameSource*>(context)->cameraId_.c_str());
+}
+
+void CameraFrameSource::onDeviceError(void* context, ACameraDevice* device, int error) {
+    (void)device;
+    LOGE("Camera %s error %d", static_cast<CameraFrameSource*>(context)->cameraId_.c_str(), error);
+}
+
+void CameraFrameSource::onSessionClosed(void* context, ACameraCaptureSession* session) {
+    (void)context; (void)session;
+}
+
+void CameraFrameSource::onSessionReady(void* context, ACameraCaptureSession* session) {
+    (void)context; (void)session;
+}
+
+void CameraFrameSource::onSessionActive(void* context, ACameraCaptureSession* session) {
+    (void)context; (void)session;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "frame_source.h"
+
+#include <camera/NdkCameraCaptureSession.h>
+#include <camera/NdkCameraDevice.h>
+#include <camera/NdkCameraManager.h>
+#include <media/NdkImageReader.h>
+
+#include <mutex>
+#include <string>
+
+// Frames straight from the camera HAL through an AImageReader (camera2ndk),
+// bypassing CameraX, the Java analyzer and its plane copies. Frames arrive on
+// the reader's callback thread with the image's own plane pointers and
+// strides; the image is returned to the reader when the callback returns.
+// The camera must not be held by another client (e.g. CameraX) meanwhile.
+class CameraFrameSource : public FrameSource {
+public:
+    // An empty cameraId selects the first back-facing camera.
+    CameraFrameSource(std::string cameraId, int width, int height, int maxImages = 3);
+    ~CameraFrameSource() override;
+
+    bool start(const FrameCallback& callback) override;
+    void stop() override;
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    const char* name() const override { return "camera2ndk"; }
+
+private:
+    static void onImageAvailable(void* context, AImageReader* reader);
+    static void onDeviceDisconnected(void* context, ACameraDevice* device);
+    static void onDeviceError(void* context, ACameraDevice* device, int error);
+    static void onSessionClosed(void* context, ACameraCaptureSession* session);
+    static void onSessionReady(void* context, ACameraCaptureSession* session);
+    static void onSessionActive(void* context, ACameraCaptureSession* session);
+
+    bool selectCamera();
+    void deliver(AImageReader* reader);
+
+    std::string cameraId_;
+    const int width_;
+    const int height_;
+    const int maxImages_;
+
+    ACameraManager* manager_ = nullptr;
+    ACameraDevice* device_ = nullptr;
+    AImageReader* reader_ = nullptr;
+    ANativeWindow* window_ = nullptr;
+    ACaptureSessionOutputContainer* outputs_ = nullptr;
+    ACaptureSessionOutput* output_ = nullptr;
+    ACameraOutputTarget* target_ = nullptr;
+    ACaptureRequest* request_ = nullptr;
+    ACameraCaptureSession* session_ = nullptr;
+
+    ACameraDevice_StateCallbacks deviceCallbacks_{};
+    ACameraCaptureSession_stateCallbacks sessionCallbacks_{};
+    AImageReader_ImageListener imageListener_{};
+
+    FrameCallback callback_;
+    std::mutex deliverMutex_;  // held while a frame is being delivered
+    bool running_ = false;     // guarded by deliverMutex_
+};
@@ -0,0 +1,301 @@
+#include "contours.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Neighbour directions, counter-clockwise on screen starting East.
+static const int kDx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int kDy[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+
+static constexpr double kSqrt2 = 1.41421356237309504880;
+
+static inline int directionOf(int dx, int dy) {
+    for (int d = 0; d < 8; ++d) {
+        if (kDx[d] == dx && kDy[d] == dy) return d;
+    }
+    return 0;
+}
+
+// Green's theorem accumulation of one polygon edge, as in cv::moments on a contour.
+static inline void accumulateEdge(ContourMoments& m, double xi, double yi, double xj, double yj) {
+    const double a = xi * yj - xj * yi;
+    m.m00 += a;
+    m.m10 += a * (xi + xj);
+    m.m01 += a * (yi + yj);
+    m.m20 += a * (xi * xi + xi * xj + xj * xj);
+    m.m11 += a * (xi * (2 * yi + yj) + xj * (yi + 2 * yj));
+    m.m02 += a * (yi * yi + yi * yj + yj * yj);
+}
+
+static inline int64_t cross(const ContourPoint& o, const ContourPoint& a, const ContourPoint& b) {
+    return static_cast<int64_t>(a.x - o.x) * (b.y - o.y) - static_cast<int64_t>(a.y - o.y) * (b.x - o.x);
+}
+
+// Rotating calipers over a counter-clockwise hull.
+static RotatedBox minAreaRectOfHull(const ContourPoint* h, int n) {
+    RotatedBox box;
+    if (n == 0) return box;
+    if (n == 1) {
+        box.cx = h[0].x;
+        box.cy = h[0].y;
+        return box;
+    }
+    if (n == 2) {
+        const double dx = h[1].x - h[0].x, dy = h[1].y - h[0].y;
+        box.cx = static_cast<float>((h[0].x + h[1].x) * 0.5);
+        box.cy = static_cast<float>((h[0].y + h[1].y) * 0.5);
+        box.width = static_cast<float>(std::sqrt(dx * dx + dy * dy));
+        box.angle = static_cast<float>(std::atan2(dy, dx) * 180.0 / M_PI);
+        return box;
+    }
+
+    auto dot = [](double ax, double ay, const ContourPoint& p) { return ax * p.x + ay * p.y; };
+    // Advances `idx` around the hull while `score` keeps improving; the hull
+    // is convex so each score is unimodal and pointers only move forward.
+    auto advance = [&](int& idx, double ax, double ay, bool maximize) {
+        for (int steps = 0; steps < n; ++steps) {
+            const int next = (idx + 1) % n;
+            const double cur = dot(ax, ay, h[idx]), nxt = dot(ax, ay, h[next]);
+            if (maximize ? nxt < cur : nxt > cur) break;
+            if (nxt == cur && steps > 0) break;
+            idx = next;
+        }
+    };
+
+    double bestArea = -1;
+    int far = 1, right = 1, left = 1;
+    for (int i = 0; i < n; ++i) {
+        const ContourPoint& a = h[i];
+        const ContourPoint& b = h[(i + 1) % n];
+        const double ex = b.x - a.x, ey = b.y - a.y;
+        const double len = std::sqrt(ex * ex + ey * ey);
+        if (len == 0) continue;
+        const double ux = ex / len, uy = ey / len;
+        const double nx = -uy, ny = ux;  // inward normal of a counter-clockwise hull
+
+        advance(far, nx, ny, true);
+        advance(right, ux, uy, true);
+        if (i == 0) left = far;
+        advance(left, ux, uy, false);
+
+        const double minU = dot(ux, uy, h[left]);
+        const double maxU = dot(ux, uy, h[right]);
+        const double baseN = dot(nx, ny, a);
+        const double height = dot(nx, ny, h[far]) - baseN;
+        const double width = maxU - minU;
+        const double area = width * height;
+        if (bestArea < 0 || area < bestArea) {
+            bestArea = area;
+            const double midU = (minU + maxU) * 0.5;
+            const double midN = baseN + height * 0.5;
+            box.cx = static_cast<float>(ux * midU + nx * midN);
+            box.cy = static_cast<float>(uy * midU + ny * midN);
+            box.width = static_cast<float>(width);
+            box.height = static_cast<float>(height);
+            box.angle = static_cast<float>(std::atan2(uy, ux) * 180.0 / M_PI);
+        }
+    }
+    return box;
+}
+
+void ContourTracer::finishDescriptors(ContourArena& arena, ContourDescriptor& c) {
+    // Normalize orientation so moments describe a positive area.
+    if (c.moments.m00 < 0) {
+        c.moments.m00 = -c.moments.m00;
+        c.moments.m10 = -c.moments.m10;
+        c.moments.m01 = -c.moments.m01;
+        c.moments.m20 = -c.moments.m20;
+        c.moments.m11 = -c.moments.m11;
+        c.moments.m02 = -c.moments.m02;
+    }
+    c.moments.m00 *= 0.5;
+    c.moments.m10 /= 6;
+    c.moments.m01 /= 6;
+    c.moments.m20 /= 12;
+    c.moments.m11 /= 24;
+    c.moments.m02 /= 12;
+    c.area = c.moments.m00;
+
+    // Monotone-chain hull over the points just traced (still hot in cache).
+    const ContourPoint* pts = arena.points.data() + c.pointOffset;
+    sorted_.assign(pts, pts + c.pointCount);
+    std::sort(sorted_.begin(), sorted_.end(), [](const ContourPoint& a, const ContourPoint& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    sorted_.erase(std::unique(sorted_.begin(), sorted_.end(), [](const ContourPoint& a, const ContourPoint& b) {
+        return a.x == b.x && a.y == b.y;
+    }), sorted_.end());
+
+    c.hullOffset = static_cast<int32_t>(arena.hull.size());
+    const int n = static_cast<int>(sorted_.size());
+    if (n < 3) {
+        arena.hull.insert(arena.hull.end(), sorted_.begin(), sorted_.end());
+    } else {
+        // Lower hull then upper hull; y grows downward, so "counter-clockwise"
+        // here is clockwise on screen, matching cv::convexHull(clockwise=false).
+        std::vector<ContourPoint>& hull = arena.hull;
+        const size_t base = hull.size();
+        for (int i = 0; i < n; ++i) {
+            while (hull.size() >= base + 2 && cross(hull[hull.size() - 2], hull.back(), sorted_[i]) <= 0) {
+                hull.pop_back();
+            }
+            hull.push_back(sorted_[i]);
+        }
+        const size_t lowerSize = hull.size();
+        for (int i = n - 2; i >= 0; --i) {
+            while (hull.size() > lowerSize && cross(hull[hull.size() - 2], hull.back(), sorted_[i]) <= 0) {
+                hull.pop_back();
+            }
+            hull.push_back(sorted_[i]);
+        }
+        hull.pop_back();  // last point repeats the first
+    }
+    c.hullCount = static_cast<int32_t>(arena.hull.size()) - c.hullOffset;
+    c.minAreaRect = minAreaRectOfHull(arena.hull.data() + c.hullOffset, c.hullCount);
+}
+
+void ContourTracer::trim() {
+    std::vector<int32_t>().swap(labels_);
+    std::vector<uint8_t>().swap(borderIsHole_);
+    std::vector<int32_t>().swap(borderParent_);
+    std::vector<int32_t>().swap(lastChild_);
+    std::vector<ContourPoint>().swap(sorted_);
+}
+
+int ContourTracer::trace(const uint8_t* mask, size_t stride, int channels, int width, int height,
+                         ContourArena& arena) {
+    arena.clear();
+    if (mask == nullptr || width <= 0 || height <= 0) return 0;
+
+    // Padded label image: 0 background, 1 unvisited foreground, +/-NBD visited.
+    const int ls = width + 2;
+    labels_.assign(static_cast<size_t>(ls) * (height + 2), 0);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = mask + y * stride;
+        int32_t* dst = labels_.data() + static_cast<size_t>(y + 1) * ls + 1;
+        for (int x = 0; x < width; ++x) dst[x] = src[x * channels] != 0;
+    }
+
+    int off[8];
+    for (int d = 0; d < 8; ++d) off[d] = kDy[d] * ls + kDx[d];
+
+    // NBD 1 is the frame, treated as a hole with no contour of its own.
+    borderIsHole_.assign(2, 1);
+    borderParent_.assign(2, -1);
+    lastChild_.clear();
+    int nbd = 1;
+
+    int32_t* L = labels_.data();
+    for (int y = 1; y <= height; ++y) {
+        int lnbd = 1;
+        for (int x = 1; x <= width; ++x) {
+            const int p = y * ls + x;
+            const int32_t f = L[p];
+            if (f == 0) continue;
+
+            bool isHole;
+            int fromDir;
+            if (f == 1 && L[p - 1] == 0) {
+                isHole = false;
+                fromDir = 4;  // west
+            } else if (f >= 1 && L[p + 1] == 0) {
+                isHole = true;
+                fromDir = 0;  // east
+                if (f > 1) lnbd = f;
+            } else {
+                if (f != 1) lnbd = std::abs(f);
+                continue;
+            }
+
+            ++nbd;
+            // Parent from the border last crossed on this row (Suzuki-Abe table 1).
+            const bool prevHole = borderIsHole_[lnbd] != 0;
+            const int prevIndex = lnbd - 2;  // -1 for the frame
+            const int parent = (isHole != prevHole) ? prevIndex : borderParent_[lnbd];
+            borderIsHole_.push_back(isHole);
+            borderParent_.push_back(parent);
+
+            const int index = static_cast<int>(arena.contours.size());
+            arena.contours.emplace_back();
+            lastChild_.push_back(-1);
+            ContourDescriptor& c = arena.contours.back();
+            c.isHole = isHole;
+            c.parent = parent;
+            if (parent >= 0) {
+                if (lastChild_[parent] < 0) {
+                    arena.contours[parent].firstChild = index;
+                } else {
+                    arena.contours[lastChild_[parent]].nextSibling = index;
+                }
+                lastChild_[parent] = index;
+            }
+            c.pointOffset = static_cast<int32_t>(arena.points.size());
+
+            int minX = x, maxX = x, minY = y, maxY = y;
+            auto append = [&](int pos) {
+                const int py = pos / ls, px = pos - py * ls;
+                arena.points.push_back({static_cast<int16_t>(px - 1), static_cast<int16_t>(py - 1)});
+                minX = std::min(minX, px); maxX = std::max(maxX, px);
+                minY = std::min(minY, py); maxY = std::max(maxY, py);
+            };
+
+            // 3.1: clockwise from the entry neighbour for any foreground pixel.
+            int d1 = -1;
+            for (int k = 0; k < 8; ++k) {
+                const int d = (fromDir - k + 8) & 7;
+                if (L[p + off[d]] != 0) { d1 = d; break; }
+            }
+            append(p);
+            if (d1 < 0) {
+                L[p] = -nbd;  // isolated pixel
+            } else {
+                const int p1 = p + off[d1];
+                int p2 = p1;
+                int p3 = p;
+                for (;;) {
+                    // 3.3: counter-clockwise from the neighbour after p2.
+                    const int dyx = (p2 / ls) - (p3 / ls);
+                    const int d2 = directionOf((p2 - p3) - dyx * ls, dyx);
+                    bool eastZeroExamined = false;
+                    int p4 = p3;
+                    int d4 = d2;
+                    for (int k = 1; k <= 8; ++k) {
+                        const int d = (d2 + k) & 7;
+                        if (L[p3 + off[d]] != 0) { p4 = p3 + off[d]; d4 = d; break; }
+                        if (d == 0) eastZeroExamined = true;
+                    }
+                    // 3.4
+                    if (eastZeroExamined) {
+                        L[p3] = -nbd;
+                    } else if (L[p3] == 1) {
+                        L[p3] = nbd;
+                    }
+
+                    const double step = (d4 & 1) ? kSqrt2 : 1.0;
+                    c.perimeter += step;
+                    const int y3 = p3 / ls, x3 = p3 - y3 * ls;
+                    const int y4 = p4 / ls, x4 = p4 - y4 * ls;
+                    accumulateEdge(c.moments, x3 - 1, y3 - 1, x4 - 1, y4 - 1);
+
+                    // 3.5
+                    if (p4 == p && p3 == p1) break;
+                    p2 = p3;
+                    p3 = p4;
+                    append(p3);
+                }
+            }
+
+            c.pointCount = static_cast<int32_t>(arena.points.size()) - c.pointOffset;
+            c.x = minX - 1;
+            c.y = minY - 1;
+            c.width = maxX - minX + 1;
+            c.height = maxY - minY + 1;
+            finishDescriptors(arena, c);
+
+            // Step 4
+            if (L[p] != 1) lnbd = std::abs(L[p]);
+        }
+    }
+    return static_cast<int>(arena.contours.size());
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Contour Extraction =================
+// Suzuki-Abe border following (the algorithm behind cv::findContours with
+// RETR_TREE / CHAIN_APPROX_NONE) that fills a reusable arena and computes
+// shape descriptors while each border is traced, so a frame's worth of
+// contours costs no per-contour heap allocation once the arena has grown.
+
+struct ContourPoint {
+    int16_t x;
+    int16_t y;
+};
+
+struct ContourMoments {
+    double m00 = 0, m10 = 0, m01 = 0, m20 = 0, m11 = 0, m02 = 0;
+};
+
+struct RotatedBox {
+    float cx = 0, cy = 0;
+    float width = 0, height = 0;
+    float angle = 0;  // degrees, direction of the `width` side
+};
+
+struct ContourDescriptor {
+    int32_t pointOffset = 0;  // into ContourArena::points
+    int32_t pointCount = 0;
+    int32_t hullOffset = 0;   // into ContourArena::hull, counter-clockwise
+    int32_t hullCount = 0;
+
+    // Hierarchy as contour indices, -1 when absent (same meaning as
+    // cv::findContours' hierarchy vector).
+    int32_t parent = -1;
+    int32_t firstChild = -1;
+    int32_t nextSibling = -1;
+    bool isHole = false;
+
+    int32_t x = 0, y = 0, width = 0, height = 0;  // bounding box
+    double area = 0;       // polygon area of the border (|m00|)
+    double perimeter = 0;  // closed chain length, diagonal steps count sqrt(2)
+    ContourMoments moments;
+    RotatedBox minAreaRect;
+};
+
+struct ContourArena {
+    std::vector<ContourPoint> points;
+    std::vector<ContourPoint> hull;
+    std::vector<ContourDescriptor> contours;
+
+    // Empties the arena but keeps its capacity for the next frame.
+    void clear() {
+        points.clear();
+        hull.clear();
+        contours.clear();
+    }
+
+    // Empties the arena and gives its capacity back.
+    void release() {
+        std::vector<ContourPoint>().swap(points);
+        std::vector<ContourPoint>().swap(hull);
+        std::vector<ContourDescriptor>().swap(contours);
+    }
+};
+
+class ContourTracer {
+public:
+    // Traces every border of the non-zero pixels of `mask` (8-bit, `channels`
+    // bytes per pixel; channel 0 is tested) into `arena`, which is cleared
+    // first. Returns the number of contours.
+    int trace(const uint8_t* mask, size_t stride, int channels, int width, int height,
+              ContourArena& arena);
+
+    // Frees the label image and per-trace scratch.
+    void trim();
+
+private:
+    void finishDescriptors(ContourArena& arena, ContourDescriptor& c);
+
+    std::vector<int32_t> labels_;       // padded label image
+    std::vector<uint8_t> borderIsHole_; // per NBD
+    std::vector<int32_t> borderParent_; // per NBD, contour index
+    std::vector<int32_t> lastChild_;    // per contour, for sibling links
+    std::vector<ContourPoint> sorted_;  // hull scratch
+};
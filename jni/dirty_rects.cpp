@@ -0,0 +1,142 @@
+#include "dirty_rects.h"
+
+#include <algorithm>
+#include <cstring>
+
+DirtyRectTracker::DirtyRectTracker(int tileSize)
+    : tile_(tileSize > 0 ? tileSize : kDefaultTileSize) {}
+
+void DirtyRectTracker::invalidate() {
+    width_ = height_ = 0;
+    format_ = nullptr;
+    shadow_.clear();
+}
+
+void DirtyRectTracker::trim() {
+    invalidate();
+    std::vector<uint8_t>().swap(shadow_);
+    std::vector<uint8_t>().swap(dirty_);
+}
+
+int DirtyRectTracker::present(const uint8_t* src, size_t srcStride, const PixelFormatOps& format,
+                              int width, int height,
+                              uint8_t* dst, size_t dstStride,
+                              std::vector<DirtyRect>& rects) {
+    if (format.layout != PlaneLayout::Packed) {
+        rects.clear();
+        traffic_ = 0;
+        return 0;
+    }
+    const uint8_t* planes[1] = {src};
+    return presentPlanes(planes, srcStride, format, width, height, dst, dstStride, rects);
+}
+
+int DirtyRectTracker::present(const PlanarImage& src, int width, int height,
+                              uint8_t* dst, size_t dstStride,
+                              std::vector<DirtyRect>& rects) {
+    const uint8_t* planes[PlanarImage::kMaxPlanes] = {};
+    for (int p = 0; p < src.planes(); ++p) planes[p] = src.plane(p);
+    width = std::min(width, src.width());
+    height = std::min(height, src.height());
+    return presentPlanes(planes, src.stride(), pixelFormatOps(src.pixelFormat()), width, height,
+                         dst, dstStride, rects);
+}
+
+int DirtyRectTracker::presentPlanes(const uint8_t* const* planes, size_t srcStride, const PixelFormatOps& format,
+                                    int width, int height,
+                                    uint8_t* dst, size_t dstStride,
+                                    std::vector<DirtyRect>& rects) {
+    rects.clear();
+    traffic_ = 0;
+    if (planes[0] == nullptr || dst == nullptr || width <= 0 || height <= 0 || format.rowToRgba == nullptr) return 0;
+
+    const int planeCount = format.planes;
+    const int pixelBytes = format.pixelBytes;
+    const size_t rowBytes = static_cast<size_t>(width) * pixelBytes;
+    const size_t planeBytes = rowBytes * height;
+    const int tilesX = (width + tile_ - 1) / tile_;
+    const int tilesY = (height + tile_ - 1) / tile_;
+    const bool fullRefresh = width != width_ || height != height_ || &format != format_;
+
+    if (fullRefresh) {
+        width_ = width;
+        height_ = height;
+        format_ = &format;
+        shadow_.resize(planeBytes * planeCount);
+    }
+    dirty_.assign(static_cast<size_t>(tilesX), 0);
+
+    const uint8_t* rows[PlanarImage::kMaxPlanes];
+    for (int ty = 0; ty < tilesY; ++ty) {
+        const int y0 = ty * tile_;
+        const int y1 = std::min(y0 + tile_, height);
+
+        // Compare row-major so both source and shadow stream through the cache;
+        // a tile stops being compared as soon as one of its rows differs.
+        if (fullRefresh) {
+            std::fill(dirty_.begin(), dirty_.end(), 1);
+        } else {
+            std::fill(dirty_.begin(), dirty_.end(), 0);
+            for (int y = y0; y < y1; ++y) {
+                for (int p = 0; p < planeCount; ++p) {
+                    const uint8_t* s = planes[p] + y * srcStride;
+                    const uint8_t* prev = shadow_.data() + p * planeBytes + y * rowBytes;
+                    for (int tx = 0; tx < tilesX; ++tx) {
+                        if (dirty_[tx]) continue;
+                        const int x0 = tx * tile_;
+                        const size_t len = static_cast<size_t>(std::min(tile_, width - x0)) * pixelBytes;
+                        const size_t off = static_cast<size_t>(x0) * pixelBytes;
+                        traffic_ += 2 * len;
+                        if (std::memcmp(s + off, prev + off, len) != 0) dirty_[tx] = 1;
+                    }
+                }
+            }
+        }
+
+        for (int tx = 0; tx < tilesX; ++tx) {
+            if (!dirty_[tx]) continue;
+            const int x0 = tx * tile_;
+            const int tw = std::min(tile_, width - x0);
+            const size_t len = static_cast<size_t>(tw) * pixelBytes;
+            const size_t off = static_cast<size_t>(x0) * pixelBytes;
+            for (int y = y0; y < y1; ++y) {
+                for (int p = 0; p < planeCount; ++p) {
+                    rows[p] = planes[p] + y * srcStride + off;
+                    std::memcpy(shadow_.data() + p * planeBytes + y * rowBytes + off, rows[p], len);
+                }
+                format.rowToRgba(rows, dst + y * dstStride + static_cast<size_t>(x0) * 4, tw);
+            }
+            // Source read, shadow written, RGBA written.
+            traffic_ += (2 * len * planeCount + static_cast<size_t>(tw) * 4) * (y1 - y0);
+        }
+
+        mergeTileRow(ty, tilesX, width, height, rects);
+    }
+    return static_cast<int>(rects.size());
+}
+
+void DirtyRectTracker::mergeTileRow(int ty, int tilesX, int width, int height,
+                                    std::vector<DirtyRect>& rects) const {
+    const int y0 = ty * tile_;
+    const int h = std::min(tile_, height - y0);
+    int tx = 0;
+    while (tx < tilesX) {
+        if (!dirty_[tx]) { ++tx; continue; }
+        int end = tx;
+        while (end < tilesX && dirty_[end]) ++end;
+        const int x = tx * tile_;
+        const int w = std::min(end * tile_, width) - x;
+
+        // Grow a rectangle from the tile row above when it spans the same columns.
+        bool merged = false;
+        for (auto it = rects.rbegin(); it != rects.rend(); ++it) {
+            if (it->x == x && it->w == w && it->y + it->h == y0) {
+                it->h += h;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) rects.push_back({x, y0, w, h});
+        tx = end;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "pixel_format.h"
+#include "planar_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Dirty-Rectangle Output =================
+// Tracks the last frame presented into a persistent RGBA output buffer and,
+// for each new frame, repacks only the tiles whose source pixels changed.
+// This is where the pipeline's planar output is interleaved.
+
+struct DirtyRect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+class DirtyRectTracker {
+public:
+    static constexpr int kDefaultTileSize = 32;
+
+    explicit DirtyRectTracker(int tileSize = kDefaultTileSize);
+
+    // Forget the previous frame; the next present() repacks everything.
+    // Call this whenever the output buffer itself is replaced.
+    void invalidate();
+
+    // invalidate() and free the shadow copy of the previous frame.
+    void trim();
+
+    // Diffs `src` (one plane of a packed `format`) against the previous frame,
+    // packs the changed tiles into `dst` (RGBA) and returns the merged changed
+    // rectangles. `dst` must be the same buffer that received the previous frame.
+    int present(const uint8_t* src, size_t srcStride, const PixelFormatOps& format,
+                int width, int height,
+                uint8_t* dst, size_t dstStride,
+                std::vector<DirtyRect>& rects);
+
+    // The same for the top-left width x height of a planar image: each plane
+    // is diffed on its own and changed tiles are interleaved straight into
+    // `dst`.
+    int present(const PlanarImage& src, int width, int height,
+                uint8_t* dst, size_t dstStride,
+                std::vector<DirtyRect>& rects);
+
+    int tileSize() const { return tile_; }
+
+    // Source, shadow and destination bytes the latest present() read or
+    // wrote, for bandwidth accounting.
+    size_t lastTraffic() const { return traffic_; }
+
+private:
+    // format.planes planes sharing srcStride; format must not be chroma-subsampled.
+    int presentPlanes(const uint8_t* const* planes, size_t srcStride, const PixelFormatOps& format,
+                      int width, int height,
+                      uint8_t* dst, size_t dstStride,
+                      std::vector<DirtyRect>& rects);
+    void mergeTileRow(int ty, int tilesX, int width, int height,
+                      std::vector<DirtyRect>& rects) const;
+
+    int tile_;
+    int width_ = 0;
+    int height_ = 0;
+    const PixelFormatOps* format_ = nullptr;  // of the previous frame
+    size_t traffic_ = 0;
+    std::vector<uint8_t> shadow_;  // last presented source pixels, tightly packed, plane after plane
+    std::vector<uint8_t> dirty_;   // one flag per tile, reused across frames
+};
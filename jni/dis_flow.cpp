@@ -0,0 +1,239 @@
+#include "dis_flow.h"
+#include "band_pool.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void DisFlow::trim() {
+    std::vector<int16_t>().swap(gx_);
+    std::vector<int16_t>().swap(gy_);
+    std::vector<int>().swap(xs_);
+    std::vector<int>().swap(ys_);
+    std::vector<int>().swap(colFirst_);
+    std::vector<int>().swap(colLast_);
+    std::vector<int>().swap(rowFirst_);
+    std::vector<int>().swap(rowLast_);
+    std::vector<float>().swap(patchFlow_);
+    std::vector<float>().swap(dense_);
+    std::vector<float>().swap(coarse_);
+}
+
+int DisFlow::flowWidth(const LumaPyramid& pyr) const {
+    const int finest = std::max(1, params_.finestLevel);
+    return pyr.levels() >= finest ? pyr.level(finest).width : 0;
+}
+
+int DisFlow::flowHeight(const LumaPyramid& pyr) const {
+    const int finest = std::max(1, params_.finestLevel);
+    return pyr.levels() >= finest ? pyr.level(finest).height : 0;
+}
+
+// Central differences (not halved) with replicated borders.
+void DisFlow::gradients(const LumaPyramid::Level& t) {
+    const int w = t.width, h = t.height;
+    gx_.resize(static_cast<size_t>(w) * h);
+    gy_.resize(static_cast<size_t>(w) * h);
+    BandPool::instance().run(h, 16, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* up = t.data() + std::max(y - 1, 0) * w;
+            const uint8_t* mid = t.data() + y * w;
+            const uint8_t* dn = t.data() + std::min(y + 1, h - 1) * w;
+            int16_t* ox = gx_.data() + static_cast<size_t>(y) * w;
+            int16_t* oy = gy_.data() + static_cast<size_t>(y) * w;
+            ox[0] = static_cast<int16_t>(mid[1] - mid[0]);
+            for (int x = 1; x < w - 1; ++x) ox[x] = static_cast<int16_t>(mid[x + 1] - mid[x - 1]);
+            ox[w - 1] = static_cast<int16_t>(mid[w - 1] - mid[w - 2]);
+            for (int x = 0; x < w; ++x) oy[x] = static_cast<int16_t>(dn[x] - up[x]);
+        }
+    });
+}
+
+static void gridPositions(int extent, int stride, std::vector<int>& pos,
+                          std::vector<int>& first, std::vector<int>& last) {
+    const int maxPos = extent - DisFlow::kPatchSize;
+    pos.clear();
+    for (int p = 0; p < maxPos; p += stride) pos.push_back(p);
+    pos.push_back(maxPos);
+
+    first.assign(extent, 0);
+    last.assign(extent, 0);
+    int lo = 0;
+    for (int x = 0; x < extent; ++x) {
+        while (pos[lo] + DisFlow::kPatchSize <= x) ++lo;
+        int hi = lo;
+        while (hi + 1 < static_cast<int>(pos.size()) && pos[hi + 1] <= x) ++hi;
+        first[x] = lo;
+        last[x] = hi;
+    }
+}
+
+void DisFlow::patchGrid(int width, int height) {
+    const int stride = std::max(1, std::min(params_.patchStride, kPatchSize));
+    gridPositions(width, stride, xs_, colFirst_, colLast_);
+    gridPositions(height, stride, ys_, rowFirst_, rowLast_);
+    patchFlow_.resize(xs_.size() * ys_.size() * 2);
+}
+
+void DisFlow::searchPatches(const LumaPyramid::Level& t, const LumaPyramid::Level& img,
+                            const float* coarse, int coarseW, int coarseH, int py0, int py1) {
+    const int w = t.width, h = t.height;
+    const int nx = static_cast<int>(xs_.size());
+    const int maxX = w - kPatchSize - 1;
+    const int maxY = h - kPatchSize - 1;
+
+    for (int py = py0; py < py1; ++py) {
+        const int y = ys_[py];
+        for (int px = 0; px < nx; ++px) {
+            const int x = xs_[px];
+            float u = 0, v = 0;
+            if (coarse) {
+                const int cx = std::min((x + kPatchSize / 2) / 2, coarseW - 1);
+                const int cy = std::min((y + kPatchSize / 2) / 2, coarseH - 1);
+                const float* c = coarse + (static_cast<size_t>(cy) * coarseW + cx) * 2;
+                u = c[0] * 2;
+                v = c[1] * 2;
+            }
+            float* out = patchFlow_.data() + (static_cast<size_t>(py) * nx + px) * 2;
+
+            const uint8_t* tp = t.data() + y * w + x;
+            const int16_t* gxp = gx_.data() + static_cast<size_t>(y) * w + x;
+            const int16_t* gyp = gy_.data() + static_cast<size_t>(y) * w + x;
+            int64_t hxx = 0, hxy = 0, hyy = 0;
+            for (int r = 0; r < kPatchSize; ++r) {
+                for (int c = 0; c < kPatchSize; ++c) {
+                    const int a = gxp[r * w + c], b = gyp[r * w + c];
+                    hxx += a * a;
+                    hxy += a * b;
+                    hyy += b * b;
+                }
+            }
+            const double det = static_cast<double>(hxx) * hyy - static_cast<double>(hxy) * hxy;
+            if (det < 1.0) {
+                // Textureless patch: keep the coarse estimate.
+                out[0] = u;
+                out[1] = v;
+                continue;
+            }
+
+            float bestU = u, bestV = v;
+            int32_t bestSsd = INT32_MAX;
+            bool converged = false;
+            for (int it = 0;; ++it) {
+                const float wx = std::min(std::max(x + u, 0.0f), static_cast<float>(maxX));
+                const float wy = std::min(std::max(y + v, 0.0f), static_cast<float>(maxY));
+                const int ix = static_cast<int>(wx), iy = static_cast<int>(wy);
+                const int fx = static_cast<int>((wx - ix) * 128.0f + 0.5f);
+                const int fy = static_cast<int>((wy - iy) * 128.0f + 0.5f);
+                int32_t bx, by;
+                const int32_t ssd = kernels::patchResidual8<simd::Native>(img.data(), w, ix, iy, fx, fy, tp, gxp, gyp, w, bx, by);
+                if (ssd < bestSsd) {
+                    bestSsd = ssd;
+                    bestU = u;
+                    bestV = v;
+                }
+                if (converged || it == params_.iterations) break;
+                // Gradients are 2x and residuals 16x their nominal scale.
+                const double du = (hyy * static_cast<double>(bx) - hxy * static_cast<double>(by)) / det / 8.0;
+                const double dv = (hxx * static_cast<double>(by) - hxy * static_cast<double>(bx)) / det / 8.0;
+                u -= static_cast<float>(du);
+                v -= static_cast<float>(dv);
+                converged = du * du + dv * dv < 1e-4;
+            }
+            out[0] = bestU;
+            out[1] = bestV;
+        }
+    }
+}
+
+// 1 / max(|error|, 1) for every possible 8-bit photometric error.
+static const float* inverseErrorLut() {
+    static const struct Lut {
+        float v[256];
+        Lut() {
+            v[0] = 1.0f;
+            for (int i = 1; i < 256; ++i) v[i] = 1.0f / static_cast<float>(i);
+        }
+    } lut;
+    return lut.v;
+}
+
+void DisFlow::densify(const LumaPyramid::Level& t, const LumaPyramid::Level& img, int y0, int y1) {
+    const int w = t.width, h = t.height;
+    const int nx = static_cast<int>(xs_.size());
+    const float* invErr = inverseErrorLut();
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* trow = t.data() + y * w;
+        float* out = dense_.data() + static_cast<size_t>(y) * w * 2;
+        for (int x = 0; x < w; ++x) {
+            float su = 0, sv = 0, sw = 0;
+            for (int py = rowFirst_[y]; py <= rowLast_[y]; ++py) {
+                const float* pf = patchFlow_.data() + static_cast<size_t>(py) * nx * 2;
+                for (int px = colFirst_[x]; px <= colLast_[x]; ++px) {
+                    const float u = pf[px * 2], v = pf[px * 2 + 1];
+                    // +0.5 then truncate rounds correctly once clamped to >= 0.
+                    const int sx = std::min(static_cast<int>(std::max(x + u + 0.5f, 0.0f)), w - 1);
+                    const int sy = std::min(static_cast<int>(std::max(y + v + 0.5f, 0.0f)), h - 1);
+                    const float wt = invErr[std::abs(img.data()[sy * w + sx] - trow[x])];
+                    su += wt * u;
+                    sv += wt * v;
+                    sw += wt;
+                }
+            }
+            out[x * 2] = su / sw;
+            out[x * 2 + 1] = sv / sw;
+        }
+    }
+}
+
+bool DisFlow::estimate(const LumaPyramid& prev, const LumaPyramid& cur,
+                       int16_t* flow, size_t flowStride) {
+    if (flow == nullptr || prev.baseWidth() != cur.baseWidth() || prev.baseHeight() != cur.baseHeight()) {
+        return false;
+    }
+    const int finest = std::max(1, params_.finestLevel);
+    int coarsest = std::min({params_.coarsestLevel, prev.levels(), cur.levels()});
+    // Tiny top levels are mostly aliasing and mislead every level below them.
+    while (coarsest >= finest &&
+           (prev.level(coarsest).width < 4 * kPatchSize || prev.level(coarsest).height < 4 * kPatchSize)) {
+        --coarsest;
+    }
+    if (coarsest < finest) return false;
+
+    BandPool& pool = BandPool::instance();
+    int coarseW = 0, coarseH = 0;
+    bool haveCoarse = false;
+    for (int level = coarsest; level >= finest; --level) {
+        const LumaPyramid::Level& t = prev.level(level);
+        const LumaPyramid::Level& img = cur.level(level);
+        gradients(t);
+        patchGrid(t.width, t.height);
+        dense_.resize(static_cast<size_t>(t.width) * t.height * 2);
+
+        const float* coarse = haveCoarse ? coarse_.data() : nullptr;
+        pool.run(static_cast<int>(ys_.size()), 4, [&](int p0, int p1) {
+            searchPatches(t, img, coarse, coarseW, coarseH, p0, p1);
+        });
+        pool.run(t.height, 16, [&](int y0, int y1) {
+            densify(t, img, y0, y1);
+        });
+
+        coarse_.swap(dense_);
+        coarseW = t.width;
+        coarseH = t.height;
+        haveCoarse = true;
+    }
+
+    // coarse_ now holds the finest level; scale to full-resolution Q4.
+    const float scale = static_cast<float>((1 << finest) << kFracBits);
+    for (int y = 0; y < coarseH; ++y) {
+        const float* src = coarse_.data() + static_cast<size_t>(y) * coarseW * 2;
+        int16_t* dst = flow + y * flowStride;
+        for (int i = 0; i < coarseW * 2; ++i) {
+            const float v = std::min(std::max(src[i] * scale, -32768.0f), 32767.0f);
+            dst[i] = static_cast<int16_t>(std::lround(v));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pyramid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Dense Inverse Search Optical Flow =================
+// DIS-style dense flow (Kroeger et al. 2016) from the previous frame's luma
+// pyramid to the current one, coarse to fine down to 1/4 scale:
+//  - inverse-compositional Gauss-Newton search for 8x8 patches on a stride-4
+//    grid, with the bilinear warp, residual SSD and gradient products done in
+//    16-bit SIMD;
+//  - densification by photometric-error-weighted averaging of the patches
+//    covering each pixel;
+//  - patch rows and pixel rows split across the BandPool.
+// The variational refinement step of full DIS is omitted.
+class DisFlow {
+public:
+    static constexpr int kPatchSize = 8;  // the SIMD kernels are written for 8
+    static constexpr int kFracBits = 4;   // output fixed point: 1/16 pixel
+
+    struct Params {
+        int patchStride = 4;
+        int iterations = 8;
+        int finestLevel = 2;    // 1/4 scale
+        int coarsestLevel = 4;
+    };
+
+    DisFlow() = default;
+    explicit DisFlow(const Params& params) : params_(params) {}
+
+    const Params& params() const { return params_; }
+
+    // Frees the per-estimate scratch; the next estimate() reallocates it.
+    void trim();
+
+    // Size of the flow field estimate() writes for pyramids of this base size.
+    int flowWidth(const LumaPyramid& pyr) const;
+    int flowHeight(const LumaPyramid& pyr) const;
+
+    // Writes flowWidth x flowHeight (dx, dy) int16 pairs, in full-resolution
+    // pixels with kFracBits fractional bits; flowStride counts int16 elements.
+    // Returns false if the pyramids are mismatched or too shallow.
+    bool estimate(const LumaPyramid& prev, const LumaPyramid& cur,
+                  int16_t* flow, size_t flowStride);
+
+private:
+    void gradients(const LumaPyramid::Level& t);
+    void patchGrid(int width, int height);
+    void searchPatches(const LumaPyramid::Level& t, const LumaPyramid::Level& img,
+                       const float* coarse, int coarseW, int coarseH, int py0, int py1);
+    void densify(const LumaPyramid::Level& t, const LumaPyramid::Level& img, int y0, int y1);
+
+    Params params_;
+    std::vector<int16_t> gx_;
+    std::vector<int16_t> gy_;
+    std::vector<int> xs_;         // patch grid origins
+    std::vector<int> ys_;
+    std::vector<int> colFirst_;   // first / last patch column covering each x
+    std::vector<int> colLast_;
+    std::vector<int> rowFirst_;
+    std::vector<int> rowLast_;
+    std::vector<float> patchFlow_;  // (u, v) per patch
+    std::vector<float> dense_;      // (u, v) per pixel, current level
+    std::vector<float> coarse_;     // (u, v) per pixel, previous (coarser) level
+};
@@ -0,0 +1,132 @@
+#include "frame_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+ThreadedFrameSource::ThreadedFrameSource(int width, int height, double fps, int64_t maxFrames)
+    : width_(width), height_(height), fps_(fps), maxFrames_(maxFrames) {}
+
+ThreadedFrameSource::~ThreadedFrameSource() {
+    stop();
+}
+
+bool ThreadedFrameSource::start(const FrameCallback& callback) {
+    if (running_ || width_ <= 0 || height_ <= 0 || !callback || !open()) return false;
+    // A worker that ran to the end of its stream has exited but not been joined.
+    if (thread_.joinable()) thread_.join();
+    callback_ = callback;
+    running_ = true;
+    thread_ = std::thread(&ThreadedFrameSource::run, this);
+    return true;
+}
+
+void ThreadedFrameSource::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+}
+
+void ThreadedFrameSource::run() {
+    using Clock = std::chrono::steady_clock;
+    std::vector<uint8_t> frame(static_cast<size_t>(width_) * height_ * 3 / 2);
+    const size_t lumaBytes = static_cast<size_t>(width_) * height_;
+    const size_t chromaBytes = static_cast<size_t>(width_ / 2) * (height_ / 2);
+    const auto period = fps_ > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps_))
+                                   : Clock::duration::zero();
+    const auto begin = Clock::now();
+
+    for (int64_t index = 0; running_ && (maxFrames_ <= 0 || index < maxFrames_); ++index) {
+        if (!produce(index, frame)) break;
+
+        FrameView view;
+        view.y = frame.data();
+        view.u = frame.data() + lumaBytes;
+        view.v = view.u + chromaBytes;
+        view.yStride = static_cast<size_t>(width_);
+        view.chromaStride = static_cast<size_t>(width_ / 2);
+        view.chromaPixelStride = 1;
+        view.width = width_;
+        view.height = height_;
+        view.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+        callback_(view);
+
+        if (period != Clock::duration::zero()) std::this_thread::sleep_until(begin + period * (index + 1));
+    }
+    running_ = false;
+}
+
+FileFrameSource::FileFrameSource(std::string path, Format format, int width, int height,
+                                 double fps, bool loop, int64_t maxFrames)
+    : ThreadedFrameSource(width, height, fps, maxFrames), path_(std::move(path)), format_(format), loop_(loop) {}
+
+FileFrameSource::~FileFrameSource() {
+    stop();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+size_t FileFrameSource::frameBytes() const {
+    const size_t luma = static_cast<size_t>(width_) * height_;
+    return format_ == Format::Gray8 ? luma : luma + 2 * static_cast<size_t>(width_ / 2) * (height_ / 2);
+}
+
+bool FileFrameSource::open() {
+    if (fd_ < 0) fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    return fd_ >= 0;
+}
+
+bool FileFrameSource::produce(int64_t index, std::vector<uint8_t>& frame) {
+    const size_t bytes = frameBytes();
+    const off_t size = lseek(fd_, 0, SEEK_END);
+    const int64_t frames = size > 0 ? static_cast<int64_t>(size) / static_cast<int64_t>(bytes) : 0;
+    if (frames == 0 || (!loop_ && index >= frames)) return false;
+
+    raw_.resize(bytes);
+    const off_t offset = static_cast<off_t>((index % frames) * static_cast<int64_t>(bytes));
+    if (::pread(fd_, raw_.data(), bytes, offset) != static_cast<ssize_t>(bytes)) return false;
+
+    const size_t luma = static_cast<size_t>(width_) * height_;
+    const size_t chroma = static_cast<size_t>(width_ / 2) * (height_ / 2);
+    std::memcpy(frame.data(), raw_.data(), luma);
+    if (format_ == Format::Gray8) {
+        std::memset(frame.data() + luma, 128, 2 * chroma);
+    } else if (format_ == Format::I420) {
+        std::memcpy(frame.data() + luma, raw_.data() + luma, 2 * chroma);
+    } else {
+        // De-interleave NV12 so every source hands out planar chroma.
+        const uint8_t* uv = raw_.data() + luma;
+        uint8_t* u = frame.data() + luma;
+        uint8_t* v = u + chroma;
+        for (size_t i = 0; i < chroma; ++i) {
+            u[i] = uv[2 * i];
+            v[i] = uv[2 * i + 1];
+        }
+    }
+    return true;
+}
+
+bool SyntheticFrameSource::produce(int64_t index, std::vector<uint8_t>& frame) {
+    const int w = width_;
+    const int h = height_;
+    const float t = static_cast<float>(index);
+    const int blockSize = std::max(8, std::min(w, h) / 6);
+    const int bx = static_cast<int>(index * 4 % std::max(1, w - blockSize));
+    const int by = (h - blockSize) / 2;
+
+    std::vector<float> gx(static_cast<size_t>(w));
+    for (int x = 0; x < w; ++x) gx[x] = 40.0f * std::sin(0.05f * x + 0.2f * t);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = frame.data() + static_cast<size_t>(y) * w;
+        const float gy = 40.0f * std::cos(0.07f * y - 0.1f * t);
+        const bool inBand = y >= by && y < by + blockSize;
+        for (int x = 0; x < w; ++x) {
+            const bool inBlock = inBand && x >= bx && x < bx + blockSize;
+            row[x] = inBlock ? 235 : static_cast<uint8_t>(128.0f + gx[x] + gy);
+        }
+    }
+    const size_t luma = static_cast<size_t>(w) * h;
+    std::memset(frame.data() + luma, 128, 2 * static_cast<size_t>(w / 2) * (h / 2));
+    return true;
+}
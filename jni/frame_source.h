@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One YUV 4:2:0 frame as delivered by a source; valid only during the
+// callback. Chroma pointers are null for luma-only sources. chromaPixelStride
+// is 1 for planar (I420) and 2 for semi-planar (NV12 / NV21) layouts.
+struct FrameView {
+    const uint8_t* y = nullptr;
+    const uint8_t* u = nullptr;
+    const uint8_t* v = nullptr;
+    size_t yStride = 0;
+    size_t chromaStride = 0;
+    int chromaPixelStride = 1;
+    int width = 0;
+    int height = 0;
+    int64_t timestampNs = 0;
+};
+
+// ================= Frame Sources =================
+// A producer of frames that calls back on its own thread, so native stages
+// can be fed without a round trip through Java. start() returns once frames
+// are flowing (or failed to); stop() returns only after the last callback has
+// finished, so the callback may reference objects that die right after.
+class FrameSource {
+public:
+    using FrameCallback = std::function<void(const FrameView&)>;
+
+    virtual ~FrameSource() = default;
+
+    virtual bool start(const FrameCallback& callback) = 0;
+    virtual void stop() = 0;
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    virtual const char* name() const = 0;
+};
+
+// Base for sources that generate frames on a worker thread at a fixed rate
+// (fps <= 0 runs as fast as the consumer allows). The worker stops after
+// maxFrames frames when that is positive.
+class ThreadedFrameSource : public FrameSource {
+public:
+    ThreadedFrameSource(int width, int height, double fps, int64_t maxFrames);
+    ~ThreadedFrameSource() override;
+
+    bool start(const FrameCallback& callback) override;
+    void stop() override;
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+
+protected:
+    // Fills frame (width x height luma followed by I420 chroma); returns false
+    // at end of stream.
+    virtual bool produce(int64_t index, std::vector<uint8_t>& frame) = 0;
+    virtual bool open() { return true; }
+
+    const int width_;
+    const int height_;
+
+private:
+    void run();
+
+    const double fps_;
+    const int64_t maxFrames_;
+    FrameCallback callback_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+// Raw frames read back to back from a file, for host benchmarks and replays.
+// Gray frames are width * height bytes; I420 and NV12 add the 4:2:0 chroma.
+class FileFrameSource : public ThreadedFrameSource {
+public:
+    enum class Format { Gray8, I420, NV12 };
+
+    FileFrameSource(std::string path, Format format, int width, int height,
+                    double fps = 0.0, bool loop = false, int64_t maxFrames = 0);
+    ~FileFrameSource() override;
+
+    const char* name() const override { return "file"; }
+
+protected:
+    bool open() override;
+    bool produce(int64_t index, std::vector<uint8_t>& frame) override;
+
+private:
+    size_t frameBytes() const;
+
+    const std::string path_;
+    const Format format_;
+    const bool loop_;
+    int fd_ = -1;
+    std::vector<uint8_t> raw_;
+};
+
+// Deterministic moving test pattern (drifting gratings plus a travelling
+// block), so pipelines can be exercised with no camera or data files.
+class SyntheticFrameSource : public ThreadedFrameSource {
+public:
+    SyntheticFrameSource(int width, int height, double fps = 30.0, int64_t maxFrames = 0)
+        : ThreadedFrameSource(width, height, fps, maxFrames) {}
+    ~SyntheticFrameSource() override { stop(); }
+
+    const char* name() const override { return "synthetic"; }
+
+protected:
+    bool produce(int64_t index, std::vector<uint8_t>& frame) override;
+};
@@ -0,0 +1,102 @@
+#include "guided_upsample.h"
+
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Output pairs per support test: one guidedVoteRow vector step. Blocks with
+// at most kSparsePairs supported pairs are cheaper voted pair by pair.
+constexpr int kVoteBlock = 8;
+constexpr int kSparsePairs = 2;
+
+}  // namespace
+
+GuidedEdgeUpsampler::GuidedEdgeUpsampler(int rangeSigma) {
+    setRangeSigma(rangeSigma);
+}
+
+void GuidedEdgeUpsampler::setRangeSigma(int sigma) {
+    sigma_ = std::max(1, sigma);
+    const double denom = 2.0 * sigma_ * sigma_;
+    for (int d = 0; d < 256; ++d) {
+        rangeLut_[d] = static_cast<uint16_t>(std::lround(256.0 * std::exp(-(d * d) / denom)));
+    }
+}
+
+void GuidedEdgeUpsampler::trim() {
+    std::vector<uint8_t>().swap(support_);
+}
+
+void GuidedEdgeUpsampler::upsample(const uint8_t* fullLuma, size_t lumaStride,
+                                   int width, int height,
+                                   const uint8_t* lowLuma, const uint8_t* lowEdges,
+                                   size_t lowStride,
+                                   uint8_t* dst, size_t dstStride) {
+    const int lw = width / 2;
+    const int lh = height / 2;
+    if (lw <= 0 || lh <= 0) return;
+
+    support_.resize(static_cast<size_t>(lw));
+    uint8_t* support = support_.data();
+
+    for (int y = 0; y < height; ++y) {
+        // Output pixel centre maps to low-res (y - 0.5) / 2: even rows take
+        // 1/4 from the row above and 3/4 from the row below, odd rows the reverse.
+        const int ly0 = std::min(std::max((y - 1) >> 1, 0), lh - 1);
+        const int ly1 = std::min(ly0 + 1, lh - 1);
+        const int wy0 = (y & 1) ? 3 : 1;
+        const int wy1 = 4 - wy0;
+
+        const uint8_t* l0 = lowLuma + ly0 * lowStride;
+        const uint8_t* l1 = lowLuma + ly1 * lowStride;
+        const uint8_t* e0 = lowEdges + ly0 * lowStride;
+        const uint8_t* e1 = lowEdges + ly1 * lowStride;
+        const uint8_t* guide = fullLuma + y * lumaStride;
+        uint8_t* out = dst + y * dstStride;
+
+        // OR of each 2x2 low-res edge neighbourhood, so runs of output pixels
+        // without an edge nearby skip the bilateral vote.
+        kernels::orSupportRow<simd::Native>(e0, e1, lw, support);
+
+        const uint8_t* const lum[2] = {l0, l1};
+        const uint8_t* const edge[2] = {e0, e1};
+        auto votePixel = [&](int x) {
+            const int lx0 = std::min(std::max((x - 1) >> 1, 0), lw - 1);
+            const int lx1 = std::min(lx0 + 1, lw - 1);
+            const int wx0 = (x & 1) ? 3 : 1;
+            const int wx1 = 4 - wx0;
+            const int s[4] = {wy0 * wx0, wy0 * wx1, wy1 * wx0, wy1 * wx1};
+            const int l[4] = {l0[lx0], l0[lx1], l1[lx0], l1[lx1]};
+            const int e[4] = {e0[lx0] != 0, e0[lx1] != 0, e1[lx0] != 0, e1[lx1] != 0};
+            out[x] = kernels::guidedVotePixel(guide[x], l, e, s, rangeLut_);
+        };
+
+        // Interior outputs 2k + 1 and 2k + 2 lie between low columns k and
+        // k + 1. Blocks of pairs are voted a vector at a time when most pairs
+        // have support, pair by pair when few do, and cleared when none do.
+        // Both image borders clamp and are voted per pixel.
+        votePixel(0);
+        for (int k = 0; k < lw - 1; k += kVoteBlock) {
+            const int end = std::min(k + kVoteBlock, lw - 1);
+            int supported = 0;
+            for (int i = k; i < end; ++i) supported += support[i] != 0;
+            if (supported > kSparsePairs) {
+                kernels::guidedVoteRow<simd::Native>(guide, lum, edge, rangeLut_, wy0, k, end, lw, out);
+                continue;
+            }
+            std::memset(out + 2 * k + 1, 0, static_cast<size_t>(2 * (end - k)));
+            for (int i = k; supported > 0 && i < end; ++i) {
+                if (!support[i]) continue;
+                votePixel(2 * i + 1);
+                votePixel(2 * i + 2);
+                --supported;
+            }
+        }
+        for (int x = std::max(1, 2 * lw - 1); x < width; ++x) votePixel(x);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "pyramid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Low-Resolution Edges + Guided Upsampling =================
+// Edges are computed on a 2x-downscaled luma and brought back to display
+// resolution with a joint bilateral vote guided by the full-resolution luma.
+// The result is a single 0 / 255 plane; the output stage interleaves it.
+
+class GuidedEdgeUpsampler {
+public:
+    static constexpr int kDefaultSigma = 12;
+
+    explicit GuidedEdgeUpsampler(int rangeSigma = kDefaultSigma);
+
+    // Range sigma in luma levels; smaller values snap edges harder to luma steps.
+    void setRangeSigma(int sigma);
+    int rangeSigma() const { return sigma_; }
+
+    // fullLuma: width x height guide. lowLuma/lowEdges: (width / 2) x (height / 2),
+    // sharing lowStride; edges are 0 / non-zero. dst receives width x height
+    // edges as 0 / 255.
+    void upsample(const uint8_t* fullLuma, size_t lumaStride, int width, int height,
+                  const uint8_t* lowLuma, const uint8_t* lowEdges, size_t lowStride,
+                  uint8_t* dst, size_t dstStride);
+
+    // Frees the row scratch; the next upsample() reallocates it.
+    void trim();
+
+private:
+    int sigma_;
+    uint16_t rangeLut_[256];  // 8.8 fixed-point exp(-d^2 / 2 sigma^2)
+    std::vector<uint8_t> support_;  // per low-res column: any edge in its 2x2 neighbourhood
+};
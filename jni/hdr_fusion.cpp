@@ -0,0 +1,213 @@
+#include "hdr_fusion.h"
+
+#include "band_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Reflects i into [0, n) without repeating the edge sample (OpenCV's
+// BORDER_REFLECT_101), folding as often as an image smaller than the apron
+// needs.
+inline int mirror(int i, int n) {
+    if (n == 1) return 0;
+    const int period = 2 * (n - 1);
+    i = std::abs(i) % period;
+    return i < n ? i : period - i;
+}
+
+}  // namespace
+
+void ExposureFusion::setParams(const Params& params) {
+    params_ = params;
+    params_.levels = std::min(std::max(params_.levels, 1), 8);
+    params_.tileSize = std::max(params_.tileSize, 1 << params_.levels);
+    const float sigma = std::max(params_.exposureSigma, 0.01f);
+    for (int v = 0; v < 256; ++v) {
+        const float d = v / 255.0f - 0.5f;
+        // Never zero, so a pixel clipped in every frame still has a weight.
+        exposureLut_[v] = static_cast<uint16_t>(std::max(1.0f, 4096.0f * std::exp(-d * d / (2.0f * sigma * sigma))));
+    }
+}
+
+void ExposureFusion::trim() {
+    std::vector<std::unique_ptr<Scratch>> scratch;
+    {
+        std::lock_guard<std::mutex> lock(scratchMutex_);
+        scratch.swap(scratch_);
+    }
+}
+
+std::unique_ptr<ExposureFusion::Scratch> ExposureFusion::takeScratch() {
+    std::lock_guard<std::mutex> lock(scratchMutex_);
+    if (scratch_.empty()) return std::unique_ptr<Scratch>(new Scratch());
+    std::unique_ptr<Scratch> s = std::move(scratch_.back());
+    scratch_.pop_back();
+    return s;
+}
+
+void ExposureFusion::giveScratch(std::unique_ptr<Scratch> scratch) {
+    std::lock_guard<std::mutex> lock(scratchMutex_);
+    scratch_.push_back(std::move(scratch));
+}
+
+bool ExposureFusion::fuse(const uint8_t* const* frames, const size_t* strides, int count,
+                          int width, int height, uint8_t* dst, size_t dstStride) {
+    if (frames == nullptr || strides == nullptr || dst == nullptr ||
+        count < 2 || count > kMaxFrames || width <= 0 || height <= 0) {
+        return false;
+    }
+    const int tile = params_.tileSize;
+    const int tilesX = (width + tile - 1) / tile;
+    const int tilesY = (height + tile - 1) / tile;
+    BandPool::instance().run(tilesX * tilesY, 1, [&](int t0, int t1) {
+        std::unique_ptr<Scratch> s = takeScratch();
+        for (int t = t0; t < t1; ++t) {
+            const int x0 = (t % tilesX) * tile;
+            const int y0 = (t / tilesX) * tile;
+            fuseTile(*s, frames, strides, count, width, height,
+                     x0, y0, std::min(x0 + tile, width), std::min(y0 + tile, height), dst, dstStride);
+        }
+        giveScratch(std::move(s));
+    });
+    return true;
+}
+
+void ExposureFusion::fuseTile(Scratch& s, const uint8_t* const* frames, const size_t* strides, int count,
+                              int width, int height, int x0, int y0, int x1, int y1,
+                              uint8_t* dst, size_t dstStride) const {
+    const int unit = 1 << params_.levels;
+    const int apron = 2 * unit;
+    // Every tile, clipped edge tiles included, covers the full tile plus
+    // apron (rounded up to the coarsest level, so each level halves exactly),
+    // with the image mirrored beyond its borders. All tiles then build
+    // pyramids of the same depth and blend low frequencies alike on both
+    // sides of a tile boundary.
+    const int ex0 = x0 - apron;
+    const int ey0 = y0 - apron;
+    const int tw = (params_.tileSize + 2 * apron + unit - 1) / unit * unit;
+    const int th = tw;
+    const size_t area = static_cast<size_t>(tw) * th;
+
+    const bool inside = ex0 >= 0 && ex0 + tw <= width;
+    if (!inside) {
+        s.columns.resize(tw);
+        for (int x = 0; x < tw; ++x) s.columns[x] = mirror(ex0 + x, width);
+    }
+    for (int k = 0; k < count; ++k) {
+        s.image[k].resize(area);
+        for (int y = 0; y < th; ++y) {
+            const uint8_t* src = frames[k] + mirror(ey0 + y, height) * strides[k];
+            uint8_t* d = s.image[k].data() + static_cast<size_t>(y) * tw;
+            if (inside) {
+                std::memcpy(d, src + ex0, tw);
+            } else {
+                for (int x = 0; x < tw; ++x) d[x] = src[s.columns[x]];
+            }
+        }
+        s.weight[k].resize(area);
+    }
+
+    // Weights: contrast x well-exposedness, normalised to sum to 255 per pixel.
+    int32_t raw[kMaxFrames];
+    for (int y = 0; y < th; ++y) {
+        const size_t up = static_cast<size_t>(y > 0 ? y - 1 : 0) * tw;
+        const size_t row = static_cast<size_t>(y) * tw;
+        const size_t down = static_cast<size_t>(y + 1 < th ? y + 1 : y) * tw;
+        for (int x = 0; x < tw; ++x) {
+            const int l = x > 0 ? x - 1 : 0;
+            const int r = x + 1 < tw ? x + 1 : x;
+            int32_t sum = 0;
+            for (int k = 0; k < count; ++k) {
+                const uint8_t* p = s.image[k].data();
+                const int v = p[row + x];
+                const int lap = std::abs(4 * v - p[row + l] - p[row + r] - p[up + x] - p[down + x]);
+                raw[k] = (lap + 1) * exposureLut_[v];
+                sum += raw[k];
+            }
+            const float scale = 255.0f / static_cast<float>(sum);
+            for (int k = 0; k < count; ++k) {
+                s.weight[k][row + x] = static_cast<uint8_t>(static_cast<float>(raw[k]) * scale + 0.5f);
+            }
+        }
+    }
+
+    for (int k = 0; k < count; ++k) {
+        s.imagePyr[k].build(s.image[k].data(), tw, tw, th, params_.levels);
+        s.weightPyr[k].build(s.weight[k].data(), tw, tw, th, params_.levels);
+    }
+    const int levels = s.imagePyr[0].levels();
+
+    size_t offsets[9];
+    size_t total = 0;
+    for (int i = 0; i <= levels; ++i) {
+        offsets[i] = total;
+        total += static_cast<size_t>(tw >> i) * (th >> i);
+    }
+    s.fused.resize(total);
+    s.weightSum.resize(area);
+    s.valueSum.resize(area);
+    s.coarse.resize(area / 4);
+    s.up.resize(area);
+
+    auto image = [&](int k, int i) {
+        return i == 0 ? s.image[k].data() : s.imagePyr[k].level(i).data();
+    };
+    auto weight = [&](int k, int i) {
+        return i == 0 ? s.weight[k].data() : s.weightPyr[k].level(i).data();
+    };
+
+    // Blend Laplacian levels, then the coarsest Gaussian level.
+    for (int i = 0; i <= levels; ++i) {
+        const int lw = tw >> i, lh = th >> i;
+        const size_t n = static_cast<size_t>(lw) * lh;
+        std::fill(s.weightSum.begin(), s.weightSum.begin() + n, 0);
+        std::fill(s.valueSum.begin(), s.valueSum.begin() + n, 0);
+        for (int k = 0; k < count; ++k) {
+            const uint8_t* g = image(k, i);
+            const uint8_t* w = weight(k, i);
+            if (i < levels) {
+                const uint8_t* next = image(k, i + 1);
+                const size_t cn = n / 4;
+                for (size_t j = 0; j < cn; ++j) s.coarse[j] = next[j];
+                upsample2x(s.coarse.data(), lw / 2, lw / 2, lh / 2, s.up.data(), lw);
+                for (size_t j = 0; j < n; ++j) {
+                    s.valueSum[j] += w[j] * (g[j] - s.up[j]);
+                    s.weightSum[j] += w[j];
+                }
+            } else {
+                for (size_t j = 0; j < n; ++j) {
+                    s.valueSum[j] += w[j] * g[j];
+                    s.weightSum[j] += w[j];
+                }
+            }
+        }
+        int16_t* f = s.fused.data() + offsets[i];
+        for (size_t j = 0; j < n; ++j) {
+            const int32_t ws = s.weightSum[j];
+            f[j] = ws > 0 ? static_cast<int16_t>(std::lrint(static_cast<float>(s.valueSum[j]) / static_cast<float>(ws))) : 0;
+        }
+    }
+
+    // Collapse: each level becomes upsample(coarser reconstruction) + its band.
+    for (int i = levels - 1; i >= 0; --i) {
+        const int lw = tw >> i, lh = th >> i;
+        const size_t n = static_cast<size_t>(lw) * lh;
+        upsample2x(s.fused.data() + offsets[i + 1], lw / 2, lw / 2, lh / 2, s.up.data(), lw);
+        int16_t* f = s.fused.data() + offsets[i];
+        for (size_t j = 0; j < n; ++j) {
+            f[j] = static_cast<int16_t>(std::min(std::max(f[j] + s.up[j], -32768), 32767));
+        }
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        const int16_t* f = s.fused.data() + static_cast<size_t>(y - ey0) * tw + (x0 - ex0);
+        uint8_t* d = dst + y * dstStride;
+        for (int x = 0; x < x1 - x0; ++x) {
+            d[x0 + x] = static_cast<uint8_t>(std::min(std::max<int>(f[x], 0), 255));
+        }
+    }
+}
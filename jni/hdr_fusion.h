@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pyramid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ================= Exposure Fusion =================
+// Mertens-style fusion of an exposure bracket of luma planes into one 8-bit
+// luma. Per-pixel weights are local contrast (|3x3 Laplacian|) times
+// well-exposedness (a Gaussian around mid-grey); each frame's Laplacian
+// pyramid is blended with its LumaPyramid of weights and the result
+// collapsed. The image is processed in tiles with an apron of two coarsest-
+// level pixels, mirrored past the image borders so every tile has the same
+// size and pyramid depth; tiles run on the BandPool, and scratch is bounded
+// by tile size times worker count regardless of the image size.
+class ExposureFusion {
+public:
+    static constexpr int kMaxFrames = 5;
+
+    struct Params {
+        int levels = 5;
+        int tileSize = 256;
+        float exposureSigma = 0.2f;  // of the well-exposedness Gaussian, in [0, 1] luma
+    };
+
+    ExposureFusion() { setParams(Params()); }
+    explicit ExposureFusion(const Params& params) { setParams(params); }
+
+    void setParams(const Params& params);
+    const Params& params() const { return params_; }
+
+    // Frees the tile scratch kept between brackets; the weight LUT stays.
+    void trim();
+
+    // Fuses `count` (2..kMaxFrames) width x height planes into dst.
+    bool fuse(const uint8_t* const* frames, const size_t* strides, int count,
+              int width, int height, uint8_t* dst, size_t dstStride);
+
+private:
+    struct Scratch {
+        std::vector<uint8_t> image[kMaxFrames];
+        std::vector<uint8_t> weight[kMaxFrames];
+        LumaPyramid imagePyr[kMaxFrames];
+        LumaPyramid weightPyr[kMaxFrames];
+        std::vector<int16_t> fused;     // all levels, finest first
+        std::vector<int16_t> coarse;    // G(i + 1) widened to int16
+        std::vector<int16_t> up;
+        std::vector<int32_t> weightSum;
+        std::vector<int32_t> valueSum;
+        std::vector<int> columns;       // source column of each tile column, for edge tiles
+    };
+
+    std::unique_ptr<Scratch> takeScratch();
+    void giveScratch(std::unique_ptr<Scratch> scratch);
+    void fuseTile(Scratch& s, const uint8_t* const* frames, const size_t* strides, int count,
+                  int width, int height, int x0, int y0, int x1, int y1,
+                  uint8_t* dst, size_t dstStride) const;
+
+    Params params_;
+    uint16_t exposureLut_[256];  // well-exposedness in Q12
+
+    std::mutex scratchMutex_;
+    std::vector<std::unique_ptr<Scratch>> scratch_;
+};
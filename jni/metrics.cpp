@@ -0,0 +1,164 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)), counts_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+    for (size_t i = 0; i <= bounds_.size(); ++i) counts_[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::observe(double v) {
+    size_t i = 0;
+    while (i < bounds_.size() && v > bounds_[i]) ++i;
+    counts_[i].fetch_add(1, std::memory_order_relaxed);
+    double sum = sum_.load(std::memory_order_relaxed);
+    while (!sum_.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t Histogram::count() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i <= bounds_.size(); ++i) total += bucketCount(i);
+    return total;
+}
+
+std::vector<double> latencyBuckets() {
+    return {0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066, 0.133};
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(const std::string& name, const std::string& help,
+                                                 Type type, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family* family = nullptr;
+    for (const auto& f : families_) {
+        if (f->name == name) {
+            family = f.get();
+            break;
+        }
+    }
+    if (family == nullptr) {
+        families_.emplace_back(new Family{name, help, type, {}});
+        family = families_.back().get();
+    }
+    for (const auto& s : family->series) {
+        if (s->labels == labels) return *s;
+    }
+    family->series.emplace_back(new Series());
+    family->series.back()->labels = labels;
+    return *family->series.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    Series& s = series(name, help, Type::Counter, labels);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!s.counter) s.counter.reset(new Counter());
+    return *s.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    Series& s = series(name, help, Type::Gauge, labels);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!s.gauge) s.gauge.reset(new Gauge());
+    return *s.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      const std::vector<double>& bounds, const std::string& labels) {
+    Series& s = series(name, help, Type::Histogram, labels);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!s.histogram) s.histogram.reset(new Histogram(bounds));
+    return *s.histogram;
+}
+
+void MetricsRegistry::callbackGauge(const std::string& name, const std::string& help,
+                                    std::function<double()> fn, const std::string& labels) {
+    Series& s = series(name, help, Type::Gauge, labels);
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.callback = std::move(fn);
+}
+
+static void appendf(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void appendf(std::string& out, const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    const int n = std::vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n > 0) out.append(buf, std::min<size_t>(static_cast<size_t>(n), sizeof(buf) - 1));
+}
+
+static void appendValue(std::string& out, double v) {
+    if (std::isnan(v)) {
+        out += "NaN";
+    } else if (std::isinf(v)) {
+        out += v > 0 ? "+Inf" : "-Inf";
+    } else {
+        appendf(out, "%.9g", v);
+    }
+}
+
+// name{labels} or name{labels,extra}
+static void appendSeriesName(std::string& out, const std::string& name, const char* suffix,
+                             const std::string& labels, const char* extra = "") {
+    out += name;
+    out += suffix;
+    if (labels.empty() && *extra == '\0') return;
+    out += '{';
+    out += labels;
+    if (!labels.empty() && *extra != '\0') out += ',';
+    out += extra;
+    out += '}';
+}
+
+void MetricsRegistry::render(std::string& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& f : families_) {
+        static const char* const kTypeNames[] = {"counter", "gauge", "histogram"};
+        appendf(out, "# HELP %s %s\n# TYPE %s %s\n", f->name.c_str(), f->help.c_str(),
+                f->name.c_str(), kTypeNames[static_cast<int>(f->type)]);
+        for (const auto& s : f->series) {
+            if (s->histogram) {
+                const Histogram& h = *s->histogram;
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i <= h.bounds().size(); ++i) {
+                    cumulative += h.bucketCount(i);
+                    char le[48];
+                    if (i < h.bounds().size()) {
+                        std::snprintf(le, sizeof(le), "le=\"%g\"", h.bounds()[i]);
+                    } else {
+                        std::snprintf(le, sizeof(le), "le=\"+Inf\"");
+                    }
+                    appendSeriesName(out, f->name, "_bucket", s->labels, le);
+                    appendf(out, " %" PRIu64 "\n", cumulative);
+                }
+                appendSeriesName(out, f->name, "_sum", s->labels);
+                out += ' ';
+                appendValue(out, h.sum());
+                out += '\n';
+                appendSeriesName(out, f->name, "_count", s->labels);
+                appendf(out, " %" PRIu64 "\n", cumulative);
+            } else {
+                appendSeriesName(out, f->name, "", s->labels);
+                out += ' ';
+                if (s->counter) {
+                    appendf(out, "%" PRIu64, s->counter->value());
+                } else if (s->callback) {
+                    appendValue(out, s->callback());
+                } else {
+                    appendValue(out, s->gauge ? s->gauge->value() : 0.0);
+                }
+                out += '\n';
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ================= Metrics Registry =================
+// Process-wide counters, gauges and histograms rendered in the Prometheus
+// text exposition format. Metrics are registered once (under a mutex) and the
+// returned references stay valid for the life of the process; updating them
+// is a relaxed atomic operation, so hot paths never lock or allocate.
+// Rendering only reads the atomics.
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(double v) { value_.store(v, std::memory_order_relaxed); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Fixed upper bucket bounds (ascending, +Inf implied). observe() is a short
+// linear scan plus two relaxed atomic adds.
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double v);
+
+    const std::vector<double>& bounds() const { return bounds_; }
+    // Per-bucket (not cumulative) count; i == bounds().size() is the +Inf bucket.
+    uint64_t bucketCount(size_t i) const { return counts_[i].load(std::memory_order_relaxed); }
+    double sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t count() const;
+
+private:
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<double> sum_{0.0};
+};
+
+// Latency buckets in seconds, 0.5 ms .. 133 ms.
+std::vector<double> latencyBuckets();
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // Returns the series with this name and label set, creating it on first
+    // use. `labels` is the inside of the braces, e.g. stage="edges". A name
+    // keeps the type and help it was first registered with.
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         const std::vector<double>& bounds, const std::string& labels = "");
+
+    // A gauge whose value is computed by `fn` at render time, for values
+    // that are too costly to maintain on the frame path (RSS, sysfs reads).
+    // `fn` runs under the registry lock and must not register metrics.
+    void callbackGauge(const std::string& name, const std::string& help,
+                       std::function<double()> fn, const std::string& labels = "");
+
+    // Appends the exposition text for every metric to `out`.
+    void render(std::string& out) const;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+private:
+    MetricsRegistry() = default;
+
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> callback;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<std::unique_ptr<Series>> series;
+    };
+
+    Series& series(const std::string& name, const std::string& help, Type type, const std::string& labels);
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Family>> families_;
+};
@@ -0,0 +1,120 @@
+#include "metrics_exporter.h"
+
+#include "metrics.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// A client gets this long to send its request line (if any) and to take the
+// response; a stuck scraper must not wedge the exporter.
+static constexpr int kClientTimeoutMs = 200;
+
+bool MetricsExporter::start(const std::string& address) {
+    if (running() || address.empty()) return false;
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const bool abstract = address[0] == '@';
+    const std::string name = abstract ? address.substr(1) : address;
+    if (name.empty() || name.size() >= sizeof(addr.sun_path) - (abstract ? 1 : 0)) return false;
+    // Abstract names start with a NUL byte and are not NUL-terminated.
+    std::memcpy(addr.sun_path + (abstract ? 1 : 0), name.data(), name.size());
+    const socklen_t addrLen = static_cast<socklen_t>(
+            offsetof(sockaddr_un, sun_path) + (abstract ? 1 : 0) + name.size() + (abstract ? 0 : 1));
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (!abstract) unlink(name.c_str());  // a stale socket from a previous run
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), addrLen) != 0 || listen(fd, 4) != 0 ||
+        pipe2(wakeFds_, O_CLOEXEC) != 0) {
+        close(fd);
+        return false;
+    }
+    listenFd_ = fd;
+    address_ = address;
+    thread_ = std::thread(&MetricsExporter::run, this);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    if (!thread_.joinable()) return;
+    const char byte = 0;
+    (void)!write(wakeFds_[1], &byte, 1);
+    thread_.join();
+    close(listenFd_);
+    close(wakeFds_[0]);
+    close(wakeFds_[1]);
+    listenFd_ = wakeFds_[0] = wakeFds_[1] = -1;
+    if (address_[0] != '@') unlink(address_.c_str());
+    address_.clear();
+}
+
+void MetricsExporter::run() {
+    pollfd fds[2] = {{listenFd_, POLLIN, 0}, {wakeFds_[0], POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents != 0) return;
+        if (fds[0].revents & POLLIN) {
+            const int client = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client >= 0) {
+                serve(client);
+                close(client);
+            }
+        }
+    }
+}
+
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        pollfd p = {fd, POLLOUT, 0};
+        if (poll(&p, 1, kClientTimeoutMs) <= 0) return false;
+        const ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void MetricsExporter::serve(int client) {
+    // Peek for a request; plain `nc -U` / socat clients send nothing.
+    char request[512];
+    size_t received = 0;
+    bool http = false;
+    pollfd p = {client, POLLIN, 0};
+    while (received < sizeof(request) && poll(&p, 1, kClientTimeoutMs) > 0) {
+        const ssize_t n = recv(client, request + received, sizeof(request) - received, 0);
+        if (n <= 0) break;
+        received += static_cast<size_t>(n);
+        if (received < 4) continue;
+        http = std::memcmp(request, "GET ", 4) == 0;
+        // Headers end with an empty line; anything else is not waited for.
+        if (!http || std::memcmp(request + received - 4, "\r\n\r\n", 4) == 0) break;
+    }
+
+    buffer_.clear();
+    MetricsRegistry::instance().render(buffer_);
+    if (http) {
+        char header[160];
+        const int n = std::snprintf(header, sizeof(header),
+                                    "HTTP/1.0 200 OK\r\n"
+                                    "Content-Type: text/plain; version=0.0.4\r\n"
+                                    "Content-Length: %zu\r\n\r\n",
+                                    buffer_.size());
+        if (!writeAll(client, header, static_cast<size_t>(n))) return;
+    }
+    writeAll(client, buffer_.data(), buffer_.size());
+}
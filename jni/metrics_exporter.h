@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+// ================= Metrics Exporter =================
+// Serves MetricsRegistry snapshots on a local stream socket from its own
+// thread. Each connection gets one snapshot and is closed. A client that
+// sends an HTTP request line first (curl --unix-socket, a Prometheus sidecar)
+// gets an HTTP/1.0 response; one that sends nothing gets the bare text.
+// Nothing here runs on, or waits for, the frame path.
+class MetricsExporter {
+public:
+    MetricsExporter() = default;
+    ~MetricsExporter() { stop(); }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // `address` is a filesystem path, or "@name" for the abstract namespace.
+    bool start(const std::string& address);
+    void stop();
+
+    bool running() const { return thread_.joinable(); }
+    const std::string& address() const { return address_; }
+
+private:
+    void run();
+    void serve(int client);
+
+    std::string address_;
+    int listenFd_ = -1;
+    int wakeFds_[2] = {-1, -1};  // pipe that interrupts poll() on stop()
+    std::thread thread_;
+    std::string buffer_;  // exporter thread only
+};
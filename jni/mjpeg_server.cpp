@@ -0,0 +1,328 @@
+#include "mjpeg_server.h"
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr const char* kBoundary = "flamframe";
+static constexpr int kSocketTimeoutMs = 2000;
+
+using Clock = std::chrono::steady_clock;
+
+struct MjpegServer::Client {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> done{false};
+};
+
+static int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static bool sendAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;  // includes the SO_SNDTIMEO timeout
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool sendText(int fd, const char* text) {
+    return sendAll(fd, text, std::strlen(text));
+}
+
+// Value of `key` in a "a=1&b=2" query string, or `fallback`.
+static int queryInt(const std::string& query, const char* key, int fallback) {
+    const size_t keyLen = std::strlen(key);
+    size_t pos = 0;
+    while (pos < query.size()) {
+        const size_t end = std::min(query.find('&', pos), query.size());
+        if (end - pos > keyLen && query.compare(pos, keyLen, key) == 0 && query[pos + keyLen] == '=') {
+            return std::atoi(query.c_str() + pos + keyLen + 1);
+        }
+        pos = end + 1;
+    }
+    return fallback;
+}
+
+MjpegServer::MjpegServer()
+    : clientsGauge_(MetricsRegistry::instance().gauge("flam_mjpeg_clients", "Connected MJPEG preview clients")),
+      encoded_(MetricsRegistry::instance().counter("flam_mjpeg_encoded_total", "Frames JPEG-encoded for preview")),
+      sentFrames_(MetricsRegistry::instance().counter("flam_mjpeg_sent_frames_total", "Preview frames sent to clients")),
+      sentBytes_(MetricsRegistry::instance().counter("flam_mjpeg_sent_bytes_total", "Preview bytes sent to clients")) {}
+
+MjpegServer::~MjpegServer() {
+    stop();
+}
+
+bool MjpegServer::start(const Options& options, Encoder encoder) {
+    if (running() || !encoder || options.maxFps <= 0 || options.maxKbps <= 0) return false;
+
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    addr.sin_addr.s_addr = htonl(options.lan ? INADDR_ANY : INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0 || pipe2(wakeFds_, O_CLOEXEC) != 0) {
+        close(fd);
+        return false;
+    }
+    listenFd_ = fd;
+    port_ = ntohs(addr.sin_port);
+    options_ = options;
+    options_.quality = std::max(1, std::min(100, options.quality));
+    options_.maxClients = std::max(1, options.maxClients);
+    encoder_ = std::move(encoder);
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        stop_ = false;
+        hasPending_ = false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(frameMutex_);
+        frame_.reset();
+    }
+    encodeThread_ = std::thread(&MjpegServer::encodeLoop, this);
+    acceptThread_ = std::thread(&MjpegServer::acceptLoop, this);
+    return true;
+}
+
+void MjpegServer::stop() {
+    if (!acceptThread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> pendingLock(pendingMutex_);
+        std::lock_guard<std::mutex> frameLock(frameMutex_);
+        stop_ = true;
+    }
+    pendingReady_.notify_all();
+    frameReady_.notify_all();
+    const char byte = 0;
+    (void)!write(wakeFds_[1], &byte, 1);
+    acceptThread_.join();
+    reapClients(true);
+    encodeThread_.join();
+
+    close(listenFd_);
+    close(wakeFds_[0]);
+    close(wakeFds_[1]);
+    listenFd_ = wakeFds_[0] = wakeFds_[1] = -1;
+    port_ = 0;
+}
+
+void MjpegServer::submit(const uint8_t* pixels, size_t stride, int channels, int width, int height) {
+    if (clients_.load(std::memory_order_relaxed) == 0) return;
+    if (pixels == nullptr || width <= 0 || height <= 0 || (channels != 1 && channels != 4)) return;
+
+    const int64_t now = steadyNs();
+    if (now - lastSubmitNs_.load(std::memory_order_relaxed) < 1000000000LL / options_.maxFps) return;
+    std::unique_lock<std::mutex> lock(pendingMutex_, std::try_to_lock);
+    if (!lock.owns_lock()) return;  // never wait on the frame path
+    lastSubmitNs_.store(now, std::memory_order_relaxed);
+
+    const size_t rowBytes = static_cast<size_t>(width) * channels;
+    pending_.resize(rowBytes * height);
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(pending_.data() + rowBytes * y, pixels + stride * y, rowBytes);
+    }
+    pendingChannels_ = channels;
+    pendingWidth_ = width;
+    pendingHeight_ = height;
+    hasPending_ = true;
+    lock.unlock();
+    pendingReady_.notify_one();
+}
+
+void MjpegServer::encodeLoop() {
+    std::vector<uint8_t> raw;
+    for (;;) {
+        int channels, width, height;
+        {
+            std::unique_lock<std::mutex> lock(pendingMutex_);
+            pendingReady_.wait(lock, [this] { return stop_ || hasPending_; });
+            if (stop_) return;
+            raw.swap(pending_);
+            channels = pendingChannels_;
+            width = pendingWidth_;
+            height = pendingHeight_;
+            hasPending_ = false;
+        }
+        std::shared_ptr<std::vector<uint8_t>> jpeg(new std::vector<uint8_t>());
+        if (!encoder_(raw.data(), static_cast<size_t>(width) * channels, channels, width, height,
+                      options_.quality, *jpeg)) {
+            continue;
+        }
+        encoded_.inc();
+        {
+            std::lock_guard<std::mutex> lock(frameMutex_);
+            frame_ = std::move(jpeg);
+            ++generation_;
+        }
+        frameReady_.notify_all();
+    }
+}
+
+void MjpegServer::acceptLoop() {
+    pollfd fds[2] = {{listenFd_, POLLIN, 0}, {wakeFds_[0], POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents != 0) return;
+        if (!(fds[0].revents & POLLIN)) continue;
+        const int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+
+        timeval timeout = {kSocketTimeoutMs / 1000, (kSocketTimeoutMs % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        reapClients(false);
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        if (static_cast<int>(clientList_.size()) >= options_.maxClients) {
+            sendText(fd, "HTTP/1.0 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+            close(fd);
+            continue;
+        }
+        std::unique_ptr<Client> client(new Client());
+        client->fd = fd;
+        Client* c = client.get();
+        client->thread = std::thread([this, c] {
+            serve(c);
+            // The fd stays open until the client is reaped; end the
+            // response now so one-shot replies do not wait for that.
+            shutdown(c->fd, SHUT_RDWR);
+            c->done = true;
+        });
+        clientList_.push_back(std::move(client));
+    }
+}
+
+// Joins finished client threads, or all of them (after shutting their
+// sockets down) when the server stops.
+void MjpegServer::reapClients(bool all) {
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    for (auto it = clientList_.begin(); it != clientList_.end();) {
+        Client& c = **it;
+        if (!all && !c.done) {
+            ++it;
+            continue;
+        }
+        if (all) shutdown(c.fd, SHUT_RDWR);
+        c.thread.join();
+        close(c.fd);
+        it = clientList_.erase(it);
+    }
+}
+
+void MjpegServer::serve(Client* client) {
+    const int fd = client->fd;
+    char request[1024];
+    size_t received = 0;
+    while (received < sizeof(request) - 1) {
+        const ssize_t n = recv(fd, request + received, sizeof(request) - 1 - received, 0);
+        if (n <= 0) return;
+        received += static_cast<size_t>(n);
+        request[received] = '\0';
+        if (std::strstr(request, "\r\n\r\n") != nullptr || std::strstr(request, "\n\n") != nullptr) break;
+    }
+    request[received] = '\0';
+    if (std::strncmp(request, "GET ", 4) != 0) {
+        sendText(fd, "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n");
+        return;
+    }
+    const char* target = request + 4;
+    const std::string uri(target, std::strcspn(target, " \r\n"));
+    const size_t question = uri.find('?');
+    const std::string path = uri.substr(0, question);
+    const std::string query = question == std::string::npos ? "" : uri.substr(question + 1);
+    const bool snapshot = path == "/snapshot.jpg";
+    if (!snapshot && path != "/" && path != "/stream") {
+        sendText(fd, "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        return;
+    }
+    const int fps = std::max(1, std::min(options_.maxFps, queryInt(query, "fps", options_.maxFps)));
+    const int kbps = std::max(1, std::min(options_.maxKbps, queryInt(query, "kbps", options_.maxKbps)));
+
+    clientsGauge_.set(clients_.fetch_add(1) + 1);
+    uint64_t seen;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex_);
+        seen = generation_;  // wait for a frame encoded after connecting
+    }
+
+    if (snapshot) {
+        std::shared_ptr<const std::vector<uint8_t>> frame;
+        {
+            std::unique_lock<std::mutex> lock(frameMutex_);
+            frameReady_.wait_for(lock, std::chrono::milliseconds(kSocketTimeoutMs),
+                                 [&] { return stop_ || generation_ != seen; });
+            if (generation_ != seen) frame = frame_;
+        }
+        if (frame) {
+            char header[128];
+            std::snprintf(header, sizeof(header),
+                          "HTTP/1.0 200 OK\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n", frame->size());
+            if (sendText(fd, header) && sendAll(fd, frame->data(), frame->size())) {
+                sentFrames_.inc();
+                sentBytes_.inc(frame->size());
+            }
+        } else {
+            sendText(fd, "HTTP/1.0 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+        }
+    } else {
+        char header[192];
+        std::snprintf(header, sizeof(header),
+                      "HTTP/1.0 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=%s\r\n"
+                      "Cache-Control: no-cache\r\nConnection: close\r\n\r\n", kBoundary);
+        bool ok = sendText(fd, header);
+        const auto framePeriod = std::chrono::nanoseconds(1000000000LL / fps);
+        Clock::time_point nextSend = Clock::now();
+        while (ok) {
+            std::shared_ptr<const std::vector<uint8_t>> frame;
+            {
+                std::unique_lock<std::mutex> lock(frameMutex_);
+                // Honour the fps / bitrate budget first, then take the newest frame.
+                frameReady_.wait_until(lock, nextSend, [this] { return stop_.load(); });
+                frameReady_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) break;
+                frame = frame_;
+                seen = generation_;
+            }
+            char part[128];
+            std::snprintf(part, sizeof(part), "--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                          kBoundary, frame->size());
+            const Clock::time_point sentAt = Clock::now();
+            ok = sendText(fd, part) && sendAll(fd, frame->data(), frame->size()) && sendText(fd, "\r\n");
+            if (!ok) break;
+            sentFrames_.inc();
+            sentBytes_.inc(frame->size());
+            const auto budget = std::chrono::nanoseconds(static_cast<int64_t>(frame->size()) * 8000000LL / kbps);
+            nextSend = sentAt + std::max<Clock::duration>(framePeriod, budget);
+        }
+    }
+    clientsGauge_.set(clients_.fetch_sub(1) - 1);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Counter;
+class Gauge;
+
+// ================= MJPEG Preview Server =================
+// Streams processed frames as multipart JPEG over HTTP for headless units:
+//   GET /            multipart/x-mixed-replace stream (a browser or VLC shows it)
+//   GET /snapshot.jpg the latest frame
+// Query parameters fps= and kbps= lower a client's caps below the server's.
+//
+// submit() is called from the frame path. With no client connected it is a
+// single atomic load. Otherwise it is rate-limited to the server's fps cap
+// and copies the frame into a pending slot that the encoder thread picks up;
+// a newer frame replaces one not yet encoded (latest frame wins), and if the
+// encoder holds the slot the frame is skipped rather than waited for. Each
+// client has its own thread that sends the newest encoded frame when its fps
+// and bitrate budget allow, so a slow viewer skips frames without slowing
+// anybody else.
+class MjpegServer {
+public:
+    // Compresses 1 (gray) or 4 (RGBA) channel pixels; called on the encoder thread.
+    using Encoder = std::function<bool(const uint8_t* pixels, size_t stride, int channels,
+                                       int width, int height, int quality, std::vector<uint8_t>& jpeg)>;
+
+    struct Options {
+        bool lan = false;  // bind 0.0.0.0 instead of 127.0.0.1
+        int port = 8080;   // 0 picks a free port (see port())
+        int maxFps = 10;
+        int maxKbps = 4000;  // per client
+        int quality = 70;
+        int maxClients = 4;
+    };
+
+    MjpegServer();
+    ~MjpegServer();
+
+    MjpegServer(const MjpegServer&) = delete;
+    MjpegServer& operator=(const MjpegServer&) = delete;
+
+    bool start(const Options& options, Encoder encoder);
+    void stop();
+    bool running() const { return acceptThread_.joinable(); }
+    int port() const { return port_; }
+
+    void submit(const uint8_t* pixels, size_t stride, int channels, int width, int height);
+
+private:
+    struct Client;
+
+    void acceptLoop();
+    void encodeLoop();
+    void serve(Client* client);
+    void reapClients(bool all);
+
+    Options options_;
+    Encoder encoder_;
+    int listenFd_ = -1;
+    int wakeFds_[2] = {-1, -1};
+    int port_ = 0;
+    std::thread acceptThread_;
+    std::thread encodeThread_;
+
+    std::atomic<int> clients_{0};  // streaming clients; read first by submit()
+    std::atomic<int64_t> lastSubmitNs_{0};
+
+    // Raw frame waiting for the encoder.
+    std::mutex pendingMutex_;
+    std::condition_variable pendingReady_;
+    std::vector<uint8_t> pending_;
+    int pendingChannels_ = 0;
+    int pendingWidth_ = 0;
+    int pendingHeight_ = 0;
+    bool hasPending_ = false;
+
+    std::atomic<bool> stop_{false};  // checked by every wait; set under each waiter's mutex
+
+    // Latest encoded frame, shared by all clients.
+    std::mutex frameMutex_;
+    std::condition_variable frameReady_;
+    std::shared_ptr<const std::vector<uint8_t>> frame_;
+    uint64_t generation_ = 0;
+
+    std::mutex clientsMutex_;
+    std::vector<std::unique_ptr<Client>> clientList_;
+
+    Gauge& clientsGauge_;
+    Counter& encoded_;
+    Counter& sentFrames_;
+    Counter& sentBytes_;
+};
@@ -0,0 +1,64 @@
+// Startup info library (libflam_rnd_info.so).
+//
+// MainActivity only needs a greeting, the NDK details and the OpenCV version to
+// draw its first screen. Those live here, in a library that links nothing but
+// liblog, so app start does not pay for mapping and relocating the processing
+// library and OpenCV. The heavy library is loaded on demand by NativeLoader.
+
+#include <jni.h>
+#include <string>
+#include <android/log.h>
+
+// The version macros are header-only; this library never links OpenCV.
+#ifdef HAVE_OPENCV
+#include <opencv2/core/version.hpp>
+#endif
+
+#define TAG "FlameRnDNative"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
+
+// ================= Basic Native Functions =================
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_flam_rnd_MainActivity_stringFromJNI(
+        JNIEnv* env,
+        jobject /* this */) {
+    std::string hello = "Hello from C++ NDK!";
+    LOGI("Native function called successfully");
+    return env->NewStringUTF(hello.c_str());
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_MainActivity_getOpenCVVersion(
+        JNIEnv* env,
+        jobject /* this */) {
+    (void)env;
+#ifdef HAVE_OPENCV
+    int version = CV_VERSION_MAJOR * 10000 + CV_VERSION_MINOR * 100 + CV_VERSION_REVISION;
+    LOGI("OpenCV version: %d", version);
+    return version;
+#else
+    LOGI("OpenCV not yet configured");
+    return 0;
+#endif
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_flam_rnd_MainActivity_getNDKInfo(
+        JNIEnv* env,
+        jobject /* this */) {
+
+    std::string info = "NDK Info:\n";
+#if defined(__aarch64__) || defined(__arm__)
+    info += "- Architecture: ARM\n";
+#elif defined(__i386__) || defined(__x86_64__)
+    info += "- Architecture: x86\n";
+#else
+    info += "- Architecture: Unknown\n";
+#endif
+
+    info += "- API Level: " + std::to_string(__ANDROID_API__) + "\n";
+    info += "- C++ Standard: " + std::to_string(__cplusplus) + "\n";
+
+    LOGI("NDK Info requested: %s", info.c_str());
+    return env->NewStringUTF(info.c_str());
+}
@@ -309,13 +309,41 @@
 #include <jni.h>
 #include <string>
 #include <android/log.h>
+#include <android/bitmap.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "bayer.h"
+#include "camera_frame_source.h"
+#include "frame_source.h"
+#include "metrics.h"
+#include "metrics_exporter.h"
+#include "mjpeg_server.h"
+#include "phash.h"
+#include "pixel_format.h"
+#include "planar_image.h"
+#include "quality_metrics.h"
+#include "rgba_pack.h"
+#include "sampling_profiler.h"
+#include "session.h"
+#include "simd_check.h"
+#include "thermal_monitor.h"
+#include "thinning.h"
+#include "thumb_atlas.h"
+#include "yuv_pack.h"
 
 // ================= Enable OpenCV =================
 // Make sure HAVE_OPENCV is defined in CMakeLists.txt
 #ifdef HAVE_OPENCV
 #include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #endif
 
@@ -324,29 +352,8 @@
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
 
 // ================= Basic Native Functions =================
-extern "C" JNIEXPORT jstring JNICALL
-Java_com_flam_rnd_MainActivity_stringFromJNI(
-        JNIEnv* env,
-        jobject /* this */) {
-    std::string hello = "Hello from C++ NDK!";
-    LOGI("Native function called successfully");
-    return env->NewStringUTF(hello.c_str());
-}
-
-extern "C" JNIEXPORT jint JNICALL
-Java_com_flam_rnd_MainActivity_getOpenCVVersion(
-        JNIEnv* env,
-        jobject /* this */) {
-#ifdef HAVE_OPENCV
-    int version = CV_VERSION_MAJOR * 10000 + CV_VERSION_MINOR * 100 + CV_VERSION_REVISION;
-    LOGI("OpenCV version: %d", version);
-    return version;
-#else
-    LOGI("OpenCV not yet configured");
-    return 0;
-#endif
-}
-
+// stringFromJNI, getOpenCVVersion and getNDKInfo live in native_info.cpp
+// (libflam_rnd_info.so) so that app start does not load this library.
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_flam_rnd_MainActivity_processImage(
         JNIEnv* env,
@@ -394,27 +401,6 @@ Java_com_flam_rnd_MainActivity_processImage(
 #endif
 }
 
-extern "C" JNIEXPORT jstring JNICALL
-Java_com_flam_rnd_MainActivity_getNDKInfo(
-        JNIEnv* env,
-        jobject /* this */) {
-
-    std::string info = "NDK Info:\n";
-#if defined(__aarch64__) || defined(__arm__)
-    info += "- Architecture: ARM\n";
-#elif defined(__i386__) || defined(__x86_64__)
-    info += "- Architecture: x86\n";
-#else
-    info += "- Architecture: Unknown\n";
-#endif
-
-    info += "- API Level: " + std::to_string(__ANDROID_API__) + "\n";
-    info += "- C++ Standard: " + std::to_string(__cplusplus) + "\n";
-
-    LOGI("NDK Info requested: %s", info.c_str());
-    return env->NewStringUTF(info.c_str());
-}
-
 // ================= OpenCV Utilities =================
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_flam_rnd_utils_OpenCVUtils_nativeInitOpenCV(
@@ -508,6 +494,19 @@ Java_com_flam_rnd_utils_OpenCVUtils_nativeConvertYUV420ToRGB(
 #endif
 }
 
+#ifdef HAVE_OPENCV
+// Format of an 8-bit mat as the app hands them over: 1, 3 or 4 channels as
+// gray, RGB or RGBA. Null for anything else.
+static const PixelFormatOps* packedFormatOf(const cv::Mat& mat) {
+    switch (mat.type()) {
+        case CV_8UC1: return &pixelFormatOps(PixelFormat::Gray8);
+        case CV_8UC3: return &pixelFormatOps(PixelFormat::Rgb8);
+        case CV_8UC4: return &pixelFormatOps(PixelFormat::Rgba8);
+        default: return nullptr;
+    }
+}
+#endif
+
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_flam_rnd_utils_OpenCVUtils_nativeMatToRgbaBytes(
         JNIEnv* env,
@@ -518,20 +517,14 @@ Java_com_flam_rnd_utils_OpenCVUtils_nativeMatToRgbaBytes(
         return JNI_FALSE;
     }
     cv::Mat& src = *(cv::Mat*) matAddr;
-    if (src.empty()) {
-        LOGE("nativeMatToRgbaBytes: empty mat");
+    if (src.empty() || width > src.cols || height > src.rows) {
+        LOGE("nativeMatToRgbaBytes: mat is empty or smaller than %dx%d", width, height);
         return JNI_FALSE;
     }
-
-    cv::Mat rgba;
-    if (src.type() == CV_8UC4) {
-        rgba = src;
-    } else if (src.type() == CV_8UC1) {
-        cv::cvtColor(src, rgba, cv::COLOR_GRAY2RGBA);
-    } else if (src.type() == CV_8UC3) {
-        cv::cvtColor(src, rgba, cv::COLOR_RGB2RGBA);
-    } else {
-        cv::cvtColor(src, rgba, cv::COLOR_BGR2RGBA);
+    const PixelFormatOps* format = packedFormatOf(src);
+    if (format == nullptr) {
+        LOGE("nativeMatToRgbaBytes: unsupported mat type %d", src.type());
+        return JNI_FALSE;
     }
 
     const int rowBytes = width * 4;
@@ -539,15 +532,1734 @@ Java_com_flam_rnd_utils_OpenCVUtils_nativeMatToRgbaBytes(
     jbyte* outPtr = env->GetByteArrayElements(outArray, &isCopy);
     if (!outPtr) return JNI_FALSE;
 
-    for (int r = 0; r < height; ++r) {
-        std::memcpy(outPtr + r * rowBytes, rgba.ptr<unsigned char>(r), rowBytes);
-    }
+    format->toRgba(contiguousPlanes(*format, src.data, src.step, src.rows), width, height,
+                   reinterpret_cast<uint8_t*>(outPtr), rowBytes);
 
     env->ReleaseByteArrayElements(outArray, outPtr, 0);
-    if (rgba.data != src.data) rgba.release();
     return JNI_TRUE;
 #else
     (void)env; (void)matAddr; (void)outArray; (void)width; (void)height;
     return JNI_FALSE;
 #endif
 }
+
+// Converts a gray or RGBA Mat into caller-provided 4:2:0 planes (direct
+// ByteBuffers, e.g. the planes of a MediaCodec input Image).
+// chromaPixelStride 1 is I420; 2 is NV12, where vBuffer must start one byte
+// after uBuffer in the same interleaved plane (NV21 is not accepted).
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeMatToYuv420(
+        JNIEnv* env,
+        jobject /* this */, jlong matAddr,
+        jobject yBuffer, jint yStride,
+        jobject uBuffer, jint uStride,
+        jobject vBuffer, jint vStride,
+        jint chromaPixelStride) {
+#ifdef HAVE_OPENCV
+    if (matAddr == 0 || yBuffer == nullptr || uBuffer == nullptr || vBuffer == nullptr) return false;
+    const cv::Mat& src = *(cv::Mat*) matAddr;
+    if (src.empty() || (src.type() != CV_8UC1 && src.type() != CV_8UC4)) {
+        LOGE("nativeMatToYuv420: expected a gray or RGBA mat");
+        return false;
+    }
+    uint8_t* y = static_cast<uint8_t*>(env->GetDirectBufferAddress(yBuffer));
+    uint8_t* u = static_cast<uint8_t*>(env->GetDirectBufferAddress(uBuffer));
+    uint8_t* v = static_cast<uint8_t*>(env->GetDirectBufferAddress(vBuffer));
+    if (y == nullptr || u == nullptr || v == nullptr) {
+        LOGE("nativeMatToYuv420: planes must be direct buffers");
+        return false;
+    }
+
+    const int w = src.cols;
+    const int h = src.rows;
+    const int64_t chromaWidth = (w + 1) / 2;
+    const int64_t chromaHeight = (h + 1) / 2;
+    const bool nv12 = chromaPixelStride == 2;
+    if ((!nv12 && chromaPixelStride != 1) || (nv12 && v != u + 1)) {
+        LOGE("nativeMatToYuv420: chroma layout must be I420 or NV12");
+        return false;
+    }
+    // Last byte touched in each plane, as Image planes size their buffers.
+    const int64_t chromaRowBytes = nv12 ? chromaWidth * 2 - 1 : chromaWidth;
+    if (yStride < w || uStride < chromaRowBytes || (!nv12 && vStride < chromaWidth) ||
+        env->GetDirectBufferCapacity(yBuffer) < static_cast<int64_t>(yStride) * (h - 1) + w ||
+        env->GetDirectBufferCapacity(uBuffer) < static_cast<int64_t>(uStride) * (chromaHeight - 1) + chromaRowBytes ||
+        env->GetDirectBufferCapacity(vBuffer) < static_cast<int64_t>(nv12 ? uStride : vStride) * (chromaHeight - 1) + chromaRowBytes) {
+        LOGE("nativeMatToYuv420: planes too small for %dx%d", w, h);
+        return false;
+    }
+
+    YuvPlanes planes;
+    planes.y = y;
+    planes.yStride = static_cast<size_t>(yStride);
+    planes.u = u;
+    planes.uStride = static_cast<size_t>(uStride);
+    planes.v = v;
+    planes.vStride = static_cast<size_t>(vStride);
+    return packToYuv420(src.data, static_cast<size_t>(src.step), src.channels(), w, h,
+                        nv12 ? YuvLayout::NV12 : YuvLayout::I420, planes);
+#else
+    (void)env; (void)matAddr; (void)yBuffer; (void)yStride; (void)uBuffer; (void)uStride;
+    (void)vBuffer; (void)vStride; (void)chromaPixelStride;
+    return false;
+#endif
+}
+
+
+// ================= Processing Session =================
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeCreateSession(
+        JNIEnv* env,
+        jobject /* this */, jint width, jint height, jint format) {
+    (void)env;
+    if (width <= 0 || height <= 0) {
+        LOGE("nativeCreateSession: invalid size %dx%d", width, height);
+        return 0;
+    }
+    const PixelFormatOps* input = pixelFormatOps(format);
+    if (input == nullptr || (input->layout != PlaneLayout::Packed && input->chromaShiftY == 0)) {
+        LOGE("nativeCreateSession: unsupported input pixel format %d", format);
+        return 0;
+    }
+    try {
+        ProcessingSession* session = new ProcessingSession();
+        session->width = width;
+        session->height = height;
+        session->input = input;
+        return reinterpret_cast<jlong>(session);
+    } catch (...) {
+        LOGE("nativeCreateSession failed");
+        return 0;
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeReleaseSession(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr) {
+    (void)env;
+    if (sessionAddr != 0) {
+        delete reinterpret_cast<ProcessingSession*>(sessionAddr);
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeSetEdgeMode(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jint mode) {
+    (void)env;
+    if (sessionAddr == 0) return;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    const EdgeMode previous = session->edgeMode;
+    switch (mode) {
+        case static_cast<int>(EdgeMode::HalfResGuided):
+            session->edgeMode = EdgeMode::HalfResGuided;
+            break;
+        case static_cast<int>(EdgeMode::Temporal):
+            session->edgeMode = EdgeMode::Temporal;
+            break;
+        default:
+            session->edgeMode = EdgeMode::Full;
+            break;
+    }
+    if (session->edgeMode != previous) {
+        session->temporal.reset();
+    }
+    LOGI("Edge mode set to %d", static_cast<int>(session->edgeMode));
+}
+
+// ================= Pipeline Metrics =================
+// Registered on first use; the frame path only does relaxed atomic updates.
+// Served by the exporter thread started with nativeStartMetricsExporter.
+struct PipelineMetrics {
+    Counter& frames;
+    Gauge& fps;
+    Histogram& frameSeconds;
+    Histogram& blockMotionSeconds;
+    Histogram& flowSeconds;
+    Histogram& panoramaSeconds;
+    Histogram& edgesSeconds;
+    Histogram& presentSeconds;
+    Counter& dirtyRects;
+    Counter& sourceFrames;
+    Counter& sourceDropped;
+    Gauge& poolLiveBytes;
+    Gauge& poolFreeBytes;
+};
+
+static PipelineMetrics& pipelineMetrics() {
+    static PipelineMetrics* metrics = [] {
+        MetricsRegistry& r = MetricsRegistry::instance();
+        const std::vector<double> buckets = latencyBuckets();
+        const char* stageHelp = "Pipeline stage latency in seconds";
+        r.callbackGauge("flam_resident_bytes", "Resident set size of the process",
+                        [] { return static_cast<double>(residentBytes()); });
+        return new PipelineMetrics{
+            r.counter("flam_frames_total", "Frames through the processing pipeline"),
+            r.gauge("flam_fps", "Pipeline frame rate, moving average"),
+            r.histogram("flam_frame_seconds", "Whole-pipeline latency per frame in seconds", buckets),
+            r.histogram("flam_stage_seconds", stageHelp, buckets, "stage=\"block_motion\""),
+            r.histogram("flam_stage_seconds", stageHelp, buckets, "stage=\"flow\""),
+            r.histogram("flam_stage_seconds", stageHelp, buckets, "stage=\"panorama\""),
+            r.histogram("flam_stage_seconds", stageHelp, buckets, "stage=\"edges\""),
+            r.histogram("flam_stage_seconds", stageHelp, buckets, "stage=\"present\""),
+            r.counter("flam_dirty_rects_total", "Rectangles repainted by dirty-rect presentation"),
+            r.counter("flam_source_frames_total", "Frames delivered by native frame sources"),
+            r.counter("flam_source_dropped_total", "Source frames replaced before they were presented"),
+            r.gauge("flam_pool_live_bytes", "Buffer pool bytes in use (latest session)"),
+            r.gauge("flam_pool_free_bytes", "Buffer pool bytes idle (latest session)"),
+        };
+    }();
+    return *metrics;
+}
+
+static int64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static MetricsExporter gMetricsExporter;
+static std::mutex gMetricsExporterMutex;
+
+// `address` is a socket path or "@name" for the abstract namespace, e.g.
+// "@flam_rnd.metrics" (read it with: socat - ABSTRACT-CONNECT:flam_rnd.metrics).
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStartMetricsExporter(
+        JNIEnv* env,
+        jobject /* this */, jstring address) {
+    if (address == nullptr) return false;
+    const char* chars = env->GetStringUTFChars(address, nullptr);
+    if (chars == nullptr) return false;
+    const std::string name(chars);
+    env->ReleaseStringUTFChars(address, chars);
+
+    pipelineMetrics();  // register everything so the first scrape is complete
+    std::lock_guard<std::mutex> lock(gMetricsExporterMutex);
+    if (gMetricsExporter.running()) return gMetricsExporter.address() == name;
+    if (!gMetricsExporter.start(name)) {
+        LOGE("nativeStartMetricsExporter: cannot listen on %s", name.c_str());
+        return false;
+    }
+    LOGI("Metrics exporter listening on %s", name.c_str());
+    return true;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStopMetricsExporter(
+        JNIEnv* env,
+        jobject /* this */) {
+    (void)env;
+    std::lock_guard<std::mutex> lock(gMetricsExporterMutex);
+    gMetricsExporter.stop();
+}
+
+// ================= Thermal Telemetry =================
+// Device temperature and CPU clocks next to pipeline throughput, so a
+// throughput collapse can be told apart as throttling or a regression.
+
+static ThermalMonitor gThermalMonitor;
+static std::mutex gThermalMonitorMutex;
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStartTelemetry(
+        JNIEnv* env,
+        jobject /* this */, jint periodMs) {
+    (void)env;
+    std::lock_guard<std::mutex> lock(gThermalMonitorMutex);
+    if (gThermalMonitor.running()) return true;
+    return gThermalMonitor.start(periodMs, &pipelineMetrics().frameSeconds);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStopTelemetry(
+        JNIEnv* env,
+        jobject /* this */) {
+    (void)env;
+    std::lock_guard<std::mutex> lock(gThermalMonitorMutex);
+    gThermalMonitor.stop();
+}
+
+// Fills `out` with the most recent samples, oldest first, as
+// {timestampNs, maxTempC, minFreqRatio, fps, meanFrameMs} quintuples.
+// Returns the number of samples written.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeGetTelemetry(
+        JNIEnv* env,
+        jobject /* this */, jdoubleArray out) {
+    if (out == nullptr) return 0;
+    const size_t max = static_cast<size_t>(env->GetArrayLength(out)) / 5;
+    std::vector<TelemetrySample> samples(std::min(max, ThermalMonitor::kHistory));
+    const size_t count = gThermalMonitor.recent(samples.data(), samples.size());
+    std::vector<jdouble> values(count * 5);
+    for (size_t i = 0; i < count; ++i) {
+        const TelemetrySample& s = samples[i];
+        values[i * 5 + 0] = static_cast<jdouble>(s.timestampNs);
+        values[i * 5 + 1] = s.maxTempC;
+        values[i * 5 + 2] = s.minFreqRatio;
+        values[i * 5 + 3] = s.fps;
+        values[i * 5 + 4] = s.meanFrameMs;
+    }
+    env->SetDoubleArrayRegion(out, 0, static_cast<jsize>(values.size()), values.data());
+    return static_cast<jint>(count);
+}
+
+// ================= Sampling Profiler =================
+// Samples the analyzer, frame source and band worker threads; see
+// sampling_profiler.h. The result is folded stacks for flamegraph tools.
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStartProfiler(
+        JNIEnv* env,
+        jobject /* this */, jint hz) {
+    (void)env;
+    if (!SamplingProfiler::instance().start(hz)) {
+        LOGE("nativeStartProfiler: cannot start at %d Hz", hz);
+        return false;
+    }
+    LOGI("Sampling profiler started at %d Hz", std::min<int>(hz, SamplingProfiler::kMaxHz));
+    return true;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStopProfiler(
+        JNIEnv* env,
+        jobject /* this */) {
+    (void)env;
+    SamplingProfiler::instance().stop();
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeProfileFolded(
+        JNIEnv* env,
+        jobject /* this */) {
+    std::string folded;
+    SamplingProfiler::instance().writeFolded(folded);
+    return env->NewStringUTF(folded.c_str());
+}
+
+// ================= Preview Streaming =================
+// MJPEG over HTTP of the pipeline output (see mjpeg_server.h). runPipeline
+// offers every frame; with no viewer connected that costs one atomic load.
+
+static MjpegServer gPreviewServer;
+static std::mutex gPreviewServerMutex;
+
+// Returns the port the server listens on, or 0 if it could not start.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStartPreviewServer(
+        JNIEnv* env,
+        jobject /* this */, jint port, jboolean lan, jint maxFps, jint maxKbps, jint quality) {
+    (void)env;
+#ifdef HAVE_OPENCV
+    std::lock_guard<std::mutex> lock(gPreviewServerMutex);
+    if (gPreviewServer.running()) return gPreviewServer.port();
+    MjpegServer::Options options;
+    options.port = port;
+    options.lan = lan;
+    options.maxFps = maxFps;
+    options.maxKbps = maxKbps;
+    options.quality = quality;
+    // Runs on the server's encoder thread only, so the scratch Mat is not shared.
+    cv::Mat bgr;
+    const bool ok = gPreviewServer.start(options, [bgr](const uint8_t* pixels, size_t stride, int channels,
+                                                        int width, int height, int q,
+                                                        std::vector<uint8_t>& jpeg) mutable {
+        const cv::Mat src(height, width, channels == 4 ? CV_8UC4 : CV_8UC1, const_cast<uint8_t*>(pixels), stride);
+        const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, q};
+        try {
+            if (channels == 1) return cv::imencode(".jpg", src, jpeg, params);
+            cv::cvtColor(src, bgr, cv::COLOR_RGBA2BGR);
+            return cv::imencode(".jpg", bgr, jpeg, params);
+        } catch (const std::exception& e) {
+            LOGE("Preview encode failed: %s", e.what());
+            return false;
+        }
+    });
+    if (!ok) {
+        LOGE("nativeStartPreviewServer: cannot listen on port %d", port);
+        return 0;
+    }
+    LOGI("Preview stream on %s:%d", lan ? "0.0.0.0" : "127.0.0.1", gPreviewServer.port());
+    return gPreviewServer.port();
+#else
+    (void)port; (void)lan; (void)maxFps; (void)maxKbps; (void)quality;
+    return 0;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStopPreviewServer(
+        JNIEnv* env,
+        jobject /* this */) {
+    (void)env;
+    std::lock_guard<std::mutex> lock(gPreviewServerMutex);
+    gPreviewServer.stop();
+}
+
+// ================= Memory Trimming =================
+// Releases session memory down to `level` (see TrimLevel) while keeping
+// parameters and LUTs; the next frame re-warms the pool and regrows the rest.
+// statsOut, if given, receives {rssBefore, rssAfter, bytesFreed}.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeTrimSession(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jint level, jlong poolFloorBytes, jlongArray statsOut) {
+    if (sessionAddr == 0 || level < 0 || level > static_cast<int>(TrimLevel::All)) return false;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+
+    const size_t before = residentBytes();
+    const bool panoramaKept = level > static_cast<int>(TrimLevel::History) && session->panoramaEnabled;
+    const size_t freed = session->trim(static_cast<TrimLevel>(level),
+                                       static_cast<size_t>(std::max<jlong>(poolFloorBytes, 0)));
+    const size_t after = residentBytes();
+    LOGI("Trim level %d%s: freed %zu KiB, RSS %zu -> %zu KiB", level,
+         panoramaKept ? " (capped at History, panorama in progress)" : "",
+         freed >> 10, before >> 10, after >> 10);
+
+    if (statsOut != nullptr && env->GetArrayLength(statsOut) >= 3) {
+        const jlong stats[3] = {static_cast<jlong>(before), static_cast<jlong>(after), static_cast<jlong>(freed)};
+        env->SetLongArrayRegion(statsOut, 0, 3, stats);
+    }
+    return true;
+}
+
+// Resident set size of the process in bytes, 0 if unknown.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeResidentBytes(
+        JNIEnv* env,
+        jobject /* this */) {
+    (void)env;
+    return static_cast<jlong>(residentBytes());
+}
+
+// Builds this frame's pyramid, estimates flow from the previous one into a
+// pooled buffer and derives the global motion hint used by temporal stages.
+static void updateFlow(ProcessingSession* session, const uint8_t* luma, size_t stride, int w, int h) {
+    LumaPyramid& cur = session->pyramids[session->currentPyramid];
+    const LumaPyramid& prev = session->pyramids[session->currentPyramid ^ 1];
+    cur.build(luma, stride, w, h, session->flow.params().coarsestLevel);
+    session->currentPyramid ^= 1;
+
+    // No field for this frame: drop the previous one and its motion too, so
+    // getFlow and motion-compensated stages do not act on a stale estimate.
+    auto invalidate = [session]() {
+        session->flowField.reset();
+        session->flowWidth = session->flowHeight = 0;
+        session->motionDx = session->motionDy = 0;
+    };
+    const int fw = session->flow.flowWidth(cur);
+    const int fh = session->flow.flowHeight(cur);
+    if (fw <= 0 || fh <= 0 || prev.baseWidth() != w || prev.baseHeight() != h) {
+        invalidate();
+        return;
+    }
+
+    PooledBuffer field = session->pool.acquire(static_cast<size_t>(fw) * fh * 2 * sizeof(int16_t));
+    if (!session->flow.estimate(prev, cur, field.as<int16_t>(), static_cast<size_t>(fw) * 2)) {
+        invalidate();
+        return;
+    }
+    session->flowField = std::move(field);  // the previous field goes back to the pool
+    session->flowWidth = fw;
+    session->flowHeight = fh;
+
+    int64_t sumX = 0, sumY = 0;
+    const int16_t* f = session->flowField.as<int16_t>();
+    const size_t n = static_cast<size_t>(fw) * fh;
+    for (size_t i = 0; i < n; ++i) {
+        sumX += f[2 * i];
+        sumY += f[2 * i + 1];
+    }
+    const double scale = 1.0 / (static_cast<double>(n) * (1 << DisFlow::kFracBits));
+    session->motionDx = static_cast<int>(std::lround(sumX * scale));
+    session->motionDy = static_cast<int>(std::lround(sumY * scale));
+}
+
+#ifdef HAVE_OPENCV
+// Luma stages (motion, flow, panorama) followed by the session's edge mode,
+// writing the edge plane to `out`. Shared by processFrame and native sources;
+// nothing here interleaves, that is left to the presenter.
+static void runPipeline(ProcessingSession* session, const cv::Mat& gray, PlanarImage& out) {
+    const int w = gray.cols;
+    const int h = gray.rows;
+    PipelineMetrics& metrics = pipelineMetrics();
+    const int64_t frameStart = monotonicNs();
+    int64_t stageStart = frameStart;
+    auto endStage = [&stageStart](Histogram& histogram) {
+        const int64_t now = monotonicNs();
+        histogram.observe((now - stageStart) * 1e-9);
+        stageStart = now;
+    };
+    if (session->lastFrameNs != 0 && frameStart > session->lastFrameNs) {
+        const double instant = 1e9 / static_cast<double>(frameStart - session->lastFrameNs);
+        session->fps = session->fps > 0.0 ? 0.9 * session->fps + 0.1 * instant : instant;
+        metrics.fps.set(session->fps);
+    }
+    session->lastFrameNs = frameStart;
+
+    if (session->rewarmPending) session->rewarm();
+    if (session->blockMotionEnabled) {
+        const bool matched = session->blockMatcher.process(gray.data, static_cast<size_t>(gray.step), w, h);
+        if (!session->flowEnabled) {
+            // Vectors point from the current block into the previous frame,
+            // so the scene moved by their negation. No vectors (first frame,
+            // size change) means no motion estimate, not the previous one.
+            int dx = 0, dy = 0;
+            if (matched) session->blockMatcher.medianVector(dx, dy);
+            session->motionDx = -dx;
+            session->motionDy = -dy;
+        }
+        endStage(metrics.blockMotionSeconds);
+    }
+    if (session->flowEnabled) {
+        updateFlow(session, gray.data, static_cast<size_t>(gray.step), w, h);
+        endStage(metrics.flowSeconds);
+    }
+    if (session->panoramaEnabled) {
+        if (session->panorama.addFrame(gray.data, static_cast<size_t>(gray.step), w, h) ==
+            PanoramaStitcher::Result::Full) {
+            LOGI("Panorama reached its tile budget; stopping");
+            session->panoramaEnabled = false;
+        }
+        endStage(metrics.panoramaSeconds);
+    }
+
+    out.reset(PlanarFormat::Gray, w, h);
+    cv::Mat edges(h, w, CV_8UC1, out.plane(0), out.stride());
+    if (session->edgeMode == EdgeMode::HalfResGuided && w >= 2 && h >= 2) {
+        const int lw = w / 2;
+        const int lh = h / 2;
+        session->lowLuma.resize(static_cast<size_t>(lw) * lh);
+        session->lowEdges.resize(static_cast<size_t>(lw) * lh);
+        cv::Mat low(lh, lw, CV_8UC1, session->lowLuma.data());
+        cv::Mat lowEdges(lh, lw, CV_8UC1, session->lowEdges.data());
+
+        downsampleLuma2x(gray.data, static_cast<size_t>(gray.step), w, h, low.data, lw);
+        cv::Canny(low, lowEdges, 100, 200);
+        session->upsampler.upsample(gray.data, static_cast<size_t>(gray.step), w, h,
+                                    low.data, lowEdges.data, lw,
+                                    edges.data, out.stride());
+    } else if (session->edgeMode == EdgeMode::Temporal) {
+        session->temporal.process(gray.data, static_cast<size_t>(gray.step), w, h,
+                                  edges.data, out.stride(),
+                                  session->motionDx, session->motionDy);
+    } else {
+        cv::Canny(gray, edges, 100, 200);
+    }
+    endStage(metrics.edgesSeconds);
+
+    metrics.frameSeconds.observe((stageStart - frameStart) * 1e-9);
+    metrics.frames.inc();
+    metrics.poolLiveBytes.set(static_cast<double>(session->pool.liveBytes()));
+    metrics.poolFreeBytes.set(static_cast<double>(session->pool.freeBytes()));
+
+    gPreviewServer.submit(out.plane(0), out.stride(), 1, w, h);
+}
+#endif
+
+// Runs the session's edge pipeline on a mat in the session's input format,
+// like nativeProcessImage but reusing the session's scratch planes: packed
+// formats as CV_8UC(channels), YUV 4:2:0 as OpenCV's single CV_8UC1 mat of
+// height * 3 / 2 rows. The edge plane stays in the session for
+// nativeEdgesToBitmapDirty; only if copyEdges is set is the mat replaced by
+// it (CV_8UC1), for callers that need the edges as a mat.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeProcessFrame(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jlong matAddr, jboolean copyEdges) {
+    (void)env;
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || matAddr == 0) return false;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    static thread_local ProfiledThread profiled("analyzer");
+    try {
+        cv::Mat& frame = *(cv::Mat*) matAddr;
+        const PixelFormatOps& input = *session->input;
+        const bool packed = input.layout == PlaneLayout::Packed;
+        const int w = frame.cols;
+        const int h = packed ? frame.rows : frame.rows * 2 / 3;
+        if (frame.empty() || frame.type() != CV_8UC(packed ? input.channels : 1) ||
+            (!packed && (!frame.isContinuous() || ((w | h) & 1) != 0 || frame.rows != h * 3 / 2))) {
+            LOGE("nativeProcessFrame: expected a non-empty %s mat", input.name);
+            return false;
+        }
+
+        session->luma.resize(static_cast<size_t>(w) * h);
+        cv::Mat gray(h, w, CV_8UC1, session->luma.data());
+        input.toLuma(contiguousPlanes(input, frame.data, frame.step, h), w, h, gray.data, gray.step);
+
+        runPipeline(session, gray, session->edges);
+        if (copyEdges) {
+            cv::Mat(h, w, CV_8UC1, session->edges.plane(0), session->edges.stride()).copyTo(frame);
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("nativeProcessFrame exception: %s", e.what());
+        return false;
+    }
+#else
+    (void)sessionAddr; (void)matAddr; (void)copyEdges;
+    return false;
+#endif
+}
+
+static_assert(sizeof(DirtyRect) == 4 * sizeof(jint), "DirtyRect is copied to Java as int quads");
+
+// Presents a frame into `bitmap` through the session's dirty-rect tracker and
+// reports the changed rectangles; see nativeMatToBitmapDirty. `present(width, height, pixels,
+// stride)` hands the source to session->output.
+template <typename Present>
+static jint presentToBitmap(JNIEnv* env, ProcessingSession* session, int srcWidth, int srcHeight,
+                            jobject bitmap, jintArray rectsOut, Present present) {
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+        info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) {
+        LOGE("presentToBitmap: bitmap must be ARGB_8888");
+        return -1;
+    }
+
+    const int width = std::min(srcWidth, static_cast<int>(info.width));
+    const int height = std::min(srcHeight, static_cast<int>(info.height));
+
+    const int64_t start = monotonicNs();
+    void* pixels = nullptr;
+    if (AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS || !pixels) {
+        LOGE("presentToBitmap: lockPixels failed");
+        return -1;
+    }
+    // A different bitmap does not hold the previous frame, so repaint it fully.
+    if (pixels != session->outputPixels) {
+        session->output.invalidate();
+        session->outputPixels = pixels;
+    }
+    present(width, height, static_cast<uint8_t*>(pixels), static_cast<size_t>(info.stride));
+    AndroidBitmap_unlockPixels(env, bitmap);
+
+    const std::vector<DirtyRect>& rects = session->dirtyRects;
+    PipelineMetrics& metrics = pipelineMetrics();
+    metrics.presentSeconds.observe((monotonicNs() - start) * 1e-9);
+    metrics.dirtyRects.inc(rects.size());
+    const jsize capacity = rectsOut ? env->GetArrayLength(rectsOut) / 4 : 0;
+    if (rects.empty() || capacity == 0) {
+        return static_cast<jint>(rects.size());
+    }
+    if (static_cast<jsize>(rects.size()) > capacity) {
+        int x0 = width, y0 = height, x1 = 0, y1 = 0;
+        for (const DirtyRect& r : rects) {
+            x0 = std::min(x0, r.x);
+            y0 = std::min(y0, r.y);
+            x1 = std::max(x1, r.x + r.w);
+            y1 = std::max(y1, r.y + r.h);
+        }
+        const jint bounds[4] = {x0, y0, x1 - x0, y1 - y0};
+        env->SetIntArrayRegion(rectsOut, 0, 4, bounds);
+        return 1;
+    }
+    env->SetIntArrayRegion(rectsOut, 0, static_cast<jsize>(rects.size() * 4),
+                           reinterpret_cast<const jint*>(rects.data()));
+    return static_cast<jint>(rects.size());
+}
+
+// Writes only the tiles that changed since the previous call into `bitmap`
+// (which must be the same RGBA_8888 bitmap every frame) and stores the changed
+// rectangles as (x, y, w, h) quadruples in `rectsOut`. Returns the number of
+// rectangles, 0 for an unchanged frame, or -1 on error. If `rectsOut` is too
+// small the rectangles are collapsed into their bounding box.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeMatToBitmapDirty(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jlong matAddr, jobject bitmap, jintArray rectsOut) {
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || matAddr == 0 || bitmap == nullptr) {
+        LOGE("nativeMatToBitmapDirty: invalid arguments");
+        return -1;
+    }
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    cv::Mat& src = *(cv::Mat*) matAddr;
+    if (src.empty()) {
+        LOGE("nativeMatToBitmapDirty: empty mat");
+        return -1;
+    }
+
+    const PixelFormatOps* format = packedFormatOf(src);
+    if (format == nullptr) {
+        LOGE("nativeMatToBitmapDirty: unsupported mat type %d", src.type());
+        return -1;
+    }
+    return presentToBitmap(env, session, src.cols, src.rows, bitmap, rectsOut,
+                           [&](int width, int height, uint8_t* pixels, size_t stride) {
+        session->output.present(src.data, static_cast<size_t>(src.step), *format, width, height,
+                                pixels, stride, session->dirtyRects);
+    });
+#else
+    (void)env; (void)sessionAddr; (void)matAddr; (void)bitmap; (void)rectsOut;
+    return -1;
+#endif
+}
+
+// nativeMatToBitmapDirty for the edge plane of the latest nativeProcessFrame,
+// presented straight from the session without going through a mat.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeEdgesToBitmapDirty(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jobject bitmap, jintArray rectsOut) {
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || bitmap == nullptr) {
+        LOGE("nativeEdgesToBitmapDirty: invalid arguments");
+        return -1;
+    }
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    const PlanarImage& edges = session->edges;
+    if (edges.empty()) {
+        LOGE("nativeEdgesToBitmapDirty: no processed frame");
+        return -1;
+    }
+    return presentToBitmap(env, session, edges.width(), edges.height(), bitmap, rectsOut,
+                           [&](int width, int height, uint8_t* pixels, size_t stride) {
+        session->output.present(edges, width, height, pixels, stride, session->dirtyRects);
+    });
+#else
+    (void)env; (void)sessionAddr; (void)bitmap; (void)rectsOut;
+    return -1;
+#endif
+}
+
+// ================= Skeletonization =================
+// Thins a binary mask in place. Accepts a gray mask or a gray-in-RGBA mat
+// (as produced by the edge pipeline); the packed masks live in the session.
+// Returns iterations run or -1 on error.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeThinMask(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jlong matAddr, jint maxIterations) {
+    (void)env;
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || matAddr == 0) return -1;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    cv::Mat& mat = *(cv::Mat*) matAddr;
+    if (mat.empty() || (mat.type() != CV_8UC1 && mat.type() != CV_8UC4)) {
+        LOGE("nativeThinMask: expected 8-bit gray or RGBA mat");
+        return -1;
+    }
+    const int w = mat.cols;
+    const int h = mat.rows;
+    const int iterations = maxIterations > 0 ? maxIterations : kDefaultThinningIterations;
+
+    BitMask& mask = session->thinMask;
+    BitMask& scratch = session->thinScratch;
+    int ran;
+    if (mat.type() == CV_8UC1) {
+        packMask(mat.data, static_cast<size_t>(mat.step), w, h, mask);
+        ran = thinZhangSuen(mask, scratch, iterations);
+        unpackMask(mask, mat.data, static_cast<size_t>(mat.step));
+    } else {
+        std::vector<uint8_t>& plane = session->thinPlane;
+        plane.resize(static_cast<size_t>(w) * h);
+        for (int y = 0; y < h; ++y) {
+            const uint8_t* src = mat.ptr<uint8_t>(y);
+            for (int x = 0; x < w; ++x) plane[static_cast<size_t>(y) * w + x] = src[x * 4];
+        }
+        packMask(plane.data(), w, w, h, mask);
+        ran = thinZhangSuen(mask, scratch, iterations);
+        unpackMask(mask, plane.data(), w);
+        packToRgba(plane.data(), w, 1, mat.data, static_cast<size_t>(mat.step), w, h);
+    }
+    return ran;
+#else
+    (void)sessionAddr; (void)matAddr; (void)maxIterations;
+    return -1;
+#endif
+}
+
+// ================= Contour Extraction =================
+// Floats written per contour by nativeFindContours (keep in sync with
+// OpenCVUtils.CONTOUR_RECORD_SIZE):
+// parent, isHole, area, perimeter, bbox x/y/w/h, centroid x/y,
+// min-area rect cx/cy/w/h/angle, hull vertex count.
+static constexpr int kContourRecordSize = 16;
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeFindContours(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jlong matAddr, jfloatArray out) {
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || matAddr == 0) return -1;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    cv::Mat& mat = *(cv::Mat*) matAddr;
+    if (mat.empty() || (mat.type() != CV_8UC1 && mat.type() != CV_8UC4)) {
+        LOGE("nativeFindContours: expected 8-bit gray or RGBA mat");
+        return -1;
+    }
+
+    ContourArena& arena = session->contours;
+    const int count = session->contourTracer.trace(mat.data, static_cast<size_t>(mat.step),
+                                                   mat.channels(), mat.cols, mat.rows, arena);
+    if (out == nullptr) return count;
+
+    const int capacity = env->GetArrayLength(out) / kContourRecordSize;
+    const int n = std::min(count, capacity);
+    if (n <= 0) return count;
+    jfloat* dst = static_cast<jfloat*>(env->GetPrimitiveArrayCritical(out, nullptr));
+    if (dst == nullptr) return -1;
+    for (int i = 0; i < n; ++i) {
+        const ContourDescriptor& c = arena.contours[i];
+        jfloat* r = dst + i * kContourRecordSize;
+        const double m00 = c.moments.m00;
+        r[0] = static_cast<jfloat>(c.parent);
+        r[1] = c.isHole ? 1.0f : 0.0f;
+        r[2] = static_cast<jfloat>(c.area);
+        r[3] = static_cast<jfloat>(c.perimeter);
+        r[4] = static_cast<jfloat>(c.x);
+        r[5] = static_cast<jfloat>(c.y);
+        r[6] = static_cast<jfloat>(c.width);
+        r[7] = static_cast<jfloat>(c.height);
+        r[8] = static_cast<jfloat>(m00 > 0 ? c.moments.m10 / m00 : c.x + c.width * 0.5);
+        r[9] = static_cast<jfloat>(m00 > 0 ? c.moments.m01 / m00 : c.y + c.height * 0.5);
+        r[10] = c.minAreaRect.cx;
+        r[11] = c.minAreaRect.cy;
+        r[12] = c.minAreaRect.width;
+        r[13] = c.minAreaRect.height;
+        r[14] = c.minAreaRect.angle;
+        r[15] = static_cast<jfloat>(c.hullCount);
+    }
+    env->ReleasePrimitiveArrayCritical(out, dst, 0);
+    return count;
+#else
+    (void)env; (void)sessionAddr; (void)matAddr; (void)out;
+    return -1;
+#endif
+}
+
+// ================= Optical Flow =================
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeSetFlowEnabled(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jboolean enabled) {
+    (void)env;
+    if (sessionAddr == 0) return;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    session->flowEnabled = enabled;
+    if (!enabled) {
+        session->flowField.reset();
+        session->flowWidth = session->flowHeight = 0;
+        session->motionDx = session->motionDy = 0;
+    }
+}
+
+// Copies the latest flow field into `out` as (dx, dy) pairs in 1/16
+// full-resolution pixels and its size into `sizeOut` (width, height).
+// Returns the number of vectors copied, 0 if no field is available yet.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeGetFlow(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jshortArray out, jintArray sizeOut) {
+    if (sessionAddr == 0 || out == nullptr) return 0;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    if (session->flowField.empty()) return 0;
+
+    const jint size[2] = {session->flowWidth, session->flowHeight};
+    if (sizeOut != nullptr && env->GetArrayLength(sizeOut) >= 2) {
+        env->SetIntArrayRegion(sizeOut, 0, 2, size);
+    }
+    const jsize vectors = std::min<jsize>(env->GetArrayLength(out) / 2, size[0] * size[1]);
+    env->SetShortArrayRegion(out, 0, vectors * 2, session->flowField.as<jshort>());
+    return vectors;
+}
+
+// ================= Block Motion =================
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeSetBlockMotionEnabled(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jboolean enabled) {
+    (void)env;
+    if (sessionAddr == 0) return;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    session->blockMotionEnabled = enabled;
+    if (!enabled) {
+        session->blockMatcher.reset();
+        if (!session->flowEnabled) session->motionDx = session->motionDy = 0;
+    }
+}
+
+static_assert(sizeof(BlockVector) == sizeof(jint), "BlockVector is copied to Java as one int");
+
+// Copies the latest block vector field into `out`, one int per 16x16 block in
+// row order, packed as dx (bits 0-7, signed), dy (bits 8-15, signed) and SAD
+// (bits 16-31), and the field size in blocks into `sizeOut`. Returns the
+// number of blocks copied, 0 if no field is available yet.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeGetBlockMotion(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jintArray out, jintArray sizeOut) {
+    if (sessionAddr == 0 || out == nullptr) return 0;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    const std::vector<BlockVector>& field = session->blockMatcher.vectors();
+    if (field.empty()) return 0;
+
+    const jint size[2] = {session->blockMatcher.blocksX(), session->blockMatcher.blocksY()};
+    if (sizeOut != nullptr && env->GetArrayLength(sizeOut) >= 2) {
+        env->SetIntArrayRegion(sizeOut, 0, 2, size);
+    }
+    const jsize blocks = std::min<jsize>(env->GetArrayLength(out), static_cast<jsize>(field.size()));
+    env->SetIntArrayRegion(out, 0, blocks, reinterpret_cast<const jint*>(field.data()));
+    return blocks;
+}
+
+// ================= Panorama =================
+// Enabling starts a new mosaic; disabling keeps the current one for rendering.
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeSetPanoramaEnabled(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jboolean enabled) {
+    (void)env;
+    if (sessionAddr == 0) return;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    if (enabled && !session->panoramaEnabled) session->panorama.reset();
+    session->panoramaEnabled = enabled;
+}
+
+// Renders the mosaic into `matAddr` as 8-bit gray, or as Canny edges with the
+// coverage border suppressed when `edges` is set.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeRenderPanorama(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jlong matAddr, jboolean edges) {
+    (void)env;
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || matAddr == 0) return false;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    const PanoramaStitcher& panorama = session->panorama;
+    if (panorama.empty()) return false;
+    try {
+        cv::Mat& out = *(cv::Mat*) matAddr;
+        cv::Mat mosaic(panorama.height(), panorama.width(), CV_8UC1);
+        cv::Mat coverage(mosaic.size(), CV_8UC1);
+        panorama.render(mosaic.data, mosaic.step, coverage.data, coverage.step);
+        if (edges) {
+            cv::Canny(mosaic, out, 100, 200);
+            cv::erode(coverage, coverage, cv::Mat(), cv::Point(-1, -1), 2);
+            out.setTo(0, coverage == 0);
+        } else {
+            mosaic.copyTo(out);
+        }
+        LOGI("Panorama: %d frames, %dx%d, %zu tiles", panorama.frameCount(),
+             panorama.width(), panorama.height(), panorama.tileCount());
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("nativeRenderPanorama exception: %s", e.what());
+        return false;
+    }
+#else
+    (void)sessionAddr; (void)matAddr; (void)edges;
+    return false;
+#endif
+}
+
+// ================= HDR Fusion =================
+// Fuses a bracket of same-sized mats (Y planes or RGBA) into an 8-bit gray
+// mat at `dstAddr`, ready for edge detection.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeFuseExposures(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jlongArray matAddrs, jlong dstAddr) {
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || matAddrs == nullptr || dstAddr == 0) return false;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    const jsize count = env->GetArrayLength(matAddrs);
+    if (count < 2 || count > ExposureFusion::kMaxFrames) {
+        LOGE("nativeFuseExposures: need 2..%d frames, got %d", ExposureFusion::kMaxFrames, count);
+        return false;
+    }
+    jlong addrs[ExposureFusion::kMaxFrames];
+    env->GetLongArrayRegion(matAddrs, 0, count, addrs);
+    try {
+        cv::Mat gray[ExposureFusion::kMaxFrames];
+        const uint8_t* planes[ExposureFusion::kMaxFrames];
+        size_t strides[ExposureFusion::kMaxFrames];
+        for (jsize i = 0; i < count; ++i) {
+            const cv::Mat& src = *(cv::Mat*) addrs[i];
+            if (src.empty() || (src.type() != CV_8UC1 && src.type() != CV_8UC4) ||
+                (i > 0 && (src.cols != gray[0].cols || src.rows != gray[0].rows))) {
+                LOGE("nativeFuseExposures: frame %d is not a matching gray or RGBA mat", i);
+                return false;
+            }
+            if (src.type() == CV_8UC4) {
+                cv::cvtColor(src, gray[i], cv::COLOR_RGBA2GRAY);
+            } else {
+                gray[i] = src;
+            }
+            planes[i] = gray[i].data;
+            strides[i] = gray[i].step;
+        }
+        cv::Mat& dst = *(cv::Mat*) dstAddr;
+        dst.create(gray[0].rows, gray[0].cols, CV_8UC1);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        const bool ok = session->hdr.fuse(planes, strides, count, gray[0].cols, gray[0].rows,
+                                          dst.data, dst.step);
+        auto end = std::chrono::high_resolution_clock::now();
+        LOGI("Fused %d exposures in %lld ms", count,
+             static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()));
+        return ok;
+    } catch (const std::exception& e) {
+        LOGE("nativeFuseExposures exception: %s", e.what());
+        return false;
+    }
+#else
+    (void)env; (void)sessionAddr; (void)matAddrs; (void)dstAddr;
+    return false;
+#endif
+}
+
+// ================= Perceptual Hash Index =================
+// pHash of a gray or RGBA mat into out[0]. Returns false if the mat is
+// unusable; every hash value, 0 included, is a valid result.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeComputePhash(
+        JNIEnv* env,
+        jobject /* this */, jlong matAddr, jlongArray out) {
+#ifdef HAVE_OPENCV
+    if (matAddr == 0 || out == nullptr || env->GetArrayLength(out) < 1) return false;
+    try {
+        const cv::Mat& src = *(cv::Mat*) matAddr;
+        cv::Mat gray;
+        if (src.type() == CV_8UC4) {
+            cv::cvtColor(src, gray, cv::COLOR_RGBA2GRAY);
+        } else if (src.type() == CV_8UC1) {
+            gray = src;
+        } else {
+            LOGE("nativeComputePhash: expected gray or RGBA mat");
+            return false;
+        }
+        uint64_t hash = 0;
+        if (!perceptualHash(gray.data, gray.step, gray.cols, gray.rows, hash)) {
+            LOGE("nativeComputePhash: %dx%d mat is too small", gray.cols, gray.rows);
+            return false;
+        }
+        const jlong value = static_cast<jlong>(hash);
+        env->SetLongArrayRegion(out, 0, 1, &value);
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("nativeComputePhash exception: %s", e.what());
+        return false;
+    }
+#else
+    (void)env; (void)matAddr; (void)out;
+    return false;
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeOpenPhashIndex(
+        JNIEnv* env,
+        jobject /* this */, jstring path) {
+    if (path == nullptr) return 0;
+    const char* chars = env->GetStringUTFChars(path, nullptr);
+    if (chars == nullptr) return 0;
+    PhashIndex* index = new PhashIndex();
+    const bool ok = index->open(chars);
+    if (ok) {
+        LOGI("Opened pHash index %s with %zu entries", chars, index->size());
+    } else {
+        LOGE("nativeOpenPhashIndex: cannot open %s", chars);
+    }
+    env->ReleaseStringUTFChars(path, chars);
+    if (!ok) {
+        delete index;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(index);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeClosePhashIndex(
+        JNIEnv* env,
+        jobject /* this */, jlong indexAddr) {
+    (void)env;
+    delete reinterpret_cast<PhashIndex*>(indexAddr);
+}
+
+// Id of the nearest indexed hash within maxDistance bits, or -1.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativePhashFindNear(
+        JNIEnv* env,
+        jobject /* this */, jlong indexAddr, jlong hash, jint maxDistance) {
+    (void)env;
+    if (indexAddr == 0) return -1;
+    return reinterpret_cast<PhashIndex*>(indexAddr)->findNear(static_cast<uint64_t>(hash), maxDistance);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativePhashInsert(
+        JNIEnv* env,
+        jobject /* this */, jlong indexAddr, jlong hash, jlong id) {
+    (void)env;
+    if (indexAddr == 0) return false;
+    return reinterpret_cast<PhashIndex*>(indexAddr)->insert(static_cast<uint64_t>(hash), id);
+}
+
+// ================= Thumbnail Atlas =================
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeOpenAtlas(
+        JNIEnv* env,
+        jobject /* this */, jstring path, jint width, jint height, jint channels) {
+    if (path == nullptr) return 0;
+    const char* chars = env->GetStringUTFChars(path, nullptr);
+    if (chars == nullptr) return 0;
+    ThumbnailAtlas::Format format;
+    format.width = width;
+    format.height = height;
+    format.channels = channels;
+    ThumbnailAtlas* atlas = new ThumbnailAtlas();
+    const bool ok = atlas->open(chars, format);
+    if (ok) {
+        LOGI("Opened thumbnail atlas %s with %d thumbnails", chars, atlas->count());
+    } else {
+        LOGE("nativeOpenAtlas: cannot open %s as %dx%dx%d", chars, width, height, channels);
+    }
+    env->ReleaseStringUTFChars(path, chars);
+    if (!ok) {
+        delete atlas;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(atlas);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeCloseAtlas(
+        JNIEnv* env,
+        jobject /* this */, jlong atlasAddr) {
+    (void)env;
+    delete reinterpret_cast<ThumbnailAtlas*>(atlasAddr);
+}
+
+// Downscales a gray or RGBA mat through a session pool buffer and appends
+// it. Returns the thumbnail index or -1.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeAtlasAppend(
+        JNIEnv* env,
+        jobject /* this */, jlong atlasAddr, jlong sessionAddr, jlong matAddr, jlong id) {
+    (void)env;
+#ifdef HAVE_OPENCV
+    if (atlasAddr == 0 || sessionAddr == 0 || matAddr == 0) return -1;
+    ThumbnailAtlas* atlas = reinterpret_cast<ThumbnailAtlas*>(atlasAddr);
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    const cv::Mat& src = *(cv::Mat*) matAddr;
+    if (src.empty() || (src.type() != CV_8UC1 && src.type() != CV_8UC4)) {
+        LOGE("nativeAtlasAppend: expected gray or RGBA mat");
+        return -1;
+    }
+    const ThumbnailAtlas::Format& format = atlas->format();
+    PooledBuffer thumb = session->pool.acquire(atlas->thumbnailBytes());
+    resampleThumbnail(src.data, src.step, src.channels(), src.cols, src.rows,
+                      thumb.data(), format.channels, format.width, format.height,
+                      session->thumbScratch);
+    return atlas->append(id, thumb.data());
+#else
+    (void)atlasAddr; (void)sessionAddr; (void)matAddr; (void)id;
+    return -1;
+#endif
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeAtlasCount(
+        JNIEnv* env,
+        jobject /* this */, jlong atlasAddr) {
+    (void)env;
+    return atlasAddr ? reinterpret_cast<ThumbnailAtlas*>(atlasAddr)->count() : 0;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeAtlasFind(
+        JNIEnv* env,
+        jobject /* this */, jlong atlasAddr, jlong id) {
+    (void)env;
+    return atlasAddr ? reinterpret_cast<ThumbnailAtlas*>(atlasAddr)->find(id) : -1;
+}
+
+// Zero-copy view of thumbnail `index` in the mapped file, valid until the
+// atlas is closed. Callers must treat it as read-only.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeAtlasSlice(
+        JNIEnv* env,
+        jobject /* this */, jlong atlasAddr, jint index) {
+    if (atlasAddr == 0) return nullptr;
+    ThumbnailAtlas* atlas = reinterpret_cast<ThumbnailAtlas*>(atlasAddr);
+    const uint8_t* pixels = atlas->pixels(index);
+    if (pixels == nullptr) return nullptr;
+    return env->NewDirectByteBuffer(const_cast<uint8_t*>(pixels), static_cast<jlong>(atlas->thumbnailBytes()));
+}
+
+// Copies thumbnail `index` into an ARGB_8888 bitmap of the atlas's size.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeAtlasToBitmap(
+        JNIEnv* env,
+        jobject /* this */, jlong atlasAddr, jint index, jobject bitmap) {
+    if (atlasAddr == 0 || bitmap == nullptr) return false;
+    ThumbnailAtlas* atlas = reinterpret_cast<ThumbnailAtlas*>(atlasAddr);
+    const ThumbnailAtlas::Format& format = atlas->format();
+    const uint8_t* src = atlas->pixels(index);
+    if (src == nullptr) return false;
+
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+        info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+        static_cast<int>(info.width) != format.width || static_cast<int>(info.height) != format.height) {
+        LOGE("nativeAtlasToBitmap: bitmap must be ARGB_8888 of %dx%d", format.width, format.height);
+        return false;
+    }
+    void* pixels = nullptr;
+    if (AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS || !pixels) {
+        LOGE("nativeAtlasToBitmap: lockPixels failed");
+        return false;
+    }
+    packToRgba(src, static_cast<size_t>(format.width) * format.channels, format.channels,
+               static_cast<uint8_t*>(pixels), info.stride, format.width, format.height);
+    AndroidBitmap_unlockPixels(env, bitmap);
+    return true;
+}
+
+// ================= Native Frame Sources =================
+// Runs a FrameSource into a session: each frame's luma goes through the
+// session pipeline on the source's thread, and the planar result is double
+// buffered for nativePresentSourceFrame. While a source runs it owns the
+// session's processing state, so processFrame must not be used on that
+// session until the source is stopped.
+struct FrameSourceRunner {
+    std::unique_ptr<FrameSource> source;
+    ProcessingSession* session = nullptr;
+    PlanarImage back;   // source thread only
+    std::mutex mutex;   // guards everything below
+    PlanarImage front;
+    int width = 0;
+    int height = 0;
+    uint64_t produced = 0;
+    uint64_t presented = 0;
+};
+
+static jlong startFrameSource(jlong sessionAddr, std::unique_ptr<FrameSource> source) {
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0) return 0;
+    std::unique_ptr<FrameSourceRunner> runner(new FrameSourceRunner());
+    runner->session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    runner->source = std::move(source);
+    FrameSourceRunner* r = runner.get();
+    const bool ok = r->source->start([r](const FrameView& frame) {
+        static thread_local ProfiledThread profiled("source");
+        try {
+            const cv::Mat gray(frame.height, frame.width, CV_8UC1,
+                               const_cast<uint8_t*>(frame.y), frame.yStride);
+            runPipeline(r->session, gray, r->back);
+            PipelineMetrics& metrics = pipelineMetrics();
+            metrics.sourceFrames.inc();
+            std::lock_guard<std::mutex> lock(r->mutex);
+            if (r->produced != r->presented) metrics.sourceDropped.inc();  // latest frame wins
+            std::swap(r->front, r->back);
+            r->width = frame.width;
+            r->height = frame.height;
+            ++r->produced;
+        } catch (const std::exception& e) {
+            LOGE("Frame source pipeline exception: %s", e.what());
+        }
+    });
+    if (!ok) {
+        LOGE("Frame source %s failed to start", r->source->name());
+        return 0;
+    }
+    LOGI("Started %s frame source %dx%d", r->source->name(), r->source->width(), r->source->height());
+    return reinterpret_cast<jlong>(runner.release());
+#else
+    (void)sessionAddr; (void)source;
+    return 0;
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStartCameraSource(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jstring cameraId, jint width, jint height) {
+    std::string id;
+    if (cameraId != nullptr) {
+        const char* chars = env->GetStringUTFChars(cameraId, nullptr);
+        if (chars != nullptr) {
+            id = chars;
+            env->ReleaseStringUTFChars(cameraId, chars);
+        }
+    }
+    return startFrameSource(sessionAddr, std::unique_ptr<FrameSource>(new CameraFrameSource(id, width, height)));
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStartSyntheticSource(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jint width, jint height, jdouble fps) {
+    (void)env;
+    return startFrameSource(sessionAddr, std::unique_ptr<FrameSource>(new SyntheticFrameSource(width, height, fps)));
+}
+
+// `format` is 0 for gray, 1 for I420 and 2 for NV12 raw frames.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStartFileSource(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jstring path, jint format,
+        jint width, jint height, jdouble fps, jboolean loop) {
+    if (path == nullptr || format < 0 || format > 2) return 0;
+    const char* chars = env->GetStringUTFChars(path, nullptr);
+    if (chars == nullptr) return 0;
+    std::unique_ptr<FrameSource> source(new FileFrameSource(
+            chars, static_cast<FileFrameSource::Format>(format), width, height, fps, loop));
+    env->ReleaseStringUTFChars(path, chars);
+    return startFrameSource(sessionAddr, std::move(source));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeStopFrameSource(
+        JNIEnv* env,
+        jobject /* this */, jlong runnerAddr) {
+    (void)env;
+    if (runnerAddr == 0) return;
+    FrameSourceRunner* runner = reinterpret_cast<FrameSourceRunner*>(runnerAddr);
+    runner->source->stop();
+    LOGI("Stopped %s frame source after %llu frames", runner->source->name(),
+         static_cast<unsigned long long>(runner->produced));
+    delete runner;
+}
+
+// Presents the newest processed source frame like nativeMatToBitmapDirty.
+// Returns 0 if no frame arrived since the last call.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativePresentSourceFrame(
+        JNIEnv* env,
+        jobject /* this */, jlong runnerAddr, jobject bitmap, jintArray rectsOut) {
+    if (runnerAddr == 0 || bitmap == nullptr) return -1;
+    FrameSourceRunner* runner = reinterpret_cast<FrameSourceRunner*>(runnerAddr);
+    std::lock_guard<std::mutex> lock(runner->mutex);
+    if (runner->produced == runner->presented || runner->front.empty()) return 0;
+    runner->presented = runner->produced;
+    ProcessingSession* session = runner->session;
+    const PlanarImage& frame = runner->front;
+    return presentToBitmap(env, session, runner->width, runner->height, bitmap, rectsOut,
+                           [&](int width, int height, uint8_t* pixels, size_t stride) {
+        session->output.present(frame, width, height, pixels, stride, session->dirtyRects);
+    });
+}
+
+// ================= RAW Bayer Ingest =================
+// Sensor RAW frames (plane 0 of a RAW10 or RAW16 Image) straight to RGBA or
+// into the edge pipeline, see BayerDecoder. Parameters come from the capture's
+// CameraCharacteristics / CaptureResult and persist in the session.
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeSetRawParams(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jint pattern, jintArray blackLevel, jint whiteLevel,
+        jfloatArray gains, jboolean srgb) {
+    if (sessionAddr == 0 || blackLevel == nullptr || gains == nullptr) return false;
+    if (pattern < 0 || pattern > static_cast<int>(BayerPattern::Bggr) || whiteLevel <= 0 ||
+        env->GetArrayLength(blackLevel) != 4 || env->GetArrayLength(gains) != 4) {
+        LOGE("nativeSetRawParams: invalid parameters");
+        return false;
+    }
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    BayerDecoder::Params params;
+    params.pattern = static_cast<BayerPattern>(pattern);
+    env->GetIntArrayRegion(blackLevel, 0, 4, params.blackLevel);
+    params.whiteLevel = whiteLevel;
+    env->GetFloatArrayRegion(gains, 0, 4, params.gains);
+    params.srgb = srgb;
+    session->bayer.setParams(params);
+    return true;
+}
+
+// Wraps a direct buffer holding one RAW frame; data is null if the buffer is
+// not direct or too small for `height` rows of `rowStride`.
+static RawFrame rawFrameOf(JNIEnv* env, jobject buffer, jint rowStride, jint width, jint height, jint packing) {
+    RawFrame raw;
+    if (buffer == nullptr || width <= 0 || height <= 0 || rowStride <= 0 ||
+        (packing != static_cast<int>(RawPacking::Raw10) && packing != static_cast<int>(RawPacking::Raw16))) {
+        return raw;
+    }
+    raw.packing = static_cast<RawPacking>(packing);
+    const int64_t rowBytes = raw.packing == RawPacking::Raw10 ? static_cast<int64_t>(width) / 4 * 5
+                                                                : static_cast<int64_t>(width) * 2;
+    if (env->GetDirectBufferCapacity(buffer) < static_cast<int64_t>(rowStride) * (height - 1) + rowBytes) {
+        return raw;
+    }
+    raw.data = static_cast<const uint8_t*>(env->GetDirectBufferAddress(buffer));
+    raw.stride = static_cast<size_t>(rowStride);
+    raw.width = width;
+    raw.height = height;
+    return raw;
+}
+
+// Demosaics a RAW frame with DEMOSAIC_* `method` and presents it into `bitmap`
+// like nativeMatToBitmapDirty. Returns -1 if the frame is unsupported.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeRawToBitmap(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jobject buffer, jint rowStride, jint width, jint height,
+        jint packing, jint method, jobject bitmap, jintArray rectsOut) {
+    if (sessionAddr == 0 || bitmap == nullptr) return -1;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    const RawFrame raw = rawFrameOf(env, buffer, rowStride, width, height, packing);
+    const DemosaicMethod demosaic = method == static_cast<int>(DemosaicMethod::EdgeDirected)
+                                        ? DemosaicMethod::EdgeDirected : DemosaicMethod::Bilinear;
+    if (raw.data == nullptr || !session->bayer.demosaic(raw, demosaic, session->rawRgb)) {
+        LOGE("nativeRawToBitmap: unsupported %dx%d frame (packing %d, stride %d)", width, height, packing, rowStride);
+        return -1;
+    }
+    const PlanarImage& rgb = session->rawRgb;
+    return presentToBitmap(env, session, width, height, bitmap, rectsOut,
+                           [&](int w, int h, uint8_t* pixels, size_t stride) {
+        session->output.present(rgb, w, h, pixels, stride, session->dirtyRects);
+    });
+}
+
+// Runs the session's edge pipeline on a RAW frame through the luma-only path,
+// skipping the demosaic. `matAddr` receives the edge plane (CV_8UC1), as
+// from nativeProcessFrame with copyEdges.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeProcessRawFrame(
+        JNIEnv* env,
+        jobject /* this */, jlong sessionAddr, jobject buffer, jint rowStride, jint width, jint height,
+        jint packing, jlong matAddr) {
+#ifdef HAVE_OPENCV
+    if (sessionAddr == 0 || matAddr == 0) return false;
+    ProcessingSession* session = reinterpret_cast<ProcessingSession*>(sessionAddr);
+    static thread_local ProfiledThread profiled("analyzer");
+    try {
+        const RawFrame raw = rawFrameOf(env, buffer, rowStride, width, height, packing);
+        session->luma.resize(static_cast<size_t>(width) * height);
+        if (raw.data == nullptr || !session->bayer.luma(raw, session->luma.data(), static_cast<size_t>(width))) {
+            LOGE("nativeProcessRawFrame: unsupported %dx%d frame (packing %d, stride %d)",
+                 width, height, packing, rowStride);
+            return false;
+        }
+        cv::Mat gray(height, width, CV_8UC1, session->luma.data());
+        runPipeline(session, gray, session->edges);
+        cv::Mat& out = *(cv::Mat*) matAddr;
+        cv::Mat(height, width, CV_8UC1, session->edges.plane(0), session->edges.stride()).copyTo(out);
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("nativeProcessRawFrame exception: %s", e.what());
+        return false;
+    }
+#else
+    (void)env; (void)sessionAddr; (void)buffer; (void)rowStride; (void)width; (void)height;
+    (void)packing; (void)matAddr;
+    return false;
+#endif
+}
+
+// ================= Quality Metrics =================
+#ifdef HAVE_OPENCV
+// Single 8-bit plane of a gray or RGBA mat: luma for images, channel 0 for
+// edge maps given as gray-in-RGBA. Empty if unsupported.
+static cv::Mat qualityPlane(const cv::Mat& src, bool edges) {
+    cv::Mat plane;
+    if (src.type() == CV_8UC1) {
+        plane = src;
+    } else if (src.type() == CV_8UC4) {
+        if (edges) {
+            cv::extractChannel(src, plane, 0);
+        } else {
+            cv::cvtColor(src, plane, cv::COLOR_RGBA2GRAY);
+        }
+    }
+    return plane;
+}
+#endif
+
+// out receives {psnr dB, ssim} of two same-size gray or RGBA mats (compared
+// on luma); PSNR is +infinity for identical images.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeImageQuality(
+        JNIEnv* env,
+        jobject /* this */, jlong matAddr, jlong referenceAddr, jdoubleArray out) {
+#ifdef HAVE_OPENCV
+    if (matAddr == 0 || referenceAddr == 0 || out == nullptr || env->GetArrayLength(out) < 2) return false;
+    try {
+        const cv::Mat a = qualityPlane(*(cv::Mat*) matAddr, false);
+        const cv::Mat b = qualityPlane(*(cv::Mat*) referenceAddr, false);
+        if (a.empty() || b.empty() || a.size() != b.size()) {
+            LOGE("nativeImageQuality: expected two gray or RGBA mats of the same size");
+            return false;
+        }
+        const jdouble result[2] = {
+            psnr(a.data, a.step, b.data, b.step, a.cols, a.rows),
+            ssim(a.data, a.step, b.data, b.step, a.cols, a.rows),
+        };
+        env->SetDoubleArrayRegion(out, 0, 2, result);
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("nativeImageQuality exception: %s", e.what());
+        return false;
+    }
+#else
+    (void)env; (void)matAddr; (void)referenceAddr; (void)out;
+    return false;
+#endif
+}
+
+// out receives {precision, recall, F-score} of an edge map against a
+// reference edge map, matching within `tolerance` pixels.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeEdgeScore(
+        JNIEnv* env,
+        jobject /* this */, jlong edgesAddr, jlong referenceAddr, jint tolerance, jdoubleArray out) {
+#ifdef HAVE_OPENCV
+    if (edgesAddr == 0 || referenceAddr == 0 || out == nullptr || env->GetArrayLength(out) < 3) return false;
+    try {
+        const cv::Mat e = qualityPlane(*(cv::Mat*) edgesAddr, true);
+        const cv::Mat r = qualityPlane(*(cv::Mat*) referenceAddr, true);
+        if (e.empty() || r.empty() || e.size() != r.size()) {
+            LOGE("nativeEdgeScore: expected two gray or RGBA mats of the same size");
+            return false;
+        }
+        const EdgeScore score = edgeScore(e.data, e.step, r.data, r.step, e.cols, e.rows, tolerance);
+        const jdouble result[3] = {score.precision, score.recall, score.fScore};
+        env->SetDoubleArrayRegion(out, 0, 3, result);
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("nativeEdgeScore exception: %s", e.what());
+        return false;
+    }
+#else
+    (void)env; (void)edgesAddr; (void)referenceAddr; (void)tolerance; (void)out;
+    return false;
+#endif
+}
+
+// ================= Pipeline Benchmark / PGO Training =================
+// Replays frames through every pipeline configuration and reports the mean
+// native time per frame of each (pipeline plus dirty-rect output) and, when
+// asked, its mean edge F-score against exact cv::Canny on the same frames
+// (untimed, kBenchmarkEdgeTolerance pixels of slack). It can also report
+// the intermediate-image traffic of each stage for the planar layout the
+// pipeline uses and for the RGBA one it replaced (untimed; see
+// kBenchmarkTrafficValues for which figures are measured). With a
+// recorded corpus the frames come from a looping FileFrameSource, otherwise
+// from the synthetic pattern. In a FLAM_PGO=GENERATE build this is the
+// training run: the profile is written to profileDir when it finishes.
+#ifdef FLAM_PGO_GENERATE
+extern "C" void __llvm_profile_set_filename(const char* name);
+extern "C" int __llvm_profile_write_file(void);
+#endif
+
+struct BenchmarkMode {
+    const char* name;
+    EdgeMode edgeMode;
+    bool flow;
+    bool blockMotion;
+    bool panorama;
+};
+
+// Keep in sync with OpenCVUtils.BENCHMARK_MODES.
+static const BenchmarkMode kBenchmarkModes[] = {
+    {"full", EdgeMode::Full, false, false, false},
+    {"half-res guided", EdgeMode::HalfResGuided, false, false, false},
+    {"temporal", EdgeMode::Temporal, false, false, false},
+    {"temporal + flow", EdgeMode::Temporal, true, false, false},
+    {"temporal + block motion", EdgeMode::Temporal, false, true, false},
+    {"full + panorama", EdgeMode::Full, false, false, true},
+};
+static constexpr int kBenchmarkModeCount = sizeof(kBenchmarkModes) / sizeof(kBenchmarkModes[0]);
+static constexpr int kBenchmarkEdgeTolerance = 1;
+
+// Per mode: {edges planar, edges RGBA, present planar, present RGBA} bytes/frame.
+// The edge figures are computed, not measured: the size of the output image
+// the stage writes in each layout. The present figures are measured, what
+// DirtyRectTracker actually read and wrote to diff and repaint it.
+static constexpr int kBenchmarkTrafficValues = 4;
+
+#ifdef HAVE_OPENCV
+// Mean ms per frame of one mode, or -1 if the source failed. If fScore is
+// non-null it receives the mean edge F-score against the exact path, and if
+// traffic is non-null the mean kBenchmarkTrafficValues byte counts.
+static double benchmarkMode(const BenchmarkMode& mode, const std::string& corpus, int format,
+                            int width, int height, int frames, double* fScore, double* traffic) {
+    std::unique_ptr<FrameSource> source;
+    if (corpus.empty()) {
+        source.reset(new SyntheticFrameSource(width, height, 0.0, frames));
+    } else {
+        source.reset(new FileFrameSource(corpus, static_cast<FileFrameSource::Format>(format),
+                                         width, height, 0.0, true, frames));
+    }
+
+    ProcessingSession session;
+    session.width = width;
+    session.height = height;
+    session.edgeMode = mode.edgeMode;
+    session.flowEnabled = mode.flow;
+    session.blockMotionEnabled = mode.blockMotion;
+    session.panoramaEnabled = mode.panorama;
+
+    const size_t stride = static_cast<size_t>(width) * 4;
+    PlanarImage edges;
+    std::vector<uint8_t> presented(stride * height);
+    std::vector<uint8_t> rgba;  // interleaved reference for the traffic comparison
+    std::vector<uint8_t> rgbaPresented;
+    DirtyRectTracker rgbaOutput;
+    std::vector<DirtyRect> rgbaRects;
+    std::mutex mutex;
+    std::condition_variable done;
+    int processed = 0;
+    double totalMs = 0.0;
+    double totalScore = 0.0;
+    double totalTraffic[kBenchmarkTrafficValues] = {};
+    cv::Mat exact;
+
+    const bool ok = source->start([&](const FrameView& frame) {
+        const cv::Mat gray(frame.height, frame.width, CV_8UC1, const_cast<uint8_t*>(frame.y), frame.yStride);
+        const auto t0 = std::chrono::steady_clock::now();
+        runPipeline(&session, gray, edges);
+        session.output.present(edges, width, height, presented.data(), stride, session.dirtyRects);
+        const auto t1 = std::chrono::steady_clock::now();
+        double score = 0.0;
+        if (fScore != nullptr) {
+            cv::Canny(gray, exact, 100, 200);
+            score = edgeScore(edges.plane(0), edges.stride(), exact.data, exact.step,
+                              width, height, kBenchmarkEdgeTolerance).fScore;
+        }
+        double frameTraffic[kBenchmarkTrafficValues] = {};
+        if (traffic != nullptr) {
+            rgba.resize(stride * height);
+            rgbaPresented.resize(stride * height);
+            packToRgba(edges.plane(0), edges.stride(), 1, rgba.data(), stride, width, height);
+            rgbaOutput.present(rgba.data(), stride, pixelFormatOps(PixelFormat::Rgba8), width, height,
+                               rgbaPresented.data(), stride, rgbaRects);
+            // Computed output sizes; see kBenchmarkTrafficValues.
+            frameTraffic[0] = static_cast<double>(edges.bytes());
+            frameTraffic[1] = static_cast<double>(rgba.size());
+            frameTraffic[2] = static_cast<double>(session.output.lastTraffic());
+            frameTraffic[3] = static_cast<double>(rgbaOutput.lastTraffic());
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        totalMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        totalScore += score;
+        for (int i = 0; i < kBenchmarkTrafficValues; ++i) totalTraffic[i] += frameTraffic[i];
+        if (++processed == frames) done.notify_one();
+    });
+    if (!ok) return -1.0;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait_for(lock, std::chrono::seconds(60), [&] { return processed >= frames; });
+    }
+    source->stop();
+    if (fScore != nullptr) *fScore = processed > 0 ? totalScore / processed : 0.0;
+    if (traffic != nullptr) {
+        for (int i = 0; i < kBenchmarkTrafficValues; ++i) {
+            traffic[i] = processed > 0 ? totalTraffic[i] / processed : 0.0;
+        }
+    }
+    return processed > 0 ? totalMs / processed : -1.0;
+}
+#endif
+
+// Writes one mean ms/frame per mode into msOut (-1 where a mode could not
+// run), if fScoreOut is non-null one mean edge F-score per mode, and if
+// trafficOut is non-null kBenchmarkTrafficValues byte counts per mode.
+// corpusPath may be null; format is as for nativeStartFileSource.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeRunPipelineBenchmark(
+        JNIEnv* env,
+        jobject /* this */, jint width, jint height, jint frames,
+        jstring corpusPath, jint format, jstring profileDir, jdoubleArray msOut, jdoubleArray fScoreOut,
+        jdoubleArray trafficOut) {
+#ifdef HAVE_OPENCV
+    if (width < 16 || height < 16 || frames <= 0 || format < 0 || format > 2 || msOut == nullptr ||
+        env->GetArrayLength(msOut) < kBenchmarkModeCount ||
+        (fScoreOut != nullptr && env->GetArrayLength(fScoreOut) < kBenchmarkModeCount) ||
+        (trafficOut != nullptr &&
+         env->GetArrayLength(trafficOut) < kBenchmarkModeCount * kBenchmarkTrafficValues)) {
+        return false;
+    }
+    std::string corpus;
+    if (corpusPath != nullptr) {
+        const char* chars = env->GetStringUTFChars(corpusPath, nullptr);
+        if (chars == nullptr) return false;
+        corpus = chars;
+        env->ReleaseStringUTFChars(corpusPath, chars);
+    }
+
+    double ms[kBenchmarkModeCount];
+    double score[kBenchmarkModeCount] = {};
+    double traffic[kBenchmarkModeCount * kBenchmarkTrafficValues] = {};
+    for (int i = 0; i < kBenchmarkModeCount; ++i) {
+        double* t = traffic + i * kBenchmarkTrafficValues;
+        try {
+            ms[i] = benchmarkMode(kBenchmarkModes[i], corpus, format, width, height, frames,
+                                  fScoreOut != nullptr ? &score[i] : nullptr,
+                                  trafficOut != nullptr ? t : nullptr);
+        } catch (const std::exception& e) {
+            LOGE("Benchmark mode %s exception: %s", kBenchmarkModes[i].name, e.what());
+            ms[i] = -1.0;
+        }
+        LOGI("Benchmark %-24s %dx%d: %.2f ms/frame, edge F %.4f, edges %.0f / %.0f KiB, present %.0f / %.0f KiB (planar / RGBA)",
+             kBenchmarkModes[i].name, width, height, ms[i], score[i],
+             t[0] / 1024.0, t[1] / 1024.0, t[2] / 1024.0, t[3] / 1024.0);
+    }
+    env->SetDoubleArrayRegion(msOut, 0, kBenchmarkModeCount, ms);
+    if (fScoreOut != nullptr) env->SetDoubleArrayRegion(fScoreOut, 0, kBenchmarkModeCount, score);
+    if (trafficOut != nullptr) {
+        env->SetDoubleArrayRegion(trafficOut, 0, kBenchmarkModeCount * kBenchmarkTrafficValues, traffic);
+    }
+
+#ifdef FLAM_PGO_GENERATE
+    if (profileDir != nullptr) {
+        const char* chars = env->GetStringUTFChars(profileDir, nullptr);
+        if (chars != nullptr) {
+            const std::string path = std::string(chars) + "/flam_rnd_native.profraw";
+            env->ReleaseStringUTFChars(profileDir, chars);
+            __llvm_profile_set_filename(path.c_str());
+            if (__llvm_profile_write_file() == 0) {
+                LOGI("PGO profile written to %s", path.c_str());
+            } else {
+                LOGE("Failed to write PGO profile to %s", path.c_str());
+            }
+        }
+    }
+#else
+    (void)profileDir;
+#endif
+    return true;
+#else
+    (void)env; (void)width; (void)height; (void)frames;
+    (void)corpusPath; (void)format; (void)profileDir; (void)msOut; (void)fScoreOut; (void)trafficOut;
+    return false;
+#endif
+}
+
+// 0 for a plain build, 1 for an instrumented (FLAM_PGO=GENERATE) build and
+// 2 for a profile-optimized (FLAM_PGO=USE) one.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativePgoMode(
+        JNIEnv* env,
+        jobject /* this */) {
+    (void)env;
+#if defined(FLAM_PGO_GENERATE)
+    return 1;
+#elif defined(FLAM_PGO_USE)
+    return 2;
+#else
+    return 0;
+#endif
+}
+
+// ================= SIMD Self-Check =================
+
+// Runs simdSelfCheck() and returns its report: one line per operation or
+// kernel whose vector path differs from the scalar one, then a summary.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_flam_rnd_utils_OpenCVUtils_nativeSimdSelfCheck(
+        JNIEnv* env,
+        jobject /* this */) {
+    const SimdCheckResult result = simdSelfCheck();
+    if (result.failures > 0) {
+        LOGE("SIMD self-check (%s): %d of %d checks differ from scalar",
+             result.isa, result.failures, result.checks);
+    } else {
+        LOGI("SIMD self-check (%s): %d checks bit-exact", result.isa, result.checks);
+    }
+    return env->NewStringUTF(result.report.c_str());
+}
@@ -0,0 +1,318 @@
+#include "panorama.h"
+
+#include "band_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using cfloat = std::complex<float>;
+
+static int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int floorPow2(int v) {
+    int p = 1;
+    while (p * 2 <= v) p *= 2;
+    return p;
+}
+
+// In-place radix-2 FFT of n (a power of two) samples spaced `step` apart.
+static void fft(cfloat* data, int n, size_t step, bool inverse) {
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i * step], data[j * step]);
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        const float angle = (inverse ? 2.0f : -2.0f) * static_cast<float>(M_PI) / static_cast<float>(len);
+        const cfloat wlen(std::cos(angle), std::sin(angle));
+        for (int i = 0; i < n; i += len) {
+            cfloat w(1.0f, 0.0f);
+            for (int k = 0; k < len / 2; ++k) {
+                cfloat& a = data[(i + k) * step];
+                cfloat& b = data[(i + k + len / 2) * step];
+                const cfloat t = b * w;
+                b = a - t;
+                a += t;
+                w *= wlen;
+            }
+        }
+    }
+}
+
+static void fft2d(cfloat* data, int width, int height, bool inverse) {
+    for (int y = 0; y < height; ++y) fft(data + static_cast<size_t>(y) * width, width, 1, inverse);
+    for (int x = 0; x < width; ++x) fft(data + x, height, static_cast<size_t>(width), inverse);
+}
+
+static void hannWindow(std::vector<float>& w, int n) {
+    w.resize(n);
+    for (int i = 0; i < n; ++i) {
+        w[i] = 0.5f - 0.5f * std::cos(2.0f * static_cast<float>(M_PI) * (i + 0.5f) / n);
+    }
+}
+
+// Sub-sample peak offset from a parabola through three samples.
+static float parabolicOffset(float l, float c, float r) {
+    const float d = l - 2.0f * c + r;
+    return d < 0.0f ? std::min(std::max(0.5f * (l - r) / d, -0.5f), 0.5f) : 0.0f;
+}
+
+void PanoramaStitcher::reset() {
+    tiles_.clear();
+    frames_ = 0;
+    minX_ = minY_ = maxX_ = maxY_ = 0;
+    lastX_ = lastY_ = 0;
+    velX_ = velY_ = 0;
+}
+
+void PanoramaStitcher::trim() {
+    pyramid_.trim();
+    regionPyramid_.trim();
+    weightPyramid_.trim();
+    std::vector<uint8_t>().swap(region_);
+    std::vector<uint8_t>().swap(regionWeight_);
+    std::vector<std::complex<float>>().swap(a_);
+    std::vector<std::complex<float>>().swap(b_);
+}
+
+const PanoramaStitcher::Tile* PanoramaStitcher::findTile(int tx, int ty) const {
+    auto it = tiles_.find(tileKey(tx, ty));
+    return it == tiles_.end() ? nullptr : it->second.get();
+}
+
+PanoramaStitcher::Result PanoramaStitcher::addFrame(const uint8_t* luma, size_t stride, int width, int height) {
+    pyramid_.build(luma, stride, width, height, 2);
+    if (pyramid_.levels() < 2) return Result::Rejected;
+
+    int ox = 0, oy = 0;
+    if (frames_ > 0) {
+        const int predX = lastX_ + velX_;
+        const int predY = lastY_ + velY_;
+        int dx = 0, dy = 0;
+        if (!registerFrame(pyramid_.level(2), predX, predY, dx, dy)) return Result::Rejected;
+        ox = predX + dx;
+        oy = predY + dy;
+    }
+    if (!blendFrame(luma, stride, width, height, ox, oy)) return Result::Full;
+
+    if (frames_ == 0) {
+        minX_ = ox; minY_ = oy;
+        maxX_ = ox + width; maxY_ = oy + height;
+    } else {
+        velX_ = ox - lastX_;
+        velY_ = oy - lastY_;
+        minX_ = std::min(minX_, ox); minY_ = std::min(minY_, oy);
+        maxX_ = std::max(maxX_, ox + width); maxY_ = std::max(maxY_, oy + height);
+    }
+    lastX_ = ox;
+    lastY_ = oy;
+    ++frames_;
+    return Result::Added;
+}
+
+// Reads the mosaic rectangle into region_ / regionWeight_.
+void PanoramaStitcher::readRegion(int x, int y, int width, int height) {
+    const int t = params_.tileSize;
+    region_.resize(static_cast<size_t>(width) * height);
+    regionWeight_.resize(region_.size());
+    for (int row = 0; row < height; ++row) {
+        const int my = y + row;
+        const int ty = floorDiv(my, t);
+        const int iy = my - ty * t;
+        uint8_t* dl = region_.data() + static_cast<size_t>(row) * width;
+        uint8_t* dw = regionWeight_.data() + static_cast<size_t>(row) * width;
+        for (int col = 0; col < width;) {
+            const int mx = x + col;
+            const int tx = floorDiv(mx, t);
+            const int ix = mx - tx * t;
+            const int n = std::min(t - ix, width - col);
+            if (const Tile* tile = findTile(tx, ty)) {
+                std::memcpy(dl + col, tile->luma.data() + iy * t + ix, n);
+                std::memcpy(dw + col, tile->weight.data() + iy * t + ix, n);
+            } else {
+                std::memset(dl + col, 0, n);
+                std::memset(dw + col, 0, n);
+            }
+            col += n;
+        }
+    }
+}
+
+// Phase-correlates the centre window of the 1/4-scale frame with the mosaic at
+// the predicted position; (dx, dy) is the correction in full-res pixels.
+bool PanoramaStitcher::registerFrame(const LumaPyramid::Level& low, int predX, int predY, int& dx, int& dy) {
+    const int n = floorPow2(std::min(low.width, params_.maxWindow));
+    const int m = floorPow2(std::min(low.height, params_.maxWindow));
+    if (n < 16 || m < 16) return false;
+    const int cx = (low.width - n) / 2;
+    const int cy = (low.height - m) / 2;
+
+    readRegion(predX + 4 * cx, predY + 4 * cy, 4 * n, 4 * m);
+    regionPyramid_.build(region_.data(), 4 * n, 4 * n, 4 * m, 2);
+    weightPyramid_.build(regionWeight_.data(), 4 * n, 4 * n, 4 * m, 2);
+    const uint8_t* ref = regionPyramid_.level(2).data();
+    const uint8_t* refWeight = weightPyramid_.level(2).data();
+
+    // Uncovered mosaic pixels take the covered mean so they add no structure.
+    const size_t count = static_cast<size_t>(n) * m;
+    double refSum = 0.0, curSum = 0.0;
+    size_t covered = 0;
+    for (int y = 0; y < m; ++y) {
+        const uint8_t* c = low.data() + static_cast<size_t>(cy + y) * low.width + cx;
+        for (int x = 0; x < n; ++x) {
+            const size_t i = static_cast<size_t>(y) * n + x;
+            if (refWeight[i] != 0) {
+                refSum += ref[i];
+                ++covered;
+            }
+            curSum += c[x];
+        }
+    }
+    if (covered * 4 < count) return false;
+    const float refMean = static_cast<float>(refSum / covered);
+    const float curMean = static_cast<float>(curSum / count);
+
+    if (static_cast<int>(hannX_.size()) != n) hannWindow(hannX_, n);
+    if (static_cast<int>(hannY_.size()) != m) hannWindow(hannY_, m);
+    a_.resize(count);
+    b_.resize(count);
+    for (int y = 0; y < m; ++y) {
+        const uint8_t* c = low.data() + static_cast<size_t>(cy + y) * low.width + cx;
+        for (int x = 0; x < n; ++x) {
+            const size_t i = static_cast<size_t>(y) * n + x;
+            const float w = hannX_[x] * hannY_[y];
+            const float r = refWeight[i] != 0 ? ref[i] : refMean;
+            a_[i] = cfloat((r - refMean) * w, 0.0f);
+            b_[i] = cfloat((c[x] - curMean) * w, 0.0f);
+        }
+    }
+
+    fft2d(a_.data(), n, m, false);
+    fft2d(b_.data(), n, m, false);
+    for (size_t i = 0; i < count; ++i) {
+        const cfloat c = a_[i] * std::conj(b_[i]);
+        const float mag = std::abs(c);
+        a_[i] = mag > 1e-6f ? c / mag : cfloat(0.0f, 0.0f);
+    }
+    fft2d(a_.data(), n, m, true);
+
+    size_t peak = 0;
+    for (size_t i = 1; i < count; ++i) {
+        if (a_[i].real() > a_[peak].real()) peak = i;
+    }
+    // The inverse transform is unnormalised: a perfect match peaks at n * m.
+    if (a_[peak].real() < params_.minResponse * static_cast<float>(count)) return false;
+
+    const int px = static_cast<int>(peak % n);
+    const int py = static_cast<int>(peak / n);
+    auto at = [&](int x, int y) { return a_[static_cast<size_t>((y + m) % m) * n + (x + n) % n].real(); };
+    const float c = a_[peak].real();
+    const float fx = (px > n / 2 ? px - n : px) + parabolicOffset(at(px - 1, py), c, at(px + 1, py));
+    const float fy = (py > m / 2 ? py - m : py) + parabolicOffset(at(px, py - 1), c, at(px, py + 1));
+    dx = static_cast<int>(std::lround(4.0f * fx));
+    dy = static_cast<int>(std::lround(4.0f * fy));
+    return true;
+}
+
+bool PanoramaStitcher::blendFrame(const uint8_t* luma, size_t stride, int width, int height, int ox, int oy) {
+    const int t = params_.tileSize;
+    const int tx0 = floorDiv(ox, t), tx1 = floorDiv(ox + width - 1, t);
+    const int ty0 = floorDiv(oy, t), ty1 = floorDiv(oy + height - 1, t);
+    const int cols = tx1 - tx0 + 1;
+    const int rows = ty1 - ty0 + 1;
+
+    size_t missing = 0;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) missing += findTile(tx, ty) == nullptr;
+    }
+    if (tiles_.size() + missing > static_cast<size_t>(params_.maxTiles)) return false;
+
+    // Allocate up front so the parallel pass never touches the map.
+    std::vector<Tile*> jobs(static_cast<size_t>(cols) * rows, nullptr);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            std::unique_ptr<Tile>& slot = tiles_[tileKey(tx, ty)];
+            if (!slot) {
+                slot.reset(new Tile());
+                slot->luma.assign(static_cast<size_t>(t) * t, 0);
+                slot->weight.assign(static_cast<size_t>(t) * t, 0);
+            }
+            if (!slot->full) jobs[static_cast<size_t>(ty - ty0) * cols + (tx - tx0)] = slot.get();
+        }
+    }
+
+    // Feather ramps: weight rises from the frame border to 255 over seamWidth.
+    const int seam = std::max(1, params_.seamWidth);
+    auto ramp = [&](std::vector<int>& r, int n) {
+        r.resize(n);
+        for (int i = 0; i < n; ++i) r[i] = std::max(1, std::min({i + 1, n - i, seam}) * 255 / seam);
+    };
+    ramp(featherX_, width);
+    ramp(featherY_, height);
+
+    BandPool::instance().run(rows, 1, [&](int r0, int r1) {
+        for (int r = r0; r < r1; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                Tile* tile = jobs[static_cast<size_t>(r) * cols + c];
+                if (tile == nullptr) continue;
+                const int bx = (tx0 + c) * t;
+                const int by = (ty0 + r) * t;
+                const int x0 = std::max(bx, ox), x1 = std::min(bx + t, ox + width);
+                const int y0 = std::max(by, oy), y1 = std::min(by + t, oy + height);
+                for (int y = y0; y < y1; ++y) {
+                    const uint8_t* src = luma + static_cast<size_t>(y - oy) * stride + (x0 - ox);
+                    const int* fx = featherX_.data() + (x0 - ox);
+                    uint8_t* dl = tile->luma.data() + static_cast<size_t>(y - by) * t + (x0 - bx);
+                    uint8_t* dw = tile->weight.data() + static_cast<size_t>(y - by) * t + (x0 - bx);
+                    const int fy = featherY_[y - oy];
+                    for (int i = 0; i < x1 - x0; ++i) {
+                        const int wm = dw[i];
+                        if (wm == 255) continue;
+                        const int wf = std::min(fy, fx[i]);
+                        const int sum = wm + wf;
+                        dl[i] = static_cast<uint8_t>((dl[i] * wm + src[i] * wf + sum / 2) / sum);
+                        dw[i] = static_cast<uint8_t>(std::min(sum, 255));
+                    }
+                }
+                tile->full = std::all_of(tile->weight.begin(), tile->weight.end(),
+                                         [](uint8_t w) { return w == 255; });
+            }
+        }
+    });
+    return true;
+}
+
+void PanoramaStitcher::render(uint8_t* dst, size_t dstStride, uint8_t* coverage, size_t coverageStride) const {
+    const int t = params_.tileSize;
+    const int w = width();
+    const int h = height();
+    for (int row = 0; row < h; ++row) {
+        const int my = minY_ + row;
+        const int ty = floorDiv(my, t);
+        const int iy = my - ty * t;
+        uint8_t* dl = dst + row * dstStride;
+        uint8_t* dc = coverage ? coverage + row * coverageStride : nullptr;
+        for (int col = 0; col < w;) {
+            const int mx = minX_ + col;
+            const int tx = floorDiv(mx, t);
+            const int ix = mx - tx * t;
+            const int n = std::min(t - ix, w - col);
+            const Tile* tile = findTile(tx, ty);
+            if (tile) {
+                std::memcpy(dl + col, tile->luma.data() + iy * t + ix, n);
+            } else {
+                std::memset(dl + col, 0, n);
+            }
+            if (dc) {
+                for (int i = 0; i < n; ++i) {
+                    dc[col + i] = tile && tile->weight[iy * t + ix + i] != 0 ? 255 : 0;
+                }
+            }
+            col += n;
+        }
+    }
+}
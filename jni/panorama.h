@@ -0,0 +1,96 @@
+#pragma once
+
+#include "pyramid.h"
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// ================= Incremental Panorama =================
+// Stitches a sweep of frames into one mosaic under a pure-translation model:
+//  - each frame is registered against the mosaic around its predicted
+//    position by phase correlation of Hann-windowed 1/4-scale luma;
+//  - the mosaic is a sparse grid of square tiles allocated on first touch,
+//    so memory follows the covered area;
+//  - pixels carry a coverage weight; frames are feathered in over a seam band
+//    at their border and saturated tiles are skipped, so only the newly
+//    uncovered strip and its seam are written.
+class PanoramaStitcher {
+public:
+    struct Params {
+        int tileSize = 128;
+        int seamWidth = 32;        // feather ramp at the frame border, full-res pixels
+        int maxWindow = 256;       // phase correlation window side at 1/4 scale, power of two
+        float minResponse = 0.08f; // weaker correlation peaks reject the frame
+        int maxTiles = 2048;       // 32 MiB at the default tile size
+    };
+
+    enum class Result { Added, Rejected, Full };
+
+    PanoramaStitcher() = default;
+    explicit PanoramaStitcher(const Params& params) : params_(params) {}
+
+    void setParams(const Params& params) { params_ = params; reset(); }
+    const Params& params() const { return params_; }
+
+    // Drops the mosaic; the next frame starts a new one at the origin.
+    void reset();
+
+    // Frees the registration scratch. The mosaic and the window and feather
+    // tables are kept, so stitching continues where it left off.
+    void trim();
+
+    Result addFrame(const uint8_t* luma, size_t stride, int width, int height);
+
+    bool empty() const { return frames_ == 0; }
+    int frameCount() const { return frames_; }
+    size_t tileCount() const { return tiles_.size(); }
+
+    // Mosaic bounds in mosaic pixels; the first frame's top-left is (0, 0).
+    int minX() const { return minX_; }
+    int minY() const { return minY_; }
+    int width() const { return frames_ ? maxX_ - minX_ : 0; }
+    int height() const { return frames_ ? maxY_ - minY_ : 0; }
+
+    // Writes the width() x height() mosaic; uncovered pixels are 0. If
+    // `coverage` is non-null it receives 255 where any frame contributed.
+    void render(uint8_t* dst, size_t dstStride, uint8_t* coverage = nullptr, size_t coverageStride = 0) const;
+
+private:
+    struct Tile {
+        std::vector<uint8_t> luma;
+        std::vector<uint8_t> weight;
+        bool full = false;
+    };
+
+    static int64_t tileKey(int tx, int ty) {
+        return (static_cast<int64_t>(ty) << 32) ^ static_cast<uint32_t>(tx);
+    }
+    const Tile* findTile(int tx, int ty) const;
+
+    bool registerFrame(const LumaPyramid::Level& low, int predX, int predY, int& dx, int& dy);
+    void readRegion(int x, int y, int width, int height);
+    bool blendFrame(const uint8_t* luma, size_t stride, int width, int height, int ox, int oy);
+
+    Params params_;
+    std::unordered_map<int64_t, std::unique_ptr<Tile>> tiles_;
+    int frames_ = 0;
+    int minX_ = 0, minY_ = 0, maxX_ = 0, maxY_ = 0;
+    int lastX_ = 0, lastY_ = 0;
+    int velX_ = 0, velY_ = 0;
+
+    LumaPyramid pyramid_;
+    std::vector<uint8_t> region_;        // mosaic luma / weight read for registration
+    std::vector<uint8_t> regionWeight_;
+    LumaPyramid regionPyramid_;
+    LumaPyramid weightPyramid_;
+    std::vector<std::complex<float>> a_;
+    std::vector<std::complex<float>> b_;
+    std::vector<float> hannX_;
+    std::vector<float> hannY_;
+    std::vector<int> featherX_;
+    std::vector<int> featherY_;
+};
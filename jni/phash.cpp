@@ -0,0 +1,245 @@
+#include "phash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static constexpr int kHashInput = 32;
+static constexpr int kHashBand = 8;
+
+// cos((2x + 1) u pi / 64) for the kHashBand lowest frequencies.
+struct DctTable {
+    float c[kHashBand][kHashInput];
+    DctTable() {
+        for (int u = 0; u < kHashBand; ++u) {
+            for (int x = 0; x < kHashInput; ++x) {
+                c[u][x] = std::cos((2 * x + 1) * u * static_cast<float>(M_PI) / (2 * kHashInput));
+            }
+        }
+    }
+};
+
+bool perceptualHash(const uint8_t* luma, size_t stride, int width, int height, uint64_t& hash) {
+    static const DctTable dct;
+    if (luma == nullptr || width < kHashInput || height < kHashInput) return false;
+
+    // Box resample to 32x32.
+    float small[kHashInput][kHashInput];
+    std::vector<uint32_t> colSum(static_cast<size_t>(width));
+    for (int sy = 0; sy < kHashInput; ++sy) {
+        const int y0 = sy * height / kHashInput, y1 = (sy + 1) * height / kHashInput;
+        std::fill(colSum.begin(), colSum.end(), 0u);
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* row = luma + y * stride;
+            for (int x = 0; x < width; ++x) colSum[x] += row[x];
+        }
+        for (int sx = 0; sx < kHashInput; ++sx) {
+            const int x0 = sx * width / kHashInput, x1 = (sx + 1) * width / kHashInput;
+            uint32_t sum = 0;
+            for (int x = x0; x < x1; ++x) sum += colSum[x];
+            small[sy][sx] = static_cast<float>(sum) / static_cast<float>((x1 - x0) * (y1 - y0));
+        }
+    }
+
+    // Separable DCT-II, keeping only the low band.
+    float rows[kHashInput][kHashBand];
+    for (int y = 0; y < kHashInput; ++y) {
+        for (int u = 0; u < kHashBand; ++u) {
+            float acc = 0.0f;
+            for (int x = 0; x < kHashInput; ++x) acc += small[y][x] * dct.c[u][x];
+            rows[y][u] = acc;
+        }
+    }
+    float coeffs[kHashBand * kHashBand];
+    for (int v = 0; v < kHashBand; ++v) {
+        for (int u = 0; u < kHashBand; ++u) {
+            float acc = 0.0f;
+            for (int y = 0; y < kHashInput; ++y) acc += rows[y][u] * dct.c[v][y];
+            coeffs[v * kHashBand + u] = acc;
+        }
+    }
+
+    float sorted[kHashBand * kHashBand - 1];
+    std::copy(coeffs + 1, coeffs + kHashBand * kHashBand, sorted);
+    const int mid = (kHashBand * kHashBand - 1) / 2;
+    std::nth_element(sorted, sorted + mid, sorted + kHashBand * kHashBand - 1);
+    const float median = sorted[mid];
+
+    hash = 0;
+    for (int i = 0; i < kHashBand * kHashBand; ++i) {
+        if (coeffs[i] > median) hash |= uint64_t(1) << i;
+    }
+    return true;
+}
+
+// ================= Index File =================
+// Header: magic, version, node count; then Node records back to back.
+static constexpr uint32_t kIndexMagic = 0x49485046;  // "FPHI"
+static constexpr uint32_t kIndexVersion = 1;
+static constexpr size_t kHeaderBytes = 16;
+
+bool PhashIndex::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    nodes_.clear();
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+
+    uint32_t header[4] = {};
+    const ssize_t got = ::pread(fd, header, kHeaderBytes, 0);
+    if (got == 0) {
+        header[0] = kIndexMagic;
+        header[1] = kIndexVersion;
+        if (::pwrite(fd, header, kHeaderBytes, 0) != static_cast<ssize_t>(kHeaderBytes)) {
+            ::close(fd);
+            return false;
+        }
+    } else if (got != static_cast<ssize_t>(kHeaderBytes) ||
+               header[0] != kIndexMagic || header[1] != kIndexVersion) {
+        ::close(fd);
+        return false;
+    } else {
+        // Nodes past the count belong to an interrupted insert.
+        const uint32_t count = header[2];
+        nodes_.resize(count);
+        const size_t bytes = nodes_.size() * sizeof(Node);
+        if (bytes > 0 && ::pread(fd, nodes_.data(), bytes, kHeaderBytes) != static_cast<ssize_t>(bytes)) {
+            nodes_.clear();
+            ::close(fd);
+            return false;
+        }
+        // An insert interrupted between its link and the count leaves a link
+        // past the count. The orphan it points at still holds the link it
+        // replaced as its nextSibling; put that back before the slot is reused.
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t& link = nodes_[i].firstChild;
+            if (link <= count) continue;
+            Node orphan;
+            if (::pread(fd, &orphan, sizeof(Node), kHeaderBytes + static_cast<uint64_t>(link - 1) * sizeof(Node)) !=
+                    static_cast<ssize_t>(sizeof(Node)) ||
+                orphan.nextSibling > count ||
+                ::pwrite(fd, &orphan.nextSibling, sizeof(link), static_cast<off_t>(linkOffset(i))) !=
+                    static_cast<ssize_t>(sizeof(link))) {
+                nodes_.clear();
+                ::close(fd);
+                return false;
+            }
+            link = orphan.nextSibling;
+        }
+    }
+    fd_ = fd;
+    return true;
+}
+
+void PhashIndex::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    nodes_.clear();
+}
+
+size_t PhashIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_.size();
+}
+
+uint64_t PhashIndex::linkOffset(uint32_t index) {
+    return kHeaderBytes + static_cast<uint64_t>(index) * sizeof(Node) + offsetof(Node, firstChild);
+}
+
+bool PhashIndex::writeAt(const void* data, size_t bytes, uint64_t offset) {
+    return ::pwrite(fd_, data, bytes, static_cast<off_t>(offset)) == static_cast<ssize_t>(bytes);
+}
+
+bool PhashIndex::writeCount() {
+    const uint32_t count = static_cast<uint32_t>(nodes_.size());
+    return writeAt(&count, sizeof(count), 8);
+}
+
+int64_t PhashIndex::findNear(uint64_t hash, int maxDistance, int* distance) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (nodes_.empty()) return -1;
+
+    int64_t bestId = -1;
+    int best = maxDistance + 1;
+    std::vector<uint32_t>& stack = stack_;
+    stack.assign(1, 0);
+    while (!stack.empty()) {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        const int d = hammingDistance(hash, node.hash);
+        if (d < best) {
+            best = d;
+            bestId = node.id;
+            if (d == 0) break;
+        }
+        // Triangle inequality: only subtrees at edge distance within the
+        // current radius of d can hold a closer hash.
+        const int radius = best - 1;
+        for (uint32_t c = node.firstChild; c != 0; c = nodes_[c - 1].nextSibling) {
+            const int edge = static_cast<int>(nodes_[c - 1].distance);
+            if (edge >= d - radius && edge <= d + radius) stack.push_back(c - 1);
+        }
+    }
+    if (bestId >= 0 && distance) *distance = best;
+    return bestId;
+}
+
+bool PhashIndex::insert(uint64_t hash, int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0) return false;
+
+    Node node{hash, id, 0, 0, 0, 0};
+    const uint32_t index = static_cast<uint32_t>(nodes_.size());
+    uint32_t parent = UINT32_MAX;
+    if (!nodes_.empty()) {
+        uint32_t cur = 0;
+        for (;;) {
+            const uint32_t d = static_cast<uint32_t>(hammingDistance(hash, nodes_[cur].hash));
+            uint32_t child = nodes_[cur].firstChild;
+            while (child != 0 && nodes_[child - 1].distance != d) child = nodes_[child - 1].nextSibling;
+            if (child == 0) {
+                node.distance = d;
+                node.nextSibling = nodes_[cur].firstChild;
+                parent = cur;
+                break;
+            }
+            cur = child - 1;
+        }
+    }
+
+    // Node, link, then count: the count commits the insert. open() ignores
+    // nodes past it and repairs a link left pointing at one, and the mirror
+    // only changes once the file has.
+    if (!writeAt(&node, sizeof(Node), kHeaderBytes + static_cast<uint64_t>(index) * sizeof(Node))) return false;
+    const uint32_t link = index + 1;
+    if (parent != UINT32_MAX) {
+        if (!writeAt(&link, sizeof(link), linkOffset(parent))) return false;
+        nodes_[parent].firstChild = link;
+    }
+    nodes_.push_back(node);
+    if (!writeCount()) {
+        nodes_.pop_back();
+        if (parent != UINT32_MAX) {
+            nodes_[parent].firstChild = node.nextSibling;
+            // A stale link would name whatever the next insert puts in this
+            // slot; if it cannot be undone, stop writing and leave the repair
+            // to the next open().
+            if (!writeAt(&node.nextSibling, sizeof(link), linkOffset(parent))) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+        return false;
+    }
+    return true;
+}
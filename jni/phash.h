@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ================= Perceptual Hash =================
+
+// 64-bit DCT pHash: luma is box-resampled to 32x32, the 8x8 lowest DCT-II
+// frequencies are compared against their median (DC excluded from the
+// median). Near-identical images differ in a few bits. Fails for images
+// smaller than 32x32; every 64-bit value, 0 included, is a valid hash.
+bool perceptualHash(const uint8_t* luma, size_t stride, int width, int height, uint64_t& hash);
+
+inline int hammingDistance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+// Persistent BK-tree of (hash, id) pairs under Hamming distance. The tree
+// itself lives in the file as fixed-size nodes linked first-child /
+// next-sibling, so opening is a single read and inserting appends one node
+// and rewrites one link; nothing is rebuilt. Queries run on the in-memory
+// mirror. All methods are thread-safe.
+class PhashIndex {
+public:
+    PhashIndex() = default;
+    ~PhashIndex() { close(); }
+
+    PhashIndex(const PhashIndex&) = delete;
+    PhashIndex& operator=(const PhashIndex&) = delete;
+
+    // Opens or creates the index file. Returns false on I/O errors or a
+    // file that is not an index.
+    bool open(const std::string& path);
+    void close();
+
+    // Id of the closest stored hash within maxDistance, or -1. `distance`
+    // receives its Hamming distance when found.
+    int64_t findNear(uint64_t hash, int maxDistance, int* distance = nullptr) const;
+
+    bool insert(uint64_t hash, int64_t id);
+
+    size_t size() const;
+
+private:
+    struct Node {
+        uint64_t hash;
+        int64_t id;
+        uint32_t firstChild;   // node index + 1, 0 for none
+        uint32_t nextSibling;  // node index + 1, 0 for none
+        uint32_t distance;     // edge label: distance to the parent
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Node) == 32, "index nodes are 32 bytes on disk");
+
+    static uint64_t linkOffset(uint32_t index);
+    bool writeAt(const void* data, size_t bytes, uint64_t offset);
+    bool writeCount();
+
+    mutable std::mutex mutex_;
+    int fd_ = -1;
+    std::vector<Node> nodes_;
+    mutable std::vector<uint32_t> stack_;  // findNear's traversal, kept between queries
+};
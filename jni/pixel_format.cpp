@@ -0,0 +1,166 @@
+#include "pixel_format.h"
+
+#include "rgba_pack.h"
+#include "simd_kernels.h"
+
+#include <cstring>
+
+namespace {
+
+inline uint8_t clamp8(int x) { return static_cast<uint8_t>(x < 0 ? 0 : (x > 255 ? 255 : x)); }
+
+// OpenCV's RGB2GRAY fixed point (weights sum to 1 << 14), so results match
+// the cv::cvtColor calls these kernels replace.
+inline uint8_t lumaOf(int r, int g, int b) {
+    return static_cast<uint8_t>((r * 4899 + g * 9617 + b * 1868 + (1 << 13)) >> 14);
+}
+
+// BT.601 limited range to RGB, the inverse of yuv_pack's forward transform.
+inline void yuvToRgba(int y, int u, int v, uint8_t* p) {
+    const int c = 298 * (y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+    p[0] = clamp8((c + 409 * e) >> 8);
+    p[1] = clamp8((c - 100 * d - 208 * e) >> 8);
+    p[2] = clamp8((c + 516 * d) >> 8);
+    p[3] = 255;
+}
+
+// ---------------- Row kernels ----------------
+// rows[p] is the row in plane p; for chroma-subsampled formats rows[1..2]
+// are the chroma rows covering it.
+
+template <PixelFormat F>
+void lumaRow(const uint8_t* const* rows, uint8_t* dst, int width) {
+    using T = PixelFormatTraits<F>;
+    static_assert(T::bitDepth == 8, "8-bit kernels");
+    if constexpr (T::isYuv || T::channels == 1) {
+        std::memcpy(dst, rows[0], static_cast<size_t>(width));
+    } else if constexpr (T::layout == PlaneLayout::Planar) {
+        for (int x = 0; x < width; ++x) dst[x] = lumaOf(rows[T::r][x], rows[T::g][x], rows[T::b][x]);
+    } else {
+        // Constant pixel size and offsets: clang lowers this to ld3 / ld4.
+        const uint8_t* s = rows[0];
+        for (int x = 0; x < width; ++x, s += T::pixelBytes) dst[x] = lumaOf(s[T::r], s[T::g], s[T::b]);
+    }
+}
+
+template <PixelFormat F>
+void rgbaRow(const uint8_t* const* rows, uint8_t* dst, int width) {
+    using T = PixelFormatTraits<F>;
+    static_assert(T::bitDepth == 8, "8-bit kernels");
+    if constexpr (F == PixelFormat::Gray8) {
+        kernels::grayToRgbaRow<simd::Native>(rows[0], dst, width);
+    } else if constexpr (F == PixelFormat::Rgba8) {
+        std::memcpy(dst, rows[0], static_cast<size_t>(width) * 4);
+    } else if constexpr (F == PixelFormat::Rgb8) {
+        packRgbRowToRgba(rows[0], dst, width);
+    } else if constexpr (F == PixelFormat::RgbPlanar) {
+        kernels::planesToRgbaRow<simd::Native>(rows[0], rows[1], rows[2], dst, width);
+    } else if constexpr (T::isYuv) {
+        const uint8_t* y = rows[0];
+        for (int x = 0; x < width; ++x, dst += 4) {
+            const int cx = x >> T::chromaShiftX;
+            if constexpr (T::layout == PlaneLayout::Planar) {
+                yuvToRgba(y[x], rows[T::u][cx], rows[T::v][cx], dst);
+            } else {
+                const uint8_t* uv = rows[1] + 2 * cx;
+                yuvToRgba(y[x], uv[T::u], uv[T::v], dst);
+            }
+        }
+    } else {
+        const uint8_t* s = rows[0];
+        for (int x = 0; x < width; ++x, s += T::pixelBytes, dst += 4) {
+            dst[0] = s[T::r];
+            dst[1] = s[T::g];
+            dst[2] = s[T::b];
+            if constexpr (T::a >= 0) {
+                dst[3] = s[T::a];
+            } else {
+                dst[3] = 255;
+            }
+        }
+    }
+}
+
+// ---------------- Image kernels ----------------
+
+template <PixelFormat F, void (*Row)(const uint8_t* const*, uint8_t*, int)>
+void convertImage(const PixelPlanes& src, int width, int height, uint8_t* dst, size_t dstStride) {
+    using T = PixelFormatTraits<F>;
+    const uint8_t* rows[3] = {};
+    for (int y = 0; y < height; ++y) {
+        rows[0] = src.data[0] + y * src.stride[0];
+        for (int p = 1; p < T::planes; ++p) {
+            const int py = T::isYuv ? y >> T::chromaShiftY : y;
+            rows[p] = src.data[p] + py * src.stride[p];
+        }
+        Row(rows, dst + y * dstStride, width);
+    }
+}
+
+template <PixelFormat F>
+constexpr PixelFormatOps makeOps(const char* name) {
+    using T = PixelFormatTraits<F>;
+    return {F, name, T::channels, T::bitDepth, T::planes, T::layout, T::chromaShiftX, T::chromaShiftY,
+            T::pixelBytes,
+            &convertImage<F, &lumaRow<F>>,
+            &convertImage<F, &rgbaRow<F>>,
+            T::isYuv ? nullptr : &rgbaRow<F>};
+}
+
+// Indexed by PixelFormat.
+constexpr PixelFormatOps kFormats[] = {
+    makeOps<PixelFormat::Gray8>("gray8"),
+    makeOps<PixelFormat::Rgb8>("rgb8"),
+    makeOps<PixelFormat::Rgba8>("rgba8"),
+    makeOps<PixelFormat::Bgr8>("bgr8"),
+    makeOps<PixelFormat::Bgra8>("bgra8"),
+    makeOps<PixelFormat::RgbPlanar>("rgb-planar"),
+    makeOps<PixelFormat::I420>("i420"),
+    makeOps<PixelFormat::Nv12>("nv12"),
+    makeOps<PixelFormat::Nv21>("nv21"),
+};
+
+constexpr int kFormatCount = static_cast<int>(sizeof(kFormats) / sizeof(kFormats[0]));
+
+constexpr bool formatsInOrder() {
+    for (int i = 0; i < kFormatCount; ++i) {
+        if (static_cast<int>(kFormats[i].format) != i) return false;
+    }
+    return true;
+}
+static_assert(formatsInOrder(), "kFormats must be indexed by PixelFormat");
+
+}  // namespace
+
+const PixelFormatOps& pixelFormatOps(PixelFormat format) {
+    return kFormats[static_cast<int>(format)];
+}
+
+const PixelFormatOps* pixelFormatOps(int format) {
+    return format >= 0 && format < kFormatCount ? &kFormats[format] : nullptr;
+}
+
+PixelPlanes contiguousPlanes(const PixelFormatOps& format, const uint8_t* data, size_t stride, int height) {
+    PixelPlanes planes;
+    planes.data[0] = data;
+    planes.stride[0] = stride;
+    if (format.planes == 1) return planes;
+
+    const size_t lumaBytes = stride * static_cast<size_t>(height);
+    if (format.chromaShiftY == 0) {
+        for (int p = 1; p < format.planes; ++p) {
+            planes.data[p] = data + p * lumaBytes;
+            planes.stride[p] = stride;
+        }
+        return planes;
+    }
+    const size_t chromaRows = (static_cast<size_t>(height) + (1u << format.chromaShiftY) - 1) >> format.chromaShiftY;
+    const size_t chromaStride = format.layout == PlaneLayout::SemiPlanar ? stride : stride >> format.chromaShiftX;
+    for (int p = 1; p < format.planes; ++p) {
+        planes.data[p] = data + lumaBytes + (p - 1) * chromaStride * chromaRows;
+        planes.stride[p] = chromaStride;
+    }
+    return planes;
+}
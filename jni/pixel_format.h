@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ================= Pixel Formats =================
+// Every layout the native side ingests, described once at compile time by
+// PixelFormatTraits. Conversion kernels are templates over the format, so each
+// instantiation sees constant channel counts, component offsets and chroma
+// steps and compiles to a branch-free (and, for packed formats, vectorizable)
+// row loop. The only runtime decision is pixelFormatOps(), which callers make
+// once - a session when it is created, a JNI entry point once per call - and
+// then call through the returned table.
+
+// Values mirror OpenCVUtils.PIXEL_FORMAT_*.
+enum class PixelFormat : int {
+    Gray8 = 0,     // 1 plane, 1 byte per pixel
+    Rgb8 = 1,      // 1 plane, R G B
+    Rgba8 = 2,     // 1 plane, R G B A
+    Bgr8 = 3,      // 1 plane, B G R (OpenCV's default order)
+    Bgra8 = 4,     // 1 plane, B G R A
+    RgbPlanar = 5, // 3 planes: R, G, B (PlanarImage)
+    I420 = 6,      // Y plane, U plane, V plane, chroma 2x2 subsampled
+    Nv12 = 7,      // Y plane, interleaved U V plane, chroma 2x2 subsampled
+    Nv21 = 8,      // Y plane, interleaved V U plane, chroma 2x2 subsampled
+};
+
+enum class PlaneLayout {
+    Packed,      // all components interleaved in one plane
+    Planar,      // one plane per component
+    SemiPlanar   // luma plane plus one interleaved chroma plane
+};
+
+// Compile-time description of a format. Component indices are byte offsets
+// within a pixel (packed) or plane indices (planar); -1 when absent. For YUV
+// formats r / g / b are absent and u / v give the chroma plane (I420) or the
+// byte offset within an interleaved chroma pair (NV12 / NV21).
+template <PixelFormat F> struct PixelFormatTraits;
+
+template <PixelFormat F, int Channels, int Planes, PlaneLayout Layout, int R, int G, int B, int A,
+          int ChromaShift = 0, int U = -1, int V = -1>
+struct PixelFormatTraitsBase {
+    static constexpr PixelFormat format = F;
+    static constexpr int channels = Channels;   // components per pixel, alpha included
+    static constexpr int bitDepth = 8;          // bits per stored component
+    static constexpr int planes = Planes;
+    static constexpr PlaneLayout layout = Layout;
+    static constexpr int chromaShiftX = ChromaShift;  // log2 horizontal chroma subsampling
+    static constexpr int chromaShiftY = ChromaShift;  // log2 vertical chroma subsampling
+    static constexpr bool isYuv = U >= 0;
+    // Bytes per pixel in each full-resolution plane.
+    static constexpr int pixelBytes = Layout == PlaneLayout::Packed ? Channels : 1;
+    static constexpr int r = R, g = G, b = B, a = A;
+    static constexpr int u = U, v = V;
+};
+
+template <> struct PixelFormatTraits<PixelFormat::Gray8>
+    : PixelFormatTraitsBase<PixelFormat::Gray8, 1, 1, PlaneLayout::Packed, 0, 0, 0, -1> {};
+template <> struct PixelFormatTraits<PixelFormat::Rgb8>
+    : PixelFormatTraitsBase<PixelFormat::Rgb8, 3, 1, PlaneLayout::Packed, 0, 1, 2, -1> {};
+template <> struct PixelFormatTraits<PixelFormat::Rgba8>
+    : PixelFormatTraitsBase<PixelFormat::Rgba8, 4, 1, PlaneLayout::Packed, 0, 1, 2, 3> {};
+template <> struct PixelFormatTraits<PixelFormat::Bgr8>
+    : PixelFormatTraitsBase<PixelFormat::Bgr8, 3, 1, PlaneLayout::Packed, 2, 1, 0, -1> {};
+template <> struct PixelFormatTraits<PixelFormat::Bgra8>
+    : PixelFormatTraitsBase<PixelFormat::Bgra8, 4, 1, PlaneLayout::Packed, 2, 1, 0, 3> {};
+template <> struct PixelFormatTraits<PixelFormat::RgbPlanar>
+    : PixelFormatTraitsBase<PixelFormat::RgbPlanar, 3, 3, PlaneLayout::Planar, 0, 1, 2, -1> {};
+template <> struct PixelFormatTraits<PixelFormat::I420>
+    : PixelFormatTraitsBase<PixelFormat::I420, 3, 3, PlaneLayout::Planar, -1, -1, -1, -1, 1, 1, 2> {};
+template <> struct PixelFormatTraits<PixelFormat::Nv12>
+    : PixelFormatTraitsBase<PixelFormat::Nv12, 3, 2, PlaneLayout::SemiPlanar, -1, -1, -1, -1, 1, 0, 1> {};
+template <> struct PixelFormatTraits<PixelFormat::Nv21>
+    : PixelFormatTraitsBase<PixelFormat::Nv21, 3, 2, PlaneLayout::SemiPlanar, -1, -1, -1, -1, 1, 1, 0> {};
+
+// Plane pointers and byte strides of one image; unused entries are null.
+struct PixelPlanes {
+    const uint8_t* data[3] = {};
+    size_t stride[3] = {};
+};
+
+// Runtime handle on one format: its traits as values plus the kernels
+// instantiated for it.
+struct PixelFormatOps {
+    PixelFormat format;
+    const char* name;
+    int channels;
+    int bitDepth;
+    int planes;
+    PlaneLayout layout;
+    int chromaShiftX;
+    int chromaShiftY;
+    int pixelBytes;
+
+    // Whole width x height image to 8-bit luma: gray as is, RGB with OpenCV's
+    // RGB2GRAY weights, YUV by taking Y.
+    void (*toLuma)(const PixelPlanes& src, int width, int height, uint8_t* dst, size_t dstStride);
+
+    // Whole width x height image to RGBA (alpha 255 unless the format has
+    // one). YUV is taken as BT.601 limited range, the inverse of packToYuv420.
+    void (*toRgba)(const PixelPlanes& src, int width, int height, uint8_t* dst, size_t dstStride);
+
+    // One row to RGBA; rows[p] points at the first pixel in plane p. Null for
+    // chroma-subsampled formats, whose rows do not stand alone.
+    void (*rowToRgba)(const uint8_t* const* rows, uint8_t* dst, int width);
+};
+
+// Table for `format`. The int overload returns null for values that name no
+// format, for formats arriving from Java.
+const PixelFormatOps& pixelFormatOps(PixelFormat format);
+const PixelFormatOps* pixelFormatOps(int format);
+
+// Planes of a `format` image of `height` rows stored in one buffer the way
+// OpenCV and MediaCodec lay it out: planar RGB as consecutive planes of
+// `stride`, YUV 4:2:0 with the chroma plane(s) following the luma rows at half
+// the luma stride (I420) or the full stride (NV12 / NV21).
+PixelPlanes contiguousPlanes(const PixelFormatOps& format, const uint8_t* data, size_t stride, int height);
@@ -0,0 +1,18 @@
+#include "planar_image.h"
+
+void PlanarImage::reset(PlanarFormat format, int width, int height) {
+    format_ = format;
+    width_ = width > 0 ? width : 0;
+    height_ = height > 0 ? height : 0;
+    stride_ = (static_cast<size_t>(width_) + 15) & ~static_cast<size_t>(15);
+    const size_t needed = planeBytes() * planes();
+    if (storage_.size() < needed) storage_.resize(needed);
+}
+
+size_t PlanarImage::trim() {
+    const size_t bytes = storage_.capacity();
+    std::vector<uint8_t>().swap(storage_);
+    width_ = height_ = 0;
+    stride_ = 0;
+    return bytes;
+}
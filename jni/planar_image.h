@@ -0,0 +1,56 @@
+#pragma once
+
+#include "pixel_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Planar Images =================
+// Structure-of-arrays frame passed between pipeline stages: one 8-bit plane
+// per component (Y, or R / G / B) sharing a row stride, so per-channel kernels
+// stream contiguous bytes and no alpha travels with the data. Nothing before
+// the output stage interleaves; the dirty-rect presenter packs RGBA from the
+// planes for the tiles it repaints, and nothing else does.
+enum class PlanarFormat {
+    Gray,  // 1 plane: luma or an edge map
+    Rgb    // 3 planes: R, G, B
+};
+
+class PlanarImage {
+public:
+    static constexpr int kMaxPlanes = 3;
+
+    // Sizes the image for `format`, keeping the storage when it is already
+    // large enough. Pixel contents are unspecified afterwards.
+    void reset(PlanarFormat format, int width, int height);
+
+    // Frees the storage; returns the bytes released.
+    size_t trim();
+
+    PlanarFormat format() const { return format_; }
+    PixelFormat pixelFormat() const {
+        return format_ == PlanarFormat::Gray ? PixelFormat::Gray8 : PixelFormat::RgbPlanar;
+    }
+    int planes() const { return format_ == PlanarFormat::Gray ? 1 : 3; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    bool empty() const { return width_ <= 0 || height_ <= 0; }
+
+    // Row stride of every plane in bytes; rows start 16-byte aligned.
+    size_t stride() const { return stride_; }
+    uint8_t* plane(int i) { return storage_.data() + i * planeBytes(); }
+    const uint8_t* plane(int i) const { return storage_.data() + i * planeBytes(); }
+
+    // Pixel bytes held, excluding row padding.
+    size_t bytes() const { return static_cast<size_t>(width_) * height_ * planes(); }
+
+private:
+    size_t planeBytes() const { return stride_ * static_cast<size_t>(height_); }
+
+    PlanarFormat format_ = PlanarFormat::Gray;
+    int width_ = 0;
+    int height_ = 0;
+    size_t stride_ = 0;
+    std::vector<uint8_t> storage_;
+};
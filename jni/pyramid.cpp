@@ -0,0 +1,74 @@
+#include "pyramid.h"
+
+#include "simd_kernels.h"
+
+#include <algorithm>
+
+void downsampleLuma2x(const uint8_t* src, size_t srcStride, int width, int height,
+                      uint8_t* dst, size_t dstStride) {
+    const int lw = width / 2;
+    const int lh = height / 2;
+    for (int y = 0; y < lh; ++y) {
+        const uint8_t* a = src + (2 * y) * srcStride;
+        kernels::downsampleRow2x<simd::Native>(a, a + srcStride, dst + y * dstStride, lw);
+    }
+}
+
+void upsample2x(const int16_t* src, size_t srcStride, int width, int height,
+                int16_t* dst, size_t dstStride) {
+    // Each output sample is (9 * nearest + 3 * each side neighbour + 1 * diagonal) / 16.
+    std::vector<int32_t> rowMix(static_cast<size_t>(width));
+    for (int y = 0; y < 2 * height; ++y) {
+        const int sy = y >> 1;
+        const int ny = std::min(std::max((y & 1) ? sy + 1 : sy - 1, 0), height - 1);
+        const int16_t* a = src + sy * srcStride;
+        const int16_t* b = src + ny * srcStride;
+        for (int x = 0; x < width; ++x) rowMix[x] = 3 * a[x] + b[x];
+
+        int16_t* d = dst + y * dstStride;
+        for (int x = 0; x < width; ++x) {
+            const int32_t c = rowMix[x];
+            const int32_t l = rowMix[x > 0 ? x - 1 : 0];
+            const int32_t r = rowMix[x + 1 < width ? x + 1 : x];
+            d[2 * x] = static_cast<int16_t>((3 * c + l + 8) >> 4);
+            d[2 * x + 1] = static_cast<int16_t>((3 * c + r + 8) >> 4);
+        }
+    }
+}
+
+void LumaPyramid::trim() {
+    for (Level& level : levels_) std::vector<uint8_t>().swap(level.pixels);
+    levelCount_ = 0;
+    width_ = height_ = 0;
+}
+
+void LumaPyramid::build(const uint8_t* luma, size_t stride, int width, int height, int maxLevels) {
+    int count = 0;
+    int w = width;
+    int h = height;
+    while (count < maxLevels && w / 2 >= kMinLevelSize && h / 2 >= kMinLevelSize) {
+        w /= 2;
+        h /= 2;
+        ++count;
+    }
+    if (static_cast<int>(levels_.size()) < count) levels_.resize(count);
+    levelCount_ = count;
+    width_ = width;
+    height_ = height;
+
+    const uint8_t* src = luma;
+    size_t srcStride = stride;
+    int sw = width;
+    int sh = height;
+    for (int i = 0; i < count; ++i) {
+        Level& level = levels_[i];
+        level.width = sw / 2;
+        level.height = sh / 2;
+        level.pixels.resize(static_cast<size_t>(level.width) * level.height);
+        downsampleLuma2x(src, srcStride, sw, sh, level.pixels.data(), level.width);
+        src = level.pixels.data();
+        srcStride = level.width;
+        sw = level.width;
+        sh = level.height;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Luma Pyramid =================
+
+// 2x2 box downscale; dst is (width / 2) x (height / 2).
+void downsampleLuma2x(const uint8_t* src, size_t srcStride, int width, int height,
+                      uint8_t* dst, size_t dstStride);
+
+// Bilinear 2x upscale with clamped borders; dst is (2 * width) x (2 * height).
+// Laplacian levels are taken against this, so reconstruction must use it too.
+void upsample2x(const int16_t* src, size_t srcStride, int width, int height,
+                int16_t* dst, size_t dstStride);
+
+// Dyadic box-filtered pyramid. Level 0 is the caller's full-resolution luma and
+// is not copied; level(i) for i >= 1 is owned here, tightly packed, and keeps
+// its storage across rebuilds of the same size.
+class LumaPyramid {
+public:
+    static constexpr int kMinLevelSize = 8;
+
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> pixels;
+
+        const uint8_t* data() const { return pixels.data(); }
+    };
+
+    // Builds up to maxLevels levels below the base, stopping before either
+    // dimension drops under kMinLevelSize.
+    void build(const uint8_t* luma, size_t stride, int width, int height, int maxLevels);
+
+    // Number of owned levels (the base is not counted).
+    int levels() const { return levelCount_; }
+
+    // i in [1, levels()].
+    const Level& level(int i) const { return levels_[i - 1]; }
+
+    int baseWidth() const { return width_; }
+    int baseHeight() const { return height_; }
+
+    // Frees the level pixels. Level sizes are kept, but the pyramid reads as
+    // empty (no levels, 0x0 base) until the next build.
+    void trim();
+
+private:
+    std::vector<Level> levels_;
+    int levelCount_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+};
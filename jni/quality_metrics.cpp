@@ -0,0 +1,147 @@
+#include "quality_metrics.h"
+
+#include "band_pool.h"
+#include "bit_mask.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+// ---------------- PSNR ----------------
+
+double psnr(const uint8_t* a, size_t aStride, const uint8_t* b, size_t bStride,
+            int width, int height) {
+    if (a == nullptr || b == nullptr || width <= 0 || height <= 0) return 0.0;
+    std::mutex mutex;
+    uint64_t total = 0;
+    BandPool::instance().run(height, 32, [&](int y0, int y1) {
+        uint64_t band = 0;
+        for (int y = y0; y < y1; ++y) band += kernels::squaredErrorRow<simd::Native>(a + y * aStride, b + y * bStride, width);
+        std::lock_guard<std::mutex> lock(mutex);
+        total += band;
+    });
+    if (total == 0) return std::numeric_limits<double>::infinity();
+    const double mse = static_cast<double>(total) / (static_cast<double>(width) * height);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+// ---------------- SSIM ----------------
+
+static constexpr int kWindow = 8;  // windowSums8
+static constexpr int kWindowStep = 4;
+
+using kernels::WindowSums;
+
+// SSIM of one window from its sums, in the integer-scaled form (everything
+// multiplied by n^2 = 64^2) so only the final ratio is floating point.
+static double windowSsim(const WindowSums& s) {
+    constexpr int64_t n = kWindow * kWindow;
+    constexpr int64_t c1 = static_cast<int64_t>(0.01 * 255 * 0.01 * 255 * n * n + 0.5);
+    constexpr int64_t c2 = static_cast<int64_t>(0.03 * 255 * 0.03 * 255 * n * n + 0.5);
+    const int64_t sa = s.a, sb = s.b;
+    const int64_t meanTerm = 2 * sa * sb + c1;
+    const int64_t covTerm = 2 * (n * s.ab - sa * sb) + c2;
+    const int64_t meanNorm = sa * sa + sb * sb + c1;
+    const int64_t varNorm = n * (static_cast<int64_t>(s.aa) + s.bb) - sa * sa - sb * sb + c2;
+    return (static_cast<double>(meanTerm) * covTerm) / (static_cast<double>(meanNorm) * varNorm);
+}
+
+double ssim(const uint8_t* a, size_t aStride, const uint8_t* b, size_t bStride,
+            int width, int height) {
+    if (a == nullptr || b == nullptr || width < kWindow || height < kWindow) return 0.0;
+    const int windowsX = (width - kWindow) / kWindowStep + 1;
+    const int windowsY = (height - kWindow) / kWindowStep + 1;
+    std::mutex mutex;
+    double total = 0.0;
+    BandPool::instance().run(windowsY, 8, [&](int wy0, int wy1) {
+        double band = 0.0;
+        for (int wy = wy0; wy < wy1; ++wy) {
+            const uint8_t* ra = a + static_cast<size_t>(wy) * kWindowStep * aStride;
+            const uint8_t* rb = b + static_cast<size_t>(wy) * kWindowStep * bStride;
+            for (int wx = 0; wx < windowsX; ++wx) {
+                band += windowSsim(kernels::windowSums8<simd::Native>(ra + wx * kWindowStep, aStride, rb + wx * kWindowStep, bStride));
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        total += band;
+    });
+    return total / (static_cast<double>(windowsX) * windowsY);
+}
+
+// ---------------- Edge precision / recall ----------------
+
+// Square (Chebyshev) dilation by r: horizontal runs with word shifts, which
+// the guard words make border-free, then a vertical OR over 2r + 1 rows.
+static void dilate(const BitMask& src, int r, BitMask& rows, BitMask& dst) {
+    rows.reset(src.width, src.height);
+    dst.reset(src.width, src.height);
+    const int words = src.wordsPerRow;
+    BandPool& pool = BandPool::instance();
+    pool.run(src.height, 16, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const uint64_t* in = src.row(y);
+            uint64_t* out = rows.row(y);
+            for (int k = 0; k < words; ++k) {
+                uint64_t w = in[k];
+                for (int s = 1; s <= r; ++s) {
+                    w |= (in[k] << s) | (in[k - 1] >> (64 - s));  // from the left
+                    w |= (in[k] >> s) | (in[k + 1] << (64 - s));  // from the right
+                }
+                out[k] = w;
+            }
+        }
+    });
+    pool.run(src.height, 16, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            uint64_t* out = dst.row(y);
+            const int ya = std::max(y - r, 0);
+            const int yb = std::min(y + r, src.height - 1);
+            for (int yy = ya; yy <= yb; ++yy) {
+                const uint64_t* in = rows.row(yy);
+                for (int k = 0; k < words; ++k) out[k] |= in[k];
+            }
+        }
+    });
+}
+
+// Set bits of `a`, and set bits of `a` that are also set in `b`.
+static void countOverlap(const BitMask& a, const BitMask& b, int64_t& setA, int64_t& setBoth) {
+    int64_t total = 0, both = 0;
+    for (int y = 0; y < a.height; ++y) {
+        const uint64_t* ra = a.row(y);
+        const uint64_t* rb = b.row(y);
+        for (int k = 0; k < a.wordsPerRow; ++k) {
+            total += __builtin_popcountll(ra[k]);
+            both += __builtin_popcountll(ra[k] & rb[k]);
+        }
+    }
+    setA = total;
+    setBoth = both;
+}
+
+EdgeScore edgeScore(const uint8_t* edges, size_t edgesStride,
+                    const uint8_t* reference, size_t referenceStride,
+                    int width, int height, int tolerance) {
+    EdgeScore score;
+    if (edges == nullptr || reference == nullptr || width <= 0 || height <= 0) return score;
+    const int r = std::min(std::max(tolerance, 0), kMaxEdgeTolerance);
+
+    BitMask detected, expected, rows, near;
+    packMask(edges, edgesStride, width, height, detected);
+    packMask(reference, referenceStride, width, height, expected);
+
+    dilate(expected, r, rows, near);
+    countOverlap(detected, near, score.detected, score.truePositives);
+    dilate(detected, r, rows, near);
+    countOverlap(expected, near, score.reference, score.recalled);
+
+    if (score.detected > 0) score.precision = static_cast<double>(score.truePositives) / score.detected;
+    if (score.reference > 0) score.recall = static_cast<double>(score.recalled) / score.reference;
+    const double sum = score.precision + score.recall;
+    score.fScore = sum > 0.0 ? 2.0 * score.precision * score.recall / sum : 0.0;
+    return score;
+}
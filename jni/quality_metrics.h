@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ================= Quality Metrics =================
+// Reference-based scores for judging approximate pipeline modes against the
+// exact path. All inputs are 8-bit single-channel planes of the same size.
+
+// Peak signal-to-noise ratio in dB; +infinity for identical planes.
+double psnr(const uint8_t* a, size_t aStride, const uint8_t* b, size_t bStride,
+            int width, int height);
+
+// Mean SSIM over 8x8 windows on a 4-pixel grid (unweighted window, the usual
+// K1 = 0.01, K2 = 0.03 constants). 1 for identical planes; planes smaller
+// than a window score 0.
+double ssim(const uint8_t* a, size_t aStride, const uint8_t* b, size_t bStride,
+            int width, int height);
+
+// Edge-map agreement with a distance tolerance: a detected edge pixel is a
+// hit if a reference edge lies within `tolerance` pixels (chessboard
+// distance), and a reference pixel is recalled if a detected edge does.
+// Edges are the non-zero pixels. Precision (recall) is 1 when nothing was
+// detected (nothing was expected).
+struct EdgeScore {
+    int64_t detected = 0;
+    int64_t reference = 0;
+    int64_t truePositives = 0;  // detected pixels near a reference edge
+    int64_t recalled = 0;       // reference pixels near a detected edge
+    double precision = 1.0;
+    double recall = 1.0;
+    double fScore = 1.0;
+};
+
+static constexpr int kMaxEdgeTolerance = 16;
+
+// tolerance is clamped to [0, kMaxEdgeTolerance].
+EdgeScore edgeScore(const uint8_t* edges, size_t edgesStride,
+                    const uint8_t* reference, size_t referenceStride,
+                    int width, int height, int tolerance);
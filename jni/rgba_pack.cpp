@@ -0,0 +1,23 @@
+#include "rgba_pack.h"
+#include "simd_kernels.h"
+
+#include <cstring>
+
+void packRgbRowToRgba(const uint8_t* src, uint8_t* dst, int width) {
+    kernels::rgbToRgbaRow<simd::Native>(src, dst, width);
+}
+
+void packRowToRgba(const uint8_t* src, int channels, uint8_t* dst, int width) {
+    switch (channels) {
+        case 1: kernels::grayToRgbaRow<simd::Native>(src, dst, width); break;
+        case 3: packRgbRowToRgba(src, dst, width); break;
+        default: std::memcpy(dst, src, static_cast<size_t>(width) * 4); break;
+    }
+}
+
+void packToRgba(const uint8_t* src, size_t srcStride, int channels,
+                uint8_t* dst, size_t dstStride, int width, int height) {
+    for (int r = 0; r < height; ++r) {
+        packRowToRgba(src + r * srcStride, channels, dst + r * dstStride, width);
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ================= RGBA Packing =================
+// Expands one row of 8-bit gray (1 ch), RGB (3 ch) or RGBA (4 ch) pixels into
+// tightly packed RGBA, the layout Android's ARGB_8888 bitmaps use in memory.
+void packRowToRgba(const uint8_t* src, int channels, uint8_t* dst, int width);
+
+// The 3-channel case on its own, for callers that know the layout statically.
+void packRgbRowToRgba(const uint8_t* src, uint8_t* dst, int width);
+
+// Packs a width x height block; strides are in bytes.
+void packToRgba(const uint8_t* src, size_t srcStride, int channels,
+                uint8_t* dst, size_t dstStride, int width, int height);
@@ -0,0 +1,311 @@
+#include "sampling_profiler.h"
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <map>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <ucontext.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static constexpr uint32_t kEmpty = 0;
+static constexpr uint32_t kWriting = 1;
+static constexpr uint32_t kReady = 2;
+
+SamplingProfiler& SamplingProfiler::instance() {
+    // Never destroyed: thread_local ProfiledThread guards may outlive statics.
+    static SamplingProfiler* profiler = new SamplingProfiler();
+    return *profiler;
+}
+
+SamplingProfiler::SamplingProfiler()
+    : samples_(MetricsRegistry::instance().counter("flam_profiler_samples_total",
+                                                  "Stacks recorded by the sampling profiler")),
+      dropped_(MetricsRegistry::instance().counter("flam_profiler_dropped_total",
+                                                  "Profiler samples lost to a full stack table")) {}
+
+bool SamplingProfiler::start(int hz) {
+    if (hz <= 0) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running()) return false;
+
+    if (!handlerInstalled_) {
+        // Left installed for good: a SIGPROF still queued after stop() would
+        // otherwise kill the process with the default action.
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = &SamplingProfiler::onSignal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, nullptr) != 0) return false;
+        handlerInstalled_ = true;
+    }
+
+    if (!table_) table_.reset(new Stack[kTableSize]);
+    for (size_t i = 0; i < kTableSize; ++i) {
+        table_[i].state.store(kEmpty, std::memory_order_relaxed);
+        table_[i].count.store(0, std::memory_order_relaxed);
+    }
+
+    hz_ = std::min(hz, kMaxHz);
+    running_.store(true);
+    for (int i = 0; i < kMaxThreads; ++i) {
+        if (slots_[i].tid.load(std::memory_order_relaxed) != 0) arm(slots_[i], i);
+    }
+    return true;
+}
+
+void SamplingProfiler::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running()) return;
+    running_.store(false);
+    for (ThreadSlot& slot : slots_) disarm(slot);
+    // A handler that saw running_ before the store may still be recording.
+    while (inHandler_.load() != 0) std::this_thread::yield();
+}
+
+void SamplingProfiler::arm(ThreadSlot& slot, int index) {
+    sigevent event;
+    std::memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_value.sival_int = index;
+    event.sigev_notify_thread_id = slot.tid.load(std::memory_order_relaxed);
+    if (timer_create(slot.clock, &event, &slot.timer) != 0) return;
+
+    const long periodNs = 1000000000L / hz_;
+    itimerspec spec;
+    spec.it_interval.tv_sec = periodNs / 1000000000L;
+    spec.it_interval.tv_nsec = periodNs % 1000000000L;
+    spec.it_value = spec.it_interval;
+    if (timer_settime(slot.timer, 0, &spec, nullptr) != 0) {
+        timer_delete(slot.timer);
+        return;
+    }
+    slot.armed = true;
+}
+
+void SamplingProfiler::disarm(ThreadSlot& slot) {
+    if (!slot.armed) return;
+    timer_delete(slot.timer);
+    slot.armed = false;
+}
+
+int SamplingProfiler::registerThread(const char* name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < kMaxThreads; ++i) {
+        ThreadSlot& slot = slots_[i];
+        if (slot.tid.load(std::memory_order_relaxed) != 0) continue;
+
+        if (pthread_getcpuclockid(pthread_self(), &slot.clock) != 0) return -1;
+        slot.stackLo = slot.stackHi = 0;
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            void* base = nullptr;
+            size_t size = 0;
+            if (pthread_attr_getstack(&attr, &base, &size) == 0) {
+                slot.stackLo = reinterpret_cast<uintptr_t>(base);
+                slot.stackHi = slot.stackLo + size;
+            }
+            pthread_attr_destroy(&attr);
+        }
+        std::snprintf(slot.name, sizeof(slot.name), "%s", name);
+        slot.tid.store(static_cast<pid_t>(syscall(SYS_gettid)), std::memory_order_release);
+        if (running()) arm(slot, i);
+        return i;
+    }
+    return -1;  // out of slots: this thread is simply not sampled
+}
+
+void SamplingProfiler::unregisterThread(int index) {
+    if (index < 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    disarm(slots_[index]);
+    slots_[index].tid.store(0, std::memory_order_release);
+}
+
+// Strips the pointer-authentication code from a signed arm64 return address
+// (xpaclri is a NOP on cores without PAC).
+static inline uintptr_t stripPointerAuth(uintptr_t address) {
+#if defined(__aarch64__)
+    register uintptr_t x30 __asm__("x30") = address;
+    __asm__("hint #7" : "+r"(x30));
+    return x30;
+#else
+    return address;
+#endif
+}
+
+// Walks frame records {previous fp, return address} from the interrupted
+// context. Every record must lie inside the thread's stack and move towards
+// its base, so a clobbered or omitted frame pointer ends the walk early
+// instead of faulting.
+static int unwind(const ucontext_t* uc, uintptr_t stackLo, uintptr_t stackHi, uintptr_t* frames, int maxDepth) {
+#if defined(__aarch64__)
+    const uintptr_t pc = uc->uc_mcontext.pc;
+    uintptr_t fp = uc->uc_mcontext.regs[29];
+#elif defined(__x86_64__)
+    const uintptr_t pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+    uintptr_t fp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+#elif defined(__arm__)
+    // Thumb and ARM code disagree on the frame register; PC only.
+    const uintptr_t pc = uc->uc_mcontext.arm_pc;
+    uintptr_t fp = 0;
+#elif defined(__i386__)
+    const uintptr_t pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_EIP]);
+    uintptr_t fp = 0;
+#else
+    (void)uc;
+    const uintptr_t pc = 0;
+    uintptr_t fp = 0;
+#endif
+    int depth = 0;
+    if (pc == 0) return 0;
+    frames[depth++] = pc;
+    while (depth < maxDepth && fp >= stackLo && fp % sizeof(uintptr_t) == 0 &&
+           fp + 2 * sizeof(uintptr_t) <= stackHi) {
+        const uintptr_t* record = reinterpret_cast<const uintptr_t*>(fp);
+        const uintptr_t next = record[0];
+        const uintptr_t returnAddress = stripPointerAuth(record[1]);
+        if (returnAddress == 0) break;
+        frames[depth++] = returnAddress;
+        if (next <= fp) break;
+        fp = next;
+    }
+    return depth;
+}
+
+void SamplingProfiler::onSignal(int signo, siginfo_t* info, void* context) {
+    (void)signo;
+    const int savedErrno = errno;
+    SamplingProfiler& profiler = instance();
+    profiler.inHandler_.fetch_add(1);
+    if (profiler.running_.load() && info->si_code == SI_TIMER) {
+        const int slot = info->si_value.sival_int;
+        if (slot >= 0 && slot < kMaxThreads) profiler.record(slot, context);
+    }
+    profiler.inHandler_.fetch_sub(1);
+    errno = savedErrno;
+}
+
+void SamplingProfiler::record(int slot, void* context) {
+    const ThreadSlot& thread = slots_[slot];
+    if (thread.tid.load(std::memory_order_acquire) == 0) return;
+
+    uintptr_t frames[kMaxDepth];
+    const int depth = unwind(static_cast<const ucontext_t*>(context), thread.stackLo, thread.stackHi, frames, kMaxDepth);
+    if (depth == 0) return;
+
+    // FNV-1a over the thread slot and the frames.
+    uint64_t hash = 1469598103934665603ULL ^ static_cast<uint64_t>(slot);
+    for (int i = 0; i < depth; ++i) hash = (hash ^ frames[i]) * 1099511628211ULL;
+    if (hash == 0) hash = 1;
+
+    size_t index = static_cast<size_t>(hash) & (kTableSize - 1);
+    for (int probe = 0; probe < kMaxProbes; ++probe, index = (index + 1) & (kTableSize - 1)) {
+        Stack& entry = table_[index];
+        uint32_t state = entry.state.load(std::memory_order_acquire);
+        if (state == kEmpty) {
+            if (entry.state.compare_exchange_strong(state, kWriting, std::memory_order_acquire)) {
+                entry.thread = static_cast<uint32_t>(slot);
+                entry.depth = static_cast<uint32_t>(depth);
+                entry.hash = hash;
+                std::memcpy(entry.name, thread.name, sizeof(entry.name));
+                std::memcpy(entry.frames, frames, sizeof(uintptr_t) * depth);
+                entry.count.store(1, std::memory_order_relaxed);
+                entry.state.store(kReady, std::memory_order_release);
+                samples_.inc();
+                return;
+            }
+        }
+        // Entries still being written by another thread are skipped; the
+        // stack may then be stored twice, which writeFolded() merges.
+        if (state == kReady && entry.hash == hash && entry.thread == static_cast<uint32_t>(slot) &&
+            entry.depth == static_cast<uint32_t>(depth) &&
+            std::memcmp(entry.frames, frames, sizeof(uintptr_t) * depth) == 0) {
+            entry.count.fetch_add(1, std::memory_order_relaxed);
+            samples_.inc();
+            return;
+        }
+    }
+    dropped_.inc();
+}
+
+// Return addresses point after the call; `address - 1` is inside it.
+static std::string symbolize(uintptr_t address, std::map<uintptr_t, std::string>& cache) {
+    auto it = cache.find(address);
+    if (it != cache.end()) return it->second;
+
+    std::string name;
+    Dl_info info{};
+    char buf[64];
+    // dladdr() fails for PCs outside every mapped object (JIT code, a torn
+    // stack) and leaves info unspecified then.
+    const bool found = dladdr(reinterpret_cast<void*>(address), &info) != 0;
+    if (found && info.dli_sname != nullptr) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+        std::free(demangled);
+    } else if (found && info.dli_fname != nullptr) {
+        const char* slash = std::strrchr(info.dli_fname, '/');
+        name = slash != nullptr ? slash + 1 : info.dli_fname;
+        std::snprintf(buf, sizeof(buf), "+0x%" PRIxPTR, address - reinterpret_cast<uintptr_t>(info.dli_fbase));
+        name += buf;
+    } else {
+        std::snprintf(buf, sizeof(buf), "0x%" PRIxPTR, address);
+        name = buf;
+    }
+    for (char& c : name) {
+        if (c == ';') c = ':';  // the folded-stack frame separator
+    }
+    cache.emplace(address, name);
+    return name;
+}
+
+void SamplingProfiler::writeFolded(std::string& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!table_) return;
+
+    std::map<uintptr_t, std::string> symbols;
+    std::map<std::string, uint64_t> folded;
+    std::string line;
+    for (size_t i = 0; i < kTableSize; ++i) {
+        const Stack& entry = table_[i];
+        if (entry.state.load(std::memory_order_acquire) != kReady) continue;
+        line.assign(entry.name, strnlen(entry.name, sizeof(entry.name)));
+        if (line.empty()) line = "thread";
+        for (int f = static_cast<int>(entry.depth) - 1; f >= 0; --f) {
+            line += ';';
+            line += symbolize(f == 0 ? entry.frames[f] : entry.frames[f] - 1, symbols);
+        }
+        folded[line] += entry.count.load(std::memory_order_relaxed);
+    }
+
+    char count[32];
+    for (const auto& stack : folded) {
+        std::snprintf(count, sizeof(count), " %" PRIu64 "\n", stack.second);
+        out += stack.first;
+        out += count;
+    }
+}
+
+ProfiledThread::ProfiledThread(const char* name)
+    : slot_(SamplingProfiler::instance().registerThread(name)) {}
+
+ProfiledThread::~ProfiledThread() {
+    SamplingProfiler::instance().unregisterThread(slot_);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <signal.h>
+#include <sys/types.h>
+#include <time.h>
+
+class Counter;
+
+// ================= Sampling Profiler =================
+// Opt-in CPU profiler for the native threads that do pipeline work. Each
+// registered thread gets a timer on its own CPU-time clock that raises
+// SIGPROF on that thread (SIGEV_THREAD_ID), so idle threads cost nothing and
+// samples land where the time is actually spent. The signal handler walks the
+// frame-pointer chain (arm64 and x86_64; other ABIs record the PC only) and
+// counts the stack in a fixed open-addressing table without locking or
+// allocating. writeFolded() symbolizes the table into folded stacks for
+// flamegraph.pl / speedscope.
+//
+// Handler cost is a bounded walk (kMaxDepth frames) plus a bounded probe
+// sequence, around a microsecond, i.e. ~0.1% of a core at 1 kHz. Stacks that
+// find no slot are counted as dropped.
+class SamplingProfiler {
+public:
+    static constexpr int kMaxHz = 1000;
+
+    static SamplingProfiler& instance();
+
+    // Clears the previous profile and starts sampling every registered thread
+    // (and threads registered later) at `hz` samples per CPU-second. CPU-time
+    // timers expire on scheduler ticks, so the kernel's CONFIG_HZ (250-300 on
+    // most devices) caps the effective rate per thread.
+    bool start(int hz);
+    // Stops sampling; the profile stays readable until the next start().
+    void stop();
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+
+    // Appends one "thread;outermost;...;innermost count" line per distinct
+    // stack. Frames without an exported symbol are written as lib.so+0xoffset
+    // for offline symbolization (addr2line / llvm-symbolizer).
+    void writeFolded(std::string& out) const;
+
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+private:
+    friend class ProfiledThread;
+
+    static constexpr int kMaxThreads = 32;
+    static constexpr int kMaxDepth = 24;
+    static constexpr size_t kTableSize = 2048;  // power of two
+    static constexpr int kMaxProbes = 16;
+
+    struct ThreadSlot {
+        std::atomic<pid_t> tid{0};
+        char name[16] = {};
+        clockid_t clock = 0;
+        uintptr_t stackLo = 0;
+        uintptr_t stackHi = 0;
+        timer_t timer = nullptr;
+        bool armed = false;
+    };
+
+    struct Stack {
+        std::atomic<uint32_t> state{0};  // kEmpty, kWriting, kReady
+        uint32_t thread = 0;
+        uint32_t depth = 0;
+        uint64_t hash = 0;
+        char name[16] = {};  // copied: the thread slot may be reused before export
+        uintptr_t frames[kMaxDepth] = {};
+        std::atomic<uint64_t> count{0};
+    };
+
+    SamplingProfiler();
+
+    int registerThread(const char* name);
+    void unregisterThread(int slot);
+    void arm(ThreadSlot& slot, int index);
+    void disarm(ThreadSlot& slot);
+
+    static void onSignal(int signo, siginfo_t* info, void* context);
+    void record(int slot, void* context);
+
+    mutable std::mutex mutex_;  // start / stop / registration; never taken by the handler
+    std::atomic<bool> running_{false};
+    std::atomic<int> inHandler_{0};
+    int hz_ = 0;
+    bool handlerInstalled_ = false;
+    ThreadSlot slots_[kMaxThreads];
+    std::unique_ptr<Stack[]> table_;  // allocated by the first start()
+    Counter& samples_;
+    Counter& dropped_;
+};
+
+// Registers the current thread with the profiler for the guard's lifetime;
+// put one at the top of a worker loop, or make it a function-local
+// thread_local for threads that are not ours (camera callbacks, Java
+// executors). Cheap when the profiler is off.
+class ProfiledThread {
+public:
+    explicit ProfiledThread(const char* name);
+    ~ProfiledThread();
+
+    ProfiledThread(const ProfiledThread&) = delete;
+    ProfiledThread& operator=(const ProfiledThread&) = delete;
+
+private:
+    int slot_;
+};
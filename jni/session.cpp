@@ -0,0 +1,83 @@
+#include "session.h"
+
+#include <cstdio>
+#include <malloc.h>
+#include <unistd.h>
+
+size_t residentBytes() {
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (f == nullptr) return 0;
+    unsigned long sizePages = 0, residentPages = 0;
+    const int n = std::fscanf(f, "%lu %lu", &sizePages, &residentPages);
+    std::fclose(f);
+    if (n != 2) return 0;
+    return static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+template <typename T>
+static size_t releaseVector(std::vector<T>& v) {
+    const size_t bytes = v.capacity() * sizeof(T);
+    std::vector<T>().swap(v);
+    return bytes;
+}
+
+size_t ProcessingSession::trim(TrimLevel level, size_t poolFloorBytes) {
+    // A panorama being captured is the user's work, not a cache: background
+    // trims stop short of it until capture ends.
+    if (level > TrimLevel::History && panoramaEnabled) level = TrimLevel::History;
+
+    size_t freed = 0;
+
+    // Per-frame scratch: regrown by the next frame, nothing is lost.
+    freed += releaseVector(luma);
+    freed += edges.trim();
+    freed += releaseVector(lowLuma);
+    freed += releaseVector(lowEdges);
+    freed += releaseVector(thumbScratch);
+    freed += rawRgb.trim();
+    bayer.trim();
+    contourTracer.trim();
+    contours.release();
+    freed += releaseVector(thinMask.words) + releaseVector(thinScratch.words);
+    thinMask = BitMask();
+    thinScratch = BitMask();
+    freed += releaseVector(thinPlane);
+    upsampler.trim();
+    flow.trim();
+    hdr.trim();
+    panorama.trim();
+
+    if (level >= TrimLevel::History) {
+        // Inter-frame state: the next frame primes it again, as after a
+        // size change, and is presented in full.
+        temporal.trim();
+        blockMatcher.trim();
+        pyramids[0].trim();
+        pyramids[1].trim();
+        flowField.reset();
+        flowWidth = flowHeight = 0;
+        motionDx = motionDy = 0;
+        output.trim();
+        outputPixels = nullptr;
+        dirtyRects.clear();
+    }
+    if (level >= TrimLevel::All) {
+        panorama.reset();
+        poolFloorBytes = 0;
+    }
+
+    freed += pool.trim(poolFloorBytes);
+    rewarmPending = true;
+
+#ifdef M_PURGE
+    // Scudo and jemalloc keep freed pages cached; hand them back now so the
+    // process actually shrinks while it is in the background.
+    mallopt(M_PURGE, 0);
+#endif
+    return freed;
+}
+
+void ProcessingSession::rewarm() {
+    rewarmPending = false;
+    pool.rewarm();
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "bayer.h"
+#include "bit_mask.h"
+#include "block_motion.h"
+#include "buffer_pool.h"
+#include "contours.h"
+#include "dirty_rects.h"
+#include "dis_flow.h"
+#include "guided_upsample.h"
+#include "hdr_fusion.h"
+#include "panorama.h"
+#include "pixel_format.h"
+#include "planar_image.h"
+#include "pyramid.h"
+#include "temporal_canny.h"
+
+#include <cstddef>
+#include <vector>
+
+// Edge pipeline variants selectable per session (values mirror OpenCVUtils.EdgeMode).
+enum class EdgeMode : int {
+    Full = 0,           // Canny at full resolution
+    HalfResGuided = 1,  // Canny at half resolution, luma-guided upsampling
+    Temporal = 2,       // Canny with hysteresis seeded from the previous frame
+};
+
+// How much a session gives back under memory pressure (values mirror
+// OpenCVUtils.TrimLevel). Each level includes the ones above it; parameters,
+// LUTs and sizes are always kept.
+enum class TrimLevel : int {
+    Scratch = 0,  // per-frame scratch, and pool blocks above the floor
+    History = 1,  // state carried between frames: edges, pyramids, motion, output shadow
+    All = 2,      // the panorama mosaic too, and the pool is emptied regardless of the floor;
+                  // History while a panorama is still being captured
+};
+
+// Resident set size of this process in bytes, 0 if unknown.
+size_t residentBytes();
+
+// ================= Processing Session =================
+// Per-stream native state that must survive between frames. Kotlin holds it as
+// an opaque jlong handle, the same way it holds cv::Mat addresses.
+struct ProcessingSession {
+    int width = 0;
+    int height = 0;
+
+    // Layout of the frames processFrame receives, resolved once when the
+    // session is created; per-frame conversion calls straight through it.
+    const PixelFormatOps* input = &pixelFormatOps(PixelFormat::Rgba8);
+
+    EdgeMode edgeMode = EdgeMode::Full;
+    GuidedEdgeUpsampler upsampler;
+    TemporalCanny temporal;
+
+    // Global scene displacement since the previous frame, when a tracker
+    // provides one; used to motion-compensate temporal state.
+    int motionDx = 0;
+    int motionDy = 0;
+
+    // Large per-frame outputs are drawn from here and recycled.
+    BufferPool pool;
+
+    // Dense optical flow, when enabled: luma pyramids of the previous and
+    // current frame (swapped each frame) and the latest flow field as
+    // flowWidth x flowHeight (dx, dy) int16 pairs, see DisFlow.
+    bool flowEnabled = false;
+    LumaPyramid pyramids[2];
+    int currentPyramid = 0;
+    DisFlow flow;
+    PooledBuffer flowField;
+    int flowWidth = 0;
+    int flowHeight = 0;
+
+    // 16x16 block motion vectors against the previous frame, when enabled;
+    // computed right after luma conversion while the plane is still cached.
+    bool blockMotionEnabled = false;
+    BlockMatcher blockMatcher;
+
+    // Panorama mode: every processed frame is stitched into the mosaic.
+    bool panoramaEnabled = false;
+    PanoramaStitcher panorama;
+
+    // Exposure-bracket fusion; keeps its tile scratch between brackets.
+    ExposureFusion hdr;
+
+    // Contours of the latest findContours call; the arena keeps its capacity.
+    ContourTracer contourTracer;
+    ContourArena contours;
+
+    // thinMask's packed mask, its thinning scratch and, for RGBA mats, the
+    // extracted gray plane.
+    BitMask thinMask;
+    BitMask thinScratch;
+    std::vector<uint8_t> thinPlane;
+
+    // Reused per-frame scratch planes
+    std::vector<uint8_t> luma;
+    std::vector<uint8_t> lowLuma;
+    std::vector<uint8_t> lowEdges;
+    std::vector<uint32_t> thumbScratch;  // resampleThumbnail's column spans and sums
+
+    // Pipeline output of processFrame, kept planar until it is presented.
+    PlanarImage edges;
+
+    // RAW ingest: sensor parameters plus the normalized mosaic, and the
+    // demosaiced frame rawToBitmap presents.
+    BayerDecoder bayer;
+    PlanarImage rawRgb;
+
+    // Output stage: last presented frame and the rects changed by the latest one.
+    DirtyRectTracker output;
+    std::vector<DirtyRect> dirtyRects;
+    const void* outputPixels = nullptr;  // identity of the buffer `output` last wrote to
+
+    // Frame rate of this stream (exponential moving average) for metrics.
+    int64_t lastFrameNs = 0;
+    double fps = 0.0;
+
+    // Set by trim(); the next frame calls rewarm() first.
+    bool rewarmPending = false;
+
+    // Releases memory down to `level`, keeping at most poolFloorBytes of idle
+    // pooled blocks. Must run on the thread that owns the session, like
+    // processFrame. Returns the bytes freed from the pool and the session's
+    // own scratch planes (component storage is not itemized).
+    size_t trim(TrimLevel level, size_t poolFloorBytes);
+
+    // Brings back the pooled blocks trim() dropped; everything else regrows
+    // on demand within the first frame that needs it.
+    void rewarm();
+};
@@ -0,0 +1,585 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(FLAM_SIMD_SCALAR)
+// Native is the scalar reference; used by the host tests to run that build.
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FLAM_SIMD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FLAM_SIMD_SSE2 1
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define FLAM_SIMD_SSSE3 1
+#endif
+#endif
+
+// ================= Portable SIMD =================
+// Thin 128-bit vector layer for row kernels. A kernel is written once as a
+// template over an ISA tag and uses simd::Ops<Isa>:
+//
+//   template <class Isa> void kernel(...) {
+//       using V = simd::Ops<Isa>;
+//       const auto d = V::absDiffU8(V::loadU8(a + x), V::loadU8(b + x));
+//   }
+//
+// simd::Native is the best backend of the build (NEON on ARM, SSE2 on x86,
+// with SSSE3 for table lookups where the ABI has it, or Scalar when built
+// with FLAM_SIMD_SCALAR) and simd::Scalar is a plain C++ reference with the
+// same lane semantics. Both are always available, so simdSelfCheck() can run
+// every kernel through each and demand bit-identical output. Every op is
+// defined by its scalar version below; vector backends must match it lane for
+// lane, including saturation and rounding at the extremes.
+//
+// Vectors are 16 x u8, 8 x u16 / s16 and 4 x u32 / s32. Loads and stores are
+// unaligned; loadLoU8 reads only 8 bytes, for rows that may end there. Lane i
+// of a vector lives at memory offset i, so bitcasts between element types
+// follow little-endian byte order on every backend.
+namespace simd {
+
+struct Scalar {
+    static constexpr const char* kName = "scalar";
+};
+
+#if defined(FLAM_SIMD_NEON)
+struct Neon {
+    static constexpr const char* kName = "neon";
+};
+using Native = Neon;
+#elif defined(FLAM_SIMD_SSE2)
+struct Sse2 {
+#if defined(FLAM_SIMD_SSSE3)
+    static constexpr const char* kName = "ssse3";
+#else
+    static constexpr const char* kName = "sse2";
+#endif
+};
+using Native = Sse2;
+#else
+using Native = Scalar;
+#endif
+
+template <class Isa>
+struct Ops;
+
+// ---------------- Scalar reference ----------------
+
+template <>
+struct Ops<Scalar> {
+    struct U8 { uint8_t v[16]; };
+    struct U16 { uint16_t v[8]; };
+    struct S16 { int16_t v[8]; };
+    struct U32 { uint32_t v[4]; };
+    struct S32 { int32_t v[4]; };
+
+    static uint8_t sat8(int x) { return static_cast<uint8_t>(x < 0 ? 0 : (x > 255 ? 255 : x)); }
+    static int16_t sat16(int32_t x) {
+        return static_cast<int16_t>(x < -32768 ? -32768 : (x > 32767 ? 32767 : x));
+    }
+
+    // Load / store / constants
+    static U8 loadU8(const uint8_t* p) { U8 r; std::memcpy(r.v, p, 16); return r; }
+    static void storeU8(uint8_t* p, U8 a) { std::memcpy(p, a.v, 16); }
+    static U8 loadLoU8(const uint8_t* p) { U8 r = {}; std::memcpy(r.v, p, 8); return r; }  // upper lanes 0
+    static U16 loadU16(const uint16_t* p) { U16 r; std::memcpy(r.v, p, 16); return r; }
+    static void storeU16(uint16_t* p, U16 a) { std::memcpy(p, a.v, 16); }
+    static S16 loadS16(const int16_t* p) { S16 r; std::memcpy(r.v, p, 16); return r; }
+    static void storeS16(int16_t* p, S16 a) { std::memcpy(p, a.v, 16); }
+    static U32 loadU32(const uint32_t* p) { U32 r; std::memcpy(r.v, p, 16); return r; }
+    static void storeU32(uint32_t* p, U32 a) { std::memcpy(p, a.v, 16); }
+    static S32 loadS32(const int32_t* p) { S32 r; std::memcpy(r.v, p, 16); return r; }
+    static void storeS32(int32_t* p, S32 a) { std::memcpy(p, a.v, 16); }
+    static U8 splatU8(uint8_t x) { U8 r; for (auto& e : r.v) e = x; return r; }
+    static U16 splatU16(uint16_t x) { U16 r; for (auto& e : r.v) e = x; return r; }
+    static S16 splatS16(int16_t x) { S16 r; for (auto& e : r.v) e = x; return r; }
+    static U32 zeroU32() { U32 r = {}; return r; }
+    static S32 zeroS32() { S32 r = {}; return r; }
+
+    // Structured: lane i of a, b, c (, d) is byte 3i (4i) + 0, 1, 2 (, 3),
+    // i.e. the channels of 16 packed RGB (RGBA) pixels.
+    static void loadU8x3(const uint8_t* p, U8& a, U8& b, U8& c) {
+        for (int i = 0; i < 16; ++i) { a.v[i] = p[3 * i]; b.v[i] = p[3 * i + 1]; c.v[i] = p[3 * i + 2]; }
+    }
+    static void loadU8x4(const uint8_t* p, U8& a, U8& b, U8& c, U8& d) {
+        for (int i = 0; i < 16; ++i) {
+            a.v[i] = p[4 * i]; b.v[i] = p[4 * i + 1]; c.v[i] = p[4 * i + 2]; d.v[i] = p[4 * i + 3];
+        }
+    }
+    static void storeU8x4(uint8_t* p, U8 a, U8 b, U8 c, U8 d) {
+        for (int i = 0; i < 16; ++i) {
+            p[4 * i] = a.v[i]; p[4 * i + 1] = b.v[i]; p[4 * i + 2] = c.v[i]; p[4 * i + 3] = d.v[i];
+        }
+    }
+
+    // u8
+    static U8 orU8(U8 a, U8 b) { for (int i = 0; i < 16; ++i) a.v[i] |= b.v[i]; return a; }
+    static U8 andU8(U8 a, U8 b) { for (int i = 0; i < 16; ++i) a.v[i] &= b.v[i]; return a; }
+    static U8 minU8(U8 a, U8 b) { for (int i = 0; i < 16; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+    static U8 maxU8(U8 a, U8 b) { for (int i = 0; i < 16; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+    static U8 addSatU8(U8 a, U8 b) { for (int i = 0; i < 16; ++i) a.v[i] = sat8(a.v[i] + b.v[i]); return a; }
+    static U8 subSatU8(U8 a, U8 b) { for (int i = 0; i < 16; ++i) a.v[i] = sat8(a.v[i] - b.v[i]); return a; }
+    static U8 avgU8(U8 a, U8 b) {  // rounds up
+        for (int i = 0; i < 16; ++i) a.v[i] = static_cast<uint8_t>((a.v[i] + b.v[i] + 1) >> 1);
+        return a;
+    }
+    static U8 absDiffU8(U8 a, U8 b) {
+        for (int i = 0; i < 16; ++i) a.v[i] = static_cast<uint8_t>(a.v[i] > b.v[i] ? a.v[i] - b.v[i] : b.v[i] - a.v[i]);
+        return a;
+    }
+    // Bit i set where a[i] != 0.
+    static uint32_t nonZeroMaskU8(U8 a) {
+        uint32_t m = 0;
+        for (int i = 0; i < 16; ++i) m |= static_cast<uint32_t>(a.v[i] != 0) << i;
+        return m;
+    }
+
+    // u16 / s16 / s32
+    static U16 addU16(U16 a, U16 b) { for (int i = 0; i < 8; ++i) a.v[i] = static_cast<uint16_t>(a.v[i] + b.v[i]); return a; }
+    static U16 subU16(U16 a, U16 b) { for (int i = 0; i < 8; ++i) a.v[i] = static_cast<uint16_t>(a.v[i] - b.v[i]); return a; }
+    template <int N> static U16 shrRoundU16(U16 a) {  // (a + 2^(N-1)) >> N without overflow, 1 <= N <= 15
+        for (int i = 0; i < 8; ++i) a.v[i] = static_cast<uint16_t>((a.v[i] + (1u << (N - 1))) >> N);
+        return a;
+    }
+    static S16 addS16(S16 a, S16 b) { for (int i = 0; i < 8; ++i) a.v[i] = static_cast<int16_t>(a.v[i] + b.v[i]); return a; }
+    static S16 subS16(S16 a, S16 b) { for (int i = 0; i < 8; ++i) a.v[i] = static_cast<int16_t>(a.v[i] - b.v[i]); return a; }
+    static S16 addSatS16(S16 a, S16 b) { for (int i = 0; i < 8; ++i) a.v[i] = sat16(a.v[i] + b.v[i]); return a; }
+    static S16 subSatS16(S16 a, S16 b) { for (int i = 0; i < 8; ++i) a.v[i] = sat16(a.v[i] - b.v[i]); return a; }
+    static S16 mulLoS16(S16 a, S16 b) {
+        for (int i = 0; i < 8; ++i) a.v[i] = static_cast<int16_t>(static_cast<uint32_t>(a.v[i] * b.v[i]));
+        return a;
+    }
+    static S16 absSatS16(S16 a) { for (int i = 0; i < 8; ++i) a.v[i] = sat16(a.v[i] < 0 ? -a.v[i] : a.v[i]); return a; }
+    static S16 minS16(S16 a, S16 b) { for (int i = 0; i < 8; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+    static S16 maxS16(S16 a, S16 b) { for (int i = 0; i < 8; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+    template <int N> static S16 shrS16(S16 a) {  // arithmetic
+        for (int i = 0; i < 8; ++i) a.v[i] = static_cast<int16_t>(a.v[i] >> N);
+        return a;
+    }
+    static S32 addS32(S32 a, S32 b) {
+        for (int i = 0; i < 4; ++i) a.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) + static_cast<uint32_t>(b.v[i]));
+        return a;
+    }
+    static S32 subS32(S32 a, S32 b) {
+        for (int i = 0; i < 4; ++i) a.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) - static_cast<uint32_t>(b.v[i]));
+        return a;
+    }
+    // r[i] = a[2i] * b[2i] + a[2i+1] * b[2i+1] (wraps only for a = b = -32768 pairs)
+    static S32 mulAddPairsS16(S16 a, S16 b) {
+        S32 r;
+        for (int i = 0; i < 4; ++i) {
+            const int64_t s = static_cast<int64_t>(a.v[2 * i]) * b.v[2 * i] +
+                              static_cast<int64_t>(a.v[2 * i + 1]) * b.v[2 * i + 1];
+            r.v[i] = static_cast<int32_t>(static_cast<uint32_t>(s));
+        }
+        return r;
+    }
+    static U32 addU32(U32 a, U32 b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+
+    // Widening / narrowing
+    static U16 widenLoU8(U8 a) { U16 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i]; return r; }
+    static U16 widenHiU8(U8 a) { U16 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[8 + i]; return r; }
+    static S32 widenLoS16(S16 a) { S32 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i]; return r; }
+    static S32 widenHiS16(S16 a) { S32 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[4 + i]; return r; }
+    // r[i] = a[2i] + a[2i+1]
+    static U16 addPairsU8(U8 a) {
+        U16 r;
+        for (int i = 0; i < 8; ++i) r.v[i] = static_cast<uint16_t>(a.v[2 * i] + a.v[2 * i + 1]);
+        return r;
+    }
+    // acc[i] + b[2i] + b[2i+1]
+    static U32 addPairsAccU16(U32 acc, U16 b) {
+        for (int i = 0; i < 4; ++i) acc.v[i] += static_cast<uint32_t>(b.v[2 * i]) + b.v[2 * i + 1];
+        return acc;
+    }
+    static U8 narrowSatU16(U16 lo, U16 hi) {
+        U8 r;
+        for (int i = 0; i < 8; ++i) {
+            r.v[i] = static_cast<uint8_t>(lo.v[i] > 255 ? 255 : lo.v[i]);
+            r.v[8 + i] = static_cast<uint8_t>(hi.v[i] > 255 ? 255 : hi.v[i]);
+        }
+        return r;
+    }
+    static U8 narrowSatS16ToU8(S16 lo, S16 hi) {
+        U8 r;
+        for (int i = 0; i < 8; ++i) {
+            r.v[i] = sat8(lo.v[i]);
+            r.v[8 + i] = sat8(hi.v[i]);
+        }
+        return r;
+    }
+    static S16 narrowSatS32(S32 lo, S32 hi) {
+        S16 r;
+        for (int i = 0; i < 4; ++i) {
+            r.v[i] = sat16(lo.v[i]);
+            r.v[4 + i] = sat16(hi.v[i]);
+        }
+        return r;
+    }
+    // (x + 2^(N-1)) >> N without overflow, saturated to s16; 1 <= N <= 16
+    template <int N> static S16 shrRoundNarrowSatS32(S32 lo, S32 hi) {
+        S16 r;
+        for (int i = 0; i < 4; ++i) {
+            r.v[i] = sat16(static_cast<int32_t>((static_cast<int64_t>(lo.v[i]) + (int64_t{1} << (N - 1))) >> N));
+            r.v[4 + i] = sat16(static_cast<int32_t>((static_cast<int64_t>(hi.v[i]) + (int64_t{1} << (N - 1))) >> N));
+        }
+        return r;
+    }
+
+    // Shuffles
+    static U8 zipLoU8(U8 a, U8 b) {
+        U8 r;
+        for (int i = 0; i < 8; ++i) { r.v[2 * i] = a.v[i]; r.v[2 * i + 1] = b.v[i]; }
+        return r;
+    }
+    static U8 zipHiU8(U8 a, U8 b) {
+        U8 r;
+        for (int i = 0; i < 8; ++i) { r.v[2 * i] = a.v[8 + i]; r.v[2 * i + 1] = b.v[8 + i]; }
+        return r;
+    }
+    static U16 zipLoU16(U16 a, U16 b) {
+        U16 r;
+        for (int i = 0; i < 4; ++i) { r.v[2 * i] = a.v[i]; r.v[2 * i + 1] = b.v[i]; }
+        return r;
+    }
+    static U16 zipHiU16(U16 a, U16 b) {
+        U16 r;
+        for (int i = 0; i < 4; ++i) { r.v[2 * i] = a.v[4 + i]; r.v[2 * i + 1] = b.v[4 + i]; }
+        return r;
+    }
+    // r[i] = table[idx[i]], or 0 where idx[i] >= 16
+    static U8 lookupU8(U8 table, U8 idx) {
+        U8 r;
+        for (int i = 0; i < 16; ++i) r.v[i] = idx.v[i] < 16 ? table.v[idx.v[i]] : 0;
+        return r;
+    }
+
+    // Bitcasts
+    static U16 asU16(U8 a) { U16 r; std::memcpy(r.v, a.v, 16); return r; }
+    static U8 asU8(U16 a) { U8 r; std::memcpy(r.v, a.v, 16); return r; }
+    static S16 asS16(U16 a) { S16 r; std::memcpy(r.v, a.v, 16); return r; }
+    static U16 asU16(S16 a) { U16 r; std::memcpy(r.v, a.v, 16); return r; }
+
+    // Horizontal sums (wrapping)
+    static uint32_t sumU32(U32 a) { return a.v[0] + a.v[1] + a.v[2] + a.v[3]; }
+    static int32_t sumS32(S32 a) {
+        return static_cast<int32_t>(static_cast<uint32_t>(a.v[0]) + static_cast<uint32_t>(a.v[1]) +
+                                    static_cast<uint32_t>(a.v[2]) + static_cast<uint32_t>(a.v[3]));
+    }
+};
+
+// ---------------- NEON ----------------
+
+#if defined(FLAM_SIMD_NEON)
+template <>
+struct Ops<Neon> {
+    struct U8 { uint8x16_t v; };
+    struct U16 { uint16x8_t v; };
+    struct S16 { int16x8_t v; };
+    struct U32 { uint32x4_t v; };
+    struct S32 { int32x4_t v; };
+
+    static U8 loadU8(const uint8_t* p) { return {vld1q_u8(p)}; }
+    static void storeU8(uint8_t* p, U8 a) { vst1q_u8(p, a.v); }
+    static U8 loadLoU8(const uint8_t* p) { return {vcombine_u8(vld1_u8(p), vdup_n_u8(0))}; }
+    static U16 loadU16(const uint16_t* p) { return {vld1q_u16(p)}; }
+    static void storeU16(uint16_t* p, U16 a) { vst1q_u16(p, a.v); }
+    static S16 loadS16(const int16_t* p) { return {vld1q_s16(p)}; }
+    static void storeS16(int16_t* p, S16 a) { vst1q_s16(p, a.v); }
+    static U32 loadU32(const uint32_t* p) { return {vld1q_u32(p)}; }
+    static void storeU32(uint32_t* p, U32 a) { vst1q_u32(p, a.v); }
+    static S32 loadS32(const int32_t* p) { return {vld1q_s32(p)}; }
+    static void storeS32(int32_t* p, S32 a) { vst1q_s32(p, a.v); }
+    static U8 splatU8(uint8_t x) { return {vdupq_n_u8(x)}; }
+    static U16 splatU16(uint16_t x) { return {vdupq_n_u16(x)}; }
+    static S16 splatS16(int16_t x) { return {vdupq_n_s16(x)}; }
+    static U32 zeroU32() { return {vdupq_n_u32(0)}; }
+    static S32 zeroS32() { return {vdupq_n_s32(0)}; }
+
+    static void loadU8x3(const uint8_t* p, U8& a, U8& b, U8& c) {
+        const uint8x16x3_t v = vld3q_u8(p);
+        a.v = v.val[0]; b.v = v.val[1]; c.v = v.val[2];
+    }
+    static void loadU8x4(const uint8_t* p, U8& a, U8& b, U8& c, U8& d) {
+        const uint8x16x4_t v = vld4q_u8(p);
+        a.v = v.val[0]; b.v = v.val[1]; c.v = v.val[2]; d.v = v.val[3];
+    }
+    static void storeU8x4(uint8_t* p, U8 a, U8 b, U8 c, U8 d) {
+        uint8x16x4_t v;
+        v.val[0] = a.v; v.val[1] = b.v; v.val[2] = c.v; v.val[3] = d.v;
+        vst4q_u8(p, v);
+    }
+
+    static U8 orU8(U8 a, U8 b) { return {vorrq_u8(a.v, b.v)}; }
+    static U8 andU8(U8 a, U8 b) { return {vandq_u8(a.v, b.v)}; }
+    static U8 minU8(U8 a, U8 b) { return {vminq_u8(a.v, b.v)}; }
+    static U8 maxU8(U8 a, U8 b) { return {vmaxq_u8(a.v, b.v)}; }
+    static U8 addSatU8(U8 a, U8 b) { return {vqaddq_u8(a.v, b.v)}; }
+    static U8 subSatU8(U8 a, U8 b) { return {vqsubq_u8(a.v, b.v)}; }
+    static U8 avgU8(U8 a, U8 b) { return {vrhaddq_u8(a.v, b.v)}; }
+    static U8 absDiffU8(U8 a, U8 b) { return {vabdq_u8(a.v, b.v)}; }
+    static uint32_t nonZeroMaskU8(U8 a) {
+        // Each set lane keeps its bit within its half; pairwise sums gather each half's byte.
+        static const uint8_t kBits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        const uint8x16_t bits = vandq_u8(vtstq_u8(a.v, a.v), vld1q_u8(kBits));
+        const uint64x2_t s = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(bits)));
+        return static_cast<uint32_t>(vgetq_lane_u64(s, 0) | (vgetq_lane_u64(s, 1) << 8));
+    }
+
+    static U16 addU16(U16 a, U16 b) { return {vaddq_u16(a.v, b.v)}; }
+    static U16 subU16(U16 a, U16 b) { return {vsubq_u16(a.v, b.v)}; }
+    template <int N> static U16 shrRoundU16(U16 a) { return {vrshrq_n_u16(a.v, N)}; }
+    static S16 addS16(S16 a, S16 b) { return {vaddq_s16(a.v, b.v)}; }
+    static S16 subS16(S16 a, S16 b) { return {vsubq_s16(a.v, b.v)}; }
+    static S16 addSatS16(S16 a, S16 b) { return {vqaddq_s16(a.v, b.v)}; }
+    static S16 subSatS16(S16 a, S16 b) { return {vqsubq_s16(a.v, b.v)}; }
+    static S16 mulLoS16(S16 a, S16 b) { return {vmulq_s16(a.v, b.v)}; }
+    static S16 absSatS16(S16 a) { return {vqabsq_s16(a.v)}; }
+    static S16 minS16(S16 a, S16 b) { return {vminq_s16(a.v, b.v)}; }
+    static S16 maxS16(S16 a, S16 b) { return {vmaxq_s16(a.v, b.v)}; }
+    template <int N> static S16 shrS16(S16 a) { return {vshrq_n_s16(a.v, N)}; }
+    static S32 addS32(S32 a, S32 b) { return {vaddq_s32(a.v, b.v)}; }
+    static S32 subS32(S32 a, S32 b) { return {vsubq_s32(a.v, b.v)}; }
+    static S32 mulAddPairsS16(S16 a, S16 b) {
+        const int32x4_t lo = vmull_s16(vget_low_s16(a.v), vget_low_s16(b.v));
+        const int32x4_t hi = vmull_s16(vget_high_s16(a.v), vget_high_s16(b.v));
+        return {vcombine_s32(vpadd_s32(vget_low_s32(lo), vget_high_s32(lo)),
+                             vpadd_s32(vget_low_s32(hi), vget_high_s32(hi)))};
+    }
+    static U32 addU32(U32 a, U32 b) { return {vaddq_u32(a.v, b.v)}; }
+
+    static U16 widenLoU8(U8 a) { return {vmovl_u8(vget_low_u8(a.v))}; }
+    static U16 widenHiU8(U8 a) { return {vmovl_u8(vget_high_u8(a.v))}; }
+    static S32 widenLoS16(S16 a) { return {vmovl_s16(vget_low_s16(a.v))}; }
+    static S32 widenHiS16(S16 a) { return {vmovl_s16(vget_high_s16(a.v))}; }
+    static U16 addPairsU8(U8 a) { return {vpaddlq_u8(a.v)}; }
+    static U32 addPairsAccU16(U32 acc, U16 b) { return {vpadalq_u16(acc.v, b.v)}; }
+    static U8 narrowSatU16(U16 lo, U16 hi) { return {vcombine_u8(vqmovn_u16(lo.v), vqmovn_u16(hi.v))}; }
+    static U8 narrowSatS16ToU8(S16 lo, S16 hi) { return {vcombine_u8(vqmovun_s16(lo.v), vqmovun_s16(hi.v))}; }
+    static S16 narrowSatS32(S32 lo, S32 hi) { return {vcombine_s16(vqmovn_s32(lo.v), vqmovn_s32(hi.v))}; }
+    template <int N> static S16 shrRoundNarrowSatS32(S32 lo, S32 hi) {
+        return {vcombine_s16(vqrshrn_n_s32(lo.v, N), vqrshrn_n_s32(hi.v, N))};
+    }
+
+    static U8 zipLoU8(U8 a, U8 b) {
+        const uint8x8x2_t z = vzip_u8(vget_low_u8(a.v), vget_low_u8(b.v));
+        return {vcombine_u8(z.val[0], z.val[1])};
+    }
+    static U8 zipHiU8(U8 a, U8 b) {
+        const uint8x8x2_t z = vzip_u8(vget_high_u8(a.v), vget_high_u8(b.v));
+        return {vcombine_u8(z.val[0], z.val[1])};
+    }
+    static U16 zipLoU16(U16 a, U16 b) {
+        const uint16x4x2_t z = vzip_u16(vget_low_u16(a.v), vget_low_u16(b.v));
+        return {vcombine_u16(z.val[0], z.val[1])};
+    }
+    static U16 zipHiU16(U16 a, U16 b) {
+        const uint16x4x2_t z = vzip_u16(vget_high_u16(a.v), vget_high_u16(b.v));
+        return {vcombine_u16(z.val[0], z.val[1])};
+    }
+    static U8 lookupU8(U8 table, U8 idx) {
+#if defined(__aarch64__)
+        return {vqtbl1q_u8(table.v, idx.v)};
+#else
+        uint8x8x2_t t;
+        t.val[0] = vget_low_u8(table.v);
+        t.val[1] = vget_high_u8(table.v);
+        return {vcombine_u8(vtbl2_u8(t, vget_low_u8(idx.v)), vtbl2_u8(t, vget_high_u8(idx.v)))};
+#endif
+    }
+
+    static U16 asU16(U8 a) { return {vreinterpretq_u16_u8(a.v)}; }
+    static U8 asU8(U16 a) { return {vreinterpretq_u8_u16(a.v)}; }
+    static S16 asS16(U16 a) { return {vreinterpretq_s16_u16(a.v)}; }
+    static U16 asU16(S16 a) { return {vreinterpretq_u16_s16(a.v)}; }
+
+    static uint32_t sumU32(U32 a) {
+        const uint32x2_t s = vadd_u32(vget_low_u32(a.v), vget_high_u32(a.v));
+        return vget_lane_u32(vpadd_u32(s, s), 0);
+    }
+    static int32_t sumS32(S32 a) {
+        const int32x2_t s = vadd_s32(vget_low_s32(a.v), vget_high_s32(a.v));
+        return vget_lane_s32(vpadd_s32(s, s), 0);
+    }
+};
+#endif
+
+// ---------------- SSE2 / SSSE3 ----------------
+
+#if defined(FLAM_SIMD_SSE2)
+template <>
+struct Ops<Sse2> {
+    struct U8 { __m128i v; };
+    struct U16 { __m128i v; };
+    struct S16 { __m128i v; };
+    struct U32 { __m128i v; };
+    struct S32 { __m128i v; };
+
+    static __m128i load(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+    static void store(void* p, __m128i v) { _mm_storeu_si128(static_cast<__m128i*>(p), v); }
+
+    static U8 loadU8(const uint8_t* p) { return {load(p)}; }
+    static void storeU8(uint8_t* p, U8 a) { store(p, a.v); }
+    static U8 loadLoU8(const uint8_t* p) { return {_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))}; }
+    static U16 loadU16(const uint16_t* p) { return {load(p)}; }
+    static void storeU16(uint16_t* p, U16 a) { store(p, a.v); }
+    static S16 loadS16(const int16_t* p) { return {load(p)}; }
+    static void storeS16(int16_t* p, S16 a) { store(p, a.v); }
+    static U32 loadU32(const uint32_t* p) { return {load(p)}; }
+    static void storeU32(uint32_t* p, U32 a) { store(p, a.v); }
+    static S32 loadS32(const int32_t* p) { return {load(p)}; }
+    static void storeS32(int32_t* p, S32 a) { store(p, a.v); }
+    static U8 splatU8(uint8_t x) { return {_mm_set1_epi8(static_cast<char>(x))}; }
+    static U16 splatU16(uint16_t x) { return {_mm_set1_epi16(static_cast<short>(x))}; }
+    static S16 splatS16(int16_t x) { return {_mm_set1_epi16(x)}; }
+    static U32 zeroU32() { return {_mm_setzero_si128()}; }
+    static S32 zeroS32() { return {_mm_setzero_si128()}; }
+
+    static void loadU8x3(const uint8_t* p, U8& a, U8& b, U8& c) {
+#if defined(FLAM_SIMD_SSSE3)
+        // Channel k of register j sits at lanes 3i + k - 16j; lookupU8 zeroes the
+        // lanes that index outside it, so the three lookups per channel OR together.
+        const __m128i v[3] = {load(p), load(p + 16), load(p + 32)};
+        const __m128i thrice = _mm_setr_epi8(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+        U8* const out[3] = {&a, &b, &c};
+        for (int k = 0; k < 3; ++k) {
+            __m128i r = _mm_setzero_si128();
+            for (int j = 0; j < 3; ++j) {
+                const __m128i idx = _mm_add_epi8(thrice, _mm_set1_epi8(static_cast<char>(k - 16 * j)));
+                r = _mm_or_si128(r, lookupU8({v[j]}, {idx}).v);
+            }
+            out[k]->v = r;
+        }
+#else
+        alignas(16) uint8_t t[3][16];
+        for (int i = 0; i < 16; ++i) { t[0][i] = p[3 * i]; t[1][i] = p[3 * i + 1]; t[2][i] = p[3 * i + 2]; }
+        a.v = _mm_load_si128(reinterpret_cast<const __m128i*>(t[0]));
+        b.v = _mm_load_si128(reinterpret_cast<const __m128i*>(t[1]));
+        c.v = _mm_load_si128(reinterpret_cast<const __m128i*>(t[2]));
+#endif
+    }
+    static void loadU8x4(const uint8_t* p, U8& a, U8& b, U8& c, U8& d) {
+        // Byte 16j + l holds pixel 4j + l / 4, channel l % 4. Each round of
+        // unpacks rotates those six index bits left by one; four rounds leave
+        // the channel in the register number and the pixel in the lane.
+        __m128i v[4] = {load(p), load(p + 16), load(p + 32), load(p + 48)};
+        for (int round = 0; round < 4; ++round) {
+            const __m128i t[4] = {_mm_unpacklo_epi8(v[0], v[2]), _mm_unpackhi_epi8(v[0], v[2]),
+                                  _mm_unpacklo_epi8(v[1], v[3]), _mm_unpackhi_epi8(v[1], v[3])};
+            for (int j = 0; j < 4; ++j) v[j] = t[j];
+        }
+        a.v = v[0]; b.v = v[1]; c.v = v[2]; d.v = v[3];
+    }
+    static void storeU8x4(uint8_t* p, U8 a, U8 b, U8 c, U8 d) {
+        const __m128i ab0 = _mm_unpacklo_epi8(a.v, b.v), cd0 = _mm_unpacklo_epi8(c.v, d.v);
+        const __m128i ab1 = _mm_unpackhi_epi8(a.v, b.v), cd1 = _mm_unpackhi_epi8(c.v, d.v);
+        store(p, _mm_unpacklo_epi16(ab0, cd0));
+        store(p + 16, _mm_unpackhi_epi16(ab0, cd0));
+        store(p + 32, _mm_unpacklo_epi16(ab1, cd1));
+        store(p + 48, _mm_unpackhi_epi16(ab1, cd1));
+    }
+
+    static U8 orU8(U8 a, U8 b) { return {_mm_or_si128(a.v, b.v)}; }
+    static U8 andU8(U8 a, U8 b) { return {_mm_and_si128(a.v, b.v)}; }
+    static U8 minU8(U8 a, U8 b) { return {_mm_min_epu8(a.v, b.v)}; }
+    static U8 maxU8(U8 a, U8 b) { return {_mm_max_epu8(a.v, b.v)}; }
+    static U8 addSatU8(U8 a, U8 b) { return {_mm_adds_epu8(a.v, b.v)}; }
+    static U8 subSatU8(U8 a, U8 b) { return {_mm_subs_epu8(a.v, b.v)}; }
+    static U8 avgU8(U8 a, U8 b) { return {_mm_avg_epu8(a.v, b.v)}; }
+    static U8 absDiffU8(U8 a, U8 b) { return {_mm_or_si128(_mm_subs_epu8(a.v, b.v), _mm_subs_epu8(b.v, a.v))}; }
+    static uint32_t nonZeroMaskU8(U8 a) {
+        return ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a.v, _mm_setzero_si128()))) & 0xFFFFu;
+    }
+
+    static U16 addU16(U16 a, U16 b) { return {_mm_add_epi16(a.v, b.v)}; }
+    static U16 subU16(U16 a, U16 b) { return {_mm_sub_epi16(a.v, b.v)}; }
+    // ((a >> (N - 1)) + 1) >> 1 equals the rounded shift; pavgw adds in 17 bits.
+    template <int N> static U16 shrRoundU16(U16 a) {
+        return {_mm_avg_epu16(_mm_srli_epi16(a.v, N - 1), _mm_setzero_si128())};
+    }
+    static S16 addS16(S16 a, S16 b) { return {_mm_add_epi16(a.v, b.v)}; }
+    static S16 subS16(S16 a, S16 b) { return {_mm_sub_epi16(a.v, b.v)}; }
+    static S16 addSatS16(S16 a, S16 b) { return {_mm_adds_epi16(a.v, b.v)}; }
+    static S16 subSatS16(S16 a, S16 b) { return {_mm_subs_epi16(a.v, b.v)}; }
+    static S16 mulLoS16(S16 a, S16 b) { return {_mm_mullo_epi16(a.v, b.v)}; }
+    static S16 absSatS16(S16 a) {
+        // max(a, 0 - a) with the negation saturated, so -32768 gives 32767.
+        return {_mm_max_epi16(a.v, _mm_subs_epi16(_mm_setzero_si128(), a.v))};
+    }
+    static S16 minS16(S16 a, S16 b) { return {_mm_min_epi16(a.v, b.v)}; }
+    static S16 maxS16(S16 a, S16 b) { return {_mm_max_epi16(a.v, b.v)}; }
+    template <int N> static S16 shrS16(S16 a) { return {_mm_srai_epi16(a.v, N)}; }
+    static S32 addS32(S32 a, S32 b) { return {_mm_add_epi32(a.v, b.v)}; }
+    static S32 subS32(S32 a, S32 b) { return {_mm_sub_epi32(a.v, b.v)}; }
+    static S32 mulAddPairsS16(S16 a, S16 b) { return {_mm_madd_epi16(a.v, b.v)}; }
+    static U32 addU32(U32 a, U32 b) { return {_mm_add_epi32(a.v, b.v)}; }
+
+    static U16 widenLoU8(U8 a) { return {_mm_unpacklo_epi8(a.v, _mm_setzero_si128())}; }
+    static U16 widenHiU8(U8 a) { return {_mm_unpackhi_epi8(a.v, _mm_setzero_si128())}; }
+    static S32 widenLoS16(S16 a) { return {_mm_srai_epi32(_mm_unpacklo_epi16(a.v, a.v), 16)}; }
+    static S32 widenHiS16(S16 a) { return {_mm_srai_epi32(_mm_unpackhi_epi16(a.v, a.v), 16)}; }
+    static U16 addPairsU8(U8 a) {
+        const __m128i lowMask = _mm_set1_epi16(0x00FF);
+        return {_mm_add_epi16(_mm_and_si128(a.v, lowMask), _mm_srli_epi16(a.v, 8))};
+    }
+    static U32 addPairsAccU16(U32 acc, U16 b) {
+        const __m128i lowMask = _mm_set1_epi32(0x0000FFFF);
+        return {_mm_add_epi32(acc.v, _mm_add_epi32(_mm_and_si128(b.v, lowMask), _mm_srli_epi32(b.v, 16)))};
+    }
+    static U8 narrowSatU16(U16 lo, U16 hi) {
+        // min(x, 255) as x - max(x - 255, 0); packus then sees only 0..255.
+        const __m128i top = _mm_set1_epi16(255);
+        const __m128i l = _mm_sub_epi16(lo.v, _mm_subs_epu16(lo.v, top));
+        const __m128i h = _mm_sub_epi16(hi.v, _mm_subs_epu16(hi.v, top));
+        return {_mm_packus_epi16(l, h)};
+    }
+    static U8 narrowSatS16ToU8(S16 lo, S16 hi) { return {_mm_packus_epi16(lo.v, hi.v)}; }
+    static S16 narrowSatS32(S32 lo, S32 hi) { return {_mm_packs_epi32(lo.v, hi.v)}; }
+    // With q = x >> (N - 1), the rounded shift is (q + 1) >> 1, but q + 1 wraps
+    // for N = 1 and x = INT32_MAX; (q >> 1) + (q & 1) is the same value and
+    // never leaves the s32 range.
+    template <int N> static S16 shrRoundNarrowSatS32(S32 lo, S32 hi) {
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i ql = _mm_srai_epi32(lo.v, N - 1);
+        const __m128i qh = _mm_srai_epi32(hi.v, N - 1);
+        const __m128i l = _mm_add_epi32(_mm_srai_epi32(ql, 1), _mm_and_si128(ql, one));
+        const __m128i h = _mm_add_epi32(_mm_srai_epi32(qh, 1), _mm_and_si128(qh, one));
+        return {_mm_packs_epi32(l, h)};
+    }
+
+    static U8 zipLoU8(U8 a, U8 b) { return {_mm_unpacklo_epi8(a.v, b.v)}; }
+    static U8 zipHiU8(U8 a, U8 b) { return {_mm_unpackhi_epi8(a.v, b.v)}; }
+    static U16 zipLoU16(U16 a, U16 b) { return {_mm_unpacklo_epi16(a.v, b.v)}; }
+    static U16 zipHiU16(U16 a, U16 b) { return {_mm_unpackhi_epi16(a.v, b.v)}; }
+    static U8 lookupU8(U8 table, U8 idx) {
+#if defined(FLAM_SIMD_SSSE3)
+        // pshufb zeroes lanes whose index has bit 7 set; force that for 16..127 too.
+        const __m128i outOfRange = _mm_cmpgt_epi8(idx.v, _mm_set1_epi8(15));
+        return {_mm_shuffle_epi8(table.v, _mm_or_si128(idx.v, outOfRange))};
+#else
+        alignas(16) uint8_t t[16], i[16], r[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(t), table.v);
+        _mm_store_si128(reinterpret_cast<__m128i*>(i), idx.v);
+        for (int k = 0; k < 16; ++k) r[k] = i[k] < 16 ? t[i[k]] : 0;
+        return {_mm_load_si128(reinterpret_cast<const __m128i*>(r))};
+#endif
+    }
+
+    static U16 asU16(U8 a) { return {a.v}; }
+    static U8 asU8(U16 a) { return {a.v}; }
+    static S16 asS16(U16 a) { return {a.v}; }
+    static U16 asU16(S16 a) { return {a.v}; }
+
+    static uint32_t sumU32(U32 a) {
+        __m128i s = _mm_add_epi32(a.v, _mm_srli_si128(a.v, 8));
+        s = _mm_add_epi32(s, _mm_srli_si128(s, 4));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(s));
+    }
+    static int32_t sumS32(S32 a) { return static_cast<int32_t>(sumU32({a.v})); }
+};
+#endif
+
+}  // namespace simd
@@ -0,0 +1,532 @@
+#include "simd_check.h"
+
+#include "simd.h"
+#include "simd_kernels.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+class Rng {
+public:
+    explicit Rng(unsigned seed) : state_(seed != 0 ? seed : 1) {}
+
+    uint32_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+    int below(int n) { return static_cast<int>(next() % static_cast<uint32_t>(n)); }
+
+    // One byte in four comes from the values where saturating, rounding and
+    // sign handling part ways; in pairs they also make the s16 / s32 extremes.
+    void fill(uint8_t* p, size_t n) {
+        static const uint8_t kEdges[] = {0x00, 0x01, 0x7F, 0x80, 0xFE, 0xFF};
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t r = next();
+            p[i] = (r & 3) == 0 ? kEdges[(r >> 8) % sizeof(kEdges)] : static_cast<uint8_t>(r >> 16);
+        }
+    }
+
+private:
+    uint32_t state_;
+};
+
+// Stores any op result as bytes so both backends can be compared with memcmp.
+template <class V>
+struct Sink {
+    uint8_t* out;
+
+    void operator()(typename V::U8 v) const { V::storeU8(out, v); }
+    void operator()(typename V::U16 v) const { uint16_t t[8]; V::storeU16(t, v); std::memcpy(out, t, 16); }
+    void operator()(typename V::S16 v) const { int16_t t[8]; V::storeS16(t, v); std::memcpy(out, t, 16); }
+    void operator()(typename V::U32 v) const { uint32_t t[4]; V::storeU32(t, v); std::memcpy(out, t, 16); }
+    void operator()(typename V::S32 v) const { int32_t t[4]; V::storeS32(t, v); std::memcpy(out, t, 16); }
+    void operator()(uint32_t v) const { std::memcpy(out, &v, 4); }
+    void operator()(int32_t v) const { std::memcpy(out, &v, 4); }
+};
+
+// Structured loads and stores span 64 bytes; each check compares one
+// 16-byte quarter of the result.
+template <class V>
+typename V::U8 loadU8x3Part(const uint8_t* p, int part) {
+    typename V::U8 v[3];
+    V::loadU8x3(p, v[0], v[1], v[2]);
+    return v[part];
+}
+
+template <class V>
+typename V::U8 loadU8x4Part(const uint8_t* p, int part) {
+    typename V::U8 v[4];
+    V::loadU8x4(p, v[0], v[1], v[2], v[3]);
+    return v[part];
+}
+
+template <class V>
+typename V::U8 storeU8x4Part(const uint8_t* p, int part) {
+    uint8_t t[64];
+    V::storeU8x4(t, V::loadU8(p), V::loadU8(p + 16), V::loadU8(p + 32), V::loadU8(p + 48));
+    return V::loadU8(t + 16 * part);
+}
+
+// name, expression over the inputs a8 / b8, a16 / b16, sa / sb, wa / wb, ia / ib,
+// the 64 bytes of wide and the s32 extremes s32x.
+#define FLAM_SIMD_OPS(X)                                                  \
+    X(splatU8, V::splatU8(a[0]))                                          \
+    X(splatU16, V::splatU16(ua[0]))                                       \
+    X(splatS16, V::splatS16(sa[0]))                                       \
+    X(loadLoU8, V::loadLoU8(a))                                           \
+    X(loadU8x3_0, loadU8x3Part<V>(wide, 0))                               \
+    X(loadU8x3_1, loadU8x3Part<V>(wide, 1))                               \
+    X(loadU8x3_2, loadU8x3Part<V>(wide, 2))                               \
+    X(loadU8x4_0, loadU8x4Part<V>(wide, 0))                               \
+    X(loadU8x4_1, loadU8x4Part<V>(wide, 1))                               \
+    X(loadU8x4_2, loadU8x4Part<V>(wide, 2))                               \
+    X(loadU8x4_3, loadU8x4Part<V>(wide, 3))                               \
+    X(storeU8x4_0, storeU8x4Part<V>(wide, 0))                             \
+    X(storeU8x4_1, storeU8x4Part<V>(wide, 1))                             \
+    X(storeU8x4_2, storeU8x4Part<V>(wide, 2))                             \
+    X(storeU8x4_3, storeU8x4Part<V>(wide, 3))                             \
+    X(orU8, V::orU8(a8, b8))                                              \
+    X(andU8, V::andU8(a8, b8))                                            \
+    X(minU8, V::minU8(a8, b8))                                            \
+    X(maxU8, V::maxU8(a8, b8))                                            \
+    X(addSatU8, V::addSatU8(a8, b8))                                      \
+    X(subSatU8, V::subSatU8(a8, b8))                                      \
+    X(avgU8, V::avgU8(a8, b8))                                            \
+    X(absDiffU8, V::absDiffU8(a8, b8))                                    \
+    X(nonZeroMaskU8, V::nonZeroMaskU8(a8))                                \
+    X(nonZeroMaskU8Sparse,                                                \
+      V::nonZeroMaskU8(V::andU8(a8, V::minU8(b8, V::splatU8(1)))))        \
+    X(addU16, V::addU16(a16, b16))                                        \
+    X(subU16, V::subU16(a16, b16))                                        \
+    X(shrRoundU16_1, V::template shrRoundU16<1>(a16))                     \
+    X(shrRoundU16_2, V::template shrRoundU16<2>(a16))                     \
+    X(shrRoundU16_8, V::template shrRoundU16<8>(a16))                     \
+    X(shrRoundU16_15, V::template shrRoundU16<15>(a16))                   \
+    X(addS16, V::addS16(s16a, s16b))                                      \
+    X(subS16, V::subS16(s16a, s16b))                                      \
+    X(addSatS16, V::addSatS16(s16a, s16b))                                \
+    X(subSatS16, V::subSatS16(s16a, s16b))                                \
+    X(mulLoS16, V::mulLoS16(s16a, s16b))                                  \
+    X(absSatS16, V::absSatS16(s16a))                                      \
+    X(minS16, V::minS16(s16a, s16b))                                      \
+    X(maxS16, V::maxS16(s16a, s16b))                                      \
+    X(shrS16_3, V::template shrS16<3>(s16a))                              \
+    X(shrS16_15, V::template shrS16<15>(s16a))                            \
+    X(addS32, V::addS32(s32a, s32b))                                      \
+    X(subS32, V::subS32(s32a, s32b))                                      \
+    X(mulAddPairsS16, V::mulAddPairsS16(s16a, s16b))                      \
+    X(addU32, V::addU32(u32a, u32b))                                      \
+    X(widenLoU8, V::widenLoU8(a8))                                        \
+    X(widenHiU8, V::widenHiU8(a8))                                        \
+    X(widenLoS16, V::widenLoS16(s16a))                                    \
+    X(widenHiS16, V::widenHiS16(s16a))                                    \
+    X(addPairsU8, V::addPairsU8(a8))                                      \
+    X(addPairsAccU16, V::addPairsAccU16(u32a, b16))                       \
+    X(narrowSatU16, V::narrowSatU16(a16, b16))                            \
+    X(narrowSatS16ToU8, V::narrowSatS16ToU8(s16a, s16b))                  \
+    X(narrowSatS32, V::narrowSatS32(s32a, s32b))                          \
+    X(shrRoundNarrowSatS32_1,                                             \
+      V::template shrRoundNarrowSatS32<1>(s32a, s32b))                    \
+    X(shrRoundNarrowSatS32_10,                                            \
+      V::template shrRoundNarrowSatS32<10>(s32a, s32b))                   \
+    X(shrRoundNarrowSatS32_16,                                            \
+      V::template shrRoundNarrowSatS32<16>(s32a, s32b))                   \
+    X(shrRoundNarrowSatS32_1Extremes,                                     \
+      V::template shrRoundNarrowSatS32<1>(s32x, s32a))                    \
+    X(shrRoundNarrowSatS32_16Extremes,                                    \
+      V::template shrRoundNarrowSatS32<16>(s32a, s32x))                   \
+    X(shrRoundNarrowSatS32_10InRange,                                     \
+      V::template shrRoundNarrowSatS32<10>(V::widenLoS16(s16a),           \
+                                           V::widenHiS16(s16b)))          \
+    X(zipLoU8, V::zipLoU8(a8, b8))                                        \
+    X(zipHiU8, V::zipHiU8(a8, b8))                                        \
+    X(zipLoU16, V::zipLoU16(a16, b16))                                    \
+    X(zipHiU16, V::zipHiU16(a16, b16))                                    \
+    X(lookupU8, V::lookupU8(a8, b8))                                      \
+    X(lookupU8InRange, V::lookupU8(a8, V::andU8(b8, V::splatU8(15))))     \
+    X(bitcasts, V::asU8(V::asU16(V::asS16(V::asU16(a8)))))                \
+    X(sumU32, V::sumU32(u32a))                                            \
+    X(sumS32, V::sumS32(s32a))
+
+enum OpId {
+#define FLAM_OP_ID(name, expr) kOp_##name,
+    FLAM_SIMD_OPS(FLAM_OP_ID)
+#undef FLAM_OP_ID
+    kOpCount
+};
+
+const char* const kOpNames[] = {
+#define FLAM_OP_NAME(name, expr) #name,
+    FLAM_SIMD_OPS(FLAM_OP_NAME)
+#undef FLAM_OP_NAME
+};
+
+template <class Isa>
+void applyOp(int op, const uint8_t* a, const uint8_t* b, uint8_t* out) {
+    using V = simd::Ops<Isa>;
+    uint16_t ua[8], ub[8];
+    int16_t sa[8], sb[8];
+    uint32_t wa[4], wb[4];
+    int32_t ia[4], ib[4];
+    std::memcpy(ua, a, 16); std::memcpy(ub, b, 16);
+    std::memcpy(sa, a, 16); std::memcpy(sb, b, 16);
+    std::memcpy(wa, a, 16); std::memcpy(wb, b, 16);
+    std::memcpy(ia, a, 16); std::memcpy(ib, b, 16);
+    const auto a8 = V::loadU8(a), b8 = V::loadU8(b);
+    const auto a16 = V::loadU16(ua), b16 = V::loadU16(ub);
+    const auto s16a = V::loadS16(sa), s16b = V::loadS16(sb);
+    const auto u32a = V::loadU32(wa), u32b = V::loadU32(wb);
+    const auto s32a = V::loadS32(ia), s32b = V::loadS32(ib);
+    // Where rounding biases and shifts overflow if done naively.
+    const int32_t extremes[4] = {INT32_MAX, INT32_MIN, INT32_MAX - 1, INT32_MIN + 1};
+    const auto s32x = V::loadS32(extremes);
+    // a, b and two remixes of them, so no quarter repeats another.
+    uint8_t wide[64];
+    for (int i = 0; i < 16; ++i) {
+        wide[i] = a[i];
+        wide[16 + i] = b[i];
+        wide[32 + i] = static_cast<uint8_t>(a[15 - i] ^ 0x5A);
+        wide[48 + i] = static_cast<uint8_t>(b[15 - i] + 0x33);
+    }
+    (void)a8; (void)b8; (void)a16; (void)b16; (void)s16a; (void)s16b;
+    (void)u32a; (void)u32b; (void)s32a; (void)s32b; (void)wide; (void)s32x;
+
+    const Sink<V> sink{out};
+    switch (op) {
+#define FLAM_OP_CASE(name, expr) case kOp_##name: sink(expr); break;
+        FLAM_SIMD_OPS(FLAM_OP_CASE)
+#undef FLAM_OP_CASE
+        default: break;
+    }
+}
+
+#undef FLAM_SIMD_OPS
+
+// ---------------- Kernels ----------------
+// Each runs one kernel instantiation on inputs drawn from `rng` and appends
+// everything it produced to `out`. The Native and Scalar runs get identically
+// seeded generators, so they see the same inputs.
+
+template <class Isa>
+void runSadRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(8) == 0 ? 20000 + rng.below(64) : rng.below(300);
+    std::vector<uint8_t> a(n + 1), b(n + 1);
+    rng.fill(a.data(), a.size());
+    rng.fill(b.data(), b.size());
+    const uint32_t sad = kernels::sadRow<Isa>(a.data(), b.data(), n);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(&sad), reinterpret_cast<const uint8_t*>(&sad) + 4);
+}
+
+template <class Isa>
+void runSadBlock16(Rng& rng, std::vector<uint8_t>& out) {
+    const size_t stride = 16 + rng.below(32);
+    std::vector<uint8_t> a(stride * 16), b(stride * 16);
+    rng.fill(a.data(), a.size());
+    rng.fill(b.data(), b.size());
+    const uint32_t sad = kernels::sadBlock16<Isa>(a.data(), stride, b.data(), stride);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(&sad), reinterpret_cast<const uint8_t*>(&sad) + 4);
+}
+
+template <class Isa>
+void runWindowSums8(Rng& rng, std::vector<uint8_t>& out) {
+    const size_t aStride = 8 + rng.below(16), bStride = 8 + rng.below(16);
+    std::vector<uint8_t> a(aStride * 8), b(bStride * 8);
+    rng.fill(a.data(), a.size());
+    rng.fill(b.data(), b.size());
+    const kernels::WindowSums s = kernels::windowSums8<Isa>(a.data(), aStride, b.data(), bStride);
+    const uint32_t sums[5] = {s.a, s.b, s.aa, s.bb, s.ab};
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(sums), reinterpret_cast<const uint8_t*>(sums + 5));
+}
+
+template <class Isa>
+void runPatchResidual8(Rng& rng, std::vector<uint8_t>& out) {
+    // The image is exactly as large as the 9 x 9 bytes the warp reads.
+    const int imgStride = 9 + rng.below(16);
+    const int ix = rng.below(imgStride - 8);
+    const int tStride = 8 + rng.below(8);
+    std::vector<uint8_t> img(static_cast<size_t>(imgStride) * 9), t(static_cast<size_t>(tStride) * 8);
+    std::vector<int16_t> gx(t.size()), gy(t.size());
+    rng.fill(img.data(), img.size());
+    rng.fill(t.data(), t.size());
+    rng.fill(reinterpret_cast<uint8_t*>(gx.data()), gx.size() * sizeof(int16_t));
+    rng.fill(reinterpret_cast<uint8_t*>(gy.data()), gy.size() * sizeof(int16_t));
+    const int fx = rng.below(129), fy = rng.below(129);
+    int32_t r[3];
+    r[0] = kernels::patchResidual8<Isa>(img.data(), imgStride, ix, 0, fx, fy, t.data(), gx.data(), gy.data(),
+                                        tStride, r[1], r[2]);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(r), reinterpret_cast<const uint8_t*>(r + 3));
+}
+
+template <class Isa>
+void runSquaredErrorRow(Rng& rng, std::vector<uint8_t>& out) {
+    // Long rows cross the 16K-pixel accumulator drain.
+    const int n = rng.below(8) == 0 ? 40000 + rng.below(64) : rng.below(300);
+    std::vector<uint8_t> a(n + 1), b(n + 1);
+    rng.fill(a.data(), a.size());
+    rng.fill(b.data(), b.size());
+    const uint64_t sum = kernels::squaredErrorRow<Isa>(a.data(), b.data(), n);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(&sum), reinterpret_cast<const uint8_t*>(&sum) + 8);
+}
+
+template <class Isa>
+void runDownsampleRow2x(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint8_t> a(2 * n + 1), b(2 * n + 1), d(n + 1);
+    rng.fill(a.data(), a.size());
+    rng.fill(b.data(), b.size());
+    kernels::downsampleRow2x<Isa>(a.data(), b.data(), d.data(), n);
+    out.insert(out.end(), d.begin(), d.begin() + n);
+}
+
+template <class Isa>
+void runOrSupportRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = 1 + rng.below(100);
+    std::vector<uint8_t> e0(n), e1(n), d(n);
+    // Sparse edges, as the upsampler sees them.
+    for (int i = 0; i < n; ++i) {
+        e0[i] = rng.below(8) == 0 ? 255 : 0;
+        e1[i] = rng.below(8) == 0 ? 255 : 0;
+    }
+    kernels::orSupportRow<Isa>(e0.data(), e1.data(), n, d.data());
+    out.insert(out.end(), d.begin(), d.end());
+}
+
+template <class Isa>
+void runGuidedVoteRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int lw = 2 + rng.below(60);
+    const int k0 = rng.below(lw - 1);
+    const int k1 = k0 + rng.below(lw - k0);
+    std::vector<uint8_t> guide(2 * lw + 1), l0(lw), l1(lw), e0(lw), e1(lw), d(2 * lw + 1);
+    rng.fill(guide.data(), guide.size());
+    rng.fill(l0.data(), lw);
+    rng.fill(l1.data(), lw);
+    rng.fill(e0.data(), lw);
+    rng.fill(e1.data(), lw);
+    // A Gaussian-like falloff that reaches 0, so the spatial fallback runs too.
+    uint16_t lut[256];
+    const int reach = 1 + rng.below(256);
+    for (int i = 0; i < 256; ++i) lut[i] = static_cast<uint16_t>(i < reach ? 256 - 256 * i / reach : 0);
+    const uint8_t* const l[2] = {l0.data(), l1.data()};
+    const uint8_t* const e[2] = {e0.data(), e1.data()};
+    kernels::guidedVoteRow<Isa>(guide.data(), l, e, lut, 1 + 2 * rng.below(2), k0, k1, lw, d.data());
+    out.insert(out.end(), d.begin() + 2 * k0 + 1, d.begin() + 2 * k1 + 1);
+}
+
+template <class Isa>
+void runGrayToRgbaRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint8_t> g(n + 1), d(4 * n + 1);
+    rng.fill(g.data(), g.size());
+    kernels::grayToRgbaRow<Isa>(g.data(), d.data(), n);
+    out.insert(out.end(), d.begin(), d.begin() + 4 * n);
+}
+
+template <class Isa>
+void runPlanesToRgbaRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint8_t> r(n + 1), g(n + 1), b(n + 1), d(4 * n + 1);
+    rng.fill(r.data(), r.size());
+    rng.fill(g.data(), g.size());
+    rng.fill(b.data(), b.size());
+    kernels::planesToRgbaRow<Isa>(r.data(), g.data(), b.data(), d.data(), n);
+    out.insert(out.end(), d.begin(), d.begin() + 4 * n);
+}
+
+template <class Isa>
+void runRgbToRgbaRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint8_t> s(3 * n + 1), d(4 * n + 1);
+    rng.fill(s.data(), s.size());
+    kernels::rgbToRgbaRow<Isa>(s.data(), d.data(), n);
+    out.insert(out.end(), d.begin(), d.begin() + 4 * n);
+}
+
+template <class Isa>
+void runRgbaLumaRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint8_t> s(4 * n + 1), d(n + 1);
+    rng.fill(s.data(), s.size());
+    kernels::rgbaLumaRow<Isa>(s.data(), d.data(), n);
+    out.insert(out.end(), d.begin(), d.begin() + n);
+}
+
+template <class Isa>
+void runGrayLumaRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint8_t> s(n + 1), d(n + 1);
+    rng.fill(s.data(), s.size());
+    kernels::grayLumaRow<Isa>(s.data(), d.data(), n);
+    out.insert(out.end(), d.begin(), d.begin() + n);
+}
+
+template <class Isa>
+void runRgbaChromaRow(Rng& rng, std::vector<uint8_t>& out) {
+    const int width = 1 + rng.below(100);
+    const int chromaWidth = (width + 1) / 2;
+    const int step = 1 + rng.below(2);
+    std::vector<uint8_t> row0(4 * width), row1(4 * width), u(2 * chromaWidth), v(chromaWidth);
+    rng.fill(row0.data(), row0.size());
+    rng.fill(row1.data(), row1.size());
+    kernels::rgbaChromaRow<Isa>(row0.data(), row1.data(), u.data(), step == 2 ? u.data() + 1 : v.data(), step, width);
+    out.insert(out.end(), u.begin(), u.begin() + step * chromaWidth);
+    if (step == 1) out.insert(out.end(), v.begin(), v.end());
+}
+
+template <class Isa>
+void runPackNonZeroBits(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(65);
+    std::vector<uint8_t> s(n + 1);
+    rng.fill(s.data(), s.size());
+    for (uint8_t& e : s) e = rng.below(2) == 0 ? 0 : e;
+    const uint64_t word = kernels::packNonZeroBits<Isa>(s.data(), n);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(&word), reinterpret_cast<const uint8_t*>(&word) + 8);
+}
+
+// u16 lanes from random bytes, masked to `bits`.
+void fillU16(Rng& rng, uint16_t* p, size_t n, unsigned bits) {
+    rng.fill(reinterpret_cast<uint8_t*>(p), n * sizeof(uint16_t));
+    for (size_t i = 0; i < n; ++i) p[i] &= static_cast<uint16_t>((1u << bits) - 1);
+}
+
+template <class Isa>
+void runSum121RowsU16(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint16_t> a(n + 1), b(n + 1), c(n + 1), d(n + 1);
+    fillU16(rng, a.data(), a.size(), 16);
+    fillU16(rng, b.data(), b.size(), 16);
+    fillU16(rng, c.data(), c.size(), 16);
+    kernels::sum121RowsU16<Isa>(a.data(), b.data(), c.data(), d.data(), n);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(d.data()), reinterpret_cast<const uint8_t*>(d.data() + n));
+}
+
+template <class Isa>
+void runSum121RowU16(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint16_t> s(n + 2), d(n + 1);
+    fillU16(rng, s.data(), s.size(), 16);
+    kernels::sum121RowU16<Isa>(s.data() + 1, d.data(), n);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(d.data()), reinterpret_cast<const uint8_t*>(d.data() + n));
+}
+
+template <class Isa>
+void runShrNarrowRowU16(Rng& rng, std::vector<uint8_t>& out) {
+    const int n = rng.below(100);
+    std::vector<uint16_t> s(n + 1);
+    std::vector<uint8_t> d(2 * n + 1);
+    fillU16(rng, s.data(), s.size(), 16);
+    kernels::shrNarrowRowU16<4, Isa>(s.data(), d.data(), n);
+    kernels::shrNarrowRowU16<8, Isa>(s.data(), d.data() + n, n);
+    out.insert(out.end(), d.begin(), d.begin() + 2 * n);
+}
+
+template <class Isa>
+void runBayerBilinearRow(Rng& rng, std::vector<uint8_t>& out) {
+    static const uint8_t kPatterns[4][2][2] = {
+        {{0, 1}, {1, 2}}, {{1, 0}, {2, 1}}, {{1, 2}, {0, 1}}, {{2, 1}, {1, 0}}};
+    const int n = 1 + rng.below(100);
+    const int n8 = (n + 7) & ~7;
+    std::vector<uint16_t> mosaic(3 * static_cast<size_t>(n8 + 2)), rgb(3 * static_cast<size_t>(n8));
+    fillU16(rng, mosaic.data(), mosaic.size(), 12);
+    const uint16_t* const rows[3] = {mosaic.data() + 1, mosaic.data() + n8 + 3, mosaic.data() + 2 * n8 + 5};
+    uint16_t* const planes[3] = {rgb.data(), rgb.data() + n8, rgb.data() + 2 * n8};
+    kernels::bayerBilinearRow<Isa>(rows, kPatterns[rng.below(4)], rng.below(2), planes, n);
+    for (int c = 0; c < 3; ++c) {
+        out.insert(out.end(), reinterpret_cast<const uint8_t*>(planes[c]),
+                   reinterpret_cast<const uint8_t*>(planes[c] + n));
+    }
+}
+
+struct KernelCheck {
+    const char* name;
+    void (*native)(Rng&, std::vector<uint8_t>&);
+    void (*scalar)(Rng&, std::vector<uint8_t>&);
+};
+
+#define FLAM_KERNEL_CHECK(name, run) {name, &run<simd::Native>, &run<simd::Scalar>}
+
+const KernelCheck kKernelChecks[] = {
+    FLAM_KERNEL_CHECK("sadRow", runSadRow),
+    FLAM_KERNEL_CHECK("sadBlock16", runSadBlock16),
+    FLAM_KERNEL_CHECK("windowSums8", runWindowSums8),
+    FLAM_KERNEL_CHECK("patchResidual8", runPatchResidual8),
+    FLAM_KERNEL_CHECK("squaredErrorRow", runSquaredErrorRow),
+    FLAM_KERNEL_CHECK("downsampleRow2x", runDownsampleRow2x),
+    FLAM_KERNEL_CHECK("orSupportRow", runOrSupportRow),
+    FLAM_KERNEL_CHECK("guidedVoteRow", runGuidedVoteRow),
+    FLAM_KERNEL_CHECK("grayToRgbaRow", runGrayToRgbaRow),
+    FLAM_KERNEL_CHECK("planesToRgbaRow", runPlanesToRgbaRow),
+    FLAM_KERNEL_CHECK("rgbToRgbaRow", runRgbToRgbaRow),
+    FLAM_KERNEL_CHECK("rgbaLumaRow", runRgbaLumaRow),
+    FLAM_KERNEL_CHECK("grayLumaRow", runGrayLumaRow),
+    FLAM_KERNEL_CHECK("rgbaChromaRow", runRgbaChromaRow),
+    FLAM_KERNEL_CHECK("packNonZeroBits", runPackNonZeroBits),
+    FLAM_KERNEL_CHECK("sum121RowsU16", runSum121RowsU16),
+    FLAM_KERNEL_CHECK("sum121RowU16", runSum121RowU16),
+    FLAM_KERNEL_CHECK("shrNarrowRowU16", runShrNarrowRowU16),
+    FLAM_KERNEL_CHECK("bayerBilinearRow", runBayerBilinearRow),
+};
+
+#undef FLAM_KERNEL_CHECK
+
+constexpr int kOpTrials = 512;
+constexpr int kKernelTrials = 64;
+
+void recordFailure(SimdCheckResult& result, const char* kind, const char* name, int trial) {
+    char line[128];
+    std::snprintf(line, sizeof(line), "%s %s differs from scalar (trial %d)\n", kind, name, trial);
+    result.report += line;
+    ++result.failures;
+}
+
+}  // namespace
+
+SimdCheckResult simdSelfCheck(unsigned seed) {
+    SimdCheckResult result;
+    result.isa = simd::Native::kName;
+    Rng rng(seed);
+
+    for (int op = 0; op < kOpCount; ++op) {
+        ++result.checks;
+        for (int trial = 0; trial < kOpTrials; ++trial) {
+            uint8_t a[16], b[16];
+            rng.fill(a, sizeof(a));
+            rng.fill(b, sizeof(b));
+            uint8_t native[16] = {}, scalar[16] = {};
+            applyOp<simd::Native>(op, a, b, native);
+            applyOp<simd::Scalar>(op, a, b, scalar);
+            if (std::memcmp(native, scalar, sizeof(native)) != 0) {
+                recordFailure(result, "op", kOpNames[op], trial);
+                break;
+            }
+        }
+    }
+
+    std::vector<uint8_t> native, scalar;
+    for (const KernelCheck& check : kKernelChecks) {
+        ++result.checks;
+        for (int trial = 0; trial < kKernelTrials; ++trial) {
+            const unsigned trialSeed = rng.next();
+            Rng nativeRng(trialSeed), scalarRng(trialSeed);
+            native.clear();
+            scalar.clear();
+            check.native(nativeRng, native);
+            check.scalar(scalarRng, scalar);
+            if (native != scalar) {
+                recordFailure(result, "kernel", check.name, trial);
+                break;
+            }
+        }
+    }
+
+    char summary[128];
+    std::snprintf(summary, sizeof(summary), "%s: %d of %d ops and kernels bit-exact against scalar",
+                  result.isa, result.checks - result.failures, result.checks);
+    result.report += summary;
+    return result;
+}
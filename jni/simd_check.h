@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// ================= SIMD Self-Check =================
+// Runs every simd::Ops operation and every kernel in simd_kernels.h through
+// both simd::Native and simd::Scalar, on random inputs salted with the
+// extreme values where saturation and rounding differ, and compares the
+// results bit for bit. Cheap enough (a few ms) to run on a device.
+struct SimdCheckResult {
+    const char* isa = "";  // simd::Native::kName
+    int checks = 0;        // operations and kernels exercised
+    int failures = 0;      // of those, how many differed on some input
+    std::string report;    // one line per failure, then a summary line
+};
+
+SimdCheckResult simdSelfCheck(unsigned seed = 1);
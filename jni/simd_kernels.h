@@ -0,0 +1,522 @@
+#pragma once
+
+#include "simd.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// ================= Portable Row Kernels =================
+// Row kernels written once against simd::Ops. Callers use the simd::Native
+// instantiation; simdSelfCheck() also runs the simd::Scalar one and compares.
+// Each handles its full width: the vector loop is followed by a scalar tail
+// with the same arithmetic.
+namespace kernels {
+
+// Sum of |a - b| over n bytes.
+template <class Isa>
+uint32_t sadRow(const uint8_t* a, const uint8_t* b, int n) {
+    using V = simd::Ops<Isa>;
+    int x = 0;
+    auto acc = V::zeroU32();
+    for (; x + 16 <= n; x += 16) {
+        acc = V::addPairsAccU16(acc, V::addPairsU8(V::absDiffU8(V::loadU8(a + x), V::loadU8(b + x))));
+    }
+    uint32_t sum = V::sumU32(acc);
+    for (; x < n; ++x) sum += static_cast<uint32_t>(a[x] > b[x] ? a[x] - b[x] : b[x] - a[x]);
+    return sum;
+}
+
+// Sum of |a - b| over a 16 x 16 block. Per-lane u16 partial sums stay below
+// 16 rows * 2 * 255, so they are widened only once at the end.
+template <class Isa>
+uint32_t sadBlock16(const uint8_t* a, size_t aStride, const uint8_t* b, size_t bStride) {
+    using V = simd::Ops<Isa>;
+    auto acc = V::splatU16(0);
+    for (int y = 0; y < 16; ++y) {
+        acc = V::addU16(acc, V::addPairsU8(V::absDiffU8(V::loadU8(a + y * aStride), V::loadU8(b + y * bStride))));
+    }
+    return V::sumU32(V::addPairsAccU16(V::zeroU32(), acc));
+}
+
+// Sums over the 8x8 window at a and at b, for SSIM.
+struct WindowSums {
+    uint32_t a, b, aa, bb, ab;
+};
+
+template <class Isa>
+WindowSums windowSums8(const uint8_t* a, size_t aStride, const uint8_t* b, size_t bStride) {
+    using V = simd::Ops<Isa>;
+    auto sa = V::splatU16(0), sb = V::splatU16(0);
+    auto saa = V::zeroS32(), sbb = V::zeroS32(), sab = V::zeroS32();
+    for (int y = 0; y < 8; ++y) {
+        const auto va = V::widenLoU8(V::loadLoU8(a + y * aStride));
+        const auto vb = V::widenLoU8(V::loadLoU8(b + y * bStride));
+        sa = V::addU16(sa, va);
+        sb = V::addU16(sb, vb);
+        saa = V::addS32(saa, V::mulAddPairsS16(V::asS16(va), V::asS16(va)));
+        sbb = V::addS32(sbb, V::mulAddPairsS16(V::asS16(vb), V::asS16(vb)));
+        sab = V::addS32(sab, V::mulAddPairsS16(V::asS16(va), V::asS16(vb)));
+    }
+    return {V::sumU32(V::addPairsAccU16(V::zeroU32(), sa)), V::sumU32(V::addPairsAccU16(V::zeroU32(), sb)),
+            static_cast<uint32_t>(V::sumS32(saa)), static_cast<uint32_t>(V::sumS32(sbb)),
+            static_cast<uint32_t>(V::sumS32(sab))};
+}
+
+// Bilinear warp of the 8x8 patch of img at (ix + fx / 128, iy + fy / 128),
+// 0 <= fx, fy <= 128, compared with template t in 1/16 intensity units.
+// Returns the residual SSD and sets bx / by to the residuals weighted by the
+// gradients gx / gy. Reads 9 x 9 bytes of img; t, gx and gy share tStride.
+template <class Isa>
+int32_t patchResidual8(const uint8_t* img, int imgStride, int ix, int iy, int fx, int fy,
+                       const uint8_t* t, const int16_t* gx, const int16_t* gy, int tStride,
+                       int32_t& bx, int32_t& by) {
+    using V = simd::Ops<Isa>;
+    // Taps p and p + 1 sit side by side, so one multiply-add applies both
+    // weights of a row; each weight is at most 128 * 128.
+    int16_t top[8], bottom[8];
+    for (int i = 0; i < 8; i += 2) {
+        top[i] = static_cast<int16_t>((128 - fx) * (128 - fy));
+        top[i + 1] = static_cast<int16_t>(fx * (128 - fy));
+        bottom[i] = static_cast<int16_t>((128 - fx) * fy);
+        bottom[i + 1] = static_cast<int16_t>(fx * fy);
+    }
+    const auto wTop = V::loadS16(top), wBottom = V::loadS16(bottom);
+    const auto sixteen = V::splatS16(16);
+    auto accX = V::zeroS32(), accY = V::zeroS32(), accS = V::zeroS32();
+    for (int r = 0; r < 8; ++r) {
+        const uint8_t* a = img + (iy + r) * imgStride + ix;
+        const uint8_t* b = a + imgStride;
+        const auto a0 = V::widenLoU8(V::loadLoU8(a)), a1 = V::widenLoU8(V::loadLoU8(a + 1));
+        const auto b0 = V::widenLoU8(V::loadLoU8(b)), b1 = V::widenLoU8(V::loadLoU8(b + 1));
+        const auto lo = V::addS32(V::mulAddPairsS16(V::asS16(V::zipLoU16(a0, a1)), wTop),
+                                  V::mulAddPairsS16(V::asS16(V::zipLoU16(b0, b1)), wBottom));
+        const auto hi = V::addS32(V::mulAddPairsS16(V::asS16(V::zipHiU16(a0, a1)), wTop),
+                                  V::mulAddPairsS16(V::asS16(V::zipHiU16(b0, b1)), wBottom));
+        const auto warped = V::template shrRoundNarrowSatS32<10>(lo, hi);
+        const auto tmpl = V::mulLoS16(V::asS16(V::widenLoU8(V::loadLoU8(t + r * tStride))), sixteen);
+        const auto d = V::subS16(warped, tmpl);
+        accX = V::addS32(accX, V::mulAddPairsS16(V::loadS16(gx + r * tStride), d));
+        accY = V::addS32(accY, V::mulAddPairsS16(V::loadS16(gy + r * tStride), d));
+        accS = V::addS32(accS, V::mulAddPairsS16(d, d));
+    }
+    bx = V::sumS32(accX);
+    by = V::sumS32(accY);
+    return V::sumS32(accS);
+}
+
+// Sum of (a - b)^2 over n bytes. The s32 lanes are drained every 1024 vectors
+// (at most 16 * 1024 * 255^2 in total, under 2^32).
+template <class Isa>
+uint64_t squaredErrorRow(const uint8_t* a, const uint8_t* b, int n) {
+    using V = simd::Ops<Isa>;
+    int x = 0;
+    uint64_t sum = 0;
+    while (x + 16 <= n) {
+        const int end = n - x > 16 * 1024 ? x + 16 * 1024 : n;
+        auto acc = V::zeroS32();
+        for (; x + 16 <= end; x += 16) {
+            const auto d = V::absDiffU8(V::loadU8(a + x), V::loadU8(b + x));
+            const auto lo = V::asS16(V::widenLoU8(d));
+            const auto hi = V::asS16(V::widenHiU8(d));
+            acc = V::addS32(acc, V::mulAddPairsS16(lo, lo));
+            acc = V::addS32(acc, V::mulAddPairsS16(hi, hi));
+        }
+        sum += static_cast<uint32_t>(V::sumS32(acc));
+    }
+    for (; x < n; ++x) {
+        const int d = a[x] - b[x];
+        sum += static_cast<uint64_t>(d * d);
+    }
+    return sum;
+}
+
+// 2x2 box average of rows a and b into outWidth bytes, rounding half up.
+template <class Isa>
+void downsampleRow2x(const uint8_t* a, const uint8_t* b, uint8_t* dst, int outWidth) {
+    using V = simd::Ops<Isa>;
+    int x = 0;
+    for (; x + 16 <= outWidth; x += 16) {
+        const auto lo = V::addU16(V::addPairsU8(V::loadU8(a + 2 * x)), V::addPairsU8(V::loadU8(b + 2 * x)));
+        const auto hi = V::addU16(V::addPairsU8(V::loadU8(a + 2 * x + 16)), V::addPairsU8(V::loadU8(b + 2 * x + 16)));
+        V::storeU8(dst + x, V::narrowSatU16(V::template shrRoundU16<2>(lo), V::template shrRoundU16<2>(hi)));
+    }
+    for (; x < outWidth; ++x) {
+        dst[x] = static_cast<uint8_t>((a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2);
+    }
+}
+
+// OR of the 2x2 neighbourhood starting at each column of rows e0 / e1; the
+// last column pairs with itself.
+template <class Isa>
+void orSupportRow(const uint8_t* e0, const uint8_t* e1, int n, uint8_t* out) {
+    using V = simd::Ops<Isa>;
+    int x = 0;
+    for (; x + 17 <= n; x += 16) {
+        const auto v = V::orU8(V::loadU8(e0 + x), V::loadU8(e1 + x));
+        const auto next = V::orU8(V::loadU8(e0 + x + 1), V::loadU8(e1 + x + 1));
+        V::storeU8(out + x, V::orU8(v, next));
+    }
+    for (; x < n; ++x) {
+        const int xn = x + 1 < n ? x + 1 : n - 1;
+        out[x] = static_cast<uint8_t>(e0[x] | e1[x] | e0[xn] | e1[xn]);
+    }
+}
+
+// Joint bilateral edge vote of one output pixel with guide luma p over the
+// four low-res neighbours: weights s[i] * rangeLut[|p - lum[i]|], falling back
+// to s[i] alone when the guide matches no neighbour. 255 when the weighted
+// edge votes exceed half the total.
+inline uint8_t guidedVotePixel(int p, const int* lum, const int* edge, const int* s, const uint16_t* rangeLut) {
+    int total = 0;
+    int on = 0;
+    for (int i = 0; i < 4; ++i) {
+        const int w = s[i] * rangeLut[std::abs(p - lum[i])];
+        total += w;
+        on += w * edge[i];
+    }
+    if (total == 0) {
+        for (int i = 0; i < 4; ++i) {
+            total += s[i];
+            on += s[i] * edge[i];
+        }
+    }
+    return 2 * on > total ? 255 : 0;
+}
+
+// guidedVotePixel for output pixels 2k + 1 and 2k + 2, k in [k0, k1), which
+// both lie between low-res columns k and k + 1 (horizontal weights 3:1 and
+// 1:3). l[r] / e[r] are the low luma / edge rows above (r = 0, vertical
+// weight wy0) and below (weight 4 - wy0); lowWidth is their width, k1 <
+// lowWidth. rangeLut entries must not exceed 256, so weights (at most 9 * 256)
+// and their sums (at most 16 * 256) fit s16 lanes. The LUT is gathered per
+// lane; everything around it runs 16 outputs at a time.
+template <class Isa>
+void guidedVoteRow(const uint8_t* guide, const uint8_t* const* l, const uint8_t* const* e,
+                   const uint16_t* rangeLut, int wy0, int k0, int k1, int lowWidth, uint8_t* out) {
+    using V = simd::Ops<Isa>;
+    const int wy[2] = {wy0, 4 - wy0};
+    // Spatial weight of neighbour i = 2 * row + column per lane: even lanes are
+    // odd outputs, 3 / 4 of the way to the left column.
+    typename V::S16 spatial[4];
+    for (int i = 0; i < 4; ++i) {
+        int16_t lanes[8];
+        for (int j = 0; j < 8; ++j) lanes[j] = static_cast<int16_t>(wy[i >> 1] * (((i & 1) ^ (j & 1)) ? 1 : 3));
+        spatial[i] = V::loadS16(lanes);
+    }
+    const auto one8 = V::splatU8(1);
+    const auto one = V::splatS16(1);
+    const auto zero = V::splatS16(0);
+    const auto fallbackTotal = V::splatS16(16);
+    const auto full = V::splatS16(255);
+
+    int k = k0;
+    // Loads of columns k + 1 .. k + 16 must stay inside the row.
+    for (; k + 8 <= k1 && k + 17 <= lowWidth; k += 8) {
+        const int x = 2 * k + 1;
+        const auto p = V::loadU8(guide + x);
+        typename V::U8 edges[4];
+        alignas(16) uint8_t diff[4][16];
+        for (int r = 0; r < 2; ++r) {
+            for (int c = 0; c < 2; ++c) {
+                const auto lum = V::loadU8(l[r] + k + c);
+                V::storeU8(diff[2 * r + c], V::absDiffU8(p, V::zipLoU8(lum, lum)));
+                const auto edge = V::minU8(V::loadU8(e[r] + k + c), one8);
+                edges[2 * r + c] = V::zipLoU8(edge, edge);
+            }
+        }
+        alignas(16) uint16_t range[4][16];
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 16; ++j) range[i][j] = rangeLut[diff[i][j]];
+        }
+
+        typename V::S16 votes[2];
+        for (int h = 0; h < 2; ++h) {
+            auto total = zero, on = zero, spatialOn = zero;
+            for (int i = 0; i < 4; ++i) {
+                const auto edge = V::asS16(h ? V::widenHiU8(edges[i]) : V::widenLoU8(edges[i]));
+                const auto w = V::mulLoS16(V::loadS16(reinterpret_cast<const int16_t*>(range[i] + 8 * h)), spatial[i]);
+                total = V::addS16(total, w);
+                on = V::addS16(on, V::mulLoS16(w, edge));
+                spatialOn = V::addS16(spatialOn, V::mulLoS16(spatial[i], edge));
+            }
+            // 1 where no neighbour matched the guide: switch to spatial weights.
+            const auto fallback = V::subS16(one, V::minS16(total, one));
+            total = V::addS16(total, V::mulLoS16(fallback, fallbackTotal));
+            on = V::addS16(on, V::mulLoS16(fallback, spatialOn));
+            // 2 * on - total clamped to 0 / 1, then scaled to 0 / 255.
+            const auto margin = V::subS16(V::addS16(on, on), total);
+            votes[h] = V::mulLoS16(V::maxS16(V::minS16(margin, one), zero), full);
+        }
+        V::storeU8(out + x, V::narrowSatS16ToU8(votes[0], votes[1]));
+    }
+    for (; k < k1; ++k) {
+        const int lum[4] = {l[0][k], l[0][k + 1], l[1][k], l[1][k + 1]};
+        const int edge[4] = {e[0][k] != 0, e[0][k + 1] != 0, e[1][k] != 0, e[1][k + 1] != 0};
+        const int odd[4] = {wy[0] * 3, wy[0], wy[1] * 3, wy[1]};
+        const int even[4] = {wy[0], wy[0] * 3, wy[1], wy[1] * 3};
+        out[2 * k + 1] = guidedVotePixel(guide[2 * k + 1], lum, edge, odd, rangeLut);
+        out[2 * k + 2] = guidedVotePixel(guide[2 * k + 2], lum, edge, even, rangeLut);
+    }
+}
+
+// Gray to RGBA (gray replicated, alpha 255).
+template <class Isa>
+void grayToRgbaRow(const uint8_t* src, uint8_t* dst, int width) {
+    using V = simd::Ops<Isa>;
+    const auto alpha = V::splatU8(255);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const auto g = V::loadU8(src + x);
+        const auto gg0 = V::asU16(V::zipLoU8(g, g)), ga0 = V::asU16(V::zipLoU8(g, alpha));
+        const auto gg1 = V::asU16(V::zipHiU8(g, g)), ga1 = V::asU16(V::zipHiU8(g, alpha));
+        V::storeU8(dst + x * 4, V::asU8(V::zipLoU16(gg0, ga0)));
+        V::storeU8(dst + x * 4 + 16, V::asU8(V::zipHiU16(gg0, ga0)));
+        V::storeU8(dst + x * 4 + 32, V::asU8(V::zipLoU16(gg1, ga1)));
+        V::storeU8(dst + x * 4 + 48, V::asU8(V::zipHiU16(gg1, ga1)));
+    }
+    for (; x < width; ++x) {
+        uint8_t* p = dst + x * 4;
+        p[0] = p[1] = p[2] = src[x];
+        p[3] = 255;
+    }
+}
+
+// R, G, B planes to RGBA (alpha 255).
+template <class Isa>
+void planesToRgbaRow(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* dst, int width) {
+    using V = simd::Ops<Isa>;
+    const auto alpha = V::splatU8(255);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const auto vr = V::loadU8(r + x), vg = V::loadU8(g + x), vb = V::loadU8(b + x);
+        const auto rg0 = V::asU16(V::zipLoU8(vr, vg)), ba0 = V::asU16(V::zipLoU8(vb, alpha));
+        const auto rg1 = V::asU16(V::zipHiU8(vr, vg)), ba1 = V::asU16(V::zipHiU8(vb, alpha));
+        V::storeU8(dst + x * 4, V::asU8(V::zipLoU16(rg0, ba0)));
+        V::storeU8(dst + x * 4 + 16, V::asU8(V::zipHiU16(rg0, ba0)));
+        V::storeU8(dst + x * 4 + 32, V::asU8(V::zipLoU16(rg1, ba1)));
+        V::storeU8(dst + x * 4 + 48, V::asU8(V::zipHiU16(rg1, ba1)));
+    }
+    for (; x < width; ++x) {
+        uint8_t* p = dst + x * 4;
+        p[0] = r[x]; p[1] = g[x]; p[2] = b[x]; p[3] = 255;
+    }
+}
+
+// Packed RGB to RGBA (alpha 255).
+template <class Isa>
+void rgbToRgbaRow(const uint8_t* src, uint8_t* dst, int width) {
+    using V = simd::Ops<Isa>;
+    const auto alpha = V::splatU8(255);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        typename V::U8 r, g, b;
+        V::loadU8x3(src + x * 3, r, g, b);
+        V::storeU8x4(dst + x * 4, r, g, b, alpha);
+    }
+    for (; x < width; ++x) {
+        const uint8_t* s = src + x * 3;
+        uint8_t* p = dst + x * 4;
+        p[0] = s[0]; p[1] = s[1]; p[2] = s[2]; p[3] = 255;
+    }
+}
+
+// BT.601 limited-range luma, 8-bit fixed point:
+//   Y = ((66 R + 129 G + 25 B + 128) >> 8) + 16
+// The weighted sum is at most 220 * 255, so it fits a u16 lane; the s16
+// multiplies give the same low 16 bits.
+template <class Isa>
+void rgbaLumaRow(const uint8_t* src, uint8_t* y, int width) {
+    using V = simd::Ops<Isa>;
+    const auto kr = V::splatS16(66), kg = V::splatS16(129), kb = V::splatS16(25);
+    const auto bias = V::splatU16(16);
+    auto luma = [&](typename V::U16 r, typename V::U16 g, typename V::U16 b) {
+        const auto sum = V::addS16(V::addS16(V::mulLoS16(V::asS16(r), kr), V::mulLoS16(V::asS16(g), kg)),
+                                   V::mulLoS16(V::asS16(b), kb));
+        return V::addU16(V::template shrRoundU16<8>(V::asU16(sum)), bias);
+    };
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        typename V::U8 r, g, b, a;
+        V::loadU8x4(src + x * 4, r, g, b, a);
+        V::storeU8(y + x, V::narrowSatU16(luma(V::widenLoU8(r), V::widenLoU8(g), V::widenLoU8(b)),
+                                          luma(V::widenHiU8(r), V::widenHiU8(g), V::widenHiU8(b))));
+    }
+    for (; x < width; ++x) {
+        const uint8_t* s = src + x * 4;
+        y[x] = static_cast<uint8_t>(((66 * s[0] + 129 * s[1] + 25 * s[2] + 128) >> 8) + 16);
+    }
+}
+
+// rgbaLumaRow for gray input, where the weights add up to 220.
+template <class Isa>
+void grayLumaRow(const uint8_t* src, uint8_t* y, int width) {
+    using V = simd::Ops<Isa>;
+    const auto k = V::splatS16(220);
+    const auto bias = V::splatU16(16);
+    auto luma = [&](typename V::U16 g) {
+        return V::addU16(V::template shrRoundU16<8>(V::asU16(V::mulLoS16(V::asS16(g), k))), bias);
+    };
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const auto g = V::loadU8(src + x);
+        V::storeU8(y + x, V::narrowSatU16(luma(V::widenLoU8(g)), luma(V::widenHiU8(g))));
+    }
+    for (; x < width; ++x) y[x] = static_cast<uint8_t>(((220 * src[x] + 128) >> 8) + 16);
+}
+
+// BT.601 limited-range chroma of the 2x2 blocks of RGBA rows row0 / row1:
+//   U = ((-38 R - 74 G + 112 B + 128) >> 8) + 128
+//   V = ((112 R - 94 G - 18 B + 128) >> 8) + 128
+// where each channel is the block average, (sum + 2) >> 2, and an odd last
+// column pairs with itself. The weighted sums stay within 112 * 255 either
+// way, so they fit s16 lanes. Writes (width + 1) / 2 outputs to u[cx * step]
+// and v[cx * step]: step 1 is planar, step 2 is NV12 with v == u + 1.
+template <class Isa>
+void rgbaChromaRow(const uint8_t* row0, const uint8_t* row1, uint8_t* u, uint8_t* v, int step, int width) {
+    using V = simd::Ops<Isa>;
+    using S16 = typename V::S16;
+    const auto offset = V::splatS16(128);
+    const S16 weightsU[3] = {V::splatS16(-38), V::splatS16(-74), V::splatS16(112)};
+    const S16 weightsV[3] = {V::splatS16(112), V::splatS16(-94), V::splatS16(-18)};
+    // R, G, B averages of the eight blocks over 16 pixels of each row.
+    auto average = [&](const uint8_t* a, const uint8_t* b, S16* rgb) {
+        typename V::U8 pa[4], pb[4];
+        V::loadU8x4(a, pa[0], pa[1], pa[2], pa[3]);
+        V::loadU8x4(b, pb[0], pb[1], pb[2], pb[3]);
+        for (int c = 0; c < 3; ++c) {
+            rgb[c] = V::asS16(V::template shrRoundU16<2>(V::addU16(V::addPairsU8(pa[c]), V::addPairsU8(pb[c]))));
+        }
+    };
+    auto chroma = [&](const S16* rgb, const S16* w) {
+        const auto sum = V::addS16(V::addS16(V::mulLoS16(rgb[0], w[0]), V::mulLoS16(rgb[1], w[1])),
+                                   V::mulLoS16(rgb[2], w[2]));
+        return V::addS16(V::template shrS16<8>(V::addS16(sum, offset)), offset);
+    };
+
+    const int chromaWidth = (width + 1) / 2;
+    int cx = 0;
+    for (; cx + 16 <= width / 2; cx += 16) {
+        S16 lo[3], hi[3];
+        average(row0 + cx * 8, row1 + cx * 8, lo);
+        average(row0 + cx * 8 + 64, row1 + cx * 8 + 64, hi);
+        const auto uOut = V::narrowSatS16ToU8(chroma(lo, weightsU), chroma(hi, weightsU));
+        const auto vOut = V::narrowSatS16ToU8(chroma(lo, weightsV), chroma(hi, weightsV));
+        if (step == 2) {
+            V::storeU8(u + cx * 2, V::zipLoU8(uOut, vOut));
+            V::storeU8(u + cx * 2 + 16, V::zipHiU8(uOut, vOut));
+        } else {
+            V::storeU8(u + cx, uOut);
+            V::storeU8(v + cx, vOut);
+        }
+    }
+    for (; cx < chromaWidth; ++cx) {
+        const int x0 = cx * 2;
+        const int x1 = x0 + 1 < width ? x0 + 1 : width - 1;
+        const uint8_t* a0 = row0 + x0 * 4;
+        const uint8_t* a1 = row0 + x1 * 4;
+        const uint8_t* b0 = row1 + x0 * 4;
+        const uint8_t* b1 = row1 + x1 * 4;
+        const int r = (a0[0] + a1[0] + b0[0] + b1[0] + 2) >> 2;
+        const int g = (a0[1] + a1[1] + b0[1] + b1[1] + 2) >> 2;
+        const int b = (a0[2] + a1[2] + b0[2] + b1[2] + 2) >> 2;
+        u[cx * step] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[cx * step] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+// Packs n <= 64 bytes into a word: bit i is set where src[i] != 0.
+template <class Isa>
+uint64_t packNonZeroBits(const uint8_t* src, int n) {
+    using V = simd::Ops<Isa>;
+    uint64_t word = 0;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) word |= static_cast<uint64_t>(V::nonZeroMaskU8(V::loadU8(src + i))) << i;
+    for (; i < n; ++i) word |= static_cast<uint64_t>(src[i] != 0) << i;
+    return word;
+}
+
+// a + 2b + c per u16 lane (a vertical [1 2 1] tap), wrapping on overflow.
+template <class Isa>
+void sum121RowsU16(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* dst, int n) {
+    using V = simd::Ops<Isa>;
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        const auto mid = V::loadU16(b + x);
+        V::storeU16(dst + x, V::addU16(V::addU16(V::loadU16(a + x), V::loadU16(c + x)), V::addU16(mid, mid)));
+    }
+    for (; x < n; ++x) dst[x] = static_cast<uint16_t>(a[x] + 2 * b[x] + c[x]);
+}
+
+// src[x - 1] + 2 src[x] + src[x + 1] (a horizontal [1 2 1] tap), wrapping on
+// overflow. Reads src[-1] and src[n].
+template <class Isa>
+void sum121RowU16(const uint16_t* src, uint16_t* dst, int n) {
+    using V = simd::Ops<Isa>;
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        const auto mid = V::loadU16(src + x);
+        V::storeU16(dst + x, V::addU16(V::addU16(V::loadU16(src + x - 1), V::loadU16(src + x + 1)),
+                                       V::addU16(mid, mid)));
+    }
+    for (; x < n; ++x) dst[x] = static_cast<uint16_t>(src[x - 1] + 2 * src[x] + src[x + 1]);
+}
+
+// (v + 2^(N-1)) >> N, saturated to a byte.
+template <int N, class Isa>
+void shrNarrowRowU16(const uint16_t* src, uint8_t* dst, int n) {
+    using V = simd::Ops<Isa>;
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        V::storeU8(dst + x, V::narrowSatU16(V::template shrRoundU16<N>(V::loadU16(src + x)),
+                                            V::template shrRoundU16<N>(V::loadU16(src + x + 8))));
+    }
+    for (; x < n; ++x) {
+        const unsigned v = (src[x] + (1u << (N - 1))) >> N;
+        dst[x] = static_cast<uint8_t>(v > 255 ? 255 : v);
+    }
+}
+
+// Bilinear demosaic of one row of a Bayer mosaic. rows[0..2] are mosaic rows
+// y - 1, y and y + 1; cfa[py][px] is the colour (0 R, 1 G, 2 B) at row parity
+// py and column parity px, and parity is y & 1. Each colour is the average of
+// its samples in the 3x3 neighbourhood, weighted [1 2 1] x [1 2 1] for R and
+// B and as a plus for G, so sums stay below 4 * 4096 for 12-bit input.
+// Works in whole vectors: rows must be readable over [-1, n8], where n8 is n
+// rounded up to 8, and rgb[c] writable over [0, n8).
+template <class Isa>
+void bayerBilinearRow(const uint16_t* const* rows, const uint8_t (*cfa)[2], int parity,
+                      uint16_t* const* rgb, int n) {
+    using V = simd::Ops<Isa>;
+    // mask[r][s][c]: lanes of a load from rows[r] at an even x + s that hold colour c.
+    typename V::U8 mask[3][2][3];
+    for (int r = 0; r < 3; ++r) {
+        for (int s = 0; s < 2; ++s) {
+            for (int c = 0; c < 3; ++c) {
+                uint16_t lanes[8];
+                for (int i = 0; i < 8; ++i) lanes[i] = cfa[(parity + r + 1) & 1][(s + i) & 1] == c ? 0xFFFF : 0;
+                mask[r][s][c] = V::asU8(V::loadU16(lanes));
+            }
+        }
+    }
+    for (int x = 0; x < n; x += 8) {
+        auto at = [&](int r, int dx, int c) {
+            return V::asU16(V::andU8(V::asU8(V::loadU16(rows[r] + x + dx)), mask[r][dx & 1][c]));
+        };
+        for (int c = 0; c < 3; c += 2) {
+            auto tap = [&](int r) {
+                const auto mid = at(r, 0, c);
+                return V::addU16(V::addU16(at(r, -1, c), at(r, 1, c)), V::addU16(mid, mid));
+            };
+            const auto mid = tap(1);
+            const auto sum = V::addU16(V::addU16(tap(0), tap(2)), V::addU16(mid, mid));
+            V::storeU16(rgb[c] + x, V::template shrRoundU16<2>(sum));
+        }
+        const auto centre = at(1, 0, 1);
+        const auto cross = V::addU16(V::addU16(at(1, -1, 1), at(1, 1, 1)), V::addU16(at(0, 0, 1), at(2, 0, 1)));
+        const auto twice = V::addU16(centre, centre);
+        V::storeU16(rgb[1] + x, V::template shrRoundU16<2>(V::addU16(cross, V::addU16(twice, twice))));
+    }
+}
+
+}  // namespace kernels
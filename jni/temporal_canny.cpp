@@ -0,0 +1,241 @@
+#include "temporal_canny.h"
+
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// cls_ values. Reused tiles hold only kNone / kEdge, so the flood fill never
+// enters them but their edges still seed neighbouring recomputed tiles.
+static constexpr uint8_t kNone = 0;
+static constexpr uint8_t kWeak = 1;
+static constexpr uint8_t kStrong = 2;
+static constexpr uint8_t kEdge = 255;
+
+// tan(22.5 deg) in Q15, as used by cv::Canny's direction test.
+static constexpr int kTan22Q15 = 13573;
+
+void TemporalCanny::setParams(const Params& params) {
+    params_ = params;
+    params_.tileSize = std::max(8, params_.tileSize);
+    reset();
+}
+
+void TemporalCanny::reset() {
+    width_ = height_ = 0;
+    prevDx_ = prevDy_ = 0;
+    prevLuma_.clear();
+    prevEdges_.clear();
+}
+
+void TemporalCanny::trim() {
+    reset();
+    std::vector<uint8_t>().swap(prevLuma_);
+    std::vector<uint8_t>().swap(prevEdges_);
+    std::vector<int16_t>().swap(mag_);
+    std::vector<uint8_t>().swap(cls_);
+    std::vector<uint8_t>().swap(tileState_);
+    std::vector<int32_t>().swap(stack_);
+}
+
+bool TemporalCanny::tileChanged(const uint8_t* luma, size_t lumaStride,
+                                int x0, int y0, int x1, int y1) const {
+    const uint32_t limit = static_cast<uint32_t>(params_.staticMeanAbsDiff) *
+                           static_cast<uint32_t>((x1 - x0) * (y1 - y0));
+    uint32_t sad = 0;
+    for (int y = y0; y < y1; ++y) {
+        sad += kernels::sadRow<simd::Native>(luma + y * lumaStride + x0,
+                      prevLuma_.data() + static_cast<size_t>(y) * width_ + x0, x1 - x0);
+        if (sad > limit) return true;
+    }
+    return false;
+}
+
+// Sobel + non-maximum suppression over [x0, x1) x [y0, y1), writing cls_.
+// Magnitudes are computed with a one-pixel halo (replicated at the image
+// border) so the tile does not depend on its neighbours' state.
+void TemporalCanny::gradientAndNms(const uint8_t* luma, size_t lumaStride,
+                                   int x0, int y0, int x1, int y1) {
+    const int w = width_;
+    const int h = height_;
+    const int hx0 = std::max(x0 - 1, 0), hx1 = std::min(x1 + 1, w);
+    const int hy0 = std::max(y0 - 1, 0), hy1 = std::min(y1 + 1, h);
+
+    for (int y = hy0; y < hy1; ++y) {
+        const uint8_t* up = luma + std::max(y - 1, 0) * lumaStride;
+        const uint8_t* mid = luma + y * lumaStride;
+        const uint8_t* dn = luma + std::min(y + 1, h - 1) * lumaStride;
+        int16_t* m = mag_.data() + static_cast<size_t>(y) * w;
+        for (int x = hx0; x < hx1; ++x) {
+            const int xl = std::max(x - 1, 0), xr = std::min(x + 1, w - 1);
+            const int dx = (up[xr] + 2 * mid[xr] + dn[xr]) - (up[xl] + 2 * mid[xl] + dn[xl]);
+            const int dy = (dn[xl] + 2 * dn[x] + dn[xr]) - (up[xl] + 2 * up[x] + up[xr]);
+            m[x] = static_cast<int16_t>(std::abs(dx) + std::abs(dy));
+        }
+    }
+
+    const int low = params_.lowThreshold;
+    const int high = params_.highThreshold;
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* up = luma + std::max(y - 1, 0) * lumaStride;
+        const uint8_t* mid = luma + y * lumaStride;
+        const uint8_t* dn = luma + std::min(y + 1, h - 1) * lumaStride;
+        const int16_t* mu = mag_.data() + static_cast<size_t>(std::max(y - 1, 0)) * w;
+        const int16_t* mm = mag_.data() + static_cast<size_t>(y) * w;
+        const int16_t* md = mag_.data() + static_cast<size_t>(std::min(y + 1, h - 1)) * w;
+        uint8_t* c = cls_.data() + static_cast<size_t>(y) * w;
+        for (int x = x0; x < x1; ++x) {
+            const int m = mm[x];
+            if (m <= low) {
+                c[x] = kNone;
+                continue;
+            }
+            const int xl = std::max(x - 1, 0), xr = std::min(x + 1, w - 1);
+            const int dx = (up[xr] + 2 * mid[xr] + dn[xr]) - (up[xl] + 2 * mid[xl] + dn[xl]);
+            const int dy = (dn[xl] + 2 * dn[x] + dn[xr]) - (up[xl] + 2 * up[x] + up[xr]);
+            const int ax = std::abs(dx);
+            const int ay = std::abs(dy) << 15;
+            const int tg22 = ax * kTan22Q15;
+            const int tg67 = tg22 + (ax << 16);
+
+            bool isMax;
+            if (ay < tg22) {
+                isMax = m > mm[xl] && m >= mm[xr];
+            } else if (ay > tg67) {
+                isMax = m > mu[x] && m >= md[x];
+            } else if ((dx ^ dy) < 0) {
+                isMax = m > mu[xr] && m > md[xl];
+            } else {
+                isMax = m > mu[xl] && m > md[xr];
+            }
+            c[x] = !isMax ? kNone : (m > high ? kStrong : kWeak);
+        }
+    }
+}
+
+bool TemporalCanny::wasEdgeNear(int x, int y) const {
+    // Previous edge within one pixel of the motion-compensated position.
+    const int px = x - prevDx_;
+    const int py = y - prevDy_;
+    for (int yy = std::max(py - 1, 0); yy <= std::min(py + 1, height_ - 1); ++yy) {
+        const uint8_t* row = prevEdges_.data() + static_cast<size_t>(yy) * width_;
+        for (int xx = std::max(px - 1, 0); xx <= std::min(px + 1, width_ - 1); ++xx) {
+            if (row[xx]) return true;
+        }
+    }
+    return false;
+}
+
+int TemporalCanny::process(const uint8_t* luma, size_t lumaStride, int width, int height,
+                           uint8_t* edges, size_t edgesStride,
+                           int motionDx, int motionDy) {
+    if (luma == nullptr || edges == nullptr || width <= 0 || height <= 0) return 0;
+
+    const bool havePrev = width == width_ && height == height_ && !prevEdges_.empty();
+    const size_t count = static_cast<size_t>(width) * height;
+    if (!havePrev) {
+        width_ = width;
+        height_ = height;
+        prevLuma_.assign(count, 0);
+        prevEdges_.assign(count, 0);
+    }
+    mag_.resize(count);
+    cls_.resize(count);
+    prevDx_ = motionDx;
+    prevDy_ = motionDy;
+
+    const int tile = params_.tileSize;
+    const int tilesX = (width + tile - 1) / tile;
+    const int tilesY = (height + tile - 1) / tile;
+    tileState_.assign(static_cast<size_t>(tilesX) * tilesY, 1);
+
+    // A moving camera invalidates every tile's reference luma.
+    const bool reuseAllowed = havePrev && motionDx == 0 && motionDy == 0;
+    int recomputed = 0;
+    stack_.clear();
+
+    for (int ty = 0; ty < tilesY; ++ty) {
+        const int y0 = ty * tile, y1 = std::min(y0 + tile, height);
+        for (int tx = 0; tx < tilesX; ++tx) {
+            const int x0 = tx * tile, x1 = std::min(x0 + tile, width);
+            if (reuseAllowed && !tileChanged(luma, lumaStride, x0, y0, x1, y1)) {
+                tileState_[ty * tilesX + tx] = 0;
+                for (int y = y0; y < y1; ++y) {
+                    const uint8_t* prev = prevEdges_.data() + static_cast<size_t>(y) * width + x0;
+                    std::memcpy(cls_.data() + static_cast<size_t>(y) * width + x0, prev, x1 - x0);
+                }
+                continue;
+            }
+            ++recomputed;
+            gradientAndNms(luma, lumaStride, x0, y0, x1, y1);
+        }
+    }
+
+    // Seeds: strong pixels, weak pixels supported by the previous frame, and
+    // edges of reused tiles that touch a recomputed one.
+    for (int ty = 0; ty < tilesY; ++ty) {
+        const int y0 = ty * tile, y1 = std::min(y0 + tile, height);
+        for (int tx = 0; tx < tilesX; ++tx) {
+            const int x0 = tx * tile, x1 = std::min(x0 + tile, width);
+            if (tileState_[ty * tilesX + tx]) {
+                for (int y = y0; y < y1; ++y) {
+                    uint8_t* c = cls_.data() + static_cast<size_t>(y) * width;
+                    for (int x = x0; x < x1; ++x) {
+                        if (c[x] == kStrong || (c[x] == kWeak && havePrev && wasEdgeNear(x, y))) {
+                            c[x] = kEdge;
+                            stack_.push_back(y * width + x);
+                        }
+                    }
+                }
+            } else {
+                for (int y = y0; y < y1; ++y) {
+                    const uint8_t* c = cls_.data() + static_cast<size_t>(y) * width;
+                    const bool borderRow = y == y0 || y == y1 - 1;
+                    for (int x = x0; x < x1; ++x) {
+                        if (c[x] == kEdge && (borderRow || x == x0 || x == x1 - 1)) {
+                            stack_.push_back(y * width + x);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    while (!stack_.empty()) {
+        const int idx = stack_.back();
+        stack_.pop_back();
+        const int y = idx / width;
+        const int x = idx - y * width;
+        for (int yy = std::max(y - 1, 0); yy <= std::min(y + 1, height - 1); ++yy) {
+            uint8_t* row = cls_.data() + static_cast<size_t>(yy) * width;
+            for (int xx = std::max(x - 1, 0); xx <= std::min(x + 1, width - 1); ++xx) {
+                if (row[xx] == kWeak) {
+                    row[xx] = kEdge;
+                    stack_.push_back(yy * width + xx);
+                }
+            }
+        }
+    }
+
+    // Emit, and advance the temporal reference for recomputed tiles only so a
+    // slowly drifting tile is eventually recomputed against its last state.
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* c = cls_.data() + static_cast<size_t>(y) * width;
+        uint8_t* out = edges + y * edgesStride;
+        uint8_t* prev = prevEdges_.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            out[x] = c[x] == kEdge ? 255 : 0;
+        }
+        std::memcpy(prev, out, width);
+
+        const int ty = y / tile;
+        for (int tx = 0; tx < tilesX; ++tx) {
+            if (!tileState_[ty * tilesX + tx]) continue;
+            const int x0 = tx * tile, x1 = std::min(x0 + tile, width);
+            std::memcpy(prevLuma_.data() + static_cast<size_t>(y) * width + x0,
+                        luma + y * lumaStride + x0, x1 - x0);
+        }
+    }
+    return recomputed;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ================= Temporal Canny =================
+// Canny edge detector (3x3 Sobel, L1 magnitude, same thresholds semantics as
+// cv::Canny) that carries state between frames:
+//  - weak edges that were edges in the previous frame (optionally shifted by
+//    a motion estimate) seed the hysteresis, so weak contours stop flickering;
+//  - tiles whose luma has not changed since they were last computed keep
+//    their previous edges and skip gradient, NMS and hysteresis entirely.
+class TemporalCanny {
+public:
+    struct Params {
+        int lowThreshold = 100;
+        int highThreshold = 200;
+        int tileSize = 32;
+        int staticMeanAbsDiff = 2;  // per-pixel mean |dY| below which a tile is reused
+    };
+
+    TemporalCanny() = default;
+    explicit TemporalCanny(const Params& params) : params_(params) {}
+
+    void setParams(const Params& params);
+    const Params& params() const { return params_; }
+
+    // Drop temporal state; the next frame is computed from scratch.
+    void reset();
+
+    // reset() and free every plane; params are kept.
+    void trim();
+
+    // Computes 0/255 edges for `luma`. (motionDx, motionDy) is the global
+    // displacement of the scene since the previous frame in pixels, when a
+    // tracker provides one. Returns the number of tiles recomputed.
+    int process(const uint8_t* luma, size_t lumaStride, int width, int height,
+                uint8_t* edges, size_t edgesStride,
+                int motionDx = 0, int motionDy = 0);
+
+private:
+    bool tileChanged(const uint8_t* luma, size_t lumaStride, int x0, int y0, int x1, int y1) const;
+    void gradientAndNms(const uint8_t* luma, size_t lumaStride, int x0, int y0, int x1, int y1);
+    bool wasEdgeNear(int x, int y) const;
+
+    Params params_;
+    int width_ = 0;
+    int height_ = 0;
+    int prevDx_ = 0;
+    int prevDy_ = 0;
+
+    std::vector<uint8_t> prevLuma_;   // luma at the time each tile was last computed
+    std::vector<uint8_t> prevEdges_;  // previous output, 0 / 255
+    std::vector<int16_t> mag_;        // L1 gradient magnitude scratch
+    std::vector<uint8_t> cls_;        // per-pixel NMS class, see temporal_canny.cpp
+    std::vector<uint8_t> tileState_;  // per-tile: 0 reused, 1 recomputed
+    std::vector<int32_t> stack_;      // hysteresis flood-fill stack (pixel indices)
+};
@@ -0,0 +1,358 @@
+// BayerDecoder on hand-packed RAW10 / RAW16 fixtures and generated patches:
+// unpacking, black / white level and gain normalization, both demosaic
+// methods on flat and edge patches, and luma().
+
+#include "bayer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,     \
+                         __LINE__, #cond);                                  \
+            ++gFailures;                                                    \
+        }                                                                   \
+    } while (0)
+
+// ---- Fixtures: 4x4 frames with padded rows (pad bytes 0xEE must be ignored).
+// They decode with white = black + 4095 and a gain of 16 on every channel, so
+// one sample step is one output step: linear output is sample - black,
+// clipped to 0..255, and every unpacked bit shows.
+
+// BGGR, 5 packed bytes and 3 pad bytes per row; black 64. Samples:
+//    65  130  195  300
+//    70   71   64  317
+//    99  100  101  102
+//    10 1023  255  200
+const uint8_t kRaw10Bggr[] = {
+    0x10, 0x20, 0x30, 0x4B, 0x39, 0xEE, 0xEE, 0xEE,
+    0x11, 0x11, 0x10, 0x4F, 0x4E, 0xEE, 0xEE, 0xEE,
+    0x18, 0x19, 0x19, 0x19, 0x93, 0xEE, 0xEE, 0xEE,
+    0x02, 0xFF, 0x3F, 0x32, 0x3E, 0xEE, 0xEE, 0xEE,
+};
+const uint8_t kRaw10BggrExpected[] = {
+    1, 66, 131, 236,
+    6, 7, 0, 253,
+    35, 36, 37, 38,
+    0, 255, 191, 136,
+};
+
+// GRBG, 8 bytes of little-endian words and 4 pad bytes per row; black 256. Samples:
+//   256   257   511    300
+//     0   255  4351  65535
+//   384  1000   258    510
+//   269   511  2048    400
+const uint8_t kRaw16Grbg[] = {
+    0x00, 0x01, 0x01, 0x01, 0xFF, 0x01, 0x2C, 0x01, 0xEE, 0xEE, 0xEE, 0xEE,
+    0x00, 0x00, 0xFF, 0x00, 0xFF, 0x10, 0xFF, 0xFF, 0xEE, 0xEE, 0xEE, 0xEE,
+    0x80, 0x01, 0xE8, 0x03, 0x02, 0x01, 0xFE, 0x01, 0xEE, 0xEE, 0xEE, 0xEE,
+    0x0D, 0x01, 0xFF, 0x01, 0x00, 0x08, 0x90, 0x01, 0xEE, 0xEE, 0xEE, 0xEE,
+};
+const uint8_t kRaw16GrbgExpected[] = {
+    0, 1, 255, 44,
+    0, 0, 255, 255,
+    128, 255, 2, 254,
+    13, 255, 255, 144,
+};
+
+// Colour (0 R, 1 G, 2 B) at (x, y) for a pattern, as Camera2 orders them.
+int cfaColour(BayerPattern pattern, int x, int y) {
+    static const int kPatterns[4][2][2] = {
+        {{0, 1}, {1, 2}}, {{1, 0}, {2, 1}}, {{1, 2}, {0, 1}}, {{2, 1}, {1, 0}},
+    };
+    return kPatterns[static_cast<int>(pattern)][y & 1][x & 1];
+}
+
+BayerDecoder::Params linearParams(BayerPattern pattern, int black, int white) {
+    BayerDecoder::Params params;
+    params.pattern = pattern;
+    for (int& b : params.blackLevel) b = black;
+    params.whiteLevel = white;
+    params.srgb = false;
+    return params;
+}
+
+// Row-major samples packed as `packing` into rows of `stride` bytes.
+std::vector<uint8_t> pack(const std::vector<int>& samples, int width, int height,
+                          RawPacking packing, size_t stride) {
+    std::vector<uint8_t> bytes(stride * height, 0xEE);
+    for (int y = 0; y < height; ++y) {
+        const int* s = samples.data() + y * width;
+        uint8_t* dst = bytes.data() + y * stride;
+        if (packing == RawPacking::Raw10) {
+            for (int x = 0; x < width; x += 4, dst += 5) {
+                dst[4] = 0;
+                for (int i = 0; i < 4; ++i) {
+                    dst[i] = static_cast<uint8_t>(s[x + i] >> 2);
+                    dst[4] |= static_cast<uint8_t>((s[x + i] & 3) << (2 * i));
+                }
+            }
+        } else {
+            for (int x = 0; x < width; ++x) {
+                dst[2 * x] = static_cast<uint8_t>(s[x] & 0xFF);
+                dst[2 * x + 1] = static_cast<uint8_t>(s[x] >> 8);
+            }
+        }
+    }
+    return bytes;
+}
+
+// Mosaic of a scene given as a per-pixel colour function.
+template <typename Scene>
+std::vector<int> mosaic(BayerPattern pattern, int width, int height, Scene scene) {
+    std::vector<int> samples(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) samples[y * width + x] = scene(x, y, cfaColour(pattern, x, y));
+    }
+    return samples;
+}
+
+void testFixture(const uint8_t* data, size_t stride, RawPacking packing, BayerPattern pattern,
+                 int black, const uint8_t* expected) {
+    BayerDecoder::Params params = linearParams(pattern, black, black + 4095);
+    for (float& gain : params.gains) gain = 16.0f;
+    BayerDecoder decoder;
+    decoder.setParams(params);
+    RawFrame raw;
+    raw.data = data;
+    raw.stride = stride;
+    raw.width = raw.height = 4;
+    raw.packing = packing;
+    for (DemosaicMethod method : {DemosaicMethod::Bilinear, DemosaicMethod::EdgeDirected}) {
+        PlanarImage rgb;
+        CHECK(decoder.demosaic(raw, method, rgb));
+        // Every site keeps its own sample in both methods.
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                CHECK(rgb.plane(cfaColour(pattern, x, y))[y * rgb.stride() + x] == expected[y * 4 + x]);
+            }
+        }
+    }
+}
+
+void testFixtures() {
+    testFixture(kRaw10Bggr, 8, RawPacking::Raw10, BayerPattern::Bggr, 64, kRaw10BggrExpected);
+    testFixture(kRaw16Grbg, 12, RawPacking::Raw16, BayerPattern::Grbg, 256, kRaw16GrbgExpected);
+}
+
+// Flat colour in every pattern and packing, with per-channel gains: both
+// methods reproduce it exactly everywhere, borders included.
+void testFlat() {
+    const int w = 16, h = 12;
+    for (int p = 0; p < 4; ++p) {
+        const BayerPattern pattern = static_cast<BayerPattern>(p);
+        for (RawPacking packing : {RawPacking::Raw10, RawPacking::Raw16}) {
+            const bool raw10 = packing == RawPacking::Raw10;
+            // RAW10 scales by 3 (range 1365), RAW16 by 1 (range 4095); gains are exact too.
+            BayerDecoder::Params params = linearParams(pattern, 0, raw10 ? 1365 : 4095);
+            params.gains[0] = 2.0f;
+            params.gains[3] = 0.5f;
+            const int samples[3] = {raw10 ? 200 : 600, raw10 ? 300 : 900, raw10 ? 1000 : 3000};
+            const double unit = raw10 ? 3.0 : 1.0;
+            const double scale[3] = {2.0 * unit, unit, 0.5 * unit};
+            int expected[3];
+            for (int c = 0; c < 3; ++c) {
+                const int n = static_cast<int>(samples[c] * scale[c]);
+                expected[c] = ((n < 4095 ? n : 4095) + 8) >> 4;
+            }
+
+            const size_t stride = (raw10 ? w / 4 * 5 : w * 2) + 6;
+            const std::vector<uint8_t> bytes = pack(
+                mosaic(pattern, w, h, [&](int, int, int c) { return samples[c]; }), w, h, packing, stride);
+            BayerDecoder decoder;
+            decoder.setParams(params);
+            const RawFrame raw{bytes.data(), stride, w, h, packing};
+            for (DemosaicMethod method : {DemosaicMethod::Bilinear, DemosaicMethod::EdgeDirected}) {
+                PlanarImage rgb;
+                CHECK(decoder.demosaic(raw, method, rgb));
+                bool exact = true;
+                for (int c = 0; c < 3; ++c) {
+                    for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) exact = exact && rgb.plane(c)[y * rgb.stride() + x] == expected[c];
+                    }
+                }
+                CHECK(exact);
+            }
+        }
+    }
+}
+
+// Per-quad black levels and clipping at the white level.
+void testBlackWhite() {
+    const int w = 8, h = 4;
+    BayerDecoder::Params params = linearParams(BayerPattern::Rggb, 0, 1023);
+    const int blacks[4] = {60, 64, 68, 72};
+    for (int i = 0; i < 4; ++i) params.blackLevel[i] = blacks[i];
+    BayerDecoder decoder;
+    decoder.setParams(params);
+
+    // Each quad position at its own black level, then one below it, then saturated.
+    for (int level = 0; level < 3; ++level) {
+        const std::vector<int> samples = mosaic(BayerPattern::Rggb, w, h, [&](int x, int y, int) {
+            const int black = blacks[(y & 1) * 2 + (x & 1)];
+            return level == 0 ? black : level == 1 ? black - 1 : 1023;
+        });
+        const std::vector<uint8_t> bytes = pack(samples, w, h, RawPacking::Raw10, w / 4 * 5);
+        const RawFrame raw{bytes.data(), w / 4 * 5, w, h, RawPacking::Raw10};
+        PlanarImage rgb;
+        CHECK(decoder.demosaic(raw, DemosaicMethod::Bilinear, rgb));
+        const uint8_t expected = level == 2 ? 255 : 0;
+        bool ok = true;
+        for (int c = 0; c < 3; ++c) {
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) ok = ok && rgb.plane(c)[y * rgb.stride() + x] == expected;
+            }
+        }
+        CHECK(ok);
+    }
+}
+
+// A grey step edge, vertical or horizontal. Edge-directed demosaicing
+// interpolates along it and is exact; bilinear is exact two pixels away
+// from it but mixes the sides (false colour) next to it.
+void testEdges() {
+    const int w = 24, h = 16, lo = 300, hi = 3000, edge = 10;
+    for (bool vertical : {true, false}) {
+        for (BayerPattern pattern : {BayerPattern::Rggb, BayerPattern::Gbrg}) {
+            auto bright = [&](int x, int y) { return (vertical ? x : y) >= edge; };
+            const std::vector<uint8_t> bytes = pack(
+                mosaic(pattern, w, h, [&](int x, int y, int) { return bright(x, y) ? hi : lo; }),
+                w, h, RawPacking::Raw16, w * 2);
+            const RawFrame raw{bytes.data(), static_cast<size_t>(w) * 2, w, h, RawPacking::Raw16};
+            BayerDecoder decoder;
+            decoder.setParams(linearParams(pattern, 0, 4095));
+
+            PlanarImage directed, bilinear;
+            CHECK(decoder.demosaic(raw, DemosaicMethod::EdgeDirected, directed));
+            CHECK(decoder.demosaic(raw, DemosaicMethod::Bilinear, bilinear));
+            bool directedExact = true, bilinearFar = true, bilinearMixed = false;
+            for (int c = 0; c < 3; ++c) {
+                for (int y = 0; y < h; ++y) {
+                    for (int x = 0; x < w; ++x) {
+                        const int expected = ((bright(x, y) ? hi : lo) + 8) >> 4;
+                        const int d = vertical ? x - edge : y - edge;
+                        directedExact = directedExact && directed.plane(c)[y * directed.stride() + x] == expected;
+                        const bool exact = bilinear.plane(c)[y * bilinear.stride() + x] == expected;
+                        if (d < -1 || d > 0) bilinearFar = bilinearFar && exact;
+                        bilinearMixed = bilinearMixed || !exact;
+                    }
+                }
+            }
+            CHECK(directedExact);
+            CHECK(bilinearFar);
+            CHECK(bilinearMixed);
+        }
+    }
+}
+
+// luma() is (R + 2G + B) / 4 on flat colour, and goes through the same tone
+// curve as the demosaiced planes.
+void testLuma() {
+    const int w = 20, h = 8;
+    const int samples[3] = {400, 1200, 2800};
+    for (BayerPattern pattern : {BayerPattern::Rggb, BayerPattern::Bggr}) {
+        const std::vector<uint8_t> bytes = pack(
+            mosaic(pattern, w, h, [&](int, int, int c) { return samples[c]; }), w, h, RawPacking::Raw16, w * 2 + 4);
+        const RawFrame raw{bytes.data(), static_cast<size_t>(w) * 2 + 4, w, h, RawPacking::Raw16};
+        BayerDecoder decoder;
+        decoder.setParams(linearParams(pattern, 0, 4095));
+        std::vector<uint8_t> luma(static_cast<size_t>(w + 3) * h, 0xEE);
+        CHECK(decoder.luma(raw, luma.data(), w + 3));
+        const int expected = ((samples[0] + 2 * samples[1] + samples[2]) / 4 + 8) >> 4;
+        bool ok = true;
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) ok = ok && luma[y * (w + 3) + x] == expected;
+            for (int x = w; x < w + 3; ++x) ok = ok && luma[y * (w + 3) + x] == 0xEE;
+        }
+        CHECK(ok);
+    }
+
+    // sRGB: flat grey luma matches the demosaiced grey.
+    const int w2 = 8, h2 = 4;
+    const std::vector<uint8_t> bytes = pack(
+        mosaic(BayerPattern::Grbg, w2, h2, [](int, int, int) { return 1000; }), w2, h2, RawPacking::Raw16, w2 * 2);
+    const RawFrame raw{bytes.data(), static_cast<size_t>(w2) * 2, w2, h2, RawPacking::Raw16};
+    BayerDecoder decoder;
+    BayerDecoder::Params params = linearParams(BayerPattern::Grbg, 0, 4095);
+    params.srgb = true;
+    decoder.setParams(params);
+    std::vector<uint8_t> luma(static_cast<size_t>(w2) * h2);
+    PlanarImage rgb;
+    CHECK(decoder.luma(raw, luma.data(), w2));
+    CHECK(decoder.demosaic(raw, DemosaicMethod::Bilinear, rgb));
+    CHECK(luma[0] == rgb.plane(1)[0] && luma[0] > (1000 >> 4));  // sRGB lifts mid-tones
+}
+
+// Frames of different sizes through one decoder reuse its scratch; results
+// must not depend on what was decoded before.
+void testReuse() {
+    auto frame = [](int w, int h) {
+        return pack(mosaic(BayerPattern::Rggb, w, h, [](int x, int y, int c) { return (x * 37 + y * 91 + c * 500) % 4096; }),
+                    w, h, RawPacking::Raw16, static_cast<size_t>(w) * 2);
+    };
+    const std::vector<uint8_t> big = frame(64, 48);
+    const std::vector<uint8_t> small = frame(8, 4);
+    const RawFrame bigRaw{big.data(), 128, 64, 48, RawPacking::Raw16};
+    const RawFrame smallRaw{small.data(), 16, 8, 4, RawPacking::Raw16};
+    for (DemosaicMethod method : {DemosaicMethod::Bilinear, DemosaicMethod::EdgeDirected}) {
+        BayerDecoder decoder;
+        PlanarImage first, smallOut, again;
+        std::vector<uint8_t> lumaFirst(64 * 48), lumaAgain(64 * 48);
+        CHECK(decoder.demosaic(bigRaw, method, first));
+        CHECK(decoder.luma(bigRaw, lumaFirst.data(), 64));
+        CHECK(decoder.demosaic(smallRaw, method, smallOut));
+        decoder.trim();
+        CHECK(decoder.luma(smallRaw, lumaAgain.data(), 8));
+        CHECK(decoder.demosaic(bigRaw, method, again));
+        CHECK(decoder.luma(bigRaw, lumaAgain.data(), 64));
+        bool same = lumaFirst == lumaAgain;
+        for (int c = 0; c < 3; ++c) {
+            for (int y = 0; y < 48; ++y) {
+                for (int x = 0; x < 64; ++x) {
+                    same = same && first.plane(c)[y * first.stride() + x] == again.plane(c)[y * again.stride() + x];
+                }
+            }
+        }
+        CHECK(same);
+    }
+}
+
+void testInvalid() {
+    BayerDecoder decoder;
+    std::vector<uint8_t> bytes(64 * 8, 0);
+    PlanarImage rgb;
+    uint8_t luma[64 * 8];
+    CHECK(!decoder.demosaic(RawFrame{nullptr, 16, 8, 4, RawPacking::Raw16}, DemosaicMethod::Bilinear, rgb));
+    CHECK(!decoder.demosaic(RawFrame{bytes.data(), 16, 7, 4, RawPacking::Raw16}, DemosaicMethod::Bilinear, rgb));
+    CHECK(!decoder.demosaic(RawFrame{bytes.data(), 16, 8, 5, RawPacking::Raw16}, DemosaicMethod::Bilinear, rgb));
+    CHECK(!decoder.demosaic(RawFrame{bytes.data(), 16, 6, 4, RawPacking::Raw10}, DemosaicMethod::Bilinear, rgb));
+    CHECK(!decoder.demosaic(RawFrame{bytes.data(), 15, 8, 4, RawPacking::Raw16}, DemosaicMethod::Bilinear, rgb));
+    CHECK(!decoder.demosaic(RawFrame{bytes.data(), 9, 8, 4, RawPacking::Raw10}, DemosaicMethod::Bilinear, rgb));
+    CHECK(!decoder.luma(RawFrame{bytes.data(), 16, 8, 4, RawPacking::Raw16}, nullptr, 8));
+    CHECK(decoder.luma(RawFrame{bytes.data(), 10, 8, 4, RawPacking::Raw10}, luma, 8));
+}
+
+}  // namespace
+
+int main() {
+    testFixtures();
+    testFlat();
+    testBlackWhite();
+    testEdges();
+    testLuma();
+    testReuse();
+    testInvalid();
+    if (gFailures != 0) {
+        std::fprintf(stderr, "bayer_test: %d check(s) failed\n", gFailures);
+        return EXIT_FAILURE;
+    }
+    std::printf("bayer_test: ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+// Drives the file and synthetic frame sources through the session's
+// OpenCV-free stages (block motion, temporal Canny, dirty-rect present),
+// the way the native source runner and the benchmark feed runPipeline.
+
+#include "frame_source.h"
+#include "session.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,     \
+                         __LINE__, #cond);                                  \
+            ++gFailures;                                                    \
+        }                                                                   \
+    } while (0)
+
+// What one run of a source produced, as seen from its callback.
+struct RunResult {
+    int frames = 0;
+    int edgePixels = 0;         // over all frames
+    int firstPresentRects = 0;  // dirty rects of the first frame
+    bool layoutOk = true;       // every view was planar I420 of the source's size
+    bool timestampsOk = true;   // non-decreasing
+    std::vector<uint8_t> firstY, firstU, firstV;  // first pixel of each plane, per frame
+};
+
+// Runs `source` until it has delivered `frames` frames (or ends on its own)
+// and stops it; each frame goes through `session` as runPipeline would.
+RunResult runSource(FrameSource& source, ProcessingSession& session, int frames) {
+    const int w = source.width();
+    const int h = source.height();
+    const size_t stride = static_cast<size_t>(w) * 4;
+    std::vector<uint8_t> presented(stride * h);
+    session.output.invalidate();
+
+    RunResult result;
+    std::mutex mutex;
+    std::condition_variable done;
+    int64_t lastNs = -1;
+    const bool started = source.start([&](const FrameView& frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result.frames >= frames) return;
+        result.layoutOk = result.layoutOk && frame.width == w && frame.height == h &&
+                          frame.yStride == static_cast<size_t>(w) && frame.u != nullptr &&
+                          frame.v != nullptr && frame.chromaPixelStride == 1 &&
+                          frame.chromaStride == static_cast<size_t>(w / 2);
+        result.timestampsOk = result.timestampsOk && frame.timestampNs >= lastNs;
+        lastNs = frame.timestampNs;
+        result.firstY.push_back(frame.y[0]);
+        result.firstU.push_back(frame.u[0]);
+        result.firstV.push_back(frame.v[0]);
+
+        int dx = 0, dy = 0;
+        if (session.blockMatcher.process(frame.y, frame.yStride, w, h)) {
+            session.blockMatcher.medianVector(dx, dy);
+        }
+        session.edges.reset(PlanarFormat::Gray, w, h);
+        session.temporal.process(frame.y, frame.yStride, w, h,
+                                 session.edges.plane(0), session.edges.stride(), -dx, -dy);
+        for (int y = 0; y < h; ++y) {
+            const uint8_t* row = session.edges.plane(0) + y * session.edges.stride();
+            for (int x = 0; x < w; ++x) result.edgePixels += row[x] != 0;
+        }
+        const int rects = session.output.present(session.edges, w, h, presented.data(), stride,
+                                                 session.dirtyRects);
+        if (result.frames == 0) result.firstPresentRects = rects;
+        if (++result.frames == frames) done.notify_one();
+    });
+    if (started) {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait_for(lock, std::chrono::seconds(2), [&] { return result.frames >= frames; });
+    }
+    source.stop();
+    if (!started) result.frames = -1;
+    return result;
+}
+
+// Writes `frames` NV12 (or gray) frames whose planes are flat: frame i has
+// luma 10 + i, U 100 + i and V 200 + i.
+std::string writeFrames(int width, int height, int frames, bool nv12) {
+    char path[] = "/tmp/flam_frame_source_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) return std::string();
+    const size_t luma = static_cast<size_t>(width) * height;
+    const size_t chroma = static_cast<size_t>(width / 2) * (height / 2);
+    std::vector<uint8_t> frame(luma + (nv12 ? 2 * chroma : 0));
+    bool ok = true;
+    for (int i = 0; i < frames; ++i) {
+        std::fill(frame.begin(), frame.begin() + luma, static_cast<uint8_t>(10 + i));
+        for (size_t c = 0; nv12 && c < chroma; ++c) {
+            frame[luma + 2 * c] = static_cast<uint8_t>(100 + i);
+            frame[luma + 2 * c + 1] = static_cast<uint8_t>(200 + i);
+        }
+        ok = ok && write(fd, frame.data(), frame.size()) == static_cast<ssize_t>(frame.size());
+    }
+    close(fd);
+    return ok ? std::string(path) : std::string();
+}
+
+void testSynthetic() {
+    ProcessingSession session;
+    session.width = 160;
+    session.height = 120;
+    SyntheticFrameSource source(160, 120, 0.0, 8);
+
+    const RunResult first = runSource(source, session, 8);
+    CHECK(first.frames == 8);
+    CHECK(first.layoutOk);
+    CHECK(first.timestampsOk);
+    CHECK(first.edgePixels > 0);
+    CHECK(first.firstPresentRects > 0);
+
+    // The worker has run out of frames on its own; starting again must join
+    // it rather than overwrite a joinable thread.
+    const RunResult second = runSource(source, session, 8);
+    CHECK(second.frames == 8);
+    CHECK(second.firstY == first.firstY);
+}
+
+void testFile() {
+    const int w = 64, h = 48;
+    const std::string nv12 = writeFrames(w, h, 3, true);
+    CHECK(!nv12.empty());
+    ProcessingSession session;
+
+    {
+        FileFrameSource source(nv12, FileFrameSource::Format::NV12, w, h);
+        const RunResult run = runSource(source, session, 10);
+        CHECK(run.frames == 3);  // ends with the file
+        CHECK(run.layoutOk);
+        for (int i = 0; i < run.frames; ++i) {
+            CHECK(run.firstY[i] == 10 + i);
+            CHECK(run.firstU[i] == 100 + i);
+            CHECK(run.firstV[i] == 200 + i);
+        }
+    }
+    {
+        FileFrameSource source(nv12, FileFrameSource::Format::NV12, w, h, 0.0, true, 7);
+        const RunResult run = runSource(source, session, 7);
+        CHECK(run.frames == 7);
+        for (int i = 0; i < run.frames; ++i) CHECK(run.firstY[i] == 10 + i % 3);
+    }
+    std::remove(nv12.c_str());
+
+    const std::string gray = writeFrames(w, h, 2, false);
+    CHECK(!gray.empty());
+    {
+        FileFrameSource source(gray, FileFrameSource::Format::Gray8, w, h);
+        const RunResult run = runSource(source, session, 2);
+        CHECK(run.frames == 2);
+        for (int i = 0; i < run.frames; ++i) {
+            CHECK(run.firstY[i] == 10 + i);
+            CHECK(run.firstU[i] == 128 && run.firstV[i] == 128);
+        }
+    }
+    std::remove(gray.c_str());
+
+    FileFrameSource missing("/nonexistent/frames.nv12", FileFrameSource::Format::NV12, w, h);
+    CHECK(runSource(missing, session, 1).frames == -1);
+}
+
+}  // namespace
+
+int main() {
+    testSynthetic();
+    testFile();
+    if (gFailures != 0) {
+        std::fprintf(stderr, "frame_source_test: %d check(s) failed\n", gFailures);
+        return EXIT_FAILURE;
+    }
+    std::printf("frame_source_test: ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+// Runs the MJPEG preview server on a loopback port with a stub encoder and
+// talks HTTP to it the way a browser would: the multipart stream, the
+// snapshot, unknown paths, the client limit and the fps cap.
+
+#include "mjpeg_server.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,     \
+                         __LINE__, #cond);                                  \
+            ++gFailures;                                                    \
+        }                                                                   \
+    } while (0)
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr size_t kStubJpegBytes = 9;
+
+// Stands in for the JPEG encoder: SOI, the frame's size, channels and first
+// two pixels, EOI. Counts its calls.
+MjpegServer::Encoder stubEncoder(std::atomic<int>& calls) {
+    return [&calls](const uint8_t* pixels, size_t, int channels, int width, int height, int,
+                    std::vector<uint8_t>& jpeg) {
+        calls.fetch_add(1);
+        jpeg = {0xFF, 0xD8, static_cast<uint8_t>(width), static_cast<uint8_t>(height),
+                static_cast<uint8_t>(channels), pixels[0], pixels[1], 0xFF, 0xD9};
+        return true;
+    };
+}
+
+bool isStubJpeg(const std::string& body) {
+    return body.size() == kStubJpegBytes && static_cast<uint8_t>(body[0]) == 0xFF &&
+           static_cast<uint8_t>(body[1]) == 0xD8 && body[2] == kWidth && body[3] == kHeight && body[4] == 1 &&
+           static_cast<uint8_t>(body[7]) == 0xFF && static_cast<uint8_t>(body[8]) == 0xD9;
+}
+
+// Submits gray frames, as the frame path does, every couple of
+// milliseconds until destroyed; the first two pixels count frames.
+class Submitter {
+public:
+    explicit Submitter(MjpegServer& server)
+        : thread_([this, &server] {
+              std::vector<uint8_t> frame(static_cast<size_t>(kWidth) * kHeight);
+              for (uint16_t n = 0; !stop_; ++n) {
+                  frame[0] = static_cast<uint8_t>(n);
+                  frame[1] = static_cast<uint8_t>(n >> 8);
+                  server.submit(frame.data(), kWidth, 1, kWidth, kHeight);
+                  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+              }
+          }) {}
+    ~Submitter() {
+        stop_ = true;
+        thread_.join();
+    }
+
+private:
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+// Connects to the server and sends a GET for `path`; -1 on failure.
+int get(int port, const char* path) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char request[256];
+    std::snprintf(request, sizeof(request), "GET %s HTTP/1.0\r\n\r\n", path);
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        send(fd, request, std::strlen(request), MSG_NOSIGNAL) != static_cast<ssize_t>(std::strlen(request))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Everything the server sends on `fd` until it closes or `limit` passes.
+std::string readFor(int fd, std::chrono::milliseconds limit) {
+    std::string data;
+    const Clock::time_point deadline = Clock::now() + limit;
+    char buffer[4096];
+    for (;;) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0) break;
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, static_cast<int>(left.count())) <= 0) break;
+        const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        data.append(buffer, static_cast<size_t>(n));
+    }
+    return data;
+}
+
+std::string status(const std::string& response) {
+    return response.substr(0, response.find("\r\n"));
+}
+
+void testRoutes() {
+    std::atomic<int> encodes{0};
+    MjpegServer server;
+    MjpegServer::Options options;
+    options.port = 0;
+    CHECK(server.start(options, stubEncoder(encodes)));
+    CHECK(server.port() > 0);
+    Submitter submitter(server);
+
+    int fd = get(server.port(), "/nope");
+    CHECK(fd >= 0);
+    CHECK(status(readFor(fd, std::chrono::seconds(3))) == "HTTP/1.0 404 Not Found");
+    close(fd);
+
+    fd = get(server.port(), "/snapshot.jpg");
+    CHECK(fd >= 0);
+    const std::string snapshot = readFor(fd, std::chrono::seconds(3));
+    close(fd);
+    CHECK(status(snapshot) == "HTTP/1.0 200 OK");
+    CHECK(snapshot.find("Content-Type: image/jpeg\r\n") != std::string::npos);
+    CHECK(snapshot.find("Content-Length: 9\r\n") != std::string::npos);
+    const size_t body = snapshot.find("\r\n\r\n");
+    CHECK(body != std::string::npos && isStubJpeg(snapshot.substr(body + 4)));
+    server.stop();
+}
+
+void testClientLimit() {
+    std::atomic<int> encodes{0};
+    MjpegServer server;
+    MjpegServer::Options options;
+    options.port = 0;
+    options.maxClients = 1;
+    CHECK(server.start(options, stubEncoder(encodes)));
+
+    // The stream holds the only slot until it disconnects.
+    const int stream = get(server.port(), "/");
+    CHECK(stream >= 0);
+    CHECK(status(readFor(stream, std::chrono::milliseconds(200))) == "HTTP/1.0 200 OK");
+    const int refused = get(server.port(), "/snapshot.jpg");
+    CHECK(refused >= 0);
+    CHECK(status(readFor(refused, std::chrono::seconds(3))) == "HTTP/1.0 503 Service Unavailable");
+    close(refused);
+    close(stream);
+    server.stop();
+}
+
+void testStream() {
+    std::atomic<int> encodes{0};
+    MjpegServer server;
+    MjpegServer::Options options;
+    options.port = 0;
+    options.maxFps = 5;
+    CHECK(server.start(options, stubEncoder(encodes)));
+
+    const int fd = get(server.port(), "/");
+    CHECK(fd >= 0);
+    std::string stream;
+    const Clock::time_point start = Clock::now();
+    {
+        Submitter submitter(server);
+        stream = readFor(fd, std::chrono::milliseconds(1500));
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    close(fd);
+    server.stop();
+
+    CHECK(status(stream) == "HTTP/1.0 200 OK");
+    CHECK(stream.find("Content-Type: multipart/x-mixed-replace; boundary=flamframe\r\n") != std::string::npos);
+
+    // Every part is a complete stub frame, each newer than the last.
+    int parts = 0;
+    int lastPixel = -1;
+    bool partsOk = true;
+    const std::string boundary = "--flamframe\r\nContent-Type: image/jpeg\r\nContent-Length: ";
+    for (size_t pos = stream.find(boundary); pos != std::string::npos; pos = stream.find(boundary, pos)) {
+        pos += boundary.size();
+        const size_t length = std::strtoul(stream.c_str() + pos, nullptr, 10);
+        const size_t body = stream.find("\r\n\r\n", pos);
+        if (body == std::string::npos || body + 4 + length + 2 > stream.size()) break;  // cut off by the deadline
+        const std::string jpeg = stream.substr(body + 4, length);
+        const int pixel = jpeg.size() == kStubJpegBytes
+                              ? static_cast<uint8_t>(jpeg[5]) | static_cast<uint8_t>(jpeg[6]) << 8 : -1;
+        partsOk = partsOk && length == kStubJpegBytes && isStubJpeg(jpeg) && pixel != lastPixel &&
+                  stream.compare(body + 4 + length, 2, "\r\n") == 0;
+        lastPixel = pixel;
+        pos = body + 4 + length;
+        ++parts;
+    }
+    CHECK(partsOk);
+    CHECK(parts >= 2);
+
+    // submit() drops frames above maxFps before they reach the encoder, and
+    // the client is sent no more than it encodes; allow one frame of slack
+    // for the window edges.
+    const int cap = static_cast<int>(seconds * options.maxFps) + 1;
+    CHECK(encodes.load() <= cap);
+    CHECK(parts <= encodes.load());
+}
+
+}  // namespace
+
+int main() {
+    testRoutes();
+    testClientLimit();
+    testStream();
+    if (gFailures != 0) {
+        std::fprintf(stderr, "mjpeg_server_test: %d check(s) failed\n", gFailures);
+        return EXIT_FAILURE;
+    }
+    std::printf("mjpeg_server_test: ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+// Runs simdSelfCheck() over several seeds: every simd::Ops operation and
+// every kernel in simd_kernels.h, Native against Scalar, bit for bit. CMake
+// builds it once per backend the host can run (see CMakeLists.txt).
+
+#include "simd_check.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+int main() {
+    constexpr unsigned kSeeds = 16;
+    int failures = 0;
+    const char* isa = "";
+    for (unsigned seed = 1; seed <= kSeeds; ++seed) {
+        const SimdCheckResult result = simdSelfCheck(seed);
+        isa = result.isa;
+        if (result.failures != 0) {
+            std::fprintf(stderr, "seed %u: %s\n", seed, result.report.c_str());
+            failures += result.failures;
+        }
+    }
+    if (failures != 0) {
+        std::fprintf(stderr, "simd_check_test (%s): %d check(s) failed\n", isa, failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("simd_check_test (%s): ok\n", isa);
+    return EXIT_SUCCESS;
+}
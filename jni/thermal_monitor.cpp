@@ -0,0 +1,200 @@
+#include "thermal_monitor.h"
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits>
+#include <unistd.h>
+
+static constexpr int kMaxCores = 32;
+
+static int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// sysfs attributes regenerate their text on every read at offset 0.
+static bool readNumber(int fd, double& value) {
+    char buf[32];
+    const ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    char* end = nullptr;
+    value = std::strtod(buf, &end);
+    return end != buf;
+}
+
+static bool readLine(const std::string& path, std::string& line) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    char buf[64];
+    const ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return false;
+    line.assign(buf, static_cast<size_t>(n));
+    while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) line.pop_back();
+    return true;
+}
+
+// Label values end up inside quotes in the exposition text.
+static std::string labelSafe(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                        c == '_' || c == '-' || c == '.';
+        out += ok ? c : '_';
+    }
+    return out;
+}
+
+void ThermalMonitor::discover() {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    if (DIR* dir = opendir("/sys/class/thermal")) {
+        while (dirent* entry = readdir(dir)) {
+            if (std::strncmp(entry->d_name, "thermal_zone", 12) != 0) continue;
+            const std::string base = std::string("/sys/class/thermal/") + entry->d_name;
+            Source zone;
+            zone.fd = open((base + "/temp").c_str(), O_RDONLY | O_CLOEXEC);
+            double probe = 0.0;
+            if (zone.fd < 0 || !readNumber(zone.fd, probe)) {
+                if (zone.fd >= 0) close(zone.fd);
+                continue;
+            }
+            std::string type;
+            if (!readLine(base + "/type", type)) type = "unknown";
+            zone.gauge = &registry.gauge("flam_thermal_celsius", "Thermal zone temperature",
+                                         "zone=\"" + std::string(entry->d_name) + "\",type=\"" + labelSafe(type) + "\"");
+            zone.gauge->set(nan);
+            zones_.push_back(zone);
+        }
+        closedir(dir);
+    }
+
+    for (int cpu = 0; cpu < kMaxCores; ++cpu) {
+        char base[64];
+        std::snprintf(base, sizeof(base), "/sys/devices/system/cpu/cpu%d/cpufreq", cpu);
+        std::string maxFreq;
+        if (!readLine(std::string(base) + "/cpuinfo_max_freq", maxFreq)) continue;
+        Source core;
+        core.fd = open((std::string(base) + "/scaling_cur_freq").c_str(), O_RDONLY | O_CLOEXEC);
+        if (core.fd < 0) continue;
+        core.maxFreqHz = std::strtof(maxFreq.c_str(), nullptr) * 1000.0f;
+        const std::string label = "cpu=\"" + std::to_string(cpu) + "\"";
+        core.gauge = &registry.gauge("flam_cpu_freq_hz", "Current CPU core frequency", label);
+        core.gauge->set(nan);
+        registry.gauge("flam_cpu_max_freq_hz", "Maximum CPU core frequency", label).set(core.maxFreqHz);
+        cores_.push_back(core);
+    }
+
+    maxTemp_ = &registry.gauge("flam_thermal_max_celsius", "Hottest readable thermal zone");
+    minFreqRatio_ = &registry.gauge("flam_cpu_freq_min_ratio",
+                                    "Lowest current / maximum frequency over online cores");
+}
+
+ThermalMonitor::~ThermalMonitor() {
+    stop();
+    for (const Source& zone : zones_) close(zone.fd);
+    for (const Source& core : cores_) close(core.fd);
+}
+
+bool ThermalMonitor::start(int periodMs, const Histogram* frameSeconds) {
+    if (running() || periodMs <= 0) return false;
+    if (zones_.empty() && cores_.empty()) discover();
+    frameSeconds_ = frameSeconds;
+    lastFrames_ = frameSeconds != nullptr ? frameSeconds->count() : 0;
+    lastFrameSum_ = frameSeconds != nullptr ? frameSeconds->sum() : 0.0;
+    lastNs_ = steadyNs();
+    periodMs_ = periodMs;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        history_.assign(kHistory, TelemetrySample());
+        next_ = 0;
+        stop_ = false;
+    }
+    thread_ = std::thread(&ThermalMonitor::run, this);
+    return true;
+}
+
+void ThermalMonitor::stop() {
+    if (!thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+void ThermalMonitor::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, std::chrono::milliseconds(periodMs_), [this] { return stop_; })) {
+        lock.unlock();
+        sample();
+        lock.lock();
+    }
+}
+
+void ThermalMonitor::sample() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    TelemetrySample s;
+    s.timestampNs = steadyNs();
+
+    s.maxTempC = nan;
+    for (const Source& zone : zones_) {
+        double raw = 0.0;
+        if (!readNumber(zone.fd, raw)) continue;
+        // Most zones report millidegrees; a few drivers report degrees.
+        const double celsius = std::fabs(raw) >= 500.0 ? raw / 1000.0 : raw;
+        zone.gauge->set(celsius);
+        if (std::isnan(s.maxTempC) || celsius > s.maxTempC) s.maxTempC = static_cast<float>(celsius);
+    }
+
+    s.minFreqRatio = nan;
+    for (const Source& core : cores_) {
+        double khz = 0.0;
+        if (!readNumber(core.fd, khz)) {  // offline core
+            core.gauge->set(nan);
+            continue;
+        }
+        core.gauge->set(khz * 1000.0);
+        if (core.maxFreqHz <= 0.0f) continue;
+        const float ratio = static_cast<float>(khz * 1000.0 / core.maxFreqHz);
+        if (std::isnan(s.minFreqRatio) || ratio < s.minFreqRatio) s.minFreqRatio = ratio;
+    }
+    maxTemp_->set(s.maxTempC);
+    minFreqRatio_->set(s.minFreqRatio);
+
+    if (frameSeconds_ != nullptr) {
+        const uint64_t frames = frameSeconds_->count();
+        const double sum = frameSeconds_->sum();
+        const uint64_t dFrames = frames - lastFrames_;
+        const double seconds = (s.timestampNs - lastNs_) * 1e-9;
+        if (seconds > 0.0) s.fps = static_cast<float>(dFrames / seconds);
+        if (dFrames > 0) s.meanFrameMs = static_cast<float>((sum - lastFrameSum_) * 1000.0 / dFrames);
+        lastFrames_ = frames;
+        lastFrameSum_ = sum;
+    }
+    lastNs_ = s.timestampNs;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    history_[next_ % kHistory] = s;
+    ++next_;
+}
+
+size_t ThermalMonitor::recent(TelemetrySample* out, size_t max) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t available = std::min(next_, std::min(max, kHistory));
+    for (size_t i = 0; i < available; ++i) {
+        out[i] = history_[(next_ - available + i) % kHistory];
+    }
+    return available;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Gauge;
+class Histogram;
+
+// One telemetry period. Device state and pipeline throughput cover the same
+// window, so a throughput drop can be read against the temperature and clock
+// it happened at.
+struct TelemetrySample {
+    int64_t timestampNs = 0;   // steady clock, end of the period
+    float maxTempC = 0.0f;     // hottest readable thermal zone (NaN if none)
+    float minFreqRatio = 0.0f; // lowest scaling_cur_freq / cpuinfo_max_freq over online cores (NaN if none)
+    float fps = 0.0f;          // pipeline frames per second over the period
+    float meanFrameMs = 0.0f;  // mean pipeline latency over the period (0 without frames)
+};
+
+// ================= Thermal / Frequency Telemetry =================
+// Low-rate sampler of /sys/class/thermal zones and per-core cpufreq on its own
+// thread. Each period it updates per-zone and per-core gauges in the metrics
+// registry, plus max-temperature / min-frequency-ratio summaries, and appends a
+// TelemetrySample (with the pipeline's frame count and latency over the same
+// period, taken from `frameSeconds`) to a ring of recent history.
+// Files are opened once and re-read with pread(); zones the process may not
+// read (SELinux denies some on recent releases) are skipped.
+class ThermalMonitor {
+public:
+    static constexpr size_t kHistory = 600;  // 10 minutes at the default period
+
+    ThermalMonitor() = default;
+    ~ThermalMonitor();
+
+    ThermalMonitor(const ThermalMonitor&) = delete;
+    ThermalMonitor& operator=(const ThermalMonitor&) = delete;
+
+    bool start(int periodMs, const Histogram* frameSeconds);
+    void stop();
+    bool running() const { return thread_.joinable(); }
+
+    // Copies up to `max` of the most recent samples, oldest first.
+    size_t recent(TelemetrySample* out, size_t max) const;
+
+private:
+    struct Source {
+        int fd = -1;
+        float maxFreqHz = 0.0f;  // cores only
+        Gauge* gauge = nullptr;
+    };
+
+    void discover();
+    void run();
+    void sample();
+
+    std::vector<Source> zones_;
+    std::vector<Source> cores_;
+    Gauge* maxTemp_ = nullptr;
+    Gauge* minFreqRatio_ = nullptr;
+    const Histogram* frameSeconds_ = nullptr;
+    uint64_t lastFrames_ = 0;
+    double lastFrameSum_ = 0.0;
+    int64_t lastNs_ = 0;
+    int periodMs_ = 1000;
+
+    mutable std::mutex mutex_;  // history_, stop_
+    std::condition_variable wake_;
+    std::vector<TelemetrySample> history_;
+    size_t next_ = 0;
+    bool stop_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,111 @@
+#include "thinning.h"
+#include "band_pool.h"
+
+#include <atomic>
+#include <utility>
+
+// Adds one bit-plane to a bit-sliced 4-bit counter (s0 = LSB).
+static inline void addBit(uint64_t b, uint64_t& s0, uint64_t& s1, uint64_t& s2, uint64_t& s3) {
+    const uint64_t c0 = s0 & b;
+    s0 ^= b;
+    const uint64_t c1 = s1 & c0;
+    s1 ^= c0;
+    const uint64_t c2 = s2 & c1;
+    s2 ^= c1;
+    s3 |= c2;
+}
+
+static inline uint64_t westOf(const uint64_t* r, int k) { return (r[k] << 1) | (r[k - 1] >> 63); }
+static inline uint64_t eastOf(const uint64_t* r, int k) { return (r[k] >> 1) | (r[k + 1] << 63); }
+
+// One Zhang-Suen sub-iteration over rows [y0, y1). Returns true if any pixel
+// was deleted.
+static bool thinRows(const BitMask& src, BitMask& dst, int y0, int y1, bool secondPass) {
+    uint64_t anyDeleted = 0;
+    for (int y = y0; y < y1; ++y) {
+        const uint64_t* up = src.row(y - 1);
+        const uint64_t* mid = src.row(y);
+        const uint64_t* dn = src.row(y + 1);
+        uint64_t* out = dst.row(y);
+        for (int k = 0; k < src.wordsPerRow; ++k) {
+            const uint64_t c = mid[k];
+            if (c == 0) {
+                out[k] = 0;
+                continue;
+            }
+            // Neighbours in Zhang-Suen order: P2 = N, then clockwise.
+            const uint64_t p2 = up[k];
+            const uint64_t p3 = eastOf(up, k);
+            const uint64_t p4 = eastOf(mid, k);
+            const uint64_t p5 = eastOf(dn, k);
+            const uint64_t p6 = dn[k];
+            const uint64_t p7 = westOf(dn, k);
+            const uint64_t p8 = westOf(mid, k);
+            const uint64_t p9 = westOf(up, k);
+
+            // B(P1): number of set neighbours, must be in [2, 6].
+            uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            addBit(p2, s0, s1, s2, s3);
+            addBit(p3, s0, s1, s2, s3);
+            addBit(p4, s0, s1, s2, s3);
+            addBit(p5, s0, s1, s2, s3);
+            addBit(p6, s0, s1, s2, s3);
+            addBit(p7, s0, s1, s2, s3);
+            addBit(p8, s0, s1, s2, s3);
+            addBit(p9, s0, s1, s2, s3);
+            const uint64_t atLeast2 = s1 | s2 | s3;
+            const uint64_t atMost6 = ~(s3 | (s2 & s1 & s0));
+
+            // A(P1): exactly one 0 -> 1 transition around the ring.
+            const uint64_t ring[9] = {p2, p3, p4, p5, p6, p7, p8, p9, p2};
+            uint64_t one = 0, two = 0;
+            for (int i = 0; i < 8; ++i) {
+                const uint64_t t = ~ring[i] & ring[i + 1];
+                two |= one & t;
+                one |= t;
+            }
+            const uint64_t singleTransition = one & ~two;
+
+            const uint64_t directional = secondPass
+                ? ~(p2 & p4 & p8) & ~(p2 & p6 & p8)
+                : ~(p2 & p4 & p6) & ~(p4 & p6 & p8);
+
+            const uint64_t del = c & atLeast2 & atMost6 & singleTransition & directional;
+            out[k] = c & ~del;
+            anyDeleted |= del;
+        }
+    }
+    return anyDeleted != 0;
+}
+
+int thinZhangSuen(BitMask& mask, BitMask& scratch, int maxIterations) {
+    if (mask.width <= 0 || mask.height <= 0) return 0;
+    if (scratch.width != mask.width || scratch.height != mask.height) {
+        scratch.reset(mask.width, mask.height);
+    }
+
+    // Bands smaller than this spend more time synchronizing than thinning.
+    static constexpr int kMinBandRows = 32;
+
+    BitMask* src = &mask;
+    BitMask* dst = &scratch;
+    int iterations = 0;
+    while (iterations < maxIterations) {
+        bool changed = false;
+        for (int pass = 0; pass < 2; ++pass) {
+            std::atomic<bool> passChanged{false};
+            BandPool::instance().run(src->height, kMinBandRows, [&](int y0, int y1) {
+                if (thinRows(*src, *dst, y0, y1, pass == 1)) {
+                    passChanged.store(true, std::memory_order_relaxed);
+                }
+            });
+            std::swap(src, dst);
+            changed = changed || passChanged.load();
+        }
+        ++iterations;
+        if (!changed) break;
+    }
+    // Both sub-passes run every iteration, so the swaps always pair up and
+    // the result is already back in `mask`.
+    return iterations;
+}
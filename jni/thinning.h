@@ -0,0 +1,17 @@
+#pragma once
+
+#include "bit_mask.h"
+
+// ================= Skeletonization =================
+// Zhang-Suen thinning on bit-packed masks. Each sub-iteration evaluates the
+// deletion rule for 64 pixels at once with bit-sliced neighbour arithmetic,
+// and rows are split into bands on the BandPool; the two masks are swapped
+// between sub-iterations so bands only ever read the previous state.
+
+static constexpr int kDefaultThinningIterations = 32;
+
+// Thins `mask` in place, stopping at convergence or after maxIterations full
+// (two sub-pass) iterations. `scratch` is reused working storage. Returns the
+// number of iterations run.
+int thinZhangSuen(BitMask& mask, BitMask& scratch,
+                  int maxIterations = kDefaultThinningIterations);
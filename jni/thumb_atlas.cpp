@@ -0,0 +1,196 @@
+#include "thumb_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void resampleThumbnail(const uint8_t* src, size_t srcStride, int srcChannels, int width, int height,
+                       uint8_t* dst, int dstChannels, int dstWidth, int dstHeight,
+                       std::vector<uint32_t>& scratch) {
+    // Largest centred crop with the thumbnail's aspect ratio.
+    int cropW = width, cropH = height;
+    if (static_cast<int64_t>(width) * dstHeight > static_cast<int64_t>(height) * dstWidth) {
+        cropW = static_cast<int>(static_cast<int64_t>(height) * dstWidth / dstHeight);
+    } else {
+        cropH = static_cast<int>(static_cast<int64_t>(width) * dstHeight / dstWidth);
+    }
+    const int cx = (width - cropW) / 2;
+    const int cy = (height - cropH) / 2;
+
+    // Column spans [x0, x1) of each thumbnail column, then the channel sums
+    // of one thumbnail row.
+    const size_t columns = static_cast<size_t>(dstWidth);
+    scratch.resize(columns * (2 + srcChannels));
+    uint32_t* x0s = scratch.data();
+    uint32_t* x1s = x0s + columns;
+    uint32_t* sums = x1s + columns;
+    for (int tx = 0; tx < dstWidth; ++tx) {
+        const int x0 = cx + tx * cropW / dstWidth;
+        x0s[tx] = static_cast<uint32_t>(x0);
+        x1s[tx] = static_cast<uint32_t>(std::max(cx + (tx + 1) * cropW / dstWidth, x0 + 1));
+    }
+
+    for (int ty = 0; ty < dstHeight; ++ty) {
+        const int y0 = cy + ty * cropH / dstHeight;
+        const int y1 = std::max(cy + (ty + 1) * cropH / dstHeight, y0 + 1);
+        std::fill(sums, sums + columns * srcChannels, 0u);
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* row = src + y * srcStride;
+            for (int tx = 0; tx < dstWidth; ++tx) {
+                uint32_t* s = sums + tx * srcChannels;
+                for (uint32_t x = x0s[tx]; x < x1s[tx]; ++x) {
+                    for (int c = 0; c < srcChannels; ++c) s[c] += row[x * srcChannels + c];
+                }
+            }
+        }
+        uint8_t* out = dst + static_cast<size_t>(ty) * dstWidth * dstChannels;
+        for (int tx = 0; tx < dstWidth; ++tx) {
+            const uint32_t n = (x1s[tx] - x0s[tx]) * static_cast<uint32_t>(y1 - y0);
+            const uint32_t* s = sums + tx * srcChannels;
+            uint8_t v[4];
+            for (int c = 0; c < srcChannels; ++c) v[c] = static_cast<uint8_t>((s[c] + n / 2) / n);
+            uint8_t* o = out + tx * dstChannels;
+            if (dstChannels == srcChannels) {
+                std::memcpy(o, v, dstChannels);
+            } else if (dstChannels == 1) {
+                o[0] = static_cast<uint8_t>((77 * v[0] + 150 * v[1] + 29 * v[2] + 128) >> 8);
+            } else {
+                o[0] = o[1] = o[2] = v[0];
+                o[3] = 255;
+            }
+        }
+    }
+}
+
+// Header page: magic, version, width, height, channels, count.
+static constexpr uint32_t kAtlasMagic = 0x41485446;  // "FTHA"
+static constexpr uint32_t kAtlasVersion = 1;
+static constexpr size_t kCountOffset = 5 * sizeof(uint32_t);
+static constexpr size_t kSlotHeaderBytes = 16;  // int64 id, padded for SIMD-friendly pixels
+
+bool ThumbnailAtlas::open(const std::string& path, const Format& format) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (format.width <= 0 || format.height <= 0 || (format.channels != 1 && format.channels != 4)) return false;
+
+    format_ = format;
+    pageBytes_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    slotBytes_ = kSlotHeaderBytes + thumbnailBytes();
+    segmentBytes_ = (slotBytes_ * kSlotsPerSegment + pageBytes_ - 1) / pageBytes_ * pageBytes_;
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+
+    uint32_t header[6] = {};
+    const ssize_t got = ::pread(fd, header, sizeof(header), 0);
+    if (got == 0) {
+        const uint32_t fresh[6] = {kAtlasMagic, kAtlasVersion, static_cast<uint32_t>(format.width),
+                                   static_cast<uint32_t>(format.height), static_cast<uint32_t>(format.channels), 0};
+        if (::ftruncate(fd, static_cast<off_t>(pageBytes_)) != 0 ||
+            ::pwrite(fd, fresh, sizeof(fresh), 0) != static_cast<ssize_t>(sizeof(fresh))) {
+            ::close(fd);
+            return false;
+        }
+    } else if (got != static_cast<ssize_t>(sizeof(header)) || header[0] != kAtlasMagic ||
+               header[1] != kAtlasVersion || header[2] != static_cast<uint32_t>(format.width) ||
+               header[3] != static_cast<uint32_t>(format.height) ||
+               header[4] != static_cast<uint32_t>(format.channels)) {
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    count_ = header[5];
+
+    // Map the segments the committed thumbnails live in and index their ids.
+    while (segments_.size() * kSlotsPerSegment < count_) {
+        if (!mapSegment()) {
+            count_ = static_cast<uint32_t>(segments_.size() * kSlotsPerSegment);
+            break;
+        }
+    }
+    for (uint32_t i = 0; i < count_; ++i) {
+        int64_t id;
+        std::memcpy(&id, slot(static_cast<int>(i)), sizeof(id));
+        byId_[id] = static_cast<int>(i);
+    }
+    return true;
+}
+
+void ThumbnailAtlas::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint8_t* segment : segments_) munmap(segment, segmentBytes_);
+    segments_.clear();
+    byId_.clear();
+    count_ = 0;
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool ThumbnailAtlas::mapSegment() {
+    const off_t offset = static_cast<off_t>(pageBytes_ + segments_.size() * segmentBytes_);
+    const off_t end = offset + static_cast<off_t>(segmentBytes_);
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || (st.st_size < end && ::ftruncate(fd_, end) != 0)) return false;
+    void* p = mmap(nullptr, segmentBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset);
+    if (p == MAP_FAILED) return false;
+    segments_.push_back(static_cast<uint8_t*>(p));
+    return true;
+}
+
+uint8_t* ThumbnailAtlas::slot(int index) const {
+    return segments_[index / kSlotsPerSegment] + static_cast<size_t>(index % kSlotsPerSegment) * slotBytes_;
+}
+
+bool ThumbnailAtlas::writeCount(uint32_t count) {
+    return ::pwrite(fd_, &count, sizeof(count), kCountOffset) == static_cast<ssize_t>(sizeof(count));
+}
+
+int ThumbnailAtlas::append(int64_t id, const uint8_t* pixels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0 || pixels == nullptr) return -1;
+    if (count_ == segments_.size() * kSlotsPerSegment && !mapSegment()) return -1;
+
+    const int index = static_cast<int>(count_);
+    uint8_t* s = slot(index);
+    std::memcpy(s, &id, sizeof(id));
+    std::memcpy(s + kSlotHeaderBytes, pixels, thumbnailBytes());
+    // Slot contents must reach the file before the count that publishes them.
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(s) & ~(static_cast<uintptr_t>(pageBytes_) - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(s) + slotBytes_;
+    if (msync(reinterpret_cast<void*>(begin), end - begin, MS_SYNC) != 0 || !writeCount(count_ + 1)) {
+        return -1;
+    }
+    ++count_;
+    byId_[id] = index;
+    return index;
+}
+
+int ThumbnailAtlas::count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(count_);
+}
+
+int ThumbnailAtlas::find(int64_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byId_.find(id);
+    return it == byId_.end() ? -1 : it->second;
+}
+
+int64_t ThumbnailAtlas::idAt(int index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < 0 || static_cast<uint32_t>(index) >= count_) return -1;
+    int64_t id;
+    std::memcpy(&id, slot(index), sizeof(id));
+    return id;
+}
+
+const uint8_t* ThumbnailAtlas::pixels(int index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < 0 || static_cast<uint32_t>(index) >= count_) return nullptr;
+    return slot(index) + kSlotHeaderBytes;
+}
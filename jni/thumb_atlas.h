@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ================= Thumbnail Atlas =================
+
+// Centre-crops src to the thumbnail's aspect ratio and box-averages it down
+// to dstWidth x dstHeight (tightly packed). Channels may be 1 or 4 on either
+// side; RGBA -> gray uses BT.601 weights. `scratch` holds the column spans
+// and row sums, and keeps its capacity for the next call.
+void resampleThumbnail(const uint8_t* src, size_t srcStride, int srcChannels, int width, int height,
+                       uint8_t* dst, int dstChannels, int dstWidth, int dstHeight,
+                       std::vector<uint32_t>& scratch);
+
+// Append-only file of fixed-size thumbnails, memory-mapped so readers get
+// pointers straight into the page cache. The file is a header page followed
+// by segments of kSlotsPerSegment slots; each segment is mapped separately
+// and never remapped, so pointers stay valid until close(). A slot is an id
+// followed by the pixels; the header count is bumped only after the slot is
+// written, so a torn append is simply overwritten by the next one.
+class ThumbnailAtlas {
+public:
+    static constexpr int kSlotsPerSegment = 64;
+
+    struct Format {
+        int width = 128;
+        int height = 128;
+        int channels = 1;  // 1 (gray) or 4 (RGBA)
+    };
+
+    ThumbnailAtlas() = default;
+    ~ThumbnailAtlas() { close(); }
+
+    ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+    ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+    // Opens or creates the atlas. An existing file must have the same format.
+    bool open(const std::string& path, const Format& format);
+    void close();
+
+    const Format& format() const { return format_; }
+    size_t thumbnailBytes() const {
+        return static_cast<size_t>(format_.width) * format_.height * format_.channels;
+    }
+
+    // Appends a tightly packed thumbnail; returns its index or -1.
+    int append(int64_t id, const uint8_t* pixels);
+
+    int count() const;
+    int find(int64_t id) const;  // index of the latest thumbnail with this id, or -1
+    int64_t idAt(int index) const;
+
+    // Mapped pixels of thumbnail `index`, valid until close().
+    const uint8_t* pixels(int index) const;
+
+private:
+    uint8_t* slot(int index) const;
+    bool mapSegment();
+    bool writeCount(uint32_t count);
+
+    Format format_;
+    size_t slotBytes_ = 0;
+    size_t segmentBytes_ = 0;
+    size_t pageBytes_ = 0;
+    int fd_ = -1;
+    std::vector<uint8_t*> segments_;
+    uint32_t count_ = 0;
+    std::unordered_map<int64_t, int> byId_;
+    mutable std::mutex mutex_;
+};
@@ -0,0 +1,46 @@
+#include "yuv_pack.h"
+
+#include "band_pool.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool packToYuv420(const uint8_t* src, size_t srcStride, int channels, int width, int height,
+                  YuvLayout layout, const YuvPlanes& dst) {
+    if (src == nullptr || width <= 0 || height <= 0 || (channels != 1 && channels != 4)) return false;
+    if (dst.y == nullptr || dst.u == nullptr || (layout == YuvLayout::I420 && dst.v == nullptr)) return false;
+
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    const bool nv12 = layout == YuvLayout::NV12;
+    const size_t vStride = nv12 ? dst.uStride : dst.vStride;
+
+    BandPool::instance().run(chromaHeight, 16, [&](int cy0, int cy1) {
+        for (int cy = cy0; cy < cy1; ++cy) {
+            const int y0 = cy * 2;
+            const int y1 = std::min(y0 + 1, height - 1);
+            const uint8_t* row0 = src + srcStride * y0;
+            const uint8_t* row1 = src + srcStride * y1;
+            uint8_t* u = dst.u + dst.uStride * cy;
+            uint8_t* v = nv12 ? u + 1 : dst.v + vStride * cy;
+
+            if (channels == 1) {
+                kernels::grayLumaRow<simd::Native>(row0, dst.y + dst.yStride * y0, width);
+                if (y1 != y0) kernels::grayLumaRow<simd::Native>(row1, dst.y + dst.yStride * y1, width);
+                // The chroma weights sum to zero, so gray input has U = V = 128.
+                if (nv12) {
+                    std::memset(u, 128, static_cast<size_t>(chromaWidth) * 2);
+                } else {
+                    std::memset(u, 128, static_cast<size_t>(chromaWidth));
+                    std::memset(v, 128, static_cast<size_t>(chromaWidth));
+                }
+            } else {
+                kernels::rgbaLumaRow<simd::Native>(row0, dst.y + dst.yStride * y0, width);
+                if (y1 != y0) kernels::rgbaLumaRow<simd::Native>(row1, dst.y + dst.yStride * y1, width);
+                kernels::rgbaChromaRow<simd::Native>(row0, row1, u, v, nv12 ? 2 : 1, width);
+            }
+        }
+    });
+    return true;
+}
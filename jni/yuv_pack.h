@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ================= YUV 4:2:0 Packing =================
+// Converts processed gray (1 ch) or RGBA (4 ch) frames back to the 4:2:0
+// layouts video encoders take: BT.601 limited range, chroma from the 2x2
+// average of each block's RGB. Odd widths / heights replicate the last
+// column / row into the final chroma sample. Runs band-parallel over chroma
+// rows with the row kernels of simd_kernels.h.
+enum class YuvLayout {
+    I420,  // Y plane, U plane, V plane
+    NV12   // Y plane, interleaved UV plane (u / uStride); v is unused
+};
+
+// Destination planes, supplied by the caller (e.g. a MediaCodec input image);
+// strides are in bytes. Chroma planes are (width + 1) / 2 x (height + 1) / 2
+// samples.
+struct YuvPlanes {
+    uint8_t* y = nullptr;
+    size_t yStride = 0;
+    uint8_t* u = nullptr;
+    size_t uStride = 0;
+    uint8_t* v = nullptr;
+    size_t vStride = 0;
+};
+
+// Returns false for unsupported channel counts or missing planes.
+bool packToYuv420(const uint8_t* src, size_t srcStride, int channels, int width, int height,
+                  YuvLayout layout, const YuvPlanes& dst);